@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+
+#include "helpers/dBaseUtils.hpp"
+#include "helpers/dBaseNumeric.hpp"
+
+/// <summary>
+/// How the generated values are distributed.
+/// </summary>
+enum class BenchDistribution
+{
+    Uniform,
+    Zipf,
+    Sequential,
+};
+
+/// <summary>
+/// Settings of a synthetic DBASE file.
+/// </summary>
+struct BenchDataset
+{
+    std::vector<DBase3FieldDescriptor> Fields;
+    size_t Rows = 1000000;
+    double DeletedRatio = 0.05;
+    BenchDistribution Distribution = BenchDistribution::Uniform;
+
+    /// <summary>
+    /// Number of distinct values per field for uniform and zipf distributions.
+    /// </summary>
+    size_t Cardinality = 10000;
+    unsigned Seed = 42;
+};
+
+namespace BenchGenerator
+{
+    constexpr auto DEFAULT_SCHEMA = "NAME:C:24,CITY:C:16,AMOUNT:N:12:2,PRICE:N:10:3,QTY:N:6,DATE:D:8,ACTIVE:L:1";
+
+    /// <summary>
+    /// Parse a schema like "NAME:C:24,AMOUNT:N:12:2,DATE:D:8".
+    /// </summary>
+    /// <returns>The field descriptors, empty if the schema is invalid.</returns>
+    static std::vector<DBase3FieldDescriptor> ParseSchema(const std::string& schema) noexcept
+    {
+        std::vector<DBase3FieldDescriptor> fields;
+        std::stringstream fieldStream(schema);
+        std::string field;
+
+        while (std::getline(fieldStream, field, ','))
+        {
+            std::vector<std::string> parts;
+            std::stringstream partStream(field);
+            std::string part;
+
+            while (std::getline(partStream, part, ':')) parts.push_back(part);
+            if (parts.size() < 3 || parts[1].size() != 1) return {};
+
+            const auto length = (size_t)std::atoi(parts[2].c_str());
+            const auto decimals = parts.size() > 3 ? (size_t)std::atoi(parts[3].c_str()) : 0;
+            if (length == 0 || length > 254) return {};
+
+            fields.push_back(DBaseUtils::MakeField(parts[0], parts[1][0], length, decimals));
+        }
+
+        return fields;
+    }
+
+    static BenchDistribution ParseDistribution(const std::string& name) noexcept
+    {
+        if (name == "zipf") return BenchDistribution::Zipf;
+        if (name == "sequential") return BenchDistribution::Sequential;
+        return BenchDistribution::Uniform;
+    }
+
+    /// <summary>
+    /// Draws value ids according to the distribution.
+    /// </summary>
+    class ValueSource
+    {
+        std::mt19937_64 Rng;
+        BenchDistribution Distribution;
+        size_t Cardinality;
+        std::vector<double> ZipfCdf;
+
+    public:
+        ValueSource(const BenchDataset& dataset)
+            : Rng(dataset.Seed),
+            Distribution(dataset.Distribution),
+            Cardinality(std::max<size_t>(1, dataset.Cardinality)),
+            ZipfCdf()
+        {
+            if (Distribution == BenchDistribution::Zipf)
+            {
+                ZipfCdf.resize(Cardinality);
+                double sum = 0.0;
+
+                for (size_t i = 0; i < Cardinality; ++i)
+                {
+                    sum += 1.0 / (double)(i + 1);
+                    ZipfCdf[i] = sum;
+                }
+
+                for (auto& c : ZipfCdf) c /= sum;
+            }
+        }
+
+        std::mt19937_64& Random() noexcept { return Rng; }
+
+        size_t Next(size_t row) noexcept
+        {
+            switch (Distribution)
+            {
+            case BenchDistribution::Sequential:
+                return row;
+
+            case BenchDistribution::Zipf:
+            {
+                const auto u = std::uniform_real_distribution<double>(0.0, 1.0)(Rng);
+                return (size_t)(std::lower_bound(ZipfCdf.begin(), ZipfCdf.end(), u) - ZipfCdf.begin());
+            }
+
+            default:
+                return (size_t)(Rng() % Cardinality);
+            }
+        }
+    };
+
+    /// <summary>
+    /// Write a value derived from the id into a field.
+    /// </summary>
+    static void FillField(char* data, const DBase3FieldDescriptor& field, size_t id) noexcept
+    {
+        const auto size = (size_t)(unsigned char)field.Lenght;
+
+        switch (field.FieldType)
+        {
+        case 'N':
+        case 'F':
+        {
+            const auto limit = std::pow(10.0, (double)std::min<size_t>(size - (field.Decimals ? field.Decimals + 1 : 0) - 1, 15));
+            const auto value = std::fmod((double)id * 7.31, limit) - limit / 2.0;
+
+            if (field.Decimals) DBaseNumeric::FormatFloat(data, size, value, field.Decimals);
+            else DBaseNumeric::FormatInt(data, size, (long long)value);
+            break;
+        }
+
+        case 'D':
+        {
+            const auto day = id % 28 + 1;
+            const auto month = (id / 28) % 12 + 1;
+            const auto year = 1990 + (id / 336) % 40;
+            DBaseNumeric::FormatInt(data, size, (long long)(year * 10000 + month * 100 + day));
+            break;
+        }
+
+        case 'L':
+            memset(data, ' ', size);
+            *data = id % 2 ? 'T' : 'F';
+            break;
+
+        default:
+        {
+            // readable text of varying length so trimming has something to do
+            const auto text = "VALUE" + std::to_string(id) + std::string(id % 7, 'X');
+            memset(data, ' ', size);
+            memcpy(data, text.data(), std::min(size, text.size()));
+            break;
+        }
+        }
+    }
+
+    /// <summary>
+    /// Write a synthetic DBASE file.
+    /// </summary>
+    /// <returns>True if the file was written, false if not.</returns>
+    static bool Generate(const std::filesystem::path& file, const BenchDataset& dataset) noexcept
+    {
+        constexpr size_t BUFFER_SIZE = 4 * 1024 * 1024;
+
+        std::ofstream stream(file, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        if (!stream) return false;
+
+        std::vector<char> header(DBaseUtils::HeaderSize(dataset.Fields.size()));
+        const auto recordSize = DBaseUtils::WriteHeader(header.data(), dataset.Fields, dataset.Rows);
+        stream.write(header.data(), header.size());
+
+        ValueSource values(dataset);
+        std::bernoulli_distribution deleted(dataset.DeletedRatio);
+
+        std::vector<char> buffer;
+        buffer.reserve(BUFFER_SIZE + recordSize);
+
+        for (size_t row = 0; row < dataset.Rows; ++row)
+        {
+            const auto offset = buffer.size();
+            buffer.resize(offset + recordSize);
+
+            auto record = buffer.data() + offset;
+            *record++ = deleted(values.Random()) ? '*' : ' ';
+
+            for (const auto& field : dataset.Fields)
+            {
+                FillField(record, field, values.Next(row));
+                record += (unsigned char)field.Lenght;
+            }
+
+            if (buffer.size() >= BUFFER_SIZE)
+            {
+                stream.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+
+        buffer.push_back(0x1A);
+        stream.write(buffer.data(), buffer.size());
+        return stream.good();
+    }
+}
@@ -0,0 +1,327 @@
+#include <ctime>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+#include "dllmain.hpp"
+#include "generator.hpp"
+
+/// <summary>
+/// Timing of a single benchmark.
+/// </summary>
+struct BenchResult
+{
+    std::string Name;
+    size_t Rows;
+    size_t Bytes;
+    double Median;
+    double Min;
+};
+
+/// <summary>
+/// Runs benchmarks and collects their results.
+/// </summary>
+class BenchRunner
+{
+public:
+    size_t Iterations;
+    std::string Filter;
+    std::vector<BenchResult> Results;
+
+    BenchRunner(size_t iterations, std::string filter)
+        : Iterations(std::max<size_t>(1, iterations)),
+        Filter(std::move(filter)),
+        Results()
+    {}
+
+    /// <summary>
+    /// Time fn, the median and the fastest iteration are reported.
+    /// </summary>
+    /// <param name="name">Name of the benchmark.</param>
+    /// <param name="rows">Rows processed per iteration.</param>
+    /// <param name="bytes">Bytes processed per iteration.</param>
+    /// <param name="fn">Function to time, setup should happen outside of it.</param>
+    template<typename Fn>
+    void Run(const std::string& name, size_t rows, size_t bytes, Fn&& fn)
+    {
+        if (!Filter.empty() && name.find(Filter) == std::string::npos) return;
+
+        std::vector<double> times;
+
+        for (size_t i = 0; i < Iterations; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            fn();
+            times.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        std::sort(times.begin(), times.end());
+        Results.push_back({ name, rows, bytes, times[times.size() / 2], times.front() });
+
+        const auto& r = Results.back();
+        printf("%-28s %10.3f ms %14.0f rows/s %8.3f GB/s\n", name.c_str(), r.Median * 1000.0, r.Rows / r.Median, r.Bytes / r.Median / 1e9);
+    }
+
+    /// <summary>
+    /// Write the results as JSON.
+    /// </summary>
+    bool Write(const std::filesystem::path& file, const BenchDataset& dataset, const std::string& schema) const
+    {
+        std::ofstream out(file, std::ofstream::out | std::ofstream::trunc);
+
+        out << "{\n";
+        out << "  \"timestamp\": " << std::time(nullptr) << ",\n";
+        out << "  \"rows\": " << dataset.Rows << ",\n";
+        out << "  \"deleted_ratio\": " << dataset.DeletedRatio << ",\n";
+        out << "  \"schema\": \"" << schema << "\",\n";
+        out << "  \"iterations\": " << Iterations << ",\n";
+        out << "  \"threads\": " << DBaseParallel::Concurrency() << ",\n";
+        out << "  \"results\": [\n";
+
+        for (size_t i = 0; i < Results.size(); ++i)
+        {
+            const auto& r = Results[i];
+
+            out << "    { \"name\": \"" << r.Name << "\""
+                << ", \"rows\": " << r.Rows
+                << ", \"bytes\": " << r.Bytes
+                << ", \"median_s\": " << r.Median
+                << ", \"min_s\": " << r.Min
+                << ", \"rows_per_s\": " << r.Rows / r.Median
+                << ", \"gb_per_s\": " << r.Bytes / r.Median / 1e9
+                << " }" << (i + 1 < Results.size() ? "," : "") << "\n";
+        }
+
+        out << "  ]\n}\n";
+        return out.good();
+    }
+};
+
+// results of getters are written here so the loops are not optimized away
+static volatile double BenchSink = 0.0;
+
+static const DBaseHandle* FirstOfType(const DBase* dbase, char type, bool decimals) noexcept
+{
+    for (const auto& name : dbase->Fields())
+    {
+        const auto handle = dbase->Select(name);
+        if (handle->Type() == type && (type != 'N' || (handle->Decimals() > 0) == decimals)) return handle;
+    }
+
+    return nullptr;
+}
+
+static void RunHandleBenchmarks(BenchRunner& runner, DBase* dbase) noexcept
+{
+    const auto rows = dbase->RecordCount();
+    const auto text = FirstOfType(dbase, 'C', false);
+    const auto real = FirstOfType(dbase, 'N', true);
+    const auto integer = FirstOfType(dbase, 'N', false);
+    const auto date = FirstOfType(dbase, 'D', false);
+
+    if (text)
+    {
+        const auto size = text->Size();
+        const auto bytes = rows * size;
+        const std::string value = "Hello from dbaselib!";
+        const std::string_view view = value;
+        std::vector<char> raw(size, 'X');
+
+        runner.Run("Handle::Data", rows, bytes, [&]() { size_t s = 0; for (size_t i = 0; i < rows; ++i) s += *text->Data(i); BenchSink = (double)s; });
+        runner.Run("Handle::GetText", rows, bytes, [&]() { size_t s = 0; for (size_t i = 0; i < rows; ++i) s += text->GetText(i).find_last_not_of(' '); BenchSink = (double)s; });
+        runner.Run("Handle::SetText(char*)", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) text->SetText(i, value.c_str()); });
+        runner.Run("Handle::SetText(string)", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) text->SetText(i, value); });
+        runner.Run("Handle::SetText(view)", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) text->SetText(i, view); });
+        runner.Run("Handle::SetChar", rows, rows, [&]() { for (size_t i = 0; i < rows; ++i) text->SetChar(i, 'H'); });
+        runner.Run("Handle::CopyRaw", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) text->CopyRaw(i, raw.data(), size / 2); });
+        runner.Run("Handle::CopyRRaw", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) text->CopyRRaw(i, raw.data(), size / 2); });
+        runner.Run("Handle::Copy", rows, bytes, [&]() { for (size_t i = 1; i < rows; ++i) text->Copy(i, text, i - 1); });
+        runner.Run("Handle::CopyR", rows, bytes, [&]() { for (size_t i = 1; i < rows; ++i) text->CopyR(i, text, i - 1); });
+        runner.Run("Handle::Insert", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) text->Insert(i, 1, "ab", 2); });
+        runner.Run("Handle::ReplaceText", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) text->ReplaceText(i, "lo", "LO"); });
+        runner.Run("Handle::Clear", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) text->Clear(i); });
+    }
+
+    if (real)
+    {
+        const auto bytes = rows * real->Size();
+
+        runner.Run("Handle::GetFloat", rows, bytes, [&]() { double s = 0; for (size_t i = 0; i < rows; ++i) s += real->GetFloat(i); BenchSink = s; });
+        runner.Run("Handle::SetFloat", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) real->SetFloat(i, (float)i * 0.25f); });
+    }
+
+    if (integer)
+    {
+        const auto bytes = rows * integer->Size();
+
+        runner.Run("Handle::GetInt", rows, bytes, [&]() { long long s = 0; for (size_t i = 0; i < rows; ++i) s += integer->GetInt(i); BenchSink = (double)s; });
+        runner.Run("Handle::SetInt", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) integer->SetInt(i, (int)(i % 10000)); });
+    }
+
+    if (date)
+    {
+        const auto bytes = rows * date->Size();
+
+        tm t{};
+        t.tm_mday = 24;
+        t.tm_mon = 11;
+        t.tm_year = 121;
+
+        runner.Run("Handle::SetDate(tm)", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) date->SetDate(i, t); });
+        runner.Run("Handle::SetDate(d,m,y)", rows, bytes, [&]() { for (size_t i = 0; i < rows; ++i) date->SetDate(i, 24, 12, 2021); });
+    }
+}
+
+static void RunBulkBenchmarks(BenchRunner& runner, const std::filesystem::path& file) noexcept
+{
+    // the exports work on the library wide dbase, load it through the C ABI as the host does
+    if (!Load(file.string().c_str())) return;
+
+    const auto probe = DBaseUtils::FromFile(file);
+    probe->Load();
+
+    const auto rows = probe->RecordCount();
+    const auto text = FirstOfType(probe, 'C', false);
+    const auto real = FirstOfType(probe, 'N', true);
+    const DBaseHandle* text2 = nullptr;
+
+    for (const auto& name : probe->Fields())
+    {
+        const auto handle = probe->Select(name);
+        if (handle->Type() == 'C' && handle != text) text2 = handle;
+    }
+
+    if (text && text2)
+    {
+        runner.Run("ReplaceColumns", rows, rows * text->Size(), [&]() { ReplaceColumns(text->Name(), text2->Name()); });
+    }
+
+    if (real)
+    {
+        runner.Run("AddPercent", rows, rows * real->Size(), [&]() { AddPercent(real->Name(), 1.5f); });
+    }
+
+    if (text)
+    {
+        runner.Run("InsertText", rows, rows * text->Size(), [&]() { InsertText(text->Name(), 0, "PRE"); });
+    }
+
+    if (DBaseUtils::Find(probe, "DATE"))
+    {
+        runner.Run("SetDate", rows, rows * probe->Select("DATE")->Size(), [&]() { SetDate(24, 12, 2021); });
+    }
+
+    delete probe;
+    Unload();
+}
+
+static void PrintUsage() noexcept
+{
+    printf("usage: dbasebench [options]\n");
+    printf("  --rows N            rows to generate (default 1000000)\n");
+    printf("  --schema SPEC       fields as NAME:TYPE:LEN[:DEC],... (default %s)\n", BenchGenerator::DEFAULT_SCHEMA);
+    printf("  --deleted RATIO     ratio of deleted rows (default 0.05)\n");
+    printf("  --dist NAME         uniform, zipf or sequential (default uniform)\n");
+    printf("  --cardinality N     distinct values per field (default 10000)\n");
+    printf("  --seed N            random seed (default 42)\n");
+    printf("  --iterations N      iterations per benchmark (default 5)\n");
+    printf("  --filter TEXT       only run benchmarks containing TEXT\n");
+    printf("  --file PATH         generated file (default dbasebench.dbf in the temp directory)\n");
+    printf("  --out PATH          write the results as JSON\n");
+    printf("  --keep              keep the generated file\n");
+}
+
+int main(int argc, char** argv)
+{
+    BenchDataset dataset;
+    std::string schema = BenchGenerator::DEFAULT_SCHEMA;
+    std::string filter;
+    std::filesystem::path file = std::filesystem::temp_directory_path() / "dbasebench.dbf";
+    std::filesystem::path out;
+    size_t iterations = 5;
+    bool keep = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto next = [&]() { return i + 1 < argc ? std::string(argv[++i]) : std::string(); };
+
+        if (arg == "--rows") dataset.Rows = std::stoull(next());
+        else if (arg == "--schema") schema = next();
+        else if (arg == "--deleted") dataset.DeletedRatio = std::stod(next());
+        else if (arg == "--dist") dataset.Distribution = BenchGenerator::ParseDistribution(next());
+        else if (arg == "--cardinality") dataset.Cardinality = std::stoull(next());
+        else if (arg == "--seed") dataset.Seed = (unsigned)std::stoul(next());
+        else if (arg == "--iterations") iterations = std::stoull(next());
+        else if (arg == "--filter") filter = next();
+        else if (arg == "--file") file = next();
+        else if (arg == "--out") out = next();
+        else if (arg == "--keep") keep = true;
+        else
+        {
+            PrintUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    dataset.Fields = BenchGenerator::ParseSchema(schema);
+
+    if (dataset.Fields.empty())
+    {
+        fprintf(stderr, "invalid schema: %s\n", schema.c_str());
+        return 1;
+    }
+
+    if (!BenchGenerator::Generate(file, dataset))
+    {
+        fprintf(stderr, "failed to write %s\n", file.string().c_str());
+        return 1;
+    }
+
+    const auto fileSize = (size_t)std::filesystem::file_size(file);
+    printf("%s: %zu rows, %zu bytes, %zu threads\n\n", file.string().c_str(), dataset.Rows, fileSize, DBaseParallel::Concurrency());
+
+    BenchRunner runner(iterations, filter);
+    const auto savePath = std::filesystem::path(file).replace_extension(".out.dbf");
+
+    runner.Run("FromFile", dataset.Rows, fileSize, [&]() { delete DBaseUtils::FromFile(file); });
+
+    {
+        std::vector<DBase*> loaded;
+        for (size_t i = 0; i < runner.Iterations; ++i) loaded.push_back(DBaseUtils::FromFile(file));
+
+        size_t next = 0;
+        runner.Run("Load", dataset.Rows, fileSize, [&]() { loaded[next++ % loaded.size()]->Load(); });
+
+        for (const auto dbase : loaded) delete dbase;
+    }
+
+    {
+        const auto dbase = DBaseUtils::FromFile(file);
+        dbase->Load();
+
+        runner.Run("Save", dataset.Rows, fileSize, [&]() { dbase->Save(savePath); });
+        RunHandleBenchmarks(runner, dbase);
+
+        delete dbase;
+    }
+
+    RunBulkBenchmarks(runner, file);
+
+    std::error_code ec;
+    std::filesystem::remove(savePath, ec);
+    if (!keep) std::filesystem::remove(file, ec);
+
+    if (!out.empty() && !runner.Write(out, dataset, schema))
+    {
+        fprintf(stderr, "failed to write %s\n", out.string().c_str());
+        return 1;
+    }
+
+    return 0;
+}
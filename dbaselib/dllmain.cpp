@@ -1,27 +1,322 @@
 #include "dllmain.hpp"
 
-bool __stdcall Load(const char* dbfFilePath) noexcept
+bool DBASELIB_CALL Load(const char* dbfFilePath) noexcept
 {
+    FreeTable();
+
     dbase = DBaseUtils::FromFile(dbfFilePath);
     return dbase && dbase->Load();
 }
 
-void __stdcall Save(const char* dbfFilePath) noexcept
+void DBASELIB_CALL Save(const char* dbfFilePath) noexcept
 {
     dbase->Save(dbfFilePath);
 }
 
-void __stdcall Unload() noexcept
+void DBASELIB_CALL Unload() noexcept
+{
+    FreeTable();
+
+    delete groupResult;
+    groupResult = nullptr;
+}
+
+long long DBASELIB_CALL SaveAs(const char* dbfFilePath, const char** cols, int count, DBaseRowPredicate predicate, void* context) noexcept
+{
+    const std::vector<std::string> fields(cols, cols + std::max(count, 0));
+    if (!predicate) return (long long)DBaseSlice::SaveAs(dbase, dbfFilePath, fields);
+
+    return (long long)DBaseSlice::SaveAs(dbase, dbfFilePath, fields, [&](size_t row) { return predicate((int)row, context); });
+}
+
+int DBASELIB_CALL PartitionBy(const char* directory, const char* col, const char** cols, int count, int buckets, int maxOpenFiles) noexcept
+{
+    DBasePartitionOptions options;
+    options.Buckets = (size_t)std::max(buckets, 0);
+    if (maxOpenFiles > 0) options.MaxOpenFiles = (size_t)maxOpenFiles;
+
+    return (int)DBaseSlice::PartitionBy(dbase, directory, col, std::vector<std::string>(cols, cols + std::max(count, 0)), options);
+}
+
+int DBASELIB_CALL SaveAtomic(const char* dbfFilePath) noexcept
+{
+    return (int)dbase->SaveAtomic(dbfFilePath, saveBatch);
+}
+
+void DBASELIB_CALL SetWriteOptions(long long chunkSize, bool parallel, bool direct, bool preallocate) noexcept
+{
+    auto& options = dbase->WriteOptions;
+    if (chunkSize > 0) options.ChunkSize = (size_t)chunkSize;
+
+    options.Parallel = parallel;
+    options.Direct = direct;
+    options.Preallocate = preallocate;
+}
+
+void DBASELIB_CALL BeginSaveBatch() noexcept
+{
+    if (!saveBatch) saveBatch = new DBaseSyncBatch();
+}
+
+int DBASELIB_CALL CommitSaveBatch() noexcept
+{
+    if (!saveBatch) return (int)DBaseSaveStatus::Ok;
+
+    const auto status = saveBatch->Commit();
+    delete saveBatch;
+    saveBatch = nullptr;
+
+    return (int)status;
+}
+
+int DBASELIB_CALL LoadFiles(const char** dbfFilePaths, int count) noexcept
+{
+    UnloadFiles();
+
+    const std::vector<std::filesystem::path> files(dbfFilePaths, dbfFilePaths + std::max(count, 0));
+    batchFiles = DBaseRingIO::LoadFiles(files);
+
+    return (int)std::count_if(batchFiles.begin(), batchFiles.end(), [](const auto file) { return file != nullptr; });
+}
+
+bool DBASELIB_CALL SelectFile(int index) noexcept
 {
-    delete dbase;
+    if (index < 0 || index >= (int)batchFiles.size() || !batchFiles[index]) return false;
+
+    // a file loaded with Load is replaced by the batch file
+    FreeTable();
+    dbase = batchFiles[index];
+    return true;
 }
 
-char __stdcall GetFieldType(const char* col) noexcept
+int DBASELIB_CALL SaveFiles(const char** dbfFilePaths, int count, int* statuses) noexcept
+{
+    count = std::clamp(count, 0, (int)batchFiles.size());
+
+    const std::vector<const DBase*> dbases(batchFiles.begin(), batchFiles.begin() + count);
+    const std::vector<std::filesystem::path> files(dbfFilePaths, dbfFilePaths + count);
+    const auto results = DBaseRingIO::SaveFiles(dbases, files);
+
+    int failed = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (statuses) statuses[i] = (int)results[i];
+        failed += results[i] != DBaseSaveStatus::Ok;
+    }
+
+    return failed;
+}
+
+void DBASELIB_CALL UnloadFiles() noexcept
+{
+    if (std::find(batchFiles.begin(), batchFiles.end(), dbase) != batchFiles.end()) FreeTable();
+
+    delete batchUnion;
+    batchUnion = nullptr;
+
+    for (const auto file : batchFiles)
+    {
+        DBaseAsync::Drain(file);
+        delete file;
+    }
+
+    batchFiles.clear();
+}
+
+long long DBASELIB_CALL ConcatFiles(const char** dbfFilePaths, int count, const char* outputFilePath) noexcept
+{
+    const std::vector<std::filesystem::path> files(dbfFilePaths, dbfFilePaths + std::max(count, 0));
+    return (long long)DBaseConcat::Concat(files, outputFilePath);
+}
+
+long long DBASELIB_CALL UnionFiles() noexcept
+{
+    delete batchUnion;
+    batchUnion = new DBaseUnion();
+
+    for (const auto file : batchFiles)
+    {
+        if (!batchUnion->Add(file))
+        {
+            delete batchUnion;
+            batchUnion = nullptr;
+            return -1;
+        }
+    }
+
+    return (long long)batchUnion->RecordCount();
+}
+
+int DBASELIB_CALL LocateRow(long long row, long long* fileRow) noexcept
+{
+    if (!batchUnion || row < 0 || (size_t)row >= batchUnion->RecordCount()) return -1;
+
+    const auto [part, local] = batchUnion->Locate((size_t)row);
+    if (fileRow) *fileRow = (long long)local;
+
+    return (int)part;
+}
+
+bool DBASELIB_CALL IsIoUringSupported() noexcept
+{
+    return DBaseRingIO::Supported();
+}
+
+int DBASELIB_CALL LoadAsync(const char* dbfFilePath, DBaseCompletionCallback callback, void* context) noexcept
+{
+    return DBaseAsync::Start([file = std::filesystem::path(dbfFilePath)](DBaseOperation& operation)
+    {
+        const auto loaded = DBaseUtils::FromFile(file);
+
+        if (!loaded || operation.Cancelled() || !loaded->Load())
+        {
+            delete loaded;
+            return operation.Cancelled() ? DBaseOperationState::Cancelled : DBaseOperationState::Failed;
+        }
+
+        operation.Total.store(loaded->RecordCount());
+        operation.Progress(loaded->RecordCount());
+
+        // handed over on the host thread by TakeLoadedFile
+        operation.Keep(loaded);
+        return DBaseOperationState::Completed;
+    }, ToCompletion(callback, context));
+}
+
+bool DBASELIB_CALL TakeLoadedFile(int operation) noexcept
+{
+    const auto found = DBaseAsync::Find(operation);
+    const auto loaded = found ? found->Take<DBase>() : nullptr;
+    if (!loaded) return false;
+
+    // a file loaded with Load is replaced, batch files are freed by UnloadFiles
+    FreeTable();
+    dbase = loaded;
+    return true;
+}
+
+int DBASELIB_CALL SaveAsync(const char* dbfFilePath, DBaseCompletionCallback callback, void* context) noexcept
+{
+    return DBaseAsync::Start([file = std::filesystem::path(dbfFilePath), target = dbase](DBaseOperation& operation)
+    {
+        if (!target->Save(file)) return DBaseOperationState::Failed;
+
+        operation.Total.store(target->RecordCount());
+        operation.Progress(target->RecordCount());
+        return DBaseOperationState::Completed;
+    }, ToCompletion(callback, context), dbase);
+}
+
+int DBASELIB_CALL ReplaceColumnsAsync(const char* src, const char* dst, DBaseCompletionCallback callback, void* context) noexcept
+{
+    const auto handle = dbase->Select(src);
+    const auto handle2 = dbase->Select(dst);
+
+    const auto srcType = handle->Type();
+    const auto copyFn = srcType == 'N' || srcType == 'D' ? &DBaseHandle::CopyR : &DBaseHandle::Copy;
+
+    return DBaseAsync::Start([target = dbase, handle, handle2, copyFn](DBaseOperation& operation)
+    {
+        return DBaseAsync::For(operation, target->RecordCount(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                (*handle2.*copyFn)(i, handle, i);
+            }
+        });
+    }, ToCompletion(callback, context), dbase);
+}
+
+int DBASELIB_CALL AddPercentAsync(const char* col, float percent, DBaseCompletionCallback callback, void* context) noexcept
+{
+    const auto p = (percent / 100.0f) + 1.0f;
+    const auto handle = dbase->Select(col);
+
+    return DBaseAsync::Start([target = dbase, handle, p](DBaseOperation& operation)
+    {
+        return DBaseAsync::For(operation, target->RecordCount(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                handle->SetFloat(i, handle->GetFloat(i) * p);
+            }
+
+            target->Counters.Parsed(end - begin);
+            target->Counters.Formatted(end - begin);
+        });
+    }, ToCompletion(callback, context), dbase);
+}
+
+int DBASELIB_CALL InsertTextAsync(const char* col, int offset, const char* text, DBaseCompletionCallback callback, void* context) noexcept
+{
+    const auto handle = dbase->Select(col);
+
+    return DBaseAsync::Start([target = dbase, handle, offset, text = std::string(text)](DBaseOperation& operation)
+    {
+        return DBaseAsync::For(operation, target->RecordCount(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                handle->Insert(i, offset, text.data(), text.size());
+            }
+        });
+    }, ToCompletion(callback, context), dbase);
+}
+
+int DBASELIB_CALL SetDateAsync(int d, int m, int y, DBaseCompletionCallback callback, void* context) noexcept
+{
+    const auto handle = dbase->Select("DATE");
+
+    return DBaseAsync::Start([target = dbase, handle, d, m, y](DBaseOperation& operation)
+    {
+        return DBaseAsync::For(operation, target->RecordCount(), [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                handle->SetDate(i, d, m, y);
+            }
+
+            target->Counters.Formatted(end - begin);
+        });
+    }, ToCompletion(callback, context), dbase);
+}
+
+int DBASELIB_CALL GetOperationState(int operation, long long* done, long long* total) noexcept
+{
+    const auto found = DBaseAsync::Find(operation);
+    if (!found) return -1;
+
+    if (done) *done = (long long)found->Done.load();
+    if (total) *total = (long long)found->Total.load();
+    return (int)found->State.load();
+}
+
+bool DBASELIB_CALL CancelOperation(int operation) noexcept
+{
+    const auto found = DBaseAsync::Find(operation);
+    if (found) found->Cancel();
+
+    return found != nullptr;
+}
+
+int DBASELIB_CALL WaitOperation(int operation) noexcept
+{
+    const auto found = DBaseAsync::Find(operation);
+    return found ? (int)found->Wait() : -1;
+}
+
+bool DBASELIB_CALL ReleaseOperation(int operation) noexcept
+{
+    return DBaseAsync::Release(operation);
+}
+
+char DBASELIB_CALL GetFieldType(const char* col) noexcept
 {
     return dbase->Select(col)->Type();
 }
 
-void __stdcall ReplaceColumns(const char* src, const char* dst) noexcept
+void DBASELIB_CALL ReplaceColumns(const char* src, const char* dst) noexcept
 {
     const auto handle = dbase->Select(src);
     const auto handle2 = dbase->Select(dst);
@@ -35,7 +330,7 @@ void __stdcall ReplaceColumns(const char* src, const char* dst) noexcept
     }
 }
 
-void __stdcall AddPercent(const char* col, float percent) noexcept
+void DBASELIB_CALL AddPercent(const char* col, float percent) noexcept
 {
     const auto p = (percent / 100.0f) + 1.0f;
     const auto handle = dbase->Select(col);
@@ -44,9 +339,12 @@ void __stdcall AddPercent(const char* col, float percent) noexcept
     {
         handle->SetFloat(i, handle->GetFloat(i) * p);
     }
+
+    dbase->Counters.Parsed(dbase->RecordCount());
+    dbase->Counters.Formatted(dbase->RecordCount());
 }
 
-void __stdcall InsertText(const char* col, int offset, const char* text) noexcept
+void DBASELIB_CALL InsertText(const char* col, int offset, const char* text) noexcept
 {
     const auto handle = dbase->Select(col);
     const auto textLen = strlen(text);
@@ -57,7 +355,7 @@ void __stdcall InsertText(const char* col, int offset, const char* text) noexcep
     }
 }
 
-void __stdcall SetDate(int d, int m, int y) noexcept
+void DBASELIB_CALL SetDate(int d, int m, int y) noexcept
 {
     const auto handle = dbase->Select("DATE");
 
@@ -65,4 +363,448 @@ void __stdcall SetDate(int d, int m, int y) noexcept
     {
         handle->SetDate(i, d, m, y);
     }
-}
\ No newline at end of file
+
+    dbase->Counters.Formatted(dbase->RecordCount());
+}
+
+bool DBASELIB_CALL Sort(const char** cols, const bool* descending, int count) noexcept
+{
+    return DBaseSort::Sort(dbase, ToSortColumns(cols, descending, count));
+}
+
+bool DBASELIB_CALL SortFile(const char* dbfFilePath, const char* outputFilePath, const char** cols, const bool* descending, int count, size_t memoryBudget) noexcept
+{
+    return DBaseSort::SortFile(dbfFilePath, outputFilePath, ToSortColumns(cols, descending, count), memoryBudget ? memoryBudget : DBaseSort::DEFAULT_MEMORY_BUDGET);
+}
+
+int DBASELIB_CALL GroupBy(const char** keys, int keyCount, const char** cols, const int* ops, int aggregationCount) noexcept
+{
+    delete groupResult;
+    groupResult = nullptr;
+
+    std::vector<DBaseAggregation> aggregations;
+
+    for (int i = 0; i < aggregationCount; ++i)
+    {
+        if (ops[i] < (int)DBaseAggregate::Sum || ops[i] > (int)DBaseAggregate::Avg) return -1;
+        aggregations.push_back({ cols[i] ? cols[i] : "", (DBaseAggregate)ops[i], "" });
+    }
+
+    const auto grouping = ::GroupBy(dbase, std::vector<std::string>(keys, keys + std::max(keyCount, 0)));
+    if (!grouping.Valid()) return -1;
+
+    groupResult = new DBaseGroupResult(grouping.Aggregate(aggregations));
+    return (int)groupResult->Groups();
+}
+
+int DBASELIB_CALL GetGroupKeySize() noexcept
+{
+    return groupResult ? (int)groupResult->KeySize : -1;
+}
+
+void DBASELIB_CALL GetGroupKeys(char* keys) noexcept
+{
+    if (groupResult) memcpy(keys, groupResult->Keys.data(), groupResult->Keys.size());
+}
+
+void DBASELIB_CALL GetGroupRows(long long* rows) noexcept
+{
+    if (groupResult) std::copy(groupResult->Rows.begin(), groupResult->Rows.end(), rows);
+}
+
+void DBASELIB_CALL GetGroupValues(double* values) noexcept
+{
+    if (groupResult) std::copy(groupResult->Values.begin(), groupResult->Values.end(), values);
+}
+
+void DBASELIB_CALL SaveGroups(const char* dbfFilePath) noexcept
+{
+    if (!groupResult) return;
+
+    const auto groups = groupResult->ToDBase();
+    groups->Save(dbfFilePath);
+    delete groups;
+}
+
+long long DBASELIB_CALL LookupUpdate(const char* dbfFilePath, const char** keys, const char** srcKeys, int keyCount, const char** srcCols, const char** dstCols, int colCount) noexcept
+{
+    const auto source = DBaseUtils::FromFile(dbfFilePath);
+
+    if (!source || !source->Load())
+    {
+        delete source;
+        return -1;
+    }
+
+    keyCount = std::max(keyCount, 0);
+    colCount = std::max(colCount, 0);
+
+    std::vector<DBaseJoinColumn> columns;
+
+    for (int i = 0; i < colCount; ++i)
+    {
+        columns.push_back({ srcCols[i], dstCols[i] });
+    }
+
+    const auto updated = DBaseJoin::LookupUpdate(dbase, std::vector<std::string>(keys, keys + keyCount), source, std::vector<std::string>(srcKeys, srcKeys + keyCount), columns);
+    delete source;
+    return updated;
+}
+
+long long DBASELIB_CALL Diff(const char* oldFilePath, const char** keys, int keyCount) noexcept
+{
+    ClearDiff();
+
+    diffBase = DBaseUtils::FromFile(oldFilePath);
+    if (!diffBase || !diffBase->Load()) return -1;
+
+    diffResult = new DBaseDiffResult();
+
+    if (!DBaseDiff::Diff(diffBase, dbase, std::vector<std::string>(keys, keys + std::max(keyCount, 0)), *diffResult))
+    {
+        delete diffResult;
+        diffResult = nullptr;
+        return -1;
+    }
+
+    return (long long)diffResult->Differences();
+}
+
+bool DBASELIB_CALL GetDiffCounts(long long* inserted, long long* deleted, long long* changed) noexcept
+{
+    if (!diffResult) return false;
+
+    *inserted = (long long)diffResult->Inserted.size();
+    *deleted = (long long)diffResult->Deleted.size();
+    *changed = (long long)diffResult->Changed.size();
+    return true;
+}
+
+void DBASELIB_CALL GetDiffRows(long long* inserted, long long* deleted, long long* changedOld, long long* changedNew) noexcept
+{
+    if (!diffResult) return;
+
+    if (inserted) std::copy(diffResult->Inserted.begin(), diffResult->Inserted.end(), inserted);
+    if (deleted) std::copy(diffResult->Deleted.begin(), diffResult->Deleted.end(), deleted);
+
+    for (size_t i = 0; i < diffResult->Changed.size(); ++i)
+    {
+        if (changedOld) changedOld[i] = (long long)diffResult->Changed[i].OldRow;
+        if (changedNew) changedNew[i] = (long long)diffResult->Changed[i].NewRow;
+    }
+}
+
+int DBASELIB_CALL GetChangedFields(long long change, int* fields) noexcept
+{
+    if (!diffResult || change < 0 || (size_t)change >= diffResult->Changed.size()) return -1;
+
+    const auto& changed = diffResult->Changed[(size_t)change];
+    if (fields) std::copy(diffResult->Fields.begin() + changed.First, diffResult->Fields.begin() + changed.First + changed.Count, fields);
+
+    return (int)changed.Count;
+}
+
+bool DBASELIB_CALL SaveDiffPatch(const char* patchFilePath) noexcept
+{
+    return diffResult && DBaseDiff::WritePatch(diffBase, dbase, *diffResult, patchFilePath);
+}
+
+long long DBASELIB_CALL ApplyPatch(const char* patchFilePath, const char** keys, int keyCount, const char* outputFilePath) noexcept
+{
+    const auto patch = DBaseUtils::FromFile(patchFilePath);
+
+    if (!patch || !patch->Load())
+    {
+        delete patch;
+        return -1;
+    }
+
+    const auto records = DBaseDiff::ApplyPatch(dbase, patch, std::vector<std::string>(keys, keys + std::max(keyCount, 0)), outputFilePath);
+
+    delete patch;
+    return (long long)records;
+}
+
+int DBASELIB_CALL ComputeStats(int blockRows) noexcept
+{
+    delete stats;
+    stats = new DBaseStats(DBaseStats::Compute(dbase, blockRows > 0 ? blockRows : DBaseStats::DEFAULT_BLOCK_ROWS));
+    return (int)stats->Columns.size();
+}
+
+bool DBASELIB_CALL GetColumnStats(const char* col, DBaseColumnSummary* summary) noexcept
+{
+    const auto column = stats ? stats->Column(col) : nullptr;
+    if (!column) return false;
+
+    ToSummary(*column, summary);
+    summary->Distinct = column->Distinct;
+    return true;
+}
+
+int DBASELIB_CALL GetColumnZones(const char* col, long long* blockRows, DBaseColumnSummary* zones) noexcept
+{
+    const auto column = stats ? stats->Column(col) : nullptr;
+    if (!column) return -1;
+
+    if (blockRows) *blockRows = (long long)stats->BlockRows;
+    if (zones) for (const auto& zone : column->Zones) ToSummary(zone, zones++);
+
+    return (int)column->Zones.size();
+}
+
+long long DBASELIB_CALL FindRows(const char* col, double min, double max, long long* rows, long long capacity) noexcept
+{
+    if (!dbase || !DBaseUtils::Find(dbase, col)) return -1;
+
+    // without statistics every record is scanned
+    const DBaseStats none;
+    const auto& from = stats ? *stats : none;
+
+    return ToRows(from.Find(dbase, col, min, max), rows, capacity);
+}
+
+long long DBASELIB_CALL FindTextRows(const char* col, const char* min, const char* max, long long* rows, long long capacity) noexcept
+{
+    if (!dbase || !DBaseUtils::Find(dbase, col)) return -1;
+
+    const DBaseStats none;
+    const auto& from = stats ? *stats : none;
+
+    return ToRows(from.Find(dbase, col, std::string(min), std::string(max)), rows, capacity);
+}
+
+bool DBASELIB_CALL SaveStats(const char* dbfFilePath) noexcept
+{
+    return stats && stats->Save(DBaseStats::SidecarPath(dbfFilePath), dbfFilePath);
+}
+
+bool DBASELIB_CALL LoadStats(const char* dbfFilePath) noexcept
+{
+    auto loaded = new DBaseStats();
+
+    if (!loaded->Load(DBaseStats::SidecarPath(dbfFilePath), dbfFilePath))
+    {
+        delete loaded;
+        return false;
+    }
+
+    delete stats;
+    stats = loaded;
+    return true;
+}
+
+unsigned long long DBASELIB_CALL FingerprintTable(int blockRows) noexcept
+{
+    return DBaseFingerprint::Table(dbase, blockRows > 0 ? (size_t)blockRows : DBaseFingerprint::DEFAULT_BLOCK_ROWS);
+}
+
+int DBASELIB_CALL FingerprintBlocks(int blockRows, unsigned long long* hashes) noexcept
+{
+    const auto blocks = DBaseFingerprint::Blocks(dbase, blockRows > 0 ? (size_t)blockRows : DBaseFingerprint::DEFAULT_BLOCK_ROWS);
+    if (hashes) std::copy(blocks.begin(), blocks.end(), hashes);
+
+    return (int)blocks.size();
+}
+
+bool DBASELIB_CALL FingerprintColumns(const char** cols, int count, int blockRows, unsigned long long* hashes) noexcept
+{
+    std::vector<uint64_t> columns;
+    if (!DBaseFingerprint::Columns(dbase, std::vector<std::string>(cols, cols + std::max(count, 0)), columns, blockRows > 0 ? (size_t)blockRows : DBaseFingerprint::DEFAULT_BLOCK_ROWS)) return false;
+
+    std::copy(columns.begin(), columns.end(), hashes);
+    return true;
+}
+
+bool DBASELIB_CALL GetLastChanged(int* d, int* m, int* y) noexcept
+{
+    if (!dbase) return false;
+
+    // years since 1900, files written by tools that store two digit years are read as 1980 to 2079
+    const auto header = reinterpret_cast<const DBase3Header*>(dbase->Data);
+    const auto year = (int)(unsigned char)header->LastChanged[0];
+
+    *y = year >= 80 ? 1900 + year : 2000 + year;
+    *m = (int)(unsigned char)header->LastChanged[1];
+    *d = (int)(unsigned char)header->LastChanged[2];
+    return true;
+}
+
+int DBASELIB_CALL ProfileColumn(const char* col, int k, double* distinct, char* values, long long* counts) noexcept
+{
+    const auto profiles = DBaseProfile::Profile(dbase, { col }, k > 0 ? k : 10);
+    if (profiles.empty()) return -1;
+
+    const auto& profile = profiles.front();
+    *distinct = profile.Distinct;
+
+    for (const auto& entry : profile.Top)
+    {
+        memcpy(values, entry.Value.data(), entry.Value.size());
+        values += entry.Value.size();
+        *counts++ = (long long)entry.Count;
+    }
+
+    return (int)profile.Top.size();
+}
+
+bool DBASELIB_CALL ExportCsv(const char* csvFilePath, const char** cols, int count, char delimiter, bool header) noexcept
+{
+    DBaseCsvOptions options;
+    options.Delimiter = delimiter ? delimiter : ',';
+    options.Header = header;
+
+    return DBaseCsv::Export(dbase, csvFilePath, std::vector<std::string>(cols, cols + std::max(count, 0)), options);
+}
+
+long long DBASELIB_CALL ImportCsv(const char* csvFilePath, const char* dbfFilePath, char delimiter, bool header) noexcept
+{
+    DBaseCsvImportOptions options;
+    options.Delimiter = delimiter ? delimiter : ',';
+    options.Header = header;
+
+    return (long long)DBaseCsv::Import(csvFilePath, dbfFilePath, options);
+}
+
+bool DBASELIB_CALL ExportArrow(const char** cols, int count, bool utf8, bool recordView, ArrowSchema* schema, ArrowArray* array) noexcept
+{
+    DBaseArrowOptions options;
+    options.Utf8 = utf8;
+    options.RecordView = recordView;
+
+    return DBaseArrow::Export(dbase, std::vector<std::string>(cols, cols + std::max(count, 0)), schema, array, options);
+}
+
+bool DBASELIB_CALL ExportFeather(const char* featherFilePath, const char** cols, int count, int batchRows) noexcept
+{
+    DBaseIpcOptions options;
+    if (batchRows > 0) options.BatchRows = (size_t)batchRows;
+
+    return DBaseIpc::Write(dbase, featherFilePath, std::vector<std::string>(cols, cols + std::max(count, 0)), options);
+}
+
+long long DBASELIB_CALL ConvertFeather(const char* dbfFilePath, const char* featherFilePath, const char** cols, int count, int batchRows) noexcept
+{
+    DBaseIpcOptions options;
+    if (batchRows > 0) options.BatchRows = (size_t)batchRows;
+
+    return (long long)DBaseIpc::Convert(dbfFilePath, featherFilePath, std::vector<std::string>(cols, cols + std::max(count, 0)), options);
+}
+
+bool DBASELIB_CALL ExportParquet(const char* parquetFilePath, const char** cols, int count, int rowGroupRows) noexcept
+{
+    DBaseParquetOptions options;
+    if (rowGroupRows > 0) options.RowGroupRows = (size_t)rowGroupRows;
+
+    return DBaseParquet::Write(dbase, parquetFilePath, std::vector<std::string>(cols, cols + std::max(count, 0)), options);
+}
+
+long long DBASELIB_CALL ConvertParquet(const char* dbfFilePath, const char* parquetFilePath, const char** cols, int count, int rowGroupRows) noexcept
+{
+    DBaseParquetOptions options;
+    if (rowGroupRows > 0) options.RowGroupRows = (size_t)rowGroupRows;
+
+    return (long long)DBaseParquet::Convert(dbfFilePath, parquetFilePath, std::vector<std::string>(cols, cols + std::max(count, 0)), options);
+}
+
+bool DBASELIB_CALL CreateTable(const char* dbfFilePath, const char** names, const char* types, const int* lengths, const int* decimals, int count) noexcept
+{
+    delete builder;
+    builder = new DBaseBuilder();
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (!builder->AddField(names[i], types[i], (size_t)std::max(lengths[i], 0), decimals ? (size_t)std::max(decimals[i], 0) : 0)) return false;
+    }
+
+    return builder->Open(dbfFilePath);
+}
+
+bool DBASELIB_CALL AppendRecord() noexcept
+{
+    return builder && builder->Append();
+}
+
+bool DBASELIB_CALL SetRecordText(const char* col, const char* text) noexcept
+{
+    return builder && builder->SetText((size_t)builder->Find(col), text);
+}
+
+bool DBASELIB_CALL SetRecordNumber(const char* col, double value) noexcept
+{
+    return builder && builder->SetFloat((size_t)builder->Find(col), value);
+}
+
+bool DBASELIB_CALL SetRecordInt(const char* col, long long value) noexcept
+{
+    return builder && builder->SetInt((size_t)builder->Find(col), value);
+}
+
+bool DBASELIB_CALL SetRecordDate(const char* col, int d, int m, int y) noexcept
+{
+    return builder && builder->SetDate((size_t)builder->Find(col), d, m, y);
+}
+
+bool DBASELIB_CALL SetRecordLogical(const char* col, bool value) noexcept
+{
+    return builder && builder->SetLogical((size_t)builder->Find(col), value);
+}
+
+long long DBASELIB_CALL CloseTable() noexcept
+{
+    if (!builder) return -1;
+
+    const auto records = (long long)builder->RecordCount();
+    const auto ok = builder->Close();
+
+    delete builder;
+    builder = nullptr;
+    return ok ? records : -1;
+}
+
+long long DBASELIB_CALL AlterSchema(const char* dbfFilePath, const char* outputFilePath, const DBaseColumnChange* changes, int count) noexcept
+{
+    return (long long)DBaseAlter::AlterSchema(dbfFilePath, outputFilePath, std::vector<DBaseColumnChange>(changes, changes + std::max(count, 0)));
+}
+
+int DBASELIB_CALL GetKernelIsa() noexcept
+{
+    return (int)DBaseKernels::Active().Isa;
+}
+
+bool DBASELIB_CALL GetStats(DBaseRuntimeStats* summary) noexcept
+{
+    if (!dbase) return false;
+
+    memset(summary, 0, sizeof(DBaseRuntimeStats));
+    summary->Enabled = DBaseCounters::ENABLED;
+    summary->Phases = (int)DBasePhase::Count;
+
+#if DBASELIB_COUNTERS
+    const auto& counters = dbase->Counters;
+    summary->BytesRead = (long long)counters.BytesRead.Get();
+    summary->BytesWritten = (long long)counters.BytesWritten.Get();
+    summary->RowsScanned = (long long)counters.RowsScanned.Get();
+    summary->CellsParsed = (long long)counters.CellsParsed.Get();
+    summary->CellsFormatted = (long long)counters.CellsFormatted.Get();
+
+    for (size_t p = 0; p < (size_t)DBasePhase::Count; ++p)
+    {
+        const auto& phase = counters.Phases[p];
+        summary->PhaseCalls[p] = (long long)phase.Calls.Get();
+        summary->PhaseNanoseconds[p] = (long long)phase.Nanoseconds.Get();
+
+        for (size_t b = 0; b < DBasePhaseTimes::BUCKETS; ++b)
+        {
+            summary->PhaseHistogram[p][b] = (long long)phase.Histogram[b].Get();
+        }
+    }
+#endif
+
+    return true;
+}
+
+void DBASELIB_CALL ResetStats() noexcept
+{
+    if (dbase) dbase->Counters.Reset();
+}
@@ -8,20 +8,258 @@
 
 #include "dbase/dBase3.hpp"
 #include "helpers/dBase.hpp"
+#include "helpers/dBaseCsv.hpp"
+#include "helpers/dBaseArrow.hpp"
+#include "helpers/dBaseIpc.hpp"
+#include "helpers/dBaseParquet.hpp"
+#include "helpers/dBaseRing.hpp"
+#include "helpers/dBaseBuilder.hpp"
+#include "helpers/dBaseAlter.hpp"
+#include "helpers/dBaseSlice.hpp"
+#include "helpers/dBaseConcat.hpp"
+#include "helpers/dBaseDiff.hpp"
+#include "helpers/dBaseFingerprint.hpp"
+#include "helpers/dBaseAsync.hpp"
+#include "helpers/dBaseSort.hpp"
+#include "helpers/dBaseJoin.hpp"
+#include "helpers/dBaseStats.hpp"
+#include "helpers/dBaseProfile.hpp"
+#include "helpers/dBaseGroupBy.hpp"
 #include "helpers/dBaseUtils.hpp"
 
+#if defined(_WIN32)
+#define DBASELIB_API extern "C" __declspec(dllexport)
+#define DBASELIB_CALL __stdcall
+#else
+#define DBASELIB_API extern "C" __attribute__((visibility("default")))
+#define DBASELIB_CALL
+#endif
+
 inline DBase* dbase = nullptr;
+inline DBaseGroupResult* groupResult = nullptr;
+inline DBaseStats* stats = nullptr;
+inline DBaseSyncBatch* saveBatch = nullptr;
+inline std::vector<DBase*> batchFiles;
+inline DBaseUnion* batchUnion = nullptr;
+inline DBaseDiffResult* diffResult = nullptr;
+inline DBase* diffBase = nullptr;
+inline DBaseBuilder* builder = nullptr;
+
+/// <summary>
+/// Called on a pool thread when an asynchronous operation finished and before WaitOperation returns, state is a DBaseOperationState.
+/// </summary>
+typedef void (DBASELIB_CALL* DBaseCompletionCallback)(int operation, int state, void* context);
+
+/// <summary>
+/// Called for every live record in order by SaveAs, returns true to keep the record.
+/// </summary>
+typedef bool (DBASELIB_CALL* DBaseRowPredicate)(int row, void* context);
+
+/// <summary>
+/// Column statistics as passed to the host, text is null terminated.
+/// </summary>
+struct DBaseColumnSummary
+{
+    long long Count;
+    long long Blanks;
+    double Sum;
+    double Min;
+    double Max;
+    double Distinct;
+    char MinText[256];
+    char MaxText[256];
+};
+
+/// <summary>
+/// Counters of the loaded DBASE as passed to the host. Phases are indexed by
+/// DBasePhase (Read, Load, Save, Sort, GroupBy, Join, Stats, Profile, Csv, Columnar,
+/// Diff, Fingerprint, SaveAs, Partition), Phases is the number of them, histogram
+/// bucket i counts calls that took [2^i, 2^(i+1)) nanoseconds.
+/// </summary>
+struct DBaseRuntimeStats
+{
+    int Enabled;
+    int Phases;
+    long long BytesRead;
+    long long BytesWritten;
+    long long RowsScanned;
+    long long CellsParsed;
+    long long CellsFormatted;
+    long long PhaseCalls[(size_t)DBasePhase::Count];
+    long long PhaseNanoseconds[(size_t)DBasePhase::Count];
+    long long PhaseHistogram[(size_t)DBasePhase::Count][DBasePhaseTimes::BUCKETS];
+};
+
+DBASELIB_API bool DBASELIB_CALL Load(const char* dbfFilePath) noexcept;
+DBASELIB_API void DBASELIB_CALL Save(const char* dbfFilePath) noexcept;
+DBASELIB_API void DBASELIB_CALL Unload() noexcept;
+
+DBASELIB_API long long DBASELIB_CALL SaveAs(const char* dbfFilePath, const char** cols, int count, DBaseRowPredicate predicate, void* context) noexcept;
+DBASELIB_API int DBASELIB_CALL PartitionBy(const char* directory, const char* col, const char** cols, int count, int buckets, int maxOpenFiles) noexcept;
+DBASELIB_API int DBASELIB_CALL SaveAtomic(const char* dbfFilePath) noexcept;
+DBASELIB_API void DBASELIB_CALL SetWriteOptions(long long chunkSize, bool parallel, bool direct, bool preallocate) noexcept;
+DBASELIB_API void DBASELIB_CALL BeginSaveBatch() noexcept;
+DBASELIB_API int DBASELIB_CALL CommitSaveBatch() noexcept;
+
+DBASELIB_API int DBASELIB_CALL LoadFiles(const char** dbfFilePaths, int count) noexcept;
+DBASELIB_API bool DBASELIB_CALL SelectFile(int index) noexcept;
+DBASELIB_API int DBASELIB_CALL SaveFiles(const char** dbfFilePaths, int count, int* statuses) noexcept;
+DBASELIB_API void DBASELIB_CALL UnloadFiles() noexcept;
+DBASELIB_API long long DBASELIB_CALL ConcatFiles(const char** dbfFilePaths, int count, const char* outputFilePath) noexcept;
+DBASELIB_API long long DBASELIB_CALL UnionFiles() noexcept;
+DBASELIB_API int DBASELIB_CALL LocateRow(long long row, long long* fileRow) noexcept;
+DBASELIB_API bool DBASELIB_CALL IsIoUringSupported() noexcept;
+
+// Operations on the loaded file are cancelled and waited for before Load, Unload, SelectFile or TakeLoadedFile
+// free it, UnloadFiles does the same for the files of the batch. Other exports must not be called on a file
+// while an operation on it is running, a completion callback must not free a file another operation works on.
+DBASELIB_API int DBASELIB_CALL LoadAsync(const char* dbfFilePath, DBaseCompletionCallback callback, void* context) noexcept;
+DBASELIB_API bool DBASELIB_CALL TakeLoadedFile(int operation) noexcept;
+DBASELIB_API int DBASELIB_CALL SaveAsync(const char* dbfFilePath, DBaseCompletionCallback callback, void* context) noexcept;
+DBASELIB_API int DBASELIB_CALL ReplaceColumnsAsync(const char* src, const char* dst, DBaseCompletionCallback callback, void* context) noexcept;
+DBASELIB_API int DBASELIB_CALL AddPercentAsync(const char* col, float percent, DBaseCompletionCallback callback, void* context) noexcept;
+DBASELIB_API int DBASELIB_CALL InsertTextAsync(const char* col, int offset, const char* text, DBaseCompletionCallback callback, void* context) noexcept;
+DBASELIB_API int DBASELIB_CALL SetDateAsync(int d, int m, int y, DBaseCompletionCallback callback, void* context) noexcept;
+DBASELIB_API int DBASELIB_CALL GetOperationState(int operation, long long* done, long long* total) noexcept;
+DBASELIB_API bool DBASELIB_CALL CancelOperation(int operation) noexcept;
+DBASELIB_API int DBASELIB_CALL WaitOperation(int operation) noexcept;
+DBASELIB_API bool DBASELIB_CALL ReleaseOperation(int operation) noexcept;
+
+DBASELIB_API char DBASELIB_CALL GetFieldType(const char* col) noexcept;
+
+DBASELIB_API void DBASELIB_CALL ReplaceColumns(const char* src, const char* dst) noexcept;
+DBASELIB_API void DBASELIB_CALL AddPercent(const char* col, float percent) noexcept;
+DBASELIB_API void DBASELIB_CALL InsertText(const char* col, int offset, const char* text) noexcept;
+DBASELIB_API void DBASELIB_CALL SetDate(int d, int m, int y) noexcept;
+
+DBASELIB_API bool DBASELIB_CALL Sort(const char** cols, const bool* descending, int count) noexcept;
+DBASELIB_API bool DBASELIB_CALL SortFile(const char* dbfFilePath, const char* outputFilePath, const char** cols, const bool* descending, int count, size_t memoryBudget) noexcept;
+
+DBASELIB_API int DBASELIB_CALL GroupBy(const char** keys, int keyCount, const char** cols, const int* ops, int aggregationCount) noexcept;
+DBASELIB_API int DBASELIB_CALL GetGroupKeySize() noexcept;
+DBASELIB_API void DBASELIB_CALL GetGroupKeys(char* keys) noexcept;
+DBASELIB_API void DBASELIB_CALL GetGroupRows(long long* rows) noexcept;
+DBASELIB_API void DBASELIB_CALL GetGroupValues(double* values) noexcept;
+DBASELIB_API void DBASELIB_CALL SaveGroups(const char* dbfFilePath) noexcept;
+
+DBASELIB_API long long DBASELIB_CALL LookupUpdate(const char* dbfFilePath, const char** keys, const char** srcKeys, int keyCount, const char** srcCols, const char** dstCols, int colCount) noexcept;
+
+DBASELIB_API long long DBASELIB_CALL Diff(const char* oldFilePath, const char** keys, int keyCount) noexcept;
+DBASELIB_API bool DBASELIB_CALL GetDiffCounts(long long* inserted, long long* deleted, long long* changed) noexcept;
+DBASELIB_API void DBASELIB_CALL GetDiffRows(long long* inserted, long long* deleted, long long* changedOld, long long* changedNew) noexcept;
+DBASELIB_API int DBASELIB_CALL GetChangedFields(long long change, int* fields) noexcept;
+DBASELIB_API bool DBASELIB_CALL SaveDiffPatch(const char* patchFilePath) noexcept;
+DBASELIB_API long long DBASELIB_CALL ApplyPatch(const char* patchFilePath, const char** keys, int keyCount, const char* outputFilePath) noexcept;
+
+DBASELIB_API int DBASELIB_CALL ComputeStats(int blockRows) noexcept;
+DBASELIB_API bool DBASELIB_CALL GetColumnStats(const char* col, DBaseColumnSummary* summary) noexcept;
+DBASELIB_API bool DBASELIB_CALL SaveStats(const char* dbfFilePath) noexcept;
+DBASELIB_API bool DBASELIB_CALL LoadStats(const char* dbfFilePath) noexcept;
+DBASELIB_API int DBASELIB_CALL GetColumnZones(const char* col, long long* blockRows, DBaseColumnSummary* zones) noexcept;
+DBASELIB_API long long DBASELIB_CALL FindRows(const char* col, double min, double max, long long* rows, long long capacity) noexcept;
+DBASELIB_API long long DBASELIB_CALL FindTextRows(const char* col, const char* min, const char* max, long long* rows, long long capacity) noexcept;
+
+DBASELIB_API unsigned long long DBASELIB_CALL FingerprintTable(int blockRows) noexcept;
+DBASELIB_API int DBASELIB_CALL FingerprintBlocks(int blockRows, unsigned long long* hashes) noexcept;
+DBASELIB_API bool DBASELIB_CALL FingerprintColumns(const char** cols, int count, int blockRows, unsigned long long* hashes) noexcept;
+DBASELIB_API bool DBASELIB_CALL GetLastChanged(int* d, int* m, int* y) noexcept;
+
+DBASELIB_API int DBASELIB_CALL ProfileColumn(const char* col, int k, double* distinct, char* values, long long* counts) noexcept;
+
+DBASELIB_API bool DBASELIB_CALL ExportCsv(const char* csvFilePath, const char** cols, int count, char delimiter, bool header) noexcept;
+DBASELIB_API long long DBASELIB_CALL ImportCsv(const char* csvFilePath, const char* dbfFilePath, char delimiter, bool header) noexcept;
+DBASELIB_API bool DBASELIB_CALL ExportArrow(const char** cols, int count, bool utf8, bool recordView, ArrowSchema* schema, ArrowArray* array) noexcept;
+DBASELIB_API bool DBASELIB_CALL ExportFeather(const char* featherFilePath, const char** cols, int count, int batchRows) noexcept;
+DBASELIB_API bool DBASELIB_CALL ExportParquet(const char* parquetFilePath, const char** cols, int count, int rowGroupRows) noexcept;
+DBASELIB_API long long DBASELIB_CALL ConvertParquet(const char* dbfFilePath, const char* parquetFilePath, const char** cols, int count, int rowGroupRows) noexcept;
+
+DBASELIB_API bool DBASELIB_CALL CreateTable(const char* dbfFilePath, const char** names, const char* types, const int* lengths, const int* decimals, int count) noexcept;
+DBASELIB_API bool DBASELIB_CALL AppendRecord() noexcept;
+DBASELIB_API bool DBASELIB_CALL SetRecordText(const char* col, const char* text) noexcept;
+DBASELIB_API bool DBASELIB_CALL SetRecordNumber(const char* col, double value) noexcept;
+DBASELIB_API bool DBASELIB_CALL SetRecordInt(const char* col, long long value) noexcept;
+DBASELIB_API bool DBASELIB_CALL SetRecordDate(const char* col, int d, int m, int y) noexcept;
+DBASELIB_API bool DBASELIB_CALL SetRecordLogical(const char* col, bool value) noexcept;
+DBASELIB_API long long DBASELIB_CALL CloseTable() noexcept;
+DBASELIB_API long long DBASELIB_CALL AlterSchema(const char* dbfFilePath, const char* outputFilePath, const DBaseColumnChange* changes, int count) noexcept;
+DBASELIB_API long long DBASELIB_CALL ConvertFeather(const char* dbfFilePath, const char* featherFilePath, const char** cols, int count, int batchRows) noexcept;
 
-extern "C" __declspec(dllexport) bool __stdcall Load(const char* dbfFilePath) noexcept;
-extern "C" __declspec(dllexport) void __stdcall Save(const char* dbfFilePath) noexcept;
-extern "C" __declspec(dllexport) void __stdcall Unload() noexcept;
+DBASELIB_API int DBASELIB_CALL GetKernelIsa() noexcept;
 
-extern "C" __declspec(dllexport) char __stdcall GetFieldType(const char* col) noexcept;
+DBASELIB_API bool DBASELIB_CALL GetStats(DBaseRuntimeStats* summary) noexcept;
+DBASELIB_API void DBASELIB_CALL ResetStats() noexcept;
 
-extern "C" __declspec(dllexport) void __stdcall ReplaceColumns(const char* src, const char* dst) noexcept;
-extern "C" __declspec(dllexport) void __stdcall AddPercent(const char* col, float percent) noexcept;
-extern "C" __declspec(dllexport) void __stdcall InsertText(const char* col, int offset, const char* text) noexcept;
-extern "C" __declspec(dllexport) void __stdcall SetDate(int d, int m, int y) noexcept;
+inline std::vector<DBaseSortColumn> ToSortColumns(const char** cols, const bool* descending, int count) noexcept
+{
+    std::vector<DBaseSortColumn> columns;
+
+    for (int i = 0; i < count; ++i)
+    {
+        columns.push_back({ cols[i], descending && descending[i] });
+    }
+
+    return columns;
+}
+
+/// <summary>
+/// Forget the last diff, its rows belong to the file that was loaded when it ran.
+/// </summary>
+inline void ClearDiff() noexcept
+{
+    delete diffResult;
+    delete diffBase;
+    diffResult = nullptr;
+    diffBase = nullptr;
+}
+
+/// <summary>
+/// Free the loaded file once the operations on it stopped, files of a batch
+/// are only let go and freed by UnloadFiles. Its statistics and diff go with it.
+/// </summary>
+inline void FreeTable() noexcept
+{
+    if (std::find(batchFiles.begin(), batchFiles.end(), dbase) == batchFiles.end())
+    {
+        DBaseAsync::Drain(dbase);
+        delete dbase;
+    }
+
+    delete stats;
+    stats = nullptr;
+
+    ClearDiff();
+    dbase = nullptr;
+}
+
+inline void ToSummary(const DBaseZone& zone, DBaseColumnSummary* summary) noexcept
+{
+    summary->Count = (long long)zone.Count;
+    summary->Blanks = (long long)zone.Blanks;
+    summary->Sum = zone.Sum;
+    summary->Min = zone.Min;
+    summary->Max = zone.Max;
+    summary->Distinct = 0.0;
+
+    const auto minSize = std::min(zone.MinText.size(), sizeof(summary->MinText) - 1);
+    const auto maxSize = std::min(zone.MaxText.size(), sizeof(summary->MaxText) - 1);
+
+    memcpy(summary->MinText, zone.MinText.data(), minSize);
+    memcpy(summary->MaxText, zone.MaxText.data(), maxSize);
+    summary->MinText[minSize] = 0;
+    summary->MaxText[maxSize] = 0;
+}
+
+inline long long ToRows(const std::vector<size_t>& found, long long* rows, long long capacity) noexcept
+{
+    if (rows) std::copy_n(found.begin(), std::min((long long)found.size(), std::max(capacity, 0LL)), rows);
+    return (long long)found.size();
+}
+
+inline DBaseAsync::Completion ToCompletion(DBaseCompletionCallback callback, void* context) noexcept
+{
+    if (!callback) return {};
+    return [callback, context](const DBaseOperation& operation) { callback(operation.Id, (int)operation.State.load(), context); };
+}
 
 constexpr auto GetSameCharCount(const char* a, const char* b, size_t max) noexcept
 {
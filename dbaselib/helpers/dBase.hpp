@@ -1,9 +1,13 @@
 #pragma once
 
+#include <ctime>
 #include <string>
 #include <vector>
 #include <filesystem>
 
+#include "dBaseFile.hpp"
+#include "dBaseCounters.hpp"
+
 /// <summary>
 /// Main interface to the DBASE data fields.
 /// </summary>
@@ -30,6 +34,11 @@ public:
     /// </summary>
     virtual char Type() const noexcept = 0;
 
+    /// <summary>
+    /// Returns the offset of the DBASE field inside a record.
+    /// </summary>
+    virtual size_t Offset() const noexcept = 0;
+
     /// <summary>
     /// Returns a pointer to the given rows raw data.
     /// </summary>
@@ -186,15 +195,27 @@ public:
     std::vector<char*> Deleted;
     std::vector<std::string> FieldNames;
 
+    /// <summary>
+    /// I/O, row, cell and timing counters of this DBASE, updated by const operations too.
+    /// </summary>
+    mutable DBaseCounters Counters;
+
+    /// <summary>
+    /// How Save and SaveAtomic write the file.
+    /// </summary>
+    DBaseWriteOptions WriteOptions;
+
     DBase(char* data, size_t size, bool claimData = true)
         : Data(data),
         Size(size),
         Records(),
         Deleted(),
-        ClaimData(claimData)
+        ClaimData(claimData),
+        Counters(),
+        WriteOptions()
     {}
 
-    ~DBase()
+    virtual ~DBase()
     {
         if (ClaimData) delete[] Data;
     }
@@ -215,6 +236,11 @@ public:
     /// </summary>
     virtual char Version() const noexcept = 0;
 
+    /// <summary>
+    /// Returns the size of a single record including the deleted flag.
+    /// </summary>
+    virtual size_t RecordSize() const noexcept = 0;
+
     /// <summary>
     /// Load the DBASE data.
     /// </summary>
@@ -225,7 +251,16 @@ public:
     /// Save the DBASE as a file.
     /// </summary>
     /// <param name="file">File to save it to.</param>
-    virtual void Save(std::filesystem::path file) const noexcept = 0;
+    /// <returns>True if the file was written, false if not.</returns>
+    virtual bool Save(std::filesystem::path file) const noexcept = 0;
+
+    /// <summary>
+    /// Save the DBASE as a file so a crash leaves either the old or the new
+    /// file. Writes a sibling temp file, syncs it and renames it over the file.
+    /// </summary>
+    /// <param name="file">File to save it to.</param>
+    /// <param name="batch">Batch that syncs the directory later, nullptr to sync it right away.</param>
+    virtual DBaseSaveStatus SaveAtomic(std::filesystem::path file, DBaseSyncBatch* batch = nullptr) const noexcept = 0;
 
     /// <summary>
     /// Select a field to obtain a handle for it. The
@@ -1,14 +1,18 @@
 #pragma once
 
+#include <cmath>
 #include <string>
 #include <vector>
+#include <cstring>
+#include <fstream>
 #include <charconv>
+#include <algorithm>
 #include <filesystem>
 #include <unordered_map>
 
-#include "fast_float/fast_float.h"
-
 #include "dBase.hpp"
+#include "dBaseKernels.hpp"
+#include "dBaseNumeric.hpp"
 
 #include "../dbase/dBase3.hpp"
 
@@ -24,7 +28,6 @@ public:
     const char FieldType;
 
 private:
-    const fast_float::parse_options FFOptions{ fast_float::chars_format::general };
     const float FloatFactor;
 
 public:
@@ -32,31 +35,28 @@ public:
         : dBase(dbase),
         FieldOffset(fieldOffset),
         FieldName(descriptor->Name),
-        FieldSize((size_t)descriptor->Lenght),
+        FieldSize((size_t)(unsigned char)descriptor->Lenght),
         FieldDecimals((size_t)descriptor->Decimals),
         FieldType(descriptor->FieldType),
-        FloatFactor(std::powf(10.0f, (float)descriptor->Decimals))
+        FloatFactor(std::pow(10.0f, (float)descriptor->Decimals))
     {}
 
     constexpr virtual const char* Name() const noexcept override { return FieldName; }
     constexpr virtual size_t Size() const noexcept override { return FieldSize; }
     constexpr virtual size_t Decimals() const noexcept { return FieldDecimals; }
     constexpr virtual char Type() const noexcept { return FieldType; }
+    constexpr virtual size_t Offset() const noexcept override { return FieldOffset; }
 
     constexpr virtual char* Data(int row) const noexcept override { return dBase->Records[row] + FieldOffset; }
 
     virtual void Copy(int row, const DBaseHandle* other, int otherRow) const noexcept override
     {
-        auto ptr = Data(row);
-        memset(ptr, ' ', FieldSize);
-        memcpy(ptr, other->Data(otherRow), std::min(FieldSize, other->Size()));
+        DBaseKernels::Active().FillCopy(Data(row), FieldSize, other->Data(otherRow), other->Size());
     }
 
     virtual void CopyRaw(int row, const void* src, size_t size) const noexcept override
     {
-        auto ptr = Data(row);
-        memset(ptr, ' ', FieldSize);
-        memcpy(ptr, src, std::min(FieldSize, size));
+        DBaseKernels::Active().FillCopy(Data(row), FieldSize, static_cast<const char*>(src), size);
     }
 
     virtual void Insert(int row, int offset, const void* src, size_t size) const noexcept override
@@ -66,25 +66,15 @@ public:
 
     virtual void CopyR(int row, const DBaseHandle* other, int otherRow) const noexcept override
     {
-        auto ptr = Data(row);
-        const auto size = std::min(FieldSize, other->Size());
-        const auto offset = FieldSize - size;
-
-        memset(ptr, ' ', FieldSize);
-        memcpy(ptr + offset, other->Data(otherRow), size);
+        DBaseKernels::Active().FillCopyRight(Data(row), FieldSize, other->Data(otherRow), other->Size());
     }
 
     virtual void CopyRRaw(int row, const void* src, size_t size) const noexcept override
     {
-        auto ptr = Data(row);
-        size = std::min(FieldSize, size);
-        const auto offset = FieldSize - size;
-
-        memset(ptr, ' ', FieldSize);
-        memcpy(ptr + offset, src, size);
+        DBaseKernels::Active().FillCopyRight(Data(row), FieldSize, static_cast<const char*>(src), size);
     }
 
-    virtual void Clear(int row) const noexcept override { memset(Data(row), ' ', FieldSize); }
+    virtual void Clear(int row) const noexcept override { DBaseKernels::Active().FillCopy(Data(row), FieldSize, "", 0); }
 
     constexpr virtual std::string_view GetText(int row) const noexcept override { return std::string_view(Data(row), FieldSize); }
 
@@ -99,9 +89,12 @@ public:
     virtual void ReplaceText(int row, const char* text, const char* newText) const noexcept override
     {
         auto ptr = Data(row);
-        std::string newString(ptr, FieldSize);
-
         const auto needleLen = strlen(text);
+
+        // most fields do not contain the text, only those that do are copied and rewritten
+        if (DBaseKernels::Active().Find(ptr, FieldSize, text, needleLen) == SIZE_MAX) return;
+
+        std::string newString(ptr, FieldSize);
         const auto newNeedleLen = strlen(newText);
         size_t position = 0;
 
@@ -111,15 +104,13 @@ public:
             position += newNeedleLen;
         }
 
-        memset(ptr, ' ', FieldSize);
-        memcpy(ptr, newString.c_str(), std::min(FieldSize, newString.length()));
+        DBaseKernels::Active().FillCopy(ptr, FieldSize, newString.c_str(), newString.length());
     }
 
     virtual float GetFloat(int row) const noexcept override
     {
-        const auto str = std::string_view(Data(row), FieldSize);
         float result;
-        auto r = fast_float::from_chars_advanced(str.data() + str.find_first_not_of(' '), str.data() + FieldSize, result, FFOptions);
+        DBaseNumeric::ParseFloat(Data(row), FieldSize, result);
         return result;
     }
 
@@ -128,47 +119,23 @@ public:
         constexpr auto MAX_FLOAT_LEN = 32;
 
         char buffer[MAX_FLOAT_LEN]{ 0 };
-        std::to_chars(buffer, buffer + MAX_FLOAT_LEN, std::roundf((f * FloatFactor)) / FloatFactor, std::chars_format::fixed, 2);
+        std::to_chars(buffer, buffer + MAX_FLOAT_LEN, std::round(f * FloatFactor) / FloatFactor, std::chars_format::fixed, 2);
 
         const auto str = std::string_view(buffer);
         const auto size = std::min(FieldSize, str.length());
 
-        auto ptr = Data(row);
-        memset(ptr, ' ', FieldSize);
-        memcpy(ptr + (FieldSize - size), str.data(), size);
+        DBaseKernels::Active().FillCopyRight(Data(row), FieldSize, str.data(), size);
     }
 
-    constexpr virtual int GetInt(int row) const noexcept override
+    virtual int GetInt(int row) const noexcept override
     {
-        const auto str = std::string_view(Data(row), FieldSize);
-        const char* p = str.data() + str.find_first_not_of(' ');
-
-        int x = 0;
-        bool negative = false;
-
-        if (*p == '-')
-        {
-            negative = true;
-            ++p;
-        }
-
-        while (*p >= '0' && *p <= '9')
-        {
-            x = (x * 10) + (*p - '0');
-            ++p;
-        }
-
-        return negative ? -x : x;
+        return DBaseNumeric::ParseInt(Data(row), FieldSize);
     }
 
     virtual void SetInt(int row, int i) const noexcept override
     {
-        auto ptr = Data(row);
         const auto str = std::to_string(i);
-        const auto size = std::min(FieldSize, str.length());
-
-        memset(ptr, ' ', FieldSize);
-        memcpy(ptr + (FieldSize - size), str.c_str(), size);
+        DBaseKernels::Active().FillCopyRight(Data(row), FieldSize, str.c_str(), str.length());
     }
 
     constexpr virtual void SetDate(int row, tm t) const noexcept override { SetDate(row, t.tm_mday, t.tm_mon + 1, t.tm_year + 1900); }
@@ -182,11 +149,16 @@ public:
     const DBase3Header* Header;
     std::unordered_map<std::string, DBase3Handle*> Handles;
 
+private:
+    size_t RowSize;
+
+public:
     DBase3(char* data, size_t size, bool claimData = true, bool hasMemo = false)
         : DBase(data, size, claimData),
         HasMemo(hasMemo),
         Header(reinterpret_cast<DBase3Header*>(data)),
-        Handles()
+        Handles(),
+        RowSize(0)
     {}
 
     ~DBase3()
@@ -196,15 +168,17 @@ public:
     }
 
     constexpr virtual char Version() const noexcept override { return Header->Version; }
+    constexpr virtual size_t RecordSize() const noexcept override { return RowSize; }
 
     virtual bool Load() noexcept override
     {
+        DBaseCounters::Scope scope(Counters, DBasePhase::Load);
         char* data = const_cast<char*>(Data);
+        const char* eof = data + Size;
 
         // skip the header
         data += sizeof(DBase3Header);
 
-        const char* eof = data + Size;
         int rowSize = 0;
 
         // read all field descriptors until we reach the terminator
@@ -212,8 +186,9 @@ public:
         {
             auto desc = reinterpret_cast<DBase3FieldDescriptor*>(data);
             Handles[desc->Name] = new DBase3Handle(this, desc, rowSize);
+            FieldNames.push_back(desc->Name);
 
-            rowSize += desc->Lenght;
+            rowSize += (unsigned char)desc->Lenght;
             data += sizeof(DBase3FieldDescriptor);
 
             if (data >= eof)
@@ -223,42 +198,57 @@ public:
             }
         }
 
-        // skip field descriptor section terminator
-        do
-        {
-            ++data;
-        } while (*data != ' ' && *data != '*');
+        // skip field descriptor section terminator, records start right after the header
+        data = const_cast<char*>(Data) + Header->HeaderBytes;
 
         // add one to include the row start character
         ++rowSize;
+        RowSize = rowSize;
 
-        // read every row until end of file
-        for (; data < eof; data += rowSize)
+        // every row until end of file, a trailing partial row is the eof marker
+        const auto rows = data < eof ? (size_t)(eof - data) / rowSize : 0;
+
+        // first character in a row should always be a space (0x20) or asterisk (0x2A)
+        // this indicates the deleted state of a row (asterisk is deleted, space is not)
+        std::vector<char> flags(rows);
+        DBaseKernels::Active().GatherFlags(data, rowSize, rows, flags.data());
+        Counters.Scanned(rows);
+
+        Records.reserve(std::count(flags.begin(), flags.end(), ' '));
+        Deleted.reserve(std::count(flags.begin(), flags.end(), '*'));
+
+        for (size_t i = 0; i < rows; ++i, data += rowSize)
         {
-            // first character in a row should always be a space (0x20) or asterisk (0x2A)
-            // this indicates the deleted state of a row (asterisk is deleted, space is not)
-            if (*data == ' ')
+            if (flags[i] == ' ')
             {
                 Records.push_back(data + 1);
             }
-            else if (*data == '*')
+            else if (flags[i] == '*')
             {
                 Deleted.push_back(data + 1);
             }
         }
 
-        // save our field names for later usage
-        FieldNames.reserve(Handles.size());
-        std::transform(Handles.begin(), Handles.end(), std::back_inserter(FieldNames), [](const auto& kv) { return kv.second->Name(); });
+        return true;
+    }
 
+    virtual bool Save(std::filesystem::path file) const noexcept override
+    {
+        DBaseCounters::Scope scope(Counters, DBasePhase::Save);
+        if (!DBaseFile::Write(file, Data, Size, WriteOptions)) return false;
+
+        Counters.Written(Size);
         return true;
     }
 
-    virtual void Save(std::filesystem::path file) const noexcept override
+    virtual DBaseSaveStatus SaveAtomic(std::filesystem::path file, DBaseSyncBatch* batch = nullptr) const noexcept override
     {
-        std::ofstream dbfOutputStream(file, std::ifstream::out | std::ifstream::binary);
-        dbfOutputStream.write(Data, Size);
-        dbfOutputStream.close();
+        DBaseCounters::Scope scope(Counters, DBasePhase::Save);
+
+        const auto status = DBaseFile::WriteAtomic(file, Data, Size, batch, WriteOptions);
+        if (status == DBaseSaveStatus::Ok) Counters.Written(Size);
+
+        return status;
     }
 
     virtual inline DBaseHandle* Select(const std::string& col) const noexcept override { return Handles.at(col); }
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#include "dBase.hpp"
+#include "dBase3.hpp"
+#include "dBaseFile.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseReader.hpp"
+#include "dBaseBuilder.hpp"
+#include "dBaseKernels.hpp"
+#include "dBaseNumeric.hpp"
+#include "dBaseParallel.hpp"
+
+/// <summary>
+/// Kind of a change to the fields of a table.
+/// </summary>
+enum class DBaseChangeKind : int
+{
+    Add = 0,
+    Drop = 1,
+    Resize = 2,
+    Move = 3,
+};
+
+/// <summary>
+/// A change to the fields of a table as passed by the host, the changes apply one after another.
+/// </summary>
+struct DBaseColumnChange
+{
+    int Kind;
+    char Name[11];
+    char Type;
+    int Length;
+    int Decimals;
+
+    /// <summary>
+    /// Index in the fields after the change for Add and Move, -1 for the end.
+    /// </summary>
+    int Position;
+};
+
+namespace DBaseAlter
+{
+    inline DBaseColumnChange Change(DBaseChangeKind kind, const std::string& name, char type, int length, int decimals, int position) noexcept
+    {
+        DBaseColumnChange change{};
+        change.Kind = (int)kind;
+        memcpy(change.Name, name.c_str(), std::min<size_t>(name.size(), sizeof(change.Name) - 1));
+        change.Type = type;
+        change.Length = length;
+        change.Decimals = decimals;
+        change.Position = position;
+        return change;
+    }
+
+    inline DBaseColumnChange Add(const std::string& name, char type, int length, int decimals = 0, int position = -1) noexcept { return Change(DBaseChangeKind::Add, name, type, length, decimals, position); }
+    inline DBaseColumnChange Drop(const std::string& name) noexcept { return Change(DBaseChangeKind::Drop, name, 0, 0, 0, -1); }
+    inline DBaseColumnChange Resize(const std::string& name, int length, int decimals = 0) noexcept { return Change(DBaseChangeKind::Resize, name, 0, length, decimals, -1); }
+    inline DBaseColumnChange Move(const std::string& name, int position) noexcept { return Change(DBaseChangeKind::Move, name, 0, 0, 0, position); }
+
+    /// <summary>
+    /// A field of the new layout and the field it comes from, nullptr for a new one.
+    /// </summary>
+    struct Column
+    {
+        DBase3FieldDescriptor Field;
+        const DBaseHandle* Source;
+    };
+
+    /// <summary>
+    /// How one part of a new record is made from the old record.
+    /// </summary>
+    enum class StepKind : uint8_t
+    {
+        Copy,       // same bytes, neighbouring copies are merged
+        Blank,      // new field, filled with spaces
+        Left,       // resized character field, cut or padded on the right
+        Right,      // resized number, trimmed and right aligned
+        Reformat,   // number with other decimals, parsed and formatted again
+    };
+
+    struct Step
+    {
+        StepKind Kind;
+        size_t From;
+        size_t FromSize;
+        size_t To;
+        size_t ToSize;
+        int Decimals;
+    };
+
+    inline size_t IndexOf(const std::vector<Column>& columns, const char* name) noexcept
+    {
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            if (strncmp(columns[i].Field.Name, name, sizeof(DBaseColumnChange::Name)) == 0) return i;
+        }
+
+        return SIZE_MAX;
+    }
+
+    /// <summary>
+    /// Apply the changes to the fields of a table.
+    /// </summary>
+    /// <returns>False if a change names a field that does not exist, adds one that does or is invalid.</returns>
+    inline bool Layout(const DBase* header, const std::vector<DBaseColumnChange>& changes, std::vector<Column>& columns) noexcept
+    {
+        columns.clear();
+        for (const auto& name : header->Fields())
+        {
+            const auto handle = header->Select(name);
+            columns.push_back({ DBaseUtils::MakeField(handle), handle });
+        }
+
+        for (const auto& change : changes)
+        {
+            char name[sizeof(DBaseColumnChange::Name)] = {};
+            memcpy(name, change.Name, sizeof(name) - 1);
+
+            const auto index = IndexOf(columns, name);
+            const auto insertAt = [&](Column column)
+            {
+                const auto position = change.Position < 0 ? columns.size() : std::min<size_t>((size_t)change.Position, columns.size());
+                columns.insert(columns.begin() + position, column);
+            };
+
+            switch ((DBaseChangeKind)change.Kind)
+            {
+            case DBaseChangeKind::Add:
+            {
+                auto length = (size_t)std::max(change.Length, 0);
+                auto decimals = (size_t)std::max(change.Decimals, 0);
+                if (!*name || index != SIZE_MAX || !DBaseBuilder::CheckField(change.Type, length, decimals)) return false;
+
+                insertAt({ DBaseUtils::MakeField(name, change.Type, length, decimals), nullptr });
+                break;
+            }
+
+            case DBaseChangeKind::Drop:
+                if (index == SIZE_MAX) return false;
+                columns.erase(columns.begin() + index);
+                break;
+
+            case DBaseChangeKind::Resize:
+            {
+                if (index == SIZE_MAX) return false;
+
+                auto& field = columns[index].Field;
+                auto length = (size_t)std::max(change.Length, 0);
+                auto decimals = (size_t)std::max(change.Decimals, 0);
+                if (!DBaseBuilder::CheckField(field.FieldType, length, decimals)) return false;
+
+                field.Lenght = (char)length;
+                field.Decimals = (char)decimals;
+                break;
+            }
+
+            case DBaseChangeKind::Move:
+            {
+                if (index == SIZE_MAX) return false;
+
+                const auto column = columns[index];
+                columns.erase(columns.begin() + index);
+                insertAt(column);
+                break;
+            }
+
+            default:
+                return false;
+            }
+        }
+
+        size_t recordSize = 1;
+        for (const auto& column : columns) recordSize += (unsigned char)column.Field.Lenght;
+        return !columns.empty() && recordSize <= UINT16_MAX;
+    }
+
+    /// <summary>
+    /// Work out the steps that turn an old record into a new one. Unchanged
+    /// fields that are neighbours in both layouts become a single copy.
+    /// </summary>
+    inline std::vector<Step> Plan(const std::vector<Column>& columns) noexcept
+    {
+        // the deleted flag stays
+        std::vector<Step> steps{ { StepKind::Copy, 0, 1, 0, 1, 0 } };
+        size_t to = 1;
+
+        for (const auto& column : columns)
+        {
+            const auto size = (size_t)(unsigned char)column.Field.Lenght;
+            const auto decimals = (int)(unsigned char)column.Field.Decimals;
+            const auto source = column.Source;
+            const auto numeric = column.Field.FieldType == 'N' || column.Field.FieldType == 'F';
+
+            Step step{ StepKind::Blank, 0, 0, to, size, decimals };
+
+            if (source)
+            {
+                step.From = source->Offset() + 1;
+                step.FromSize = source->Size();
+
+                if (numeric && (int)source->Decimals() != decimals) step.Kind = StepKind::Reformat;
+                else if (step.FromSize == size) step.Kind = StepKind::Copy;
+                else step.Kind = numeric ? StepKind::Right : StepKind::Left;
+            }
+
+            auto& last = steps.back();
+
+            if (step.Kind == StepKind::Copy && last.Kind == StepKind::Copy && last.From + last.FromSize == step.From && last.To + last.ToSize == step.To)
+            {
+                last.FromSize += size;
+                last.ToSize += size;
+            }
+            else if (step.Kind == StepKind::Blank && last.Kind == StepKind::Blank)
+            {
+                last.ToSize += size;
+            }
+            else steps.push_back(step);
+
+            to += size;
+        }
+
+        return steps;
+    }
+
+    /// <summary>
+    /// Make a new record from an old one.
+    /// </summary>
+    inline void Apply(const std::vector<Step>& steps, const char* from, char* to) noexcept
+    {
+        const auto& kernels = DBaseKernels::Active();
+
+        for (const auto& step : steps)
+        {
+            const auto source = from + step.From;
+            const auto target = to + step.To;
+
+            switch (step.Kind)
+            {
+            case StepKind::Copy:
+                memcpy(target, source, step.ToSize);
+                break;
+
+            case StepKind::Blank:
+                memset(target, ' ', step.ToSize);
+                break;
+
+            case StepKind::Left:
+                kernels.FillCopy(target, step.ToSize, source, step.FromSize);
+                break;
+
+            case StepKind::Right:
+            {
+                const auto end = kernels.TrimRight(source, step.FromSize);
+                const auto start = std::min(kernels.SkipSpaces(source, end), end);
+                DBaseNumeric::WriteRight(target, step.ToSize, source + start, end - start);
+                break;
+            }
+
+            case StepKind::Reformat:
+            {
+                // blanks and values that are not numbers stay blank
+                double value;
+                if (DBaseNumeric::ParseFloat(source, step.FromSize, value)) DBaseNumeric::FormatFloat(target, step.ToSize, value, step.Decimals);
+                else memset(target, ' ', step.ToSize);
+                break;
+            }
+            }
+        }
+    }
+
+    /// <summary>
+    /// Rewrite a DBASE file with changed fields in one pass. Added fields are
+    /// blank, resized character fields are cut or padded, resized numbers are
+    /// right aligned (asterisks if they do not fit) and numbers with other
+    /// decimals are formatted again. Both files are mapped and blocks of
+    /// records are rewritten in parallel, deleted records keep their flag.
+    /// </summary>
+    /// <param name="file">File to read.</param>
+    /// <param name="output">File to write, has to be another file.</param>
+    /// <param name="changes">Changes applied one after another.</param>
+    /// <returns>Number of records written or -1 on an error.</returns>
+    static int64_t AlterSchema(const std::filesystem::path& file, const std::filesystem::path& output, const std::vector<DBaseColumnChange>& changes) noexcept
+    {
+        std::error_code error;
+        if (std::filesystem::equivalent(file, output, error)) return -1;
+
+        DBaseReader reader;
+        if (!reader.Open(file)) return -1;
+
+        std::vector<Column> columns;
+        if (!Layout(reader.Fields(), changes, columns)) return -1;
+
+        std::vector<DBase3FieldDescriptor> fields;
+        for (const auto& column : columns) fields.push_back(column.Field);
+
+        const auto steps = Plan(columns);
+        const auto records = (size_t)reader.Records();
+        if (records > UINT32_MAX) return -1;
+
+        const auto fromSize = reader.RecordSize();
+        const auto headerSize = DBaseUtils::HeaderSize(fields.size());
+
+        size_t toSize = 1;
+        for (const auto& field : fields) toSize += (unsigned char)field.Lenght;
+
+        DBaseMappedFile source;
+        DBaseMappedFile target;
+        if (!source.OpenRead(file) || !target.Create(output, headerSize + records * toSize + 1)) return -1;
+
+        DBaseUtils::WriteHeader(target.Data, fields, records);
+        target.Data[target.Size - 1] = 0x1A;
+
+        const auto from = source.Data + reader.HeaderSize();
+        const auto to = target.Data + headerSize;
+
+        DBaseParallel::For(records, [&](size_t begin, size_t end, size_t)
+        {
+            for (auto i = begin; i < end; ++i) Apply(steps, from + i * fromSize, to + i * toSize);
+        });
+
+        return (int64_t)records;
+    }
+}
@@ -0,0 +1,465 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "dBase.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseKernels.hpp"
+#include "dBaseNumeric.hpp"
+#include "dBaseParallel.hpp"
+
+// structures of the Arrow C data interface, see https://arrow.apache.org/docs/format/CDataInterface.html
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema
+{
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray
+{
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif
+
+/// <summary>
+/// How a DBASE is exported as Arrow arrays.
+/// </summary>
+struct DBaseArrowOptions
+{
+    /// <summary>
+    /// Export character fields as utf8, otherwise as binary for code pages that are not utf-8.
+    /// </summary>
+    bool Utf8 = true;
+
+    /// <summary>
+    /// Add a RECORD column of fixed size binary values that are the whole records,
+    /// starting with the deleted flag. The values point into the DBASE without a
+    /// copy if the live records are stored back to back.
+    /// </summary>
+    bool RecordView = false;
+};
+
+namespace DBaseArrow
+{
+    /// <summary>
+    /// Buffers and children of an exported array, freed by its release callback.
+    /// </summary>
+    struct ArrayData
+    {
+        std::vector<std::vector<uint8_t>> Buffers;
+        std::vector<const void*> Pointers;
+        std::vector<ArrowArray*> Children;
+    };
+
+    /// <summary>
+    /// Strings and children of an exported schema, freed by its release callback.
+    /// </summary>
+    struct SchemaData
+    {
+        std::string Format;
+        std::string Name;
+        std::vector<ArrowSchema*> Children;
+    };
+
+    inline void ReleaseArray(ArrowArray* array) noexcept
+    {
+        const auto data = static_cast<ArrayData*>(array->private_data);
+
+        // children that were moved out by the consumer are already released
+        for (const auto child : data->Children)
+        {
+            if (child->release) child->release(child);
+            delete child;
+        }
+
+        delete data;
+        array->release = nullptr;
+    }
+
+    inline void ReleaseSchema(ArrowSchema* schema) noexcept
+    {
+        const auto data = static_cast<SchemaData*>(schema->private_data);
+
+        for (const auto child : data->Children)
+        {
+            if (child->release) child->release(child);
+            delete child;
+        }
+
+        delete data;
+        schema->release = nullptr;
+    }
+
+    inline void MakeSchema(ArrowSchema* schema, std::string format, std::string name, int64_t flags) noexcept
+    {
+        const auto data = new SchemaData{ std::move(format), std::move(name), {} };
+        *schema = { data->Format.c_str(), data->Name.c_str(), nullptr, flags, 0, nullptr, nullptr, ReleaseSchema, data };
+    }
+
+    /// <summary>
+    /// Fill an array from its data. A validity buffer without nulls is dropped.
+    /// </summary>
+    inline void MakeArray(ArrowArray* array, ArrayData* data, size_t length, size_t nullCount) noexcept
+    {
+        if (data->Pointers.empty())
+        {
+            for (const auto& buffer : data->Buffers) data->Pointers.push_back(buffer.data());
+        }
+
+        if (nullCount == 0 && !data->Pointers.empty()) data->Pointers[0] = nullptr;
+
+        *array = { (int64_t)length, (int64_t)nullCount, 0, (int64_t)data->Pointers.size(), 0, data->Pointers.data(), nullptr, nullptr, ReleaseArray, data };
+    }
+
+    inline void SetBit(uint8_t* bits, size_t i) noexcept { bits[i / 8] |= (uint8_t)(1u << (i % 8)); }
+
+    /// <summary>
+    /// Returns the days since 1970-01-01 of a civil date.
+    /// </summary>
+    constexpr int32_t DaysFromCivil(int y, int m, int d) noexcept
+    {
+        y -= m <= 2;
+        const auto era = (y >= 0 ? y : y - 399) / 400;
+        const auto yoe = y - era * 400;
+        const auto doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+        const auto doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + doe - 719468;
+    }
+
+    /// <summary>
+    /// Parse a YYYYMMDD date as days since 1970-01-01.
+    /// </summary>
+    /// <returns>False if the field is blank or not a valid date.</returns>
+    inline bool ParseDate(const char* data, size_t size, int32_t& value) noexcept
+    {
+        if (size != 8 || !std::all_of(data, data + 8, [](char c) { return c >= '0' && c <= '9'; })) return false;
+
+        const auto date = DBaseNumeric::ParseInt(data, 8);
+        const auto y = date / 10000, m = date / 100 % 100, d = date % 100;
+        if (m < 1 || m > 12 || d < 1) return false;
+
+        // the first day of the next month bounds the days of this one
+        value = DaysFromCivil(y, m, d);
+        return value < DaysFromCivil(m == 12 ? y + 1 : y, m == 12 ? 1 : m + 1, 1);
+    }
+
+    /// <summary>
+    /// Parse an integer that fills the rest of the field.
+    /// </summary>
+    /// <returns>False if the field is blank or not an integer.</returns>
+    inline bool ParseInteger(const char* data, size_t size, int64_t& value) noexcept
+    {
+        const auto& kernels = DBaseKernels::Active();
+        size = kernels.TrimRight(data, size);
+
+        auto start = kernels.SkipSpaces(data, size);
+        const auto negative = start < size && data[start] == '-';
+        start += negative;
+
+        uint64_t digits;
+        const auto count = kernels.ParseDigits(data + start, size - start, digits);
+
+        value = negative ? -(int64_t)digits : (int64_t)digits;
+        return count > 0 && start + count == size;
+    }
+
+    /// <summary>
+    /// Decode the values of a fixed size column in parallel, every block of
+    /// records writes its own values and validity bits.
+    /// </summary>
+    /// <param name="first">First record of the range to decode.</param>
+    /// <param name="rows">Number of records to decode.</param>
+    /// <param name="decode">Called as decode(field, value&), returns false for a null.</param>
+    template<typename T, typename Decode>
+    inline ArrayData* DecodeValues(const DBase* dbase, const DBaseHandle* handle, size_t first, size_t rows, size_t& nullCount, Decode&& decode) noexcept
+    {
+        const auto data = new ArrayData();
+        data->Buffers.emplace_back((rows + 7) / 8, 0);
+        data->Buffers.emplace_back(rows * sizeof(T), 0);
+
+        const auto validity = data->Buffers[0].data();
+        const auto values = reinterpret_cast<T*>(data->Buffers[1].data());
+        const auto offset = handle->Offset();
+        const auto size = handle->Size();
+
+        std::vector<size_t> nulls(DBaseParallel::Concurrency(), 0);
+
+        // blocks are a multiple of 8 records, so no two threads write the same validity byte
+        DBaseParallel::For(rows, [&](size_t begin, size_t end, size_t slot)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                if (decode(dbase->Records[first + i] + offset, size, values[i])) SetBit(validity, i);
+                else ++nulls[slot];
+            }
+        });
+
+        nullCount = 0;
+        for (const auto count : nulls) nullCount += count;
+        return data;
+    }
+
+    /// <summary>
+    /// Logicals become a bit packed boolean array, ? and blanks are nulls.
+    /// </summary>
+    inline ArrayData* DecodeLogicals(const DBase* dbase, const DBaseHandle* handle, size_t first, size_t rows, size_t& nullCount) noexcept
+    {
+        const auto data = new ArrayData();
+        data->Buffers.emplace_back((rows + 7) / 8, 0);
+        data->Buffers.emplace_back((rows + 7) / 8, 0);
+
+        const auto validity = data->Buffers[0].data();
+        const auto values = data->Buffers[1].data();
+        const auto offset = handle->Offset();
+
+        std::vector<size_t> nulls(DBaseParallel::Concurrency(), 0);
+
+        DBaseParallel::For(rows, [&](size_t begin, size_t end, size_t slot)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                switch (dbase->Records[first + i][offset])
+                {
+                case 'T': case 't': case 'Y': case 'y':
+                    SetBit(values, i);
+                    SetBit(validity, i);
+                    break;
+
+                case 'F': case 'f': case 'N': case 'n':
+                    SetBit(validity, i);
+                    break;
+
+                default:
+                    ++nulls[slot];
+                }
+            }
+        });
+
+        nullCount = 0;
+        for (const auto count : nulls) nullCount += count;
+        return data;
+    }
+
+    /// <summary>
+    /// Character fields become variable size values without the trailing padding.
+    /// The lengths are measured in parallel, summed into the offsets and then
+    /// the values are copied in parallel.
+    /// </summary>
+    template<typename Offset>
+    inline ArrayData* CopyText(const DBase* dbase, const DBaseHandle* handle, size_t first, const std::vector<Offset>& lengths) noexcept
+    {
+        const auto rows = lengths.size();
+        const auto data = new ArrayData();
+        data->Buffers.emplace_back();
+        data->Buffers.emplace_back((rows + 1) * sizeof(Offset), 0);
+
+        const auto offsets = reinterpret_cast<Offset*>(data->Buffers[1].data());
+        for (size_t i = 0; i < rows; ++i) offsets[i + 1] = offsets[i] + lengths[i];
+
+        data->Buffers.emplace_back((size_t)offsets[rows], 0);
+        const auto text = data->Buffers[2].data();
+        const auto offset = handle->Offset();
+
+        DBaseParallel::For(rows, [&](size_t begin, size_t end, size_t)
+        {
+            for (auto i = begin; i < end; ++i) memcpy(text + offsets[i], dbase->Records[first + i] + offset, (size_t)lengths[i]);
+        });
+
+        return data;
+    }
+
+    /// <summary>
+    /// Returns true if the live records are stored back to back.
+    /// </summary>
+    inline bool Contiguous(const DBase* dbase) noexcept
+    {
+        const auto rows = dbase->RecordCount();
+        return rows == 0 || (size_t)(dbase->Records.back() - dbase->Records.front()) == (rows - 1) * dbase->RecordSize();
+    }
+
+    /// <summary>
+    /// Export a range of records of one field as an array and schema.
+    /// </summary>
+    /// <param name="first">First record of the range.</param>
+    /// <param name="rows">Number of records in the range.</param>
+    inline void ExportField(const DBase* dbase, const DBaseHandle* handle, size_t first, size_t rows, const DBaseArrowOptions& options, ArrowSchema* schema, ArrowArray* array) noexcept
+    {
+        size_t nullCount = 0;
+        ArrayData* data;
+        std::string format;
+
+        switch (handle->Type())
+        {
+        case 'N':
+        case 'F':
+            // integers of up to 18 digits always fit into an int64
+            if (handle->Type() == 'N' && handle->Decimals() == 0 && handle->Size() <= 18)
+            {
+                format = "l";
+                data = DecodeValues<int64_t>(dbase, handle, first, rows, nullCount, ParseInteger);
+            }
+            else
+            {
+                format = "g";
+                data = DecodeValues<double>(dbase, handle, first, rows, nullCount, [](const char* field, size_t size, double& value) { return DBaseNumeric::ParseFloat(field, size, value); });
+            }
+            break;
+
+        case 'D':
+            format = "tdD";
+            data = DecodeValues<int32_t>(dbase, handle, first, rows, nullCount, ParseDate);
+            break;
+
+        case 'L':
+            format = "b";
+            data = DecodeLogicals(dbase, handle, first, rows, nullCount);
+            break;
+
+        default:
+        {
+            const auto offset = handle->Offset();
+            const auto size = handle->Size();
+            std::vector<uint32_t> lengths(rows);
+
+            DBaseParallel::For(rows, [&](size_t begin, size_t end, size_t)
+            {
+                const auto& kernels = DBaseKernels::Active();
+                for (auto i = begin; i < end; ++i) lengths[i] = (uint32_t)kernels.TrimRight(dbase->Records[first + i] + offset, size);
+            });
+
+            uint64_t total = 0;
+            for (const auto length : lengths) total += length;
+
+            // 32 bit offsets while they fit, the large variants otherwise
+            if (total <= INT32_MAX)
+            {
+                format = options.Utf8 ? "u" : "z";
+                data = CopyText<int32_t>(dbase, handle, first, std::vector<int32_t>(lengths.begin(), lengths.end()));
+            }
+            else
+            {
+                format = options.Utf8 ? "U" : "Z";
+                data = CopyText<int64_t>(dbase, handle, first, std::vector<int64_t>(lengths.begin(), lengths.end()));
+            }
+        }
+        }
+
+        MakeSchema(schema, format, handle->Name(), ARROW_FLAG_NULLABLE);
+        MakeArray(array, data, rows, nullCount);
+    }
+
+    /// <summary>
+    /// Export the whole records as fixed size binary values.
+    /// </summary>
+    inline void ExportRecords(const DBase* dbase, ArrowSchema* schema, ArrowArray* array) noexcept
+    {
+        const auto rows = dbase->RecordCount();
+        const auto size = dbase->RecordSize();
+        const auto data = new ArrayData();
+
+        data->Pointers.push_back(nullptr);
+
+        if (Contiguous(dbase))
+        {
+            data->Pointers.push_back(rows ? dbase->Records.front() - 1 : nullptr);
+        }
+        else
+        {
+            // deleted records in between, pack the live ones
+            data->Buffers.emplace_back(rows * size);
+            const auto packed = data->Buffers[0].data();
+
+            DBaseParallel::For(rows, [&](size_t begin, size_t end, size_t)
+            {
+                for (auto i = begin; i < end; ++i) memcpy(packed + i * size, dbase->Records[i] - 1, size);
+            });
+
+            data->Pointers.push_back(packed);
+        }
+
+        MakeSchema(schema, "w:" + std::to_string(size), "RECORD", 0);
+        MakeArray(array, data, rows, 0);
+    }
+
+    /// <summary>
+    /// Export fields of a DBASE as an Arrow struct array (a record batch) through
+    /// the C data interface. Numbers become int64 or float64, dates date32,
+    /// logicals booleans, blank or invalid values nulls and character fields
+    /// utf8 without the padding. The consumer calls the release callbacks, the
+    /// record view points into the DBASE which has to outlive it.
+    /// </summary>
+    /// <param name="dbase">Loaded DBASE.</param>
+    /// <param name="fields">Fields to export in this order, empty for all fields.</param>
+    /// <param name="schema">Schema to fill.</param>
+    /// <param name="array">Array to fill.</param>
+    /// <returns>True if exported, false if a field does not exist.</returns>
+    static bool Export(const DBase* dbase, const std::vector<std::string>& fields, ArrowSchema* schema, ArrowArray* array, const DBaseArrowOptions& options = {}) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Columnar);
+
+        std::vector<const DBaseHandle*> handles;
+
+        for (const auto& name : fields.empty() ? dbase->Fields() : fields)
+        {
+            const auto handle = DBaseUtils::Find(dbase, name);
+            if (!handle) return false;
+
+            handles.push_back(handle);
+        }
+
+        const auto schemaData = new SchemaData{ "+s", "", {} };
+        const auto arrayData = new ArrayData();
+        arrayData->Pointers.push_back(nullptr);
+
+        for (const auto handle : handles)
+        {
+            schemaData->Children.push_back(new ArrowSchema());
+            arrayData->Children.push_back(new ArrowArray());
+            ExportField(dbase, handle, 0, dbase->RecordCount(), options, schemaData->Children.back(), arrayData->Children.back());
+        }
+
+        if (options.RecordView)
+        {
+            schemaData->Children.push_back(new ArrowSchema());
+            arrayData->Children.push_back(new ArrowArray());
+            ExportRecords(dbase, schemaData->Children.back(), arrayData->Children.back());
+        }
+
+        const auto children = (int64_t)schemaData->Children.size();
+        *schema = { schemaData->Format.c_str(), schemaData->Name.c_str(), nullptr, 0, children, schemaData->Children.data(), nullptr, ReleaseSchema, schemaData };
+        *array = { (int64_t)dbase->RecordCount(), 0, 0, 1, children, arrayData->Pointers.data(), arrayData->Children.data(), nullptr, ReleaseArray, arrayData };
+
+        dbase->Counters.Scanned(dbase->RecordCount());
+        dbase->Counters.Parsed((uint64_t)dbase->RecordCount() * handles.size());
+        return true;
+    }
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <thread>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+#include "dBaseParallel.hpp"
+
+/// <summary>
+/// State of an asynchronous operation.
+/// </summary>
+enum class DBaseOperationState : int
+{
+    Running = 0,
+    Completed = 1,
+    Cancelled = 2,
+    Failed = 3,
+};
+
+/// <summary>
+/// An operation that runs in the background. Progress is counted in records,
+/// cancellation is cooperative and checked once per block of records.
+/// </summary>
+class DBaseOperation
+{
+    mutable std::mutex Mutex;
+    mutable std::condition_variable Condition;
+    bool Finished = false;
+
+    // object made by the operation for the host and how to free it if nobody takes it
+    void* Result = nullptr;
+    void (*FreeResult)(void*) = nullptr;
+
+public:
+    const int Id;
+
+    // DBASE the operation works on, nullptr if it works on none
+    const void* const Target;
+
+    std::atomic<uint64_t> Done{ 0 };
+    std::atomic<uint64_t> Total{ 0 };
+    std::atomic<bool> CancelRequested{ false };
+    std::atomic<DBaseOperationState> State{ DBaseOperationState::Running };
+
+    DBaseOperation(int id, const void* target) noexcept : Id(id), Target(target) {}
+
+    DBaseOperation(const DBaseOperation&) = delete;
+    DBaseOperation& operator=(const DBaseOperation&) = delete;
+
+    ~DBaseOperation()
+    {
+        if (Result) FreeResult(Result);
+    }
+
+    /// <summary>
+    /// Keep an object made by the operation until the host takes it, called by the work.
+    /// </summary>
+    template<typename T>
+    void Keep(T* result) noexcept
+    {
+        Result = result;
+        FreeResult = [](void* object) { delete static_cast<T*>(object); };
+    }
+
+    /// <summary>
+    /// Take the object kept by the operation, nullptr while it is running or if there is none.
+    /// </summary>
+    template<typename T>
+    T* Take() noexcept
+    {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (State.load() == DBaseOperationState::Running) return nullptr;
+
+        return static_cast<T*>(std::exchange(Result, nullptr));
+    }
+
+    bool Cancelled() const noexcept { return CancelRequested.load(std::memory_order_relaxed); }
+    void Cancel() noexcept { CancelRequested.store(true, std::memory_order_relaxed); }
+    void Progress(uint64_t records) noexcept { Done.fetch_add(records, std::memory_order_relaxed); }
+
+    /// <summary>
+    /// Set the final state, the completion callback already sees it.
+    /// </summary>
+    void Complete(DBaseOperationState state) noexcept { State.store(state); }
+
+    /// <summary>
+    /// Wake up the waiters, called once the completion callback returned.
+    /// </summary>
+    void Finish() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Finished = true;
+        }
+
+        Condition.notify_all();
+    }
+
+    /// <summary>
+    /// Block until the operation has finished and its completion callback returned.
+    /// </summary>
+    DBaseOperationState Wait() const noexcept
+    {
+        std::unique_lock<std::mutex> lock(Mutex);
+        Condition.wait(lock, [this]() { return Finished; });
+        return State.load();
+    }
+};
+
+namespace DBaseAsync
+{
+    using Work = std::function<DBaseOperationState(DBaseOperation&)>;
+    using Completion = std::function<void(const DBaseOperation&)>;
+
+    /// <summary>
+    /// Returns the pool the operations run on. The record blocks of an operation
+    /// run on the shared pool, this one only drives the operations, so it has
+    /// workers even on a single core where the shared pool has none.
+    /// </summary>
+    inline DBaseThreadPool& Pool() noexcept
+    {
+        static auto pool = new DBaseThreadPool(std::max(2u, std::thread::hardware_concurrency() / 2));
+        return *pool;
+    }
+
+    struct Registry
+    {
+        std::mutex Mutex;
+        std::unordered_map<int, std::shared_ptr<DBaseOperation>> Operations;
+        // operations that did not finish yet, released ones included
+        std::vector<std::shared_ptr<DBaseOperation>> Running;
+        int Next = 1;
+    };
+
+    /// <summary>
+    /// Returns the operation the calling pool thread runs, nullptr on other threads.
+    /// </summary>
+    inline const DBaseOperation*& Current() noexcept
+    {
+        thread_local const DBaseOperation* current = nullptr;
+        return current;
+    }
+
+    inline Registry& Operations() noexcept
+    {
+        static auto registry = new Registry();
+        return *registry;
+    }
+
+    /// <summary>
+    /// Queue an operation. The operation stays known until it is released.
+    /// </summary>
+    /// <param name="work">Runs the operation and returns its final state.</param>
+    /// <param name="done">Called on the pool thread once the operation finished and before Wait returns, may be empty.</param>
+    /// <param name="target">DBASE the operation works on, Drain waits for it before the DBASE is freed.</param>
+    /// <returns>Id of the operation.</returns>
+    inline int Start(Work work, Completion done = {}, const void* target = nullptr) noexcept
+    {
+        auto& registry = Operations();
+        std::shared_ptr<DBaseOperation> operation;
+        {
+            std::lock_guard<std::mutex> lock(registry.Mutex);
+            operation = std::make_shared<DBaseOperation>(registry.Next++, target);
+            registry.Operations[operation->Id] = operation;
+            registry.Running.push_back(operation);
+        }
+
+        Pool().Submit([operation, work = std::move(work), done = std::move(done)]()
+        {
+            Current() = operation.get();
+
+            // cancelled while it was queued
+            const auto state = operation->Cancelled() ? DBaseOperationState::Cancelled : work(*operation);
+
+            // a host that waits for the operation also sees what its callback did
+            operation->Complete(state);
+            if (done) done(*operation);
+
+            {
+                auto& registry = Operations();
+                std::lock_guard<std::mutex> lock(registry.Mutex);
+                std::erase(registry.Running, operation);
+            }
+
+            Current() = nullptr;
+            operation->Finish();
+        });
+
+        return operation->Id;
+    }
+
+    /// <summary>
+    /// Returns the operation with the given id or nullptr if it is not known.
+    /// </summary>
+    inline std::shared_ptr<DBaseOperation> Find(int id) noexcept
+    {
+        auto& registry = Operations();
+        std::lock_guard<std::mutex> lock(registry.Mutex);
+
+        const auto it = registry.Operations.find(id);
+        return it != registry.Operations.end() ? it->second : nullptr;
+    }
+
+    /// <summary>
+    /// Forget a finished operation, a running one is cancelled and still runs to its end.
+    /// </summary>
+    inline bool Release(int id) noexcept
+    {
+        auto& registry = Operations();
+        std::lock_guard<std::mutex> lock(registry.Mutex);
+
+        const auto it = registry.Operations.find(id);
+        if (it == registry.Operations.end()) return false;
+
+        it->second->Cancel();
+        registry.Operations.erase(it);
+        return true;
+    }
+
+    /// <summary>
+    /// Cancel the operations on a DBASE and wait until they finished, called
+    /// before the DBASE is freed or replaced. Released operations are waited
+    /// for as well. A completion callback may free the DBASE of its own
+    /// operation, that one has already stopped working on it.
+    /// </summary>
+    /// <returns>Number of operations waited for.</returns>
+    inline size_t Drain(const void* target) noexcept
+    {
+        if (!target) return 0;
+
+        auto& registry = Operations();
+        std::vector<std::shared_ptr<DBaseOperation>> pending;
+        {
+            std::lock_guard<std::mutex> lock(registry.Mutex);
+
+            for (const auto& operation : registry.Running)
+            {
+                if (operation->Target == target && operation.get() != Current()) pending.push_back(operation);
+            }
+        }
+
+        for (const auto& operation : pending) operation->Cancel();
+        for (const auto& operation : pending) operation->Wait();
+
+        return pending.size();
+    }
+
+    /// <summary>
+    /// Run fn(begin, end) over [0, count) in blocks on the shared pool. Once the
+    /// operation is cancelled the blocks that did not start yet are skipped.
+    /// </summary>
+    /// <returns>Completed, or Cancelled if some blocks were skipped.</returns>
+    template<typename Fn>
+    DBaseOperationState For(DBaseOperation& operation, size_t count, Fn&& fn, size_t blockSize = DBaseParallel::DEFAULT_BLOCK_SIZE) noexcept
+    {
+        operation.Total.store(count);
+
+        DBaseParallel::For(count, [&](size_t begin, size_t end, size_t)
+        {
+            // without helpers the pool hands out the whole range at once
+            for (auto block = begin; block < end && !operation.Cancelled(); block += blockSize)
+            {
+                const auto blockEnd = std::min(end, block + blockSize);
+
+                fn(block, blockEnd);
+                operation.Progress(blockEnd - block);
+            }
+        }, blockSize);
+
+        return operation.Done.load() == count ? DBaseOperationState::Completed : DBaseOperationState::Cancelled;
+    }
+}
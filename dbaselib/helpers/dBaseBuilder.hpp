@@ -0,0 +1,304 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+
+#include "dBase.hpp"
+#include "dBase3.hpp"
+#include "dBaseFile.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseKernels.hpp"
+#include "dBaseNumeric.hpp"
+
+/// <summary>
+/// Creates a new DBASE III file record by record. The fields are declared
+/// first, then records are appended to a fixed size buffer that is written
+/// to the file whenever it is full, so the file can be any size. The header
+/// gets the final record count on Close.
+/// </summary>
+class DBaseBuilder
+{
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024;
+
+private:
+    std::vector<DBase3FieldDescriptor> Fields;
+    std::vector<size_t> Offsets;
+    std::unordered_map<std::string, size_t> Names;
+
+    DBaseFile::Native Handle = DBaseFile::INVALID;
+    uint64_t Offset = 0;
+    uint64_t Records = 0;
+    size_t RowSize = 1;
+    size_t BufferSize;
+    std::vector<char> Buffer;
+    size_t Used = 0;
+    bool Failed = false;
+
+    char* Current() noexcept { return Used ? Buffer.data() + Used - RowSize : nullptr; }
+
+    bool Flush() noexcept
+    {
+        if (Used && !Failed) Failed = !DBaseFile::WriteAt(Handle, Offset, Buffer.data(), Used);
+
+        Offset += Used;
+        Used = 0;
+        return !Failed;
+    }
+
+    /// <summary>
+    /// Returns the data of a field in the current record or nullptr.
+    /// </summary>
+    char* Field(size_t field) noexcept
+    {
+        const auto record = Current();
+        return record && field < Fields.size() ? record + Offsets[field] : nullptr;
+    }
+
+public:
+    explicit DBaseBuilder(size_t bufferSize = DEFAULT_BUFFER_SIZE) noexcept : BufferSize(bufferSize) {}
+
+    ~DBaseBuilder() { if (Handle != DBaseFile::INVALID) DBaseFile::Close(Handle); }
+
+    DBaseBuilder(const DBaseBuilder&) = delete;
+    DBaseBuilder& operator=(const DBaseBuilder&) = delete;
+
+    /// <summary>
+    /// Check the type, length and decimals of a field. Dates are always 8 and logicals 1 long.
+    /// </summary>
+    /// <param name="type">C, N, F, D or L.</param>
+    /// <param name="length">Size of the field, up to 254 for characters and 20 for numbers.</param>
+    /// <param name="decimals">Decimals of a number, less than its length.</param>
+    static bool CheckField(char type, size_t& length, size_t& decimals) noexcept
+    {
+        switch (type)
+        {
+        case 'C':
+            return length >= 1 && length <= 254 && !decimals;
+
+        case 'N':
+        case 'F':
+            return length >= 1 && length <= 20 && (!decimals || decimals + 2 <= length);
+
+        case 'D':
+            length = 8;
+            decimals = 0;
+            return true;
+
+        case 'L':
+            length = 1;
+            decimals = 0;
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Declare a field, see CheckField for the types and sizes.
+    /// </summary>
+    /// <param name="name">Name of the field, 1 to 10 characters and unique.</param>
+    /// <returns>False if the field is invalid or the file is already open.</returns>
+    bool AddField(const std::string& name, char type, size_t length, size_t decimals = 0) noexcept
+    {
+        if (Handle != DBaseFile::INVALID || name.empty() || name.size() > 10 || Names.count(name)) return false;
+        if (!CheckField(type, length, decimals)) return false;
+
+        if (RowSize + length > UINT16_MAX) return false;
+
+        Names[name] = Fields.size();
+        Fields.push_back(DBaseUtils::MakeField(name, type, length, decimals));
+        Offsets.push_back(RowSize);
+        RowSize += length;
+        return true;
+    }
+
+    /// <summary>
+    /// Declare a field like an existing one.
+    /// </summary>
+    bool AddField(const DBaseHandle* handle) noexcept
+    {
+        return AddField(handle->Name(), handle->Type(), handle->Size(), handle->Decimals());
+    }
+
+    /// <summary>
+    /// Returns the index of a field or -1 if it does not exist.
+    /// </summary>
+    int Find(const std::string& name) const noexcept
+    {
+        const auto it = Names.find(name);
+        return it != Names.end() ? (int)it->second : -1;
+    }
+
+    /// <summary>
+    /// Size of a record including the deleted flag.
+    /// </summary>
+    size_t RecordSize() const noexcept { return RowSize; }
+
+    uint64_t RecordCount() const noexcept { return Records; }
+
+    /// <summary>
+    /// Create the file, an existing one is replaced. The header is written now
+    /// and again on Close with the record count.
+    /// </summary>
+    bool Open(const std::filesystem::path& file) noexcept
+    {
+        if (Handle != DBaseFile::INVALID || Fields.empty()) return false;
+
+        Handle = DBaseFile::Open(file, false);
+        if (Handle == DBaseFile::INVALID) return false;
+
+        std::vector<char> header(DBaseUtils::HeaderSize(Fields.size()));
+        DBaseUtils::WriteHeader(header.data(), Fields, 0);
+
+        Buffer.resize(std::max(BufferSize / RowSize, size_t(1)) * RowSize);
+        Offset = header.size();
+        Failed = !DBaseFile::WriteAt(Handle, 0, header.data(), header.size());
+        return !Failed;
+    }
+
+    /// <summary>
+    /// Start a new record with all fields blank, the setters fill the current record.
+    /// </summary>
+    bool Append() noexcept
+    {
+        const auto record = Reserve();
+        if (record) memset(record, ' ', RowSize);
+        return record != nullptr;
+    }
+
+    /// <summary>
+    /// Start a new record that the caller writes as a whole, deleted flag first.
+    /// </summary>
+    /// <returns>The record in the buffer or nullptr if it could not be added.</returns>
+    char* Reserve() noexcept
+    {
+        if (Handle == DBaseFile::INVALID || (Used == Buffer.size() && !Flush())) return nullptr;
+
+        Used += RowSize;
+        ++Records;
+        return Current();
+    }
+
+    /// <summary>
+    /// Append a record as it is stored, without its deleted flag.
+    /// </summary>
+    bool AppendRaw(const char* record) noexcept
+    {
+        if (!Append()) return false;
+
+        memcpy(Current() + 1, record, RowSize - 1);
+        return true;
+    }
+
+    /// <summary>
+    /// Mark the current record as deleted.
+    /// </summary>
+    bool Delete() noexcept
+    {
+        const auto record = Current();
+        if (record) *record = '*';
+        return record != nullptr;
+    }
+
+    /// <summary>
+    /// Set a field to text, left aligned and cut at the field size.
+    /// </summary>
+    bool SetText(size_t field, std::string_view text) noexcept
+    {
+        const auto data = Field(field);
+        if (!data) return false;
+
+        const auto size = (unsigned char)Fields[field].Lenght;
+        DBaseKernels::Active().FillCopy(data, size, text.data(), std::min<size_t>(size, text.size()));
+        return true;
+    }
+
+    /// <summary>
+    /// Set a field to a number with the decimals of the field.
+    /// </summary>
+    /// <returns>False if the field does not exist or the number does not fit, it is then filled with asterisks.</returns>
+    bool SetFloat(size_t field, double value) noexcept
+    {
+        const auto data = Field(field);
+        if (!data) return false;
+
+        return DBaseNumeric::FormatFloat(data, (unsigned char)Fields[field].Lenght, value, (unsigned char)Fields[field].Decimals);
+    }
+
+    /// <summary>
+    /// Set a field to an integer, with zero decimals if the field has decimals.
+    /// </summary>
+    bool SetInt(size_t field, long long value) noexcept
+    {
+        const auto data = Field(field);
+        if (!data) return false;
+
+        if (Fields[field].Decimals) return DBaseNumeric::FormatFloat(data, (unsigned char)Fields[field].Lenght, (double)value, (unsigned char)Fields[field].Decimals);
+        return DBaseNumeric::FormatInt(data, (unsigned char)Fields[field].Lenght, value);
+    }
+
+    /// <summary>
+    /// Set a date field (YYYYMMDD).
+    /// </summary>
+    bool SetDate(size_t field, int d, int m, int y) noexcept
+    {
+        const auto data = Field(field);
+        if (!data || Fields[field].Lenght != 8 || y < 0 || y > 9999 || m < 1 || m > 12 || d < 1 || d > 31) return false;
+
+        auto date = y * 10000 + m * 100 + d;
+        for (int i = 7; i >= 0; --i, date /= 10) data[i] = (char)('0' + date % 10);
+        return true;
+    }
+
+    /// <summary>
+    /// Set a logical field to T or F.
+    /// </summary>
+    bool SetLogical(size_t field, bool value) noexcept
+    {
+        const auto data = Field(field);
+        if (!data) return false;
+
+        *data = value ? 'T' : 'F';
+        return true;
+    }
+
+    /// <summary>
+    /// Blank a field, which reads as a null.
+    /// </summary>
+    bool Clear(size_t field) noexcept
+    {
+        const auto data = Field(field);
+        if (data) memset(data, ' ', (unsigned char)Fields[field].Lenght);
+        return data != nullptr;
+    }
+
+    /// <summary>
+    /// Write the remaining records, the eof marker and the header with the record count.
+    /// </summary>
+    /// <returns>True if the whole file was written.</returns>
+    bool Close() noexcept
+    {
+        if (Handle == DBaseFile::INVALID) return false;
+
+        Flush();
+
+        const char eof = 0x1A;
+        std::vector<char> header(DBaseUtils::HeaderSize(Fields.size()));
+        DBaseUtils::WriteHeader(header.data(), Fields, (size_t)Records);
+
+        const auto ok = !Failed && DBaseFile::WriteAt(Handle, Offset, &eof, 1) && DBaseFile::WriteAt(Handle, 0, header.data(), header.size());
+
+        DBaseFile::Close(Handle);
+        Handle = DBaseFile::INVALID;
+        std::vector<char>().swap(Buffer);
+        return ok;
+    }
+};
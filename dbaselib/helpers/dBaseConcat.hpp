@@ -0,0 +1,175 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+
+#include "dBase.hpp"
+#include "dBaseFile.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseReader.hpp"
+#include "dBaseBuilder.hpp"
+
+namespace DBaseConcat
+{
+    /// <summary>
+    /// Returns true if two tables have the same fields in the same order,
+    /// with the same names, types, sizes and decimals.
+    /// </summary>
+    inline bool SameFields(const DBase* a, const DBase* b) noexcept
+    {
+        if (a->Fields() != b->Fields()) return false;
+
+        for (const auto& name : a->Fields())
+        {
+            const auto x = a->Select(name);
+            const auto y = b->Select(name);
+
+            if (x->Type() != y->Type() || x->Size() != y->Size() || x->Decimals() != y->Decimals() || x->Offset() != y->Offset()) return false;
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Append the live records of many DBASE files with the same fields to one
+    /// new file. All headers are checked before anything is written, then the
+    /// record area of every file is mapped and its live records are copied
+    /// through the 4 MB buffer of a DBaseBuilder, which writes one header with
+    /// the total count at the end.
+    /// </summary>
+    /// <param name="files">Files to append in this order.</param>
+    /// <param name="output">File to write, has to be none of the inputs.</param>
+    /// <returns>Number of records written or -1 if the fields differ or on an error.</returns>
+    static int64_t Concat(const std::vector<std::filesystem::path>& files, const std::filesystem::path& output) noexcept
+    {
+        if (files.empty()) return -1;
+
+        struct Input
+        {
+            size_t HeaderSize;
+            size_t RecordSize;
+            uint64_t Records;
+        };
+
+        std::vector<Input> inputs;
+        DBaseReader first;
+        DBaseBuilder builder;
+
+        for (const auto& file : files)
+        {
+            std::error_code error;
+            if (std::filesystem::equivalent(file, output, error)) return -1;
+
+            DBaseReader next;
+            auto& reader = inputs.empty() ? first : next;
+
+            if (!reader.Open(file) || !SameFields(first.Fields(), reader.Fields())) return -1;
+            inputs.push_back({ reader.HeaderSize(), reader.RecordSize(), reader.Records() });
+        }
+
+        for (const auto& name : first.Fields()->Fields()) builder.AddField(first.Fields()->Select(name));
+        if (!builder.Open(output)) return -1;
+
+        auto ok = true;
+
+        for (size_t i = 0; i < files.size() && ok; ++i)
+        {
+            const auto& input = inputs[i];
+
+            DBaseMappedFile source;
+            ok = source.OpenRead(files[i]) && source.Size >= input.HeaderSize + input.Records * input.RecordSize;
+
+            auto row = source.Data + input.HeaderSize;
+
+            for (uint64_t r = 0; r < input.Records && ok; ++r, row += input.RecordSize)
+            {
+                // deleted records and rows with another flag are left out like Load does
+                if (*row != ' ') continue;
+
+                const auto record = builder.Reserve();
+                if (record) memcpy(record, row, input.RecordSize);
+
+                ok = record && builder.RecordCount() <= UINT32_MAX;
+            }
+        }
+
+        const auto records = (int64_t)builder.RecordCount();
+        return builder.Close() && ok ? records : -1;
+    }
+}
+
+/// <summary>
+/// Several loaded DBASEs with the same fields read as one table without
+/// copying. Rows are numbered across the tables in the order they were added
+/// and a row is found by a binary search over the first row of every table.
+/// </summary>
+class DBaseUnion
+{
+    std::vector<const DBase*> Parts;
+
+    // first row of every part and the total row count at the end
+    std::vector<size_t> Starts{ 0 };
+
+public:
+    /// <summary>
+    /// Add a table, it has to outlive the union.
+    /// </summary>
+    /// <returns>False if its fields differ from the first table.</returns>
+    bool Add(const DBase* dbase) noexcept
+    {
+        if (!dbase || (!Parts.empty() && !DBaseConcat::SameFields(Parts.front(), dbase))) return false;
+
+        Parts.push_back(dbase);
+        Starts.push_back(Starts.back() + dbase->RecordCount());
+        return true;
+    }
+
+    /// <summary>
+    /// Number of live records of all tables.
+    /// </summary>
+    size_t RecordCount() const noexcept { return Starts.back(); }
+
+    size_t PartCount() const noexcept { return Parts.size(); }
+
+    const DBase* Part(size_t part) const noexcept { return Parts[part]; }
+
+    /// <summary>
+    /// Returns the table of a row and the row in that table.
+    /// </summary>
+    std::pair<size_t, size_t> Locate(size_t row) const noexcept
+    {
+        const auto part = (size_t)(std::upper_bound(Starts.begin(), Starts.end(), row) - Starts.begin()) - 1;
+        return { part, row - Starts[part] };
+    }
+
+    /// <summary>
+    /// Returns a record after its deleted flag.
+    /// </summary>
+    const char* Record(size_t row) const noexcept
+    {
+        const auto [part, local] = Locate(row);
+        return Parts[part]->Records[local];
+    }
+
+    /// <summary>
+    /// Returns the handle of a field, its offset and size hold for every table, or nullptr.
+    /// </summary>
+    const DBaseHandle* Select(const std::string& col) const noexcept
+    {
+        return Parts.empty() ? nullptr : DBaseUtils::Find(Parts.front(), col);
+    }
+
+    /// <summary>
+    /// Returns the raw text of a field in a row.
+    /// </summary>
+    std::string_view GetText(size_t row, const DBaseHandle* handle) const noexcept
+    {
+        return std::string_view(Record(row) + handle->Offset(), handle->Size());
+    }
+};
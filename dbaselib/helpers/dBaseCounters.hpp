@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// set to 0 to compile the counters out, every call below becomes an empty inline function
+#ifndef DBASELIB_COUNTERS
+#define DBASELIB_COUNTERS 1
+#endif
+
+/// <summary>
+/// Timed phases of a DBASE. Work from file to file without a loaded DBASE
+/// (CSV import, Feather and Parquet conversion, AlterSchema, ConcatFiles and
+/// SortFile) has no DBASE to count on and is not counted.
+/// </summary>
+enum class DBasePhase : int
+{
+    Read,
+    Load,
+    Save,
+    Sort,
+    GroupBy,
+    Join,
+    Stats,
+    Profile,
+    Csv,
+    Columnar,
+    Diff,
+    Fingerprint,
+    SaveAs,
+    Partition,
+    Count,
+};
+
+/// <summary>
+/// A relaxed atomic counter. Callers add whole blocks at once, never single
+/// cells, so the shared cache line is touched once per block.
+/// </summary>
+class DBaseCounter
+{
+    std::atomic<uint64_t> Value{ 0 };
+
+public:
+    void Add(uint64_t n) noexcept { Value.fetch_add(n, std::memory_order_relaxed); }
+    void Reset() noexcept { Value.store(0, std::memory_order_relaxed); }
+    uint64_t Get() const noexcept { return Value.load(std::memory_order_relaxed); }
+};
+
+/// <summary>
+/// Calls, total wall time and a latency histogram of a phase. Bucket i
+/// counts calls that took [2^i, 2^(i+1)) nanoseconds.
+/// </summary>
+struct DBasePhaseTimes
+{
+    static constexpr size_t BUCKETS = 40;
+
+    DBaseCounter Calls;
+    DBaseCounter Nanoseconds;
+    DBaseCounter Histogram[BUCKETS];
+
+    void Record(uint64_t nanoseconds) noexcept
+    {
+        size_t bucket = 0;
+        while (bucket + 1 < BUCKETS && (nanoseconds >> (bucket + 1))) ++bucket;
+
+        Calls.Add(1);
+        Nanoseconds.Add(nanoseconds);
+        Histogram[bucket].Add(1);
+    }
+
+    void Reset() noexcept
+    {
+        Calls.Reset();
+        Nanoseconds.Reset();
+        for (auto& bucket : Histogram) bucket.Reset();
+    }
+};
+
+#if DBASELIB_COUNTERS
+
+/// <summary>
+/// Counters kept per DBASE: I/O volume, rows and cells touched and the time spent per phase.
+/// </summary>
+class DBaseCounters
+{
+public:
+    static constexpr bool ENABLED = true;
+
+    DBaseCounter BytesRead;
+    DBaseCounter BytesWritten;
+    DBaseCounter RowsScanned;
+    DBaseCounter CellsParsed;
+    DBaseCounter CellsFormatted;
+    DBasePhaseTimes Phases[(size_t)DBasePhase::Count];
+
+    /// <summary>
+    /// Times a phase from construction until destruction.
+    /// </summary>
+    class Scope
+    {
+        DBaseCounters& Counters;
+        DBasePhase Phase;
+        std::chrono::steady_clock::time_point Start;
+
+    public:
+        Scope(DBaseCounters& counters, DBasePhase phase) noexcept
+            : Counters(counters),
+            Phase(phase),
+            Start(std::chrono::steady_clock::now())
+        {}
+
+        ~Scope() { Counters.Record(Phase, Start); }
+    };
+
+    void Read(uint64_t bytes) noexcept { BytesRead.Add(bytes); }
+    void Written(uint64_t bytes) noexcept { BytesWritten.Add(bytes); }
+    void Scanned(uint64_t rows) noexcept { RowsScanned.Add(rows); }
+
+    // whole blocks from the bulk operations, the handles do not count single cells
+    void Parsed(uint64_t cells) noexcept { CellsParsed.Add(cells); }
+    void Formatted(uint64_t cells) noexcept { CellsFormatted.Add(cells); }
+
+    void Record(DBasePhase phase, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now()) noexcept
+    {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        Phases[(size_t)phase].Record((uint64_t)elapsed);
+    }
+
+    const DBasePhaseTimes& Phase(DBasePhase phase) const noexcept { return Phases[(size_t)phase]; }
+
+    void Reset() noexcept
+    {
+        BytesRead.Reset();
+        BytesWritten.Reset();
+        RowsScanned.Reset();
+        CellsParsed.Reset();
+        CellsFormatted.Reset();
+        for (auto& phase : Phases) phase.Reset();
+    }
+};
+
+#else
+
+class DBaseCounters
+{
+public:
+    static constexpr bool ENABLED = false;
+
+    class Scope
+    {
+    public:
+        Scope(DBaseCounters&, DBasePhase) noexcept {}
+    };
+
+    void Read(uint64_t) noexcept {}
+    void Written(uint64_t) noexcept {}
+    void Scanned(uint64_t) noexcept {}
+    void Parsed(uint64_t) noexcept {}
+    void Formatted(uint64_t) noexcept {}
+    void Record(DBasePhase, std::chrono::steady_clock::time_point, std::chrono::steady_clock::time_point = {}) noexcept {}
+    void Reset() noexcept {}
+};
+
+#endif
@@ -0,0 +1,779 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#include "dBase.hpp"
+#include "dBaseFile.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseKernels.hpp"
+#include "dBaseParallel.hpp"
+
+/// <summary>
+/// How a DBASE is written as CSV.
+/// </summary>
+struct DBaseCsvOptions
+{
+    char Delimiter = ',';
+
+    /// <summary>
+    /// Write the field names as the first line.
+    /// </summary>
+    bool Header = true;
+
+    /// <summary>
+    /// End lines with \r\n (RFC 4180) instead of \n.
+    /// </summary>
+    bool CrLf = true;
+
+    /// <summary>
+    /// Approximate size of the text of a block of records formatted by one thread.
+    /// </summary>
+    size_t BlockBytes = 4 * 1024 * 1024;
+};
+
+/// <summary>
+/// How a CSV file is read into a new DBASE.
+/// </summary>
+struct DBaseCsvImportOptions
+{
+    char Delimiter = ',';
+
+    /// <summary>
+    /// The first line holds the field names, otherwise the fields are named F1, F2, ...
+    /// </summary>
+    bool Header = true;
+
+    /// <summary>
+    /// Minimum size of the ranges of the file parsed by one thread.
+    /// </summary>
+    size_t ChunkBytes = 1024 * 1024;
+};
+
+namespace DBaseCsv
+{
+    struct Column
+    {
+        const DBaseHandle* Handle;
+        size_t Offset;
+        size_t Size;
+        char Type;
+    };
+
+    /// <summary>
+    /// Append a value, quoted and with doubled quotes only if it contains a quote, the delimiter or a line break.
+    /// </summary>
+    inline char* WriteValue(char* out, const char* value, size_t size, char delimiter) noexcept
+    {
+        const auto& kernels = DBaseKernels::Active();
+        auto special = kernels.FindStructural(value, size, delimiter);
+
+        if (special == size)
+        {
+            memcpy(out, value, size);
+            return out + size;
+        }
+
+        *out++ = '"';
+
+        for (size_t i = 0; i < size;)
+        {
+            memcpy(out, value + i, special - i);
+            out += special - i;
+
+            if (special == size) break;
+            if (value[special] == '"') *out++ = '"';
+
+            *out++ = value[special];
+            i = special + 1;
+            special = i + kernels.FindStructural(value + i, size - i, delimiter);
+        }
+
+        *out++ = '"';
+        return out;
+    }
+
+    /// <summary>
+    /// Append a field straight from the record bytes. Characters keep their leading
+    /// spaces, numbers are trimmed on both sides and dates become YYYY-MM-DD.
+    /// </summary>
+    inline char* WriteField(char* out, const char* field, const Column& column, char delimiter) noexcept
+    {
+        const auto& kernels = DBaseKernels::Active();
+        auto size = kernels.TrimRight(field, column.Size);
+
+        switch (column.Type)
+        {
+        case 'N':
+        case 'F':
+        {
+            const auto start = kernels.SkipSpaces(field, size);
+            return WriteValue(out, field + start, size - start, delimiter);
+        }
+
+        case 'D':
+            if (size == 8 && std::all_of(field, field + 8, [](char c) { return c >= '0' && c <= '9'; }))
+            {
+                memcpy(out, field, 4);
+                out[4] = '-';
+                memcpy(out + 5, field + 4, 2);
+                out[7] = '-';
+                memcpy(out + 8, field + 6, 2);
+                return out + 10;
+            }
+
+            return WriteValue(out, field, size, delimiter);
+
+        case 'L':
+            // uninitialized logicals are written as empty values
+            if (size == 1 && *field == '?') return out;
+            return WriteValue(out, field, size, delimiter);
+
+        default:
+            return WriteValue(out, field, size, delimiter);
+        }
+    }
+
+    /// <summary>
+    /// Returns the largest number of bytes a single record can take as a line.
+    /// </summary>
+    inline size_t MaxLineSize(const std::vector<Column>& columns) noexcept
+    {
+        // every byte may be a quote that is doubled, plus the enclosing quotes and the delimiter
+        size_t size = 2;
+        for (const auto& column : columns) size += std::max<size_t>(column.Size * 2 + 2, 10) + 1;
+        return size;
+    }
+
+    /// <summary>
+    /// Write the records of a DBASE as a CSV file. Blocks of records are formatted
+    /// in parallel and written at their position, so the lines keep the record order.
+    /// Text is written in the code page of the DBASE.
+    /// </summary>
+    /// <param name="dbase">Loaded DBASE.</param>
+    /// <param name="file">CSV file to write, replaced if it exists.</param>
+    /// <param name="fields">Fields to write in this order, empty for all fields.</param>
+    /// <returns>True if written, false if a field does not exist or the file could not be written.</returns>
+    static bool Export(const DBase* dbase, const std::filesystem::path& file, const std::vector<std::string>& fields = {}, const DBaseCsvOptions& options = {}) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Csv);
+
+        std::vector<Column> columns;
+
+        for (const auto& name : fields.empty() ? dbase->Fields() : fields)
+        {
+            const auto handle = DBaseUtils::Find(dbase, name);
+            if (!handle) return false;
+
+            columns.push_back({ handle, handle->Offset(), handle->Size(), handle->Type() });
+        }
+
+        const auto handle = DBaseFile::Open(file, false);
+        if (handle == DBaseFile::INVALID) return false;
+
+        const std::string_view newLine = options.CrLf ? "\r\n" : "\n";
+        const auto lineSize = MaxLineSize(columns);
+        const auto blockRows = std::max<size_t>(1, options.BlockBytes / lineSize);
+        const auto rows = dbase->RecordCount();
+
+        uint64_t offset = 0;
+        bool ok = true;
+
+        if (options.Header && !columns.empty())
+        {
+            std::string header(lineSize, '\0');
+            auto out = header.data();
+
+            for (size_t c = 0; c < columns.size(); ++c)
+            {
+                if (c) *out++ = options.Delimiter;
+                const auto name = columns[c].Handle->Name();
+                out = WriteValue(out, name, strlen(name), options.Delimiter);
+            }
+
+            memcpy(out, newLine.data(), newLine.size());
+            out += newLine.size();
+
+            const auto size = (size_t)(out - header.data());
+            ok = DBaseFile::WriteAt(handle, offset, header.data(), size);
+            offset += size;
+        }
+
+        // a round formats a few blocks per thread, then writes them one after another
+        const auto roundBlocks = DBaseParallel::Concurrency() * 2;
+        std::vector<std::vector<char>> buffers(roundBlocks);
+        std::vector<size_t> sizes(roundBlocks);
+
+        for (size_t first = 0; ok && first < rows; first += roundBlocks * blockRows)
+        {
+            const auto blocks = std::min(roundBlocks, (rows - first + blockRows - 1) / blockRows);
+
+            DBaseParallel::For(blocks, [&](size_t begin, size_t end, size_t)
+            {
+                for (auto block = begin; block < end; ++block)
+                {
+                    const auto start = first + block * blockRows;
+                    const auto stop = std::min(rows, start + blockRows);
+
+                    auto& buffer = buffers[block];
+                    buffer.resize((stop - start) * lineSize);
+                    auto out = buffer.data();
+
+                    for (auto row = start; row < stop; ++row)
+                    {
+                        const auto record = dbase->Records[row];
+
+                        for (size_t c = 0; c < columns.size(); ++c)
+                        {
+                            if (c) *out++ = options.Delimiter;
+                            out = WriteField(out, record + columns[c].Offset, columns[c], options.Delimiter);
+                        }
+
+                        memcpy(out, newLine.data(), newLine.size());
+                        out += newLine.size();
+                    }
+
+                    sizes[block] = (size_t)(out - buffer.data());
+                }
+            }, 1);
+
+            for (size_t block = 0; ok && block < blocks; ++block)
+            {
+                ok = DBaseFile::WriteAt(handle, offset, buffers[block].data(), sizes[block]);
+                offset += sizes[block];
+            }
+        }
+
+        DBaseFile::Close(handle);
+
+        if (ok)
+        {
+            dbase->Counters.Scanned(rows);
+            dbase->Counters.Formatted((uint64_t)rows * columns.size());
+            dbase->Counters.Written(offset);
+        }
+
+        return ok;
+    }
+
+    /// <summary>
+    /// A value of a CSV line. Quoted values point inside the quotes and may
+    /// still contain doubled quotes, Quotes counts them.
+    /// </summary>
+    struct Value
+    {
+        const char* Data = nullptr;
+        size_t Size = 0;
+        size_t Quotes = 0;
+    };
+
+    /// <summary>
+    /// Move to the next delimiter or line break, quotes in unquoted values are plain characters.
+    /// </summary>
+    inline void SkipValue(const char*& p, const char* end, char delimiter) noexcept
+    {
+        const auto& kernels = DBaseKernels::Active();
+
+        for (;;)
+        {
+            p += kernels.FindStructural(p, (size_t)(end - p), delimiter);
+            if (p == end || *p != '"') return;
+            ++p;
+        }
+    }
+
+    /// <summary>
+    /// Read a value and the delimiter or line break after it.
+    /// </summary>
+    /// <returns>True if the value ends the line.</returns>
+    inline bool ReadValue(const char*& p, const char* end, char delimiter, Value& value) noexcept
+    {
+        if (p < end && *p == '"')
+        {
+            const auto start = ++p;
+            size_t quotes = 0;
+
+            for (;;)
+            {
+                const auto quote = static_cast<const char*>(memchr(p, '"', (size_t)(end - p)));
+
+                if (!quote)
+                {
+                    // unterminated, the value runs until the end of the file
+                    value = { start, (size_t)(end - start), quotes };
+                    p = end;
+                    return true;
+                }
+
+                if (quote + 1 < end && quote[1] == '"')
+                {
+                    ++quotes;
+                    p = quote + 2;
+                    continue;
+                }
+
+                value = { start, (size_t)(quote - start), quotes };
+                p = quote + 1;
+                break;
+            }
+
+            // text between the closing quote and the delimiter is dropped
+            SkipValue(p, end, delimiter);
+        }
+        else
+        {
+            const auto start = p;
+            SkipValue(p, end, delimiter);
+            value = { start, (size_t)(p - start), 0 };
+        }
+
+        if (p == end) return true;
+
+        if (*p == delimiter)
+        {
+            ++p;
+            return false;
+        }
+
+        if (*p == '\r' && ++p < end && *p == '\n') ++p;
+        else if (*p == '\n') ++p;
+
+        return true;
+    }
+
+    /// <summary>
+    /// Read a line into values, missing values stay empty and extra values are ignored.
+    /// </summary>
+    /// <returns>False for an empty line.</returns>
+    inline bool ReadLine(const char*& p, const char* end, char delimiter, std::vector<Value>& values) noexcept
+    {
+        std::fill(values.begin(), values.end(), Value{});
+
+        if (*p == '\r' || *p == '\n')
+        {
+            if (*p == '\r' && p + 1 < end && p[1] == '\n') ++p;
+            ++p;
+            return false;
+        }
+
+        Value value;
+        auto last = false;
+
+        for (size_t i = 0; !last; ++i)
+        {
+            last = ReadValue(p, end, delimiter, value);
+            if (i < values.size()) values[i] = value;
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// What the values of a column looked like, used to pick the field type.
+    /// </summary>
+    struct Inference
+    {
+        size_t Size = 0;
+        size_t IntegerDigits = 0;
+        size_t Decimals = 0;
+        bool Values = false;
+        bool Number = true;
+        bool Date = true;
+        bool Logical = true;
+
+        void Merge(const Inference& other) noexcept
+        {
+            Size = std::max(Size, other.Size);
+            IntegerDigits = std::max(IntegerDigits, other.IntegerDigits);
+            Decimals = std::max(Decimals, other.Decimals);
+            Values |= other.Values;
+            Number &= other.Number;
+            Date &= other.Date;
+            Logical &= other.Logical;
+        }
+    };
+
+    /// <summary>
+    /// Returns the value without surrounding spaces.
+    /// </summary>
+    inline std::string_view Trim(const Value& value) noexcept
+    {
+        const auto& kernels = DBaseKernels::Active();
+        const auto size = kernels.TrimRight(value.Data, value.Size);
+        const auto start = kernels.SkipSpaces(value.Data, size);
+        return std::string_view(value.Data + start, size - start);
+    }
+
+    inline bool IsDigit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+    /// <summary>
+    /// Checks for [+-]digits[.digits] with at least one digit.
+    /// </summary>
+    /// <param name="integerDigits">Digits before the point, including a minus sign.</param>
+    inline bool IsNumber(std::string_view text, size_t& integerDigits, size_t& decimals) noexcept
+    {
+        size_t i = 0;
+        const auto negative = !text.empty() && text[0] == '-';
+        if (!text.empty() && (text[0] == '-' || text[0] == '+')) ++i;
+
+        const auto integerStart = i;
+        while (i < text.size() && IsDigit(text[i])) ++i;
+        const auto integers = i - integerStart;
+
+        decimals = 0;
+
+        if (i < text.size() && text[i] == '.')
+        {
+            const auto decimalStart = ++i;
+            while (i < text.size() && IsDigit(text[i])) ++i;
+            decimals = i - decimalStart;
+        }
+
+        integerDigits = std::max<size_t>(integers, 1) + negative;
+        return i == text.size() && integers + decimals > 0;
+    }
+
+    /// <summary>
+    /// Checks for YYYY-MM-DD.
+    /// </summary>
+    inline bool IsDate(std::string_view text) noexcept
+    {
+        if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+
+        for (const auto i : { 0, 1, 2, 3, 5, 6, 8, 9 }) if (!IsDigit(text[i])) return false;
+        return true;
+    }
+
+    /// <summary>
+    /// Returns T or F for t, f, y, n, true, false, yes and no in any case, 0 for anything else.
+    /// </summary>
+    inline char ToLogical(std::string_view text) noexcept
+    {
+        if (text.empty() || text.size() > 5) return 0;
+
+        char lower[5];
+        for (size_t i = 0; i < text.size() && i < sizeof(lower); ++i) lower[i] = (char)(text[i] >= 'A' && text[i] <= 'Z' ? text[i] + 32 : text[i]);
+        const std::string_view word(lower, text.size());
+
+        if (word == "t" || word == "y" || word == "true" || word == "yes") return 'T';
+        if (word == "f" || word == "n" || word == "false" || word == "no") return 'F';
+        return 0;
+    }
+
+    inline void Infer(Inference& column, const Value& value) noexcept
+    {
+        const auto text = Trim(value);
+        if (text.empty()) return;
+
+        column.Values = true;
+        column.Size = std::max(column.Size, (size_t)(text.data() + text.size() - value.Data) - value.Quotes);
+
+        // doubled quotes are only possible in text
+        if (value.Quotes)
+        {
+            column.Number = column.Date = column.Logical = false;
+            return;
+        }
+
+        size_t integerDigits, decimals;
+
+        if (column.Number && IsNumber(text, integerDigits, decimals))
+        {
+            column.IntegerDigits = std::max(column.IntegerDigits, integerDigits);
+            column.Decimals = std::max(column.Decimals, decimals);
+        }
+        else column.Number = false;
+
+        if (column.Date && !IsDate(text)) column.Date = false;
+        if (column.Logical && !ToLogical(text)) column.Logical = false;
+    }
+
+    /// <summary>
+    /// Pick the field for a column: logical, date, numeric if every value fits, otherwise character.
+    /// </summary>
+    inline DBase3FieldDescriptor ToField(const std::string& name, const Inference& column) noexcept
+    {
+        constexpr size_t MAX_NUMBER = 20;
+        constexpr size_t MAX_TEXT = 254;
+
+        if (column.Values && column.Logical) return DBaseUtils::MakeField(name, 'L', 1);
+        if (column.Values && column.Date) return DBaseUtils::MakeField(name, 'D', 8);
+
+        const auto numberSize = column.IntegerDigits + (column.Decimals ? column.Decimals + 1 : 0);
+        if (column.Values && column.Number && numberSize <= MAX_NUMBER) return DBaseUtils::MakeField(name, 'N', numberSize, column.Decimals);
+
+        return DBaseUtils::MakeField(name, 'C', std::clamp<size_t>(column.Size, 1, MAX_TEXT));
+    }
+
+    /// <summary>
+    /// Turn the names of the header into unique field names of at most 10 characters.
+    /// </summary>
+    inline std::vector<std::string> ToFieldNames(const std::vector<Value>& header) noexcept
+    {
+        std::vector<std::string> names;
+
+        for (size_t i = 0; i < header.size(); ++i)
+        {
+            std::string name;
+
+            if (header[i].Data)
+            {
+                for (const auto c : Trim(header[i]))
+                {
+                    if (name.size() == 10) break;
+                    if (c == '"') continue;
+                    name += (char)(IsDigit(c) || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ? c : '_');
+                }
+            }
+
+            if (name.empty()) name = "F" + std::to_string(i + 1);
+
+            // make duplicates unique by replacing the end with a number
+            for (size_t n = 2; std::find(names.begin(), names.end(), name) != names.end(); ++n)
+            {
+                const auto suffix = std::to_string(n);
+                name = name.substr(0, std::min(name.size(), 10 - suffix.size())) + suffix;
+            }
+
+            names.push_back(name);
+        }
+
+        return names;
+    }
+
+    /// <summary>
+    /// Write a value into a field of a record.
+    /// </summary>
+    inline void WriteField(char* field, const DBase3FieldDescriptor& descriptor, const Value& value) noexcept
+    {
+        const auto& kernels = DBaseKernels::Active();
+        const auto size = (size_t)(unsigned char)descriptor.Lenght;
+
+        switch (descriptor.FieldType)
+        {
+        case 'L':
+        {
+            const auto logical = ToLogical(Trim(value));
+            *field = logical ? logical : '?';
+            return;
+        }
+
+        case 'D':
+        {
+            const auto text = Trim(value);
+            if (text.empty()) return kernels.FillCopy(field, size, "", 0);
+
+            memcpy(field, text.data(), 4);
+            memcpy(field + 4, text.data() + 5, 2);
+            memcpy(field + 6, text.data() + 8, 2);
+            return;
+        }
+
+        case 'N':
+        {
+            const auto text = Trim(value);
+            if (text.empty()) return kernels.FillCopy(field, size, "", 0);
+
+            // normalize to [-]digits[.decimals] with all decimals of the field
+            char buffer[32];
+            auto out = buffer;
+            size_t i = 0;
+
+            if (text[0] == '-' || text[0] == '+') if (text[i++] == '-') *out++ = '-';
+            if (i == text.size() || !IsDigit(text[i])) *out++ = '0';
+            while (i < text.size() && IsDigit(text[i])) *out++ = text[i++];
+
+            if (descriptor.Decimals)
+            {
+                *out++ = '.';
+                if (i < text.size()) ++i;
+
+                for (size_t d = 0; d < (size_t)descriptor.Decimals; ++d)
+                {
+                    *out++ = i < text.size() ? text[i++] : '0';
+                }
+            }
+
+            return kernels.FillCopyRight(field, size, buffer, (size_t)(out - buffer));
+        }
+
+        default:
+            if (!value.Quotes) return kernels.FillCopy(field, size, value.Data, value.Size);
+
+            // collapse the doubled quotes while copying
+            size_t written = 0;
+            for (size_t i = 0; i < value.Size && written < size; ++i)
+            {
+                field[written++] = value.Data[i];
+                if (value.Data[i] == '"') ++i;
+            }
+
+            memset(field + written, ' ', size - written);
+        }
+    }
+
+    /// <summary>
+    /// Create a DBASE III file from a CSV file. The file is split into ranges at
+    /// line breaks outside of quotes, found from the quote count before each
+    /// range, and the ranges are parsed in parallel twice: once to count the
+    /// records and infer the fields, once to write the records straight into
+    /// the mapped output file.
+    /// </summary>
+    /// <param name="csv">CSV file to read (RFC 4180 quoting).</param>
+    /// <param name="file">DBASE file to create, replaced if it exists.</param>
+    /// <returns>Number of records written, -1 if the files could not be read or written.</returns>
+    static int64_t Import(const std::filesystem::path& csv, const std::filesystem::path& file, const DBaseCsvImportOptions& options = {}) noexcept
+    {
+        DBaseMappedFile input;
+        if (!input.OpenRead(csv)) return -1;
+
+        const auto delimiter = options.Delimiter;
+        const char* end = input.Data + input.Size;
+        const char* p = input.Data;
+
+        // skip an utf-8 byte order mark
+        if (input.Size >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0) p += 3;
+
+        // the first line gives the number of columns
+        std::vector<Value> header;
+        Value value;
+
+        auto q = p;
+
+        for (auto last = p == end; !last;)
+        {
+            last = ReadValue(q, end, delimiter, value);
+            header.push_back(value);
+        }
+
+        if (options.Header && p < end) ReadLine(p, end, delimiter, header);
+
+        const auto columnCount = header.size();
+        if (columnCount == 0 || DBaseUtils::HeaderSize(columnCount) > UINT16_MAX) return -1;
+
+        const auto names = options.Header ? ToFieldNames(header) : ToFieldNames(std::vector<Value>(columnCount));
+        const auto body = p;
+        const auto bodySize = (size_t)(end - body);
+
+        // ranges of the file, each parses the lines that start in it
+        const auto chunkSize = std::max(options.ChunkBytes, bodySize / (DBaseParallel::Concurrency() * 4) + 1);
+        const auto chunks = std::max<size_t>(1, (bodySize + chunkSize - 1) / chunkSize);
+
+        std::vector<size_t> quotes(chunks);
+        DBaseParallel::For(chunks, [&](size_t begin, size_t stop, size_t)
+        {
+            for (auto c = begin; c < stop; ++c)
+            {
+                const auto from = body + c * chunkSize;
+                quotes[c] = (size_t)std::count(from, std::min(end, from + chunkSize), '"');
+            }
+        }, 1);
+
+        // a range starts after the first line break outside of quotes
+        std::vector<const char*> starts(chunks + 1, end);
+        starts[0] = body;
+        size_t quoteCount = 0;
+
+        for (size_t c = 1; c < chunks; ++c)
+        {
+            quoteCount += quotes[c - 1];
+            auto q = body + c * chunkSize;
+
+            for (auto quoted = (quoteCount & 1) != 0; q < end; ++q)
+            {
+                if (*q == '"') quoted = !quoted;
+                else if (!quoted && *q == '\n') break;
+            }
+
+            starts[c] = std::max(starts[c - 1], std::min(end, q + 1));
+        }
+
+        // pass one: count the records and look at the values
+        std::vector<size_t> rows(chunks);
+        std::vector<std::vector<Inference>> inferences(chunks, std::vector<Inference>(columnCount));
+        std::atomic<bool> aligned{ true };
+
+        const auto infer = [&](size_t begin, size_t stop, size_t)
+        {
+            std::vector<Value> values(columnCount);
+
+            for (auto c = begin; c < stop; ++c)
+            {
+                auto q = starts[c];
+                const auto limit = starts[c + 1];
+
+                while (q < limit)
+                {
+                    if (!ReadLine(q, end, delimiter, values)) continue;
+
+                    for (size_t i = 0; i < columnCount; ++i) if (values[i].Data) Infer(inferences[c][i], values[i]);
+                    ++rows[c];
+                }
+
+                // quotes inside unquoted values break the quote count, parse the file in one go then
+                if (q != limit) aligned = false;
+            }
+        };
+
+        DBaseParallel::For(chunks, infer, 1);
+
+        if (!aligned)
+        {
+            starts = { body, end };
+            rows.assign(1, 0);
+            inferences.assign(1, std::vector<Inference>(columnCount));
+            infer(0, 1, 0);
+        }
+
+        std::vector<Inference> columns(columnCount);
+        for (const auto& chunk : inferences) for (size_t i = 0; i < columnCount; ++i) columns[i].Merge(chunk[i]);
+
+        std::vector<DBase3FieldDescriptor> fields;
+        for (size_t i = 0; i < columnCount; ++i) fields.push_back(ToField(names[i], columns[i]));
+
+        std::vector<size_t> firstRow(rows.size() + 1, 0);
+        for (size_t c = 0; c < rows.size(); ++c) firstRow[c + 1] = firstRow[c] + rows[c];
+
+        const auto records = firstRow.back();
+        const auto headerSize = DBaseUtils::HeaderSize(columnCount);
+
+        size_t recordSize = 1;
+        for (const auto& field : fields) recordSize += (unsigned char)field.Lenght;
+        if (recordSize > UINT16_MAX || records > UINT32_MAX) return -1;
+
+        DBaseMappedFile output;
+        if (!output.Create(file, headerSize + records * recordSize + 1)) return -1;
+
+        DBaseUtils::WriteHeader(output.Data, fields, records);
+        output.Data[output.Size - 1] = 0x1A;
+
+        std::vector<size_t> offsets(columnCount);
+        for (size_t i = 1; i < columnCount; ++i) offsets[i] = offsets[i - 1] + (unsigned char)fields[i - 1].Lenght;
+
+        // pass two: every range writes its records at its first record
+        DBaseParallel::For(rows.size(), [&](size_t begin, size_t stop, size_t)
+        {
+            std::vector<Value> values(columnCount);
+
+            for (auto c = begin; c < stop; ++c)
+            {
+                auto q = starts[c];
+                auto record = output.Data + headerSize + firstRow[c] * recordSize;
+
+                while (q < starts[c + 1])
+                {
+                    if (!ReadLine(q, end, delimiter, values)) continue;
+
+                    *record = ' ';
+                    for (size_t i = 0; i < columnCount; ++i) WriteField(record + 1 + offsets[i], fields[i], values[i]);
+                    record += recordSize;
+                }
+            }
+        }, 1);
+
+        return (int64_t)records;
+    }
+}
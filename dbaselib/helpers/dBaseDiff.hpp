@@ -0,0 +1,399 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <filesystem>
+
+#include "dBase.hpp"
+#include "dBaseHash.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseNumeric.hpp"
+#include "dBaseBuilder.hpp"
+#include "dBaseConcat.hpp"
+#include "dBaseGroupBy.hpp"
+#include "dBaseParallel.hpp"
+
+/// <summary>
+/// A record that is in both versions with other field values.
+/// </summary>
+struct DBaseDiffChange
+{
+    size_t OldRow;
+    size_t NewRow;
+
+    /// <summary>
+    /// The changed fields are Fields[First] to Fields[First + Count - 1] of the result.
+    /// </summary>
+    size_t First;
+    size_t Count;
+};
+
+/// <summary>
+/// Differences between two versions of a table, rows are live record indexes.
+/// </summary>
+struct DBaseDiffResult
+{
+    std::vector<size_t> Inserted;
+    std::vector<size_t> Deleted;
+    std::vector<DBaseDiffChange> Changed;
+
+    /// <summary>
+    /// Indexes of the changed fields of all changes.
+    /// </summary>
+    std::vector<uint32_t> Fields;
+
+    size_t Differences() const noexcept { return Inserted.size() + Deleted.size() + Changed.size(); }
+};
+
+namespace DBaseDiff
+{
+    /// <summary>
+    /// Name of the first field of a patch file, I, U or D for an inserted, updated or deleted record.
+    /// </summary>
+    constexpr const char* OPERATION = "_OP";
+
+    /// <summary>
+    /// Name of the second field of a patch file, the row of the old version an
+    /// updated or deleted record belongs to, blank for an inserted record.
+    /// </summary>
+    constexpr const char* ROW = "_ROW";
+    constexpr size_t ROW_SIZE = 10;
+
+    /// <summary>
+    /// Key bytes and hashes of all records of a table. A key of a single part
+    /// points into the records, keys of several fields are copied together.
+    /// </summary>
+    class Keys
+    {
+        const DBase* Table;
+        std::vector<std::pair<size_t, size_t>> Parts;
+        std::vector<unsigned char> Data;
+
+    public:
+        size_t Size = 0;
+        std::vector<uint64_t> Hashes;
+
+        /// <param name="parts">Offset and size of every key field in a record after its deleted flag.</param>
+        Keys(const DBase* table, const std::vector<std::pair<size_t, size_t>>& parts) noexcept
+            : Table(table),
+            Parts(parts),
+            Data(),
+            Hashes(table->RecordCount())
+        {
+            for (const auto& part : Parts) Size += part.second;
+            if (Parts.size() > 1) Data.resize(table->RecordCount() * Size);
+
+            DBaseParallel::For(table->RecordCount(), [&](size_t begin, size_t end, size_t)
+            {
+                for (auto row = begin; row < end; ++row)
+                {
+                    if (Parts.size() > 1)
+                    {
+                        auto key = Data.data() + row * Size;
+
+                        for (const auto& part : Parts)
+                        {
+                            memcpy(key, Table->Records[row] + part.first, part.second);
+                            key += part.second;
+                        }
+                    }
+
+                    Hashes[row] = DBaseHash::Hash(Key(row), Size);
+                }
+            });
+        }
+
+        const unsigned char* Key(size_t row) const noexcept
+        {
+            if (Parts.size() > 1) return Data.data() + row * Size;
+            return reinterpret_cast<const unsigned char*>(Table->Records[row] + Parts.front().first);
+        }
+    };
+
+    /// <summary>
+    /// Offsets and sizes of the key fields, the whole record if there are no keys.
+    /// </summary>
+    /// <param name="shift">Added to every offset, 1 for the records of a patch of the table that start with the operation.</param>
+    /// <returns>False if a key does not exist.</returns>
+    inline bool KeyParts(const DBase* dbase, const std::vector<std::string>& keys, size_t shift, std::vector<std::pair<size_t, size_t>>& parts) noexcept
+    {
+        if (keys.empty())
+        {
+            parts.push_back({ shift, dbase->RecordSize() - 1 });
+            return true;
+        }
+
+        for (const auto& key : keys)
+        {
+            const auto handle = DBaseUtils::Find(dbase, key);
+            if (!handle) return false;
+
+            parts.push_back({ handle->Offset() + shift, handle->Size() });
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Rows of a table chained by key, so rows with the same key are taken in order.
+    /// </summary>
+    class Index
+    {
+        std::vector<size_t> Next;
+        std::vector<size_t> Tail;
+
+    public:
+        DBaseGroupTable Table;
+        std::vector<size_t> Head;
+
+        Index(size_t keySize, size_t rows) noexcept
+            : Next(rows, SIZE_MAX),
+            Tail(),
+            Table(keySize, 0),
+            Head()
+        {}
+
+        void Add(const Keys& keys, size_t row) noexcept
+        {
+            const auto group = Table.FindOrInsert(keys.Key(row), keys.Hashes[row]);
+
+            if (group == Head.size())
+            {
+                Head.push_back(row);
+                Tail.push_back(row);
+            }
+            else
+            {
+                if (Head[group] == SIZE_MAX) Head[group] = row;
+                else Next[Tail[group]] = row;
+
+                Tail[group] = row;
+            }
+        }
+
+        /// <summary>
+        /// Take the first row with the key of a row of another table, SIZE_MAX if there is none left.
+        /// </summary>
+        size_t Take(const Keys& keys, size_t row) noexcept
+        {
+            const auto group = Table.Find(keys.Key(row), keys.Hashes[row]);
+            if (group == SIZE_MAX || Head[group] == SIZE_MAX) return SIZE_MAX;
+
+            const auto taken = Head[group];
+            Head[group] = Next[taken];
+            return taken;
+        }
+    };
+
+    /// <summary>
+    /// Find the inserted, deleted and changed records between two versions of
+    /// a table with the same fields. Records are matched by their key fields,
+    /// rows with the same key are paired in order. Without keys whole records
+    /// are matched, which only finds inserted and deleted records. Matched
+    /// records are compared by the 64 bit hash of the whole record and field
+    /// by field only when the hashes differ.
+    /// </summary>
+    /// <param name="keys">Fields that identify a record, none to match whole records.</param>
+    /// <returns>False if the fields differ or a key does not exist.</returns>
+    static bool Diff(const DBase* old, const DBase* current, const std::vector<std::string>& keys, DBaseDiffResult& result) noexcept
+    {
+        DBaseCounters::Scope scope(current->Counters, DBasePhase::Diff);
+
+        result = {};
+
+        std::vector<std::pair<size_t, size_t>> parts;
+        if (!DBaseConcat::SameFields(old, current) || !KeyParts(old, keys, 0, parts)) return false;
+
+        std::vector<std::pair<size_t, size_t>> record;
+        KeyParts(old, {}, 0, record);
+
+        const Keys oldKeys(old, parts);
+        const Keys newKeys(current, parts);
+
+        // hashes of whole records, without keys they are the key hashes
+        const auto oldHashes = keys.empty() ? oldKeys.Hashes : Keys(old, record).Hashes;
+        const auto newHashes = keys.empty() ? newKeys.Hashes : Keys(current, record).Hashes;
+
+        Index index(oldKeys.Size, old->RecordCount());
+        for (size_t row = 0; row < old->RecordCount(); ++row) index.Add(oldKeys, row);
+
+        std::vector<bool> matched(old->RecordCount());
+        std::vector<const DBaseHandle*> handles;
+        for (const auto& name : old->Fields()) handles.push_back(old->Select(name));
+
+        for (size_t row = 0; row < current->RecordCount(); ++row)
+        {
+            const auto oldRow = index.Take(newKeys, row);
+
+            if (oldRow == SIZE_MAX)
+            {
+                result.Inserted.push_back(row);
+                continue;
+            }
+
+            matched[oldRow] = true;
+            if (oldHashes[oldRow] == newHashes[row]) continue;
+
+            const auto first = result.Fields.size();
+
+            for (size_t i = 0; i < handles.size(); ++i)
+            {
+                const auto offset = handles[i]->Offset();
+                if (memcmp(old->Records[oldRow] + offset, current->Records[row] + offset, handles[i]->Size()) != 0) result.Fields.push_back((uint32_t)i);
+            }
+
+            if (result.Fields.size() > first) result.Changed.push_back({ oldRow, row, first, result.Fields.size() - first });
+        }
+
+        for (size_t row = 0; row < old->RecordCount(); ++row)
+        {
+            if (!matched[row]) result.Deleted.push_back(row);
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Write a diff as a patch, a DBASE file with the operation (see OPERATION)
+    /// and the old row (see ROW) followed by the fields of the table. Deleted
+    /// records hold the old record, updated and inserted records the new one.
+    /// </summary>
+    /// <returns>False if the table has a field named like the operation or the row or the file could not be written.</returns>
+    static bool WritePatch(const DBase* old, const DBase* current, const DBaseDiffResult& result, const std::filesystem::path& file) noexcept
+    {
+        DBaseCounters::Scope scope(current->Counters, DBasePhase::Diff);
+
+        DBaseBuilder builder;
+        if (!builder.AddField(OPERATION, 'C', 1) || !builder.AddField(ROW, 'N', ROW_SIZE)) return false;
+
+        for (const auto& name : old->Fields())
+        {
+            if (!builder.AddField(old->Select(name))) return false;
+        }
+
+        if (!builder.Open(file)) return false;
+
+        const auto size = old->RecordSize() - 1;
+
+        const auto write = [&](char operation, size_t row, const char* source)
+        {
+            const auto record = builder.Reserve();
+            if (!record) return;
+
+            record[0] = ' ';
+            record[1] = operation;
+
+            if (row == SIZE_MAX) memset(record + 2, ' ', ROW_SIZE);
+            else DBaseNumeric::FormatInt(record + 2, ROW_SIZE, (long long)row);
+
+            memcpy(record + 2 + ROW_SIZE, source, size);
+        };
+
+        for (const auto row : result.Deleted) write('D', row, old->Records[row]);
+        for (const auto& change : result.Changed) write('U', change.OldRow, current->Records[change.NewRow]);
+        for (const auto row : result.Inserted) write('I', SIZE_MAX, current->Records[row]);
+
+        return builder.Close();
+    }
+
+    /// <summary>
+    /// Apply a patch written by WritePatch to a table and write the result to a
+    /// new file. Updated and deleted records are found by their old row, so
+    /// rows with the same key are told apart, and checked against the table:
+    /// a deleted record has to match as a whole, an updated one by the keys
+    /// the diff used. Updated records keep their place, deleted ones are left
+    /// out and inserted ones are appended in the order of the patch.
+    /// </summary>
+    /// <param name="base">The old version of the table.</param>
+    /// <param name="patch">Loaded patch file.</param>
+    /// <param name="keys">Fields the diff matched records by, none for whole records.</param>
+    /// <param name="output">File to write.</param>
+    /// <returns>Number of records written or -1 if the patch does not fit the table or a record to update or delete is missing.</returns>
+    static int64_t ApplyPatch(const DBase* base, const DBase* patch, const std::vector<std::string>& keys, const std::filesystem::path& output) noexcept
+    {
+        DBaseCounters::Scope scope(base->Counters, DBasePhase::Diff);
+
+        const auto& fields = base->Fields();
+        const auto& patchFields = patch->Fields();
+
+        if (patchFields.size() != fields.size() + 2 || patchFields[0] != OPERATION || patchFields[1] != ROW) return -1;
+
+        const auto rowHandle = patch->Select(ROW);
+        if (patch->Select(OPERATION)->Size() != 1 || rowHandle->Type() != 'N') return -1;
+
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            const auto a = base->Select(fields[i]);
+            const auto b = DBaseUtils::Find(patch, fields[i]);
+
+            if (!b || patchFields[i + 2] != fields[i] || a->Type() != b->Type() || a->Size() != b->Size() || a->Decimals() != b->Decimals()) return -1;
+        }
+
+        // the records of the table start after the operation and the row
+        const auto shift = rowHandle->Offset() + rowHandle->Size();
+
+        std::vector<std::pair<size_t, size_t>> keyParts;
+        std::vector<std::pair<size_t, size_t>> record;
+        if (!KeyParts(base, keys, 0, keyParts)) return -1;
+        KeyParts(base, {}, 0, record);
+
+        // the patch row that updates or deletes each row of the table
+        std::vector<size_t> actions(base->RecordCount(), SIZE_MAX);
+        std::vector<size_t> inserts;
+
+        for (size_t row = 0; row < patch->RecordCount(); ++row)
+        {
+            const auto source = patch->Records[row];
+            const auto operation = *source;
+
+            if (operation == 'I')
+            {
+                inserts.push_back(row);
+                continue;
+            }
+
+            if (operation != 'U' && operation != 'D') return -1;
+
+            const auto target = DBaseNumeric::ParseInt<int64_t>(source + rowHandle->Offset(), rowHandle->Size());
+            if (target < 0 || (size_t)target >= base->RecordCount() || actions[(size_t)target] != SIZE_MAX) return -1;
+
+            for (const auto& part : operation == 'D' ? record : keyParts)
+            {
+                if (memcmp(base->Records[(size_t)target] + part.first, source + shift + part.first, part.second) != 0) return -1;
+            }
+
+            actions[(size_t)target] = row;
+        }
+
+        DBaseBuilder builder;
+        for (const auto& name : fields) builder.AddField(base->Select(name));
+        if (!builder.Open(output)) return -1;
+
+        const auto size = base->RecordSize() - 1;
+
+        const auto write = [&](const char* source)
+        {
+            const auto record = builder.Reserve();
+            if (!record) return;
+
+            record[0] = ' ';
+            memcpy(record + 1, source, size);
+        };
+
+        for (size_t row = 0; row < base->RecordCount(); ++row)
+        {
+            const auto patchRow = actions[row];
+
+            if (patchRow == SIZE_MAX) write(base->Records[row]);
+            else if (*patch->Records[patchRow] == 'U') write(patch->Records[patchRow] + shift);
+        }
+
+        for (const auto row : inserts) write(patch->Records[row] + shift);
+
+        const auto records = (int64_t)builder.RecordCount();
+        return builder.Close() ? records : -1;
+    }
+}
@@ -0,0 +1,654 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#include "dBaseParallel.hpp"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/// <summary>
+/// How a DBASE image is written to disk.
+/// </summary>
+struct DBaseWriteOptions
+{
+    /// <summary>
+    /// Bytes per write call, rounded up to the direct I/O alignment.
+    /// </summary>
+    size_t ChunkSize = 8 * 1024 * 1024;
+
+    /// <summary>
+    /// Write the chunks from all pool threads at once.
+    /// </summary>
+    bool Parallel = true;
+
+    /// <summary>
+    /// Bypass the page cache (O_DIRECT / FILE_FLAG_NO_BUFFERING), falls back
+    /// to buffered writes if the file system does not support it.
+    /// </summary>
+    bool Direct = false;
+
+    /// <summary>
+    /// Reserve the whole file up front so the file system can lay it out in one piece.
+    /// </summary>
+    bool Preallocate = true;
+};
+
+/// <summary>
+/// Result of a durable save, passed to the host as an int.
+/// </summary>
+enum class DBaseSaveStatus : int
+{
+    Ok = 0,
+    OpenFailed = 1,
+    WriteFailed = 2,
+    SyncFailed = 3,
+    RenameFailed = 4,
+    DirectorySyncFailed = 5,
+};
+
+namespace DBaseFile
+{
+#if defined(_WIN32)
+    using Native = HANDLE;
+    inline const Native INVALID = INVALID_HANDLE_VALUE;
+#else
+    using Native = int;
+    constexpr Native INVALID = -1;
+#endif
+
+    /// <summary>
+    /// Offsets, sizes and buffers of unbuffered writes are multiples of this.
+    /// </summary>
+    constexpr size_t DIRECT_ALIGNMENT = 4096;
+
+    /// <summary>
+    /// Open a file for writing.
+    /// </summary>
+    /// <param name="file">File to open.</param>
+    /// <param name="exclusive">True to fail if the file exists, false to create or truncate it.</param>
+    /// <param name="direct">True to bypass the page cache.</param>
+    static Native Open(const std::filesystem::path& file, bool exclusive, bool direct = false) noexcept
+    {
+#if defined(_WIN32)
+        const DWORD flags = FILE_ATTRIBUTE_NORMAL | (direct ? FILE_FLAG_NO_BUFFERING : FILE_FLAG_SEQUENTIAL_SCAN);
+        return CreateFileW(file.c_str(), GENERIC_WRITE, 0, nullptr, exclusive ? CREATE_NEW : CREATE_ALWAYS, flags, nullptr);
+#else
+        auto flags = O_WRONLY | O_CREAT | O_CLOEXEC | (exclusive ? O_EXCL : O_TRUNC);
+#if defined(O_DIRECT)
+        if (direct) flags |= O_DIRECT;
+#endif
+
+        int fd;
+        do fd = ::open(file.c_str(), flags, 0644); while (fd < 0 && errno == EINTR);
+        return fd;
+#endif
+    }
+
+    /// <summary>
+    /// Create a new file, fails if it already exists.
+    /// </summary>
+    static Native Create(const std::filesystem::path& file) noexcept { return Open(file, true); }
+
+    /// <summary>
+    /// Open an existing file for writing and keep its contents.
+    /// </summary>
+    static Native Reopen(const std::filesystem::path& file) noexcept
+    {
+#if defined(_WIN32)
+        return CreateFileW(file.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+#else
+        int fd;
+        do fd = ::open(file.c_str(), O_WRONLY | O_CLOEXEC); while (fd < 0 && errno == EINTR);
+        return fd;
+#endif
+    }
+
+    /// <summary>
+    /// Open a file for reading.
+    /// </summary>
+    /// <param name="size">Size of the file.</param>
+    static Native OpenRead(const std::filesystem::path& file, uint64_t& size) noexcept
+    {
+#if defined(_WIN32)
+        const auto handle = CreateFileW(file.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        LARGE_INTEGER length{};
+
+        if (handle != INVALID_HANDLE_VALUE && !GetFileSizeEx(handle, &length))
+        {
+            CloseHandle(handle);
+            return INVALID_HANDLE_VALUE;
+        }
+
+        size = (uint64_t)length.QuadPart;
+        return handle;
+#else
+        int fd;
+        do fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC); while (fd < 0 && errno == EINTR);
+
+        struct stat info;
+
+        if (fd >= 0 && ::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+
+        size = fd >= 0 ? (uint64_t)info.st_size : 0;
+        return fd;
+#endif
+    }
+
+    static void Close(Native handle) noexcept
+    {
+#if defined(_WIN32)
+        CloseHandle(handle);
+#else
+        ::close(handle);
+#endif
+    }
+
+    /// <summary>
+    /// Write all bytes at an offset, safe to call from many threads on the same file.
+    /// </summary>
+    /// <returns>True if everything was written, false if not.</returns>
+    static bool WriteAt(Native handle, uint64_t offset, const char* data, size_t size) noexcept
+    {
+        // keep single calls below 2 GB, some systems fail larger writes
+        constexpr size_t MAX_CALL = 1024 * 1024 * 1024;
+
+        while (size > 0)
+        {
+            const auto chunk = std::min(size, MAX_CALL);
+
+#if defined(_WIN32)
+            OVERLAPPED overlapped{};
+            overlapped.Offset = (DWORD)offset;
+            overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+            DWORD written = 0;
+            if (!::WriteFile(handle, data, (DWORD)chunk, &written, &overlapped) || written == 0) return false;
+#else
+            const auto written = ::pwrite(handle, data, chunk, (off_t)offset);
+
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) return false;
+#endif
+
+            data += written;
+            offset += (uint64_t)written;
+            size -= (size_t)written;
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Read all bytes at an offset, safe to call from many threads on the same file.
+    /// </summary>
+    /// <returns>True if everything was read, false on errors or end of file.</returns>
+    static bool ReadAt(Native handle, uint64_t offset, char* data, size_t size) noexcept
+    {
+        constexpr size_t MAX_CALL = 1024 * 1024 * 1024;
+
+        while (size > 0)
+        {
+            const auto chunk = std::min(size, MAX_CALL);
+
+#if defined(_WIN32)
+            OVERLAPPED overlapped{};
+            overlapped.Offset = (DWORD)offset;
+            overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+            DWORD read = 0;
+            if (!::ReadFile(handle, data, (DWORD)chunk, &read, &overlapped) || read == 0) return false;
+#else
+            const auto read = ::pread(handle, data, chunk, (off_t)offset);
+
+            if (read < 0 && errno == EINTR) continue;
+            if (read <= 0) return false;
+#endif
+
+            data += read;
+            offset += (uint64_t)read;
+            size -= (size_t)read;
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Reserve disk space for the file, a hint only.
+    /// </summary>
+    static bool Preallocate(Native handle, uint64_t size) noexcept
+    {
+#if defined(_WIN32)
+        FILE_ALLOCATION_INFO info{};
+        info.AllocationSize.QuadPart = (LONGLONG)size;
+        return SetFileInformationByHandle(handle, FileAllocationInfo, &info, sizeof(info)) != 0;
+#elif defined(__linux__)
+        // plain fallocate, posix_fallocate would write zeros on file systems without support
+        return size == 0 || ::fallocate(handle, 0, 0, (off_t)size) == 0;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Set the size of the file.
+    /// </summary>
+    static bool Truncate(Native handle, uint64_t size) noexcept
+    {
+#if defined(_WIN32)
+        FILE_END_OF_FILE_INFO info{};
+        info.EndOfFile.QuadPart = (LONGLONG)size;
+        return SetFileInformationByHandle(handle, FileEndOfFileInfo, &info, sizeof(info)) != 0;
+#else
+        return ::ftruncate(handle, (off_t)size) == 0;
+#endif
+    }
+
+    /// <summary>
+    /// Write a whole file image from offset 0. The image is split into chunks
+    /// that are written concurrently with positional writes. Direct writes go
+    /// through aligned buffers and the padding of the last chunk is cut off.
+    /// </summary>
+    /// <param name="handle">File opened with direct set like the parameter.</param>
+    /// <param name="direct">True if the file was opened for unbuffered writes.</param>
+    /// <returns>True if everything was written, false if not.</returns>
+    static bool WriteAll(Native handle, const char* data, size_t size, const DBaseWriteOptions& options, bool direct = false) noexcept
+    {
+        if (options.Preallocate) Preallocate(handle, size);
+
+        const auto chunkSize = (std::max(options.ChunkSize, DIRECT_ALIGNMENT) + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+        const auto chunks = (size + chunkSize - 1) / chunkSize;
+        std::atomic<bool> ok{ true };
+
+        const auto writeChunks = [&](size_t begin, size_t end, size_t)
+        {
+            std::unique_ptr<char[]> staging;
+            char* buffer = nullptr;
+
+            if (direct)
+            {
+                staging.reset(new (std::nothrow) char[chunkSize + DIRECT_ALIGNMENT]);
+
+                if (!staging)
+                {
+                    ok = false;
+                    return;
+                }
+
+                buffer = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(staging.get()) + DIRECT_ALIGNMENT - 1) & ~(uintptr_t)(DIRECT_ALIGNMENT - 1));
+            }
+
+            for (size_t c = begin; c < end && ok.load(std::memory_order_relaxed); ++c)
+            {
+                const auto offset = c * chunkSize;
+                const auto length = std::min(chunkSize, size - offset);
+                bool written;
+
+                if (direct)
+                {
+                    const auto padded = (length + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+                    memcpy(buffer, data + offset, length);
+                    memset(buffer + length, 0, padded - length);
+                    written = WriteAt(handle, offset, buffer, padded);
+                }
+                else
+                {
+                    written = WriteAt(handle, offset, data + offset, length);
+                }
+
+                if (!written) ok.store(false);
+            }
+        };
+
+        if (options.Parallel && chunks > 1) DBaseParallel::For(chunks, writeChunks, 1);
+        else writeChunks(0, chunks, 0);
+
+        if (!ok) return false;
+
+        // preallocation or padding may have made the file longer than the image
+        return Truncate(handle, size);
+    }
+
+    /// <summary>
+    /// Write a whole file image, a direct write that fails is done again
+    /// buffered. Some file systems accept O_DIRECT on open and only reject
+    /// the writes (EINVAL), the file is opened again without it then.
+    /// </summary>
+    /// <param name="handle">File opened with direct set like the parameter, replaced when the file is opened again.</param>
+    /// <param name="file">Path of the opened file.</param>
+    /// <returns>True if everything was written, false if not.</returns>
+    static bool WriteAllOrBuffered(Native& handle, const std::filesystem::path& file, const char* data, size_t size, const DBaseWriteOptions& options, bool direct) noexcept
+    {
+        if (WriteAll(handle, data, size, options, direct)) return true;
+        if (!direct) return false;
+
+        Close(handle);
+        handle = Open(file, false);
+
+        return handle != INVALID && WriteAll(handle, data, size, options, false);
+    }
+
+    /// <summary>
+    /// Create or truncate a file and write the image to it.
+    /// </summary>
+    /// <returns>True if everything was written, false if not.</returns>
+    static bool Write(const std::filesystem::path& file, const char* data, size_t size, const DBaseWriteOptions& options = {}) noexcept
+    {
+        auto direct = options.Direct;
+        auto handle = Open(file, false, direct);
+
+        if (handle == INVALID && direct)
+        {
+            direct = false;
+            handle = Open(file, false);
+        }
+
+        if (handle == INVALID) return false;
+
+        const auto written = WriteAllOrBuffered(handle, file, data, size, options, direct);
+        if (handle != INVALID) Close(handle);
+
+        return written;
+    }
+
+    /// <summary>
+    /// Flush the file data to the device.
+    /// </summary>
+    static bool Sync(Native handle) noexcept
+    {
+#if defined(_WIN32)
+        return FlushFileBuffers(handle) != 0;
+#elif defined(__APPLE__)
+        return ::fcntl(handle, F_FULLFSYNC) == 0 || ::fsync(handle) == 0;
+#else
+        return ::fsync(handle) == 0;
+#endif
+    }
+
+    /// <summary>
+    /// Flush a directory so renames inside it survive a crash. Windows
+    /// renames with write through, there is nothing to do there.
+    /// </summary>
+    static bool SyncDirectory(const std::filesystem::path& directory) noexcept
+    {
+#if defined(_WIN32)
+        return true;
+#else
+        const auto fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        const auto synced = ::fsync(fd) == 0;
+        ::close(fd);
+        return synced;
+#endif
+    }
+
+    /// <summary>
+    /// Replace a file with another one in a single step.
+    /// </summary>
+    static bool Rename(const std::filesystem::path& from, const std::filesystem::path& to) noexcept
+    {
+#if defined(_WIN32)
+        return MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        return ::rename(from.c_str(), to.c_str()) == 0;
+#endif
+    }
+
+    static void Remove(const std::filesystem::path& file) noexcept
+    {
+        std::error_code error;
+        std::filesystem::remove(file, error);
+    }
+
+    /// <summary>
+    /// Returns a temp file path next to the given file, so a rename never crosses file systems.
+    /// </summary>
+    static std::filesystem::path TempPath(const std::filesystem::path& file) noexcept
+    {
+        static thread_local std::mt19937_64 rng{ std::random_device{}() };
+
+        auto temp = file;
+        temp += "." + std::to_string(rng() & 0xFFFFFFFF) + ".tmp";
+        return temp;
+    }
+
+    /// <summary>
+    /// Give the temp file the permissions of the file it replaces.
+    /// </summary>
+    static void CopyPermissions(Native handle, const std::filesystem::path& file) noexcept
+    {
+#if !defined(_WIN32)
+        struct stat info;
+        if (::stat(file.c_str(), &info) == 0) ::fchmod(handle, info.st_mode & 07777);
+#endif
+    }
+}
+
+/// <summary>
+/// Directories of files that were saved but whose renames are not synced yet.
+/// Saving many files with one batch syncs every directory once at the end.
+/// </summary>
+class DBaseSyncBatch
+{
+    std::vector<std::filesystem::path> Directories;
+
+public:
+    DBaseSyncBatch()
+        : Directories()
+    {}
+
+    void Add(const std::filesystem::path& directory) noexcept
+    {
+        if (std::find(Directories.begin(), Directories.end(), directory) == Directories.end())
+        {
+            Directories.push_back(directory);
+        }
+    }
+
+    constexpr size_t Size() const noexcept { return Directories.size(); }
+
+    /// <summary>
+    /// Sync all pending directories.
+    /// </summary>
+    /// <returns>Ok, or DirectorySyncFailed if any directory failed.</returns>
+    DBaseSaveStatus Commit() noexcept
+    {
+        auto status = DBaseSaveStatus::Ok;
+
+        for (const auto& directory : Directories)
+        {
+            if (!DBaseFile::SyncDirectory(directory)) status = DBaseSaveStatus::DirectorySyncFailed;
+        }
+
+        Directories.clear();
+        return status;
+    }
+};
+
+namespace DBaseFile
+{
+    /// <summary>
+    /// Write a file so it is either completely replaced or untouched after a
+    /// crash: the data goes to a sibling temp file which is synced and renamed
+    /// over the target, then the directory is synced.
+    /// </summary>
+    /// <param name="file">File to write.</param>
+    /// <param name="data">Contents of the file.</param>
+    /// <param name="size">Size of the contents.</param>
+    /// <param name="batch">Batch to defer the directory sync to, nullptr to sync it right away.</param>
+    /// <param name="options">How the temp file is written.</param>
+    static DBaseSaveStatus WriteAtomic(const std::filesystem::path& file, const char* data, size_t size, DBaseSyncBatch* batch = nullptr, const DBaseWriteOptions& options = {}) noexcept
+    {
+        auto direct = options.Direct;
+        auto temp = TempPath(file);
+        auto handle = Open(temp, true, direct);
+
+        // a stale temp file with the same name or no direct I/O support, try again
+        for (int attempt = 0; handle == INVALID && attempt < 8; ++attempt)
+        {
+            if (attempt > 0) direct = false;
+
+            temp = TempPath(file);
+            handle = Open(temp, true, direct);
+        }
+
+        if (handle == INVALID) return DBaseSaveStatus::OpenFailed;
+
+        CopyPermissions(handle, file);
+
+        auto status = DBaseSaveStatus::Ok;
+        if (!WriteAllOrBuffered(handle, temp, data, size, options, direct)) status = DBaseSaveStatus::WriteFailed;
+        else if (!Sync(handle)) status = DBaseSaveStatus::SyncFailed;
+
+        if (handle != INVALID) Close(handle);
+
+        if (status == DBaseSaveStatus::Ok && !Rename(temp, file)) status = DBaseSaveStatus::RenameFailed;
+
+        if (status != DBaseSaveStatus::Ok)
+        {
+            Remove(temp);
+            return status;
+        }
+
+        const auto directory = file.parent_path();
+
+        if (batch)
+        {
+            batch->Add(directory);
+            return DBaseSaveStatus::Ok;
+        }
+
+        return SyncDirectory(directory) ? DBaseSaveStatus::Ok : DBaseSaveStatus::DirectorySyncFailed;
+    }
+}
+
+/// <summary>
+/// A file mapped into memory, either read only or created with a fixed size
+/// and written through the mapping.
+/// </summary>
+class DBaseMappedFile
+{
+    DBaseFile::Native Handle;
+#if defined(_WIN32)
+    HANDLE Mapping;
+#endif
+
+public:
+    char* Data;
+    size_t Size;
+
+    DBaseMappedFile()
+        : Handle(DBaseFile::INVALID),
+#if defined(_WIN32)
+        Mapping(nullptr),
+#endif
+        Data(nullptr),
+        Size(0)
+    {}
+
+    DBaseMappedFile(const DBaseMappedFile&) = delete;
+    DBaseMappedFile& operator=(const DBaseMappedFile&) = delete;
+
+    ~DBaseMappedFile() { Close(); }
+
+    /// <summary>
+    /// Map an existing file read only. An empty file maps to no data.
+    /// </summary>
+    bool OpenRead(const std::filesystem::path& file) noexcept
+    {
+        Close();
+
+        uint64_t size;
+        Handle = DBaseFile::OpenRead(file, size);
+        if (Handle == DBaseFile::INVALID) return false;
+
+        Size = (size_t)size;
+        return Size == 0 || Map(false);
+    }
+
+    /// <summary>
+    /// Create or replace a file of the given size and map it writable.
+    /// </summary>
+    bool Create(const std::filesystem::path& file, size_t size) noexcept
+    {
+        Close();
+
+#if defined(_WIN32)
+        Handle = CreateFileW(file.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (Handle == DBaseFile::INVALID) return false;
+#else
+        do Handle = ::open(file.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); while (Handle < 0 && errno == EINTR);
+        if (Handle < 0) return false;
+
+        // reserve the blocks where supported, so a full disk fails here and not with a fault while writing the mapping
+        errno = 0;
+        if ((!DBaseFile::Preallocate(Handle, size) && errno == ENOSPC) || ::ftruncate(Handle, (off_t)size) != 0)
+        {
+            Close();
+            return false;
+        }
+#endif
+
+        Size = size;
+        return Size == 0 || Map(true);
+    }
+
+    void Close() noexcept
+    {
+#if defined(_WIN32)
+        if (Data) UnmapViewOfFile(Data);
+        if (Mapping) CloseHandle(Mapping);
+        Mapping = nullptr;
+#else
+        if (Data) ::munmap(Data, Size);
+#endif
+        if (Handle != DBaseFile::INVALID) DBaseFile::Close(Handle);
+
+        Handle = DBaseFile::INVALID;
+        Data = nullptr;
+        Size = 0;
+    }
+
+private:
+    bool Map(bool writable) noexcept
+    {
+#if defined(_WIN32)
+        // a writable mapping of a new file sets its size
+        const auto size = (uint64_t)Size;
+        Mapping = CreateFileMappingW(Handle, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, (DWORD)(size >> 32), (DWORD)size, nullptr);
+        if (Mapping) Data = static_cast<char*>(MapViewOfFile(Mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, Size));
+#else
+        const auto data = ::mmap(nullptr, Size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, Handle, 0);
+        if (data != MAP_FAILED) Data = static_cast<char*>(data);
+#endif
+
+        if (!Data) Close();
+        return Data != nullptr;
+    }
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+
+#include "dBase.hpp"
+#include "dBase3.hpp"
+#include "dBaseHash.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseParallel.hpp"
+
+/// <summary>
+/// Checksums of a loaded DBASE to tell whether a file, a block of rows or a
+/// column changed. Blocks are hashed in parallel and the block hashes are
+/// hashed again in order, so the result does not depend on the thread count.
+/// </summary>
+namespace DBaseFingerprint
+{
+    constexpr size_t DEFAULT_BLOCK_ROWS = 64 * 1024;
+
+    /// <summary>
+    /// Returns the start of the record region and the number of rows in it,
+    /// deleted ones included.
+    /// </summary>
+    inline std::pair<const char*, size_t> Region(const DBase* dbase) noexcept
+    {
+        const auto header = reinterpret_cast<const DBase3Header*>(dbase->Data);
+        const auto headerSize = std::min<size_t>(header->HeaderBytes, dbase->Size);
+
+        return { dbase->Data + headerSize, (dbase->Size - headerSize) / dbase->RecordSize() };
+    }
+
+    /// <summary>
+    /// Hash a list of hashes in order.
+    /// </summary>
+    inline uint64_t Combine(const std::vector<uint64_t>& hashes, uint64_t seed) noexcept
+    {
+        return DBaseHash::Hash(hashes.data(), hashes.size() * sizeof(uint64_t), seed);
+    }
+
+    /// <summary>
+    /// Hash the raw record region in blocks of rows, deleted flags and deleted records included.
+    /// </summary>
+    /// <returns>One hash per block, the last block may be shorter.</returns>
+    static std::vector<uint64_t> Blocks(const DBase* dbase, size_t blockRows = DEFAULT_BLOCK_ROWS) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Fingerprint);
+
+        const auto [data, rows] = Region(dbase);
+        const auto rowSize = dbase->RecordSize();
+
+        blockRows = std::max<size_t>(blockRows, 1);
+        std::vector<uint64_t> hashes((rows + blockRows - 1) / blockRows);
+
+        DBaseParallel::For(hashes.size(), [&](size_t begin, size_t end, size_t)
+        {
+            for (auto block = begin; block < end; ++block)
+            {
+                const auto first = block * blockRows;
+                const auto count = std::min(blockRows, rows - first);
+
+                hashes[block] = DBaseHash::Hash(data + first * rowSize, count * rowSize);
+            }
+        }, 1);
+
+        dbase->Counters.Scanned(rows);
+        return hashes;
+    }
+
+    /// <summary>
+    /// Fingerprint of the whole record region. Files with the same records and
+    /// deleted flags match, the header (and with it the change date) is left out.
+    /// </summary>
+    static uint64_t Table(const DBase* dbase, size_t blockRows = DEFAULT_BLOCK_ROWS) noexcept
+    {
+        return Combine(Blocks(dbase, blockRows), dbase->RecordSize());
+    }
+
+    /// <summary>
+    /// Fingerprint of the raw values of columns in the live records, so a
+    /// column matches as long as its values in the live records are the same,
+    /// whatever happens to other columns or deleted records.
+    /// </summary>
+    /// <param name="cols">Columns to fingerprint.</param>
+    /// <param name="hashes">Receives one hash per column.</param>
+    /// <returns>False if a column does not exist.</returns>
+    static bool Columns(const DBase* dbase, const std::vector<std::string>& cols, std::vector<uint64_t>& hashes, size_t blockRows = DEFAULT_BLOCK_ROWS) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Fingerprint);
+
+        std::vector<const DBaseHandle*> handles;
+
+        for (const auto& col : cols)
+        {
+            const auto handle = DBaseUtils::Find(dbase, col);
+            if (!handle) return false;
+
+            handles.push_back(handle);
+        }
+
+        const auto rows = dbase->RecordCount();
+        blockRows = std::max<size_t>(blockRows, 1);
+
+        const auto blocks = (rows + blockRows - 1) / blockRows;
+        std::vector<uint64_t> blockHashes(blocks * handles.size());
+        std::vector<std::vector<char>> buffers(DBaseParallel::Concurrency());
+
+        // every task gathers one column of one block of live records
+        DBaseParallel::For(blockHashes.size(), [&](size_t begin, size_t end, size_t slot)
+        {
+            auto& buffer = buffers[slot];
+
+            for (auto task = begin; task < end; ++task)
+            {
+                const auto handle = handles[task / blocks];
+                const auto block = task % blocks;
+                const auto first = block * blockRows;
+                const auto count = std::min(blockRows, rows - first);
+                const auto offset = handle->Offset();
+                const auto size = handle->Size();
+
+                buffer.resize(count * size);
+                for (size_t i = 0; i < count; ++i) memcpy(buffer.data() + i * size, dbase->Records[first + i] + offset, size);
+
+                blockHashes[task] = DBaseHash::Hash(buffer.data(), buffer.size());
+            }
+        }, 1);
+
+        hashes.clear();
+
+        for (size_t i = 0; i < handles.size(); ++i)
+        {
+            const std::vector<uint64_t> column(blockHashes.begin() + i * blocks, blockHashes.begin() + (i + 1) * blocks);
+            hashes.push_back(Combine(column, handles[i]->Size()));
+        }
+
+        dbase->Counters.Scanned(rows);
+        return true;
+    }
+}
@@ -0,0 +1,446 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+
+#include "dBase.hpp"
+#include "dBase3.hpp"
+#include "dBaseHash.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseNumeric.hpp"
+#include "dBaseParallel.hpp"
+
+enum class DBaseAggregate : int
+{
+    Sum = 0,
+    Min = 1,
+    Max = 2,
+    Count = 3,
+    Avg = 4,
+};
+
+/// <summary>
+/// Aggregation of a single column.
+/// </summary>
+struct DBaseAggregation
+{
+    /// <summary>
+    /// Column to aggregate, may be empty for Count to count the rows of a group.
+    /// </summary>
+    std::string Column;
+    DBaseAggregate Op;
+
+    /// <summary>
+    /// Name of the result field, generated from the op and column if empty.
+    /// </summary>
+    std::string Name;
+};
+
+struct DBaseAggregateState
+{
+    double Sum = 0.0;
+    double Min = std::numeric_limits<double>::infinity();
+    double Max = -std::numeric_limits<double>::infinity();
+    size_t Count = 0;
+
+    constexpr void Add(double value) noexcept
+    {
+        Sum += value;
+        Min = std::min(Min, value);
+        Max = std::max(Max, value);
+        ++Count;
+    }
+
+    constexpr void Merge(const DBaseAggregateState& other) noexcept
+    {
+        Sum += other.Sum;
+        Min = std::min(Min, other.Min);
+        Max = std::max(Max, other.Max);
+        Count += other.Count;
+    }
+};
+
+/// <summary>
+/// Open addressing hash table keyed by the raw bytes of the key fields.
+/// </summary>
+class DBaseGroupTable
+{
+public:
+    const size_t KeySize;
+    const size_t AggregateCount;
+
+    std::vector<unsigned char> Keys;
+    std::vector<uint64_t> Hashes;
+    std::vector<size_t> Rows;
+    std::vector<DBaseAggregateState> States;
+
+private:
+    // group index + 1, zero marks an empty slot
+    std::vector<uint32_t> Slots;
+
+public:
+    DBaseGroupTable(size_t keySize, size_t aggregateCount)
+        : KeySize(keySize),
+        AggregateCount(aggregateCount),
+        Keys(),
+        Hashes(),
+        Rows(),
+        States(),
+        Slots(1024, 0)
+    {}
+
+    size_t Groups() const noexcept { return Hashes.size(); }
+
+    /// <summary>
+    /// Returns true if a group has the key, without key columns every key is the same.
+    /// </summary>
+    bool SameKey(size_t group, const unsigned char* key) const noexcept
+    {
+        return KeySize == 0 || memcmp(Keys.data() + group * KeySize, key, KeySize) == 0;
+    }
+
+    /// <summary>
+    /// Returns the group of the key, a new group is created if it does not exist.
+    /// </summary>
+    size_t FindOrInsert(const unsigned char* key, uint64_t hash) noexcept
+    {
+        const auto mask = Slots.size() - 1;
+
+        for (auto i = hash & mask;; i = (i + 1) & mask)
+        {
+            const auto slot = Slots[i];
+
+            if (slot == 0)
+            {
+                const auto group = Groups();
+
+                Slots[i] = (uint32_t)group + 1;
+                Hashes.push_back(hash);
+                Rows.push_back(0);
+                Keys.insert(Keys.end(), key, key + KeySize);
+                States.resize(States.size() + AggregateCount);
+
+                if (Groups() * 2 > Slots.size()) Grow();
+                return group;
+            }
+
+            const auto group = slot - 1;
+
+            if (Hashes[group] == hash && SameKey(group, key))
+            {
+                return group;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Returns the group of the key or SIZE_MAX if it does not exist.
+    /// </summary>
+    size_t Find(const unsigned char* key, uint64_t hash) const noexcept
+    {
+        const auto mask = Slots.size() - 1;
+
+        for (auto i = hash & mask; Slots[i]; i = (i + 1) & mask)
+        {
+            const auto group = Slots[i] - 1;
+
+            if (Hashes[group] == hash && SameKey(group, key))
+            {
+                return group;
+            }
+        }
+
+        return SIZE_MAX;
+    }
+
+    /// <summary>
+    /// Add the groups of another table to this one.
+    /// </summary>
+    void Merge(const DBaseGroupTable& other) noexcept
+    {
+        for (size_t i = 0; i < other.Groups(); ++i)
+        {
+            const auto group = FindOrInsert(other.Keys.data() + i * KeySize, other.Hashes[i]);
+            Rows[group] += other.Rows[i];
+
+            for (size_t a = 0; a < AggregateCount; ++a)
+            {
+                States[group * AggregateCount + a].Merge(other.States[i * AggregateCount + a]);
+            }
+        }
+    }
+
+private:
+    void Grow() noexcept
+    {
+        Slots.assign(Slots.size() * 2, 0);
+        const auto mask = Slots.size() - 1;
+
+        for (size_t group = 0; group < Groups(); ++group)
+        {
+            auto i = Hashes[group] & mask;
+            while (Slots[i]) i = (i + 1) & mask;
+            Slots[i] = (uint32_t)group + 1;
+        }
+    }
+};
+
+/// <summary>
+/// Result of a group by, groups are ordered by their raw key bytes.
+/// </summary>
+class DBaseGroupResult
+{
+public:
+    std::vector<DBase3FieldDescriptor> KeyFields;
+    std::vector<DBase3FieldDescriptor> ValueFields;
+    std::vector<DBaseAggregation> Aggregations;
+    size_t KeySize;
+
+    /// <summary>
+    /// Raw key bytes of every group, KeySize bytes per group.
+    /// </summary>
+    std::vector<unsigned char> Keys;
+
+    /// <summary>
+    /// Number of records per group.
+    /// </summary>
+    std::vector<size_t> Rows;
+
+    /// <summary>
+    /// Aggregated values, Aggregations.size() values per group.
+    /// </summary>
+    std::vector<double> Values;
+
+    DBaseGroupResult() : KeyFields(), ValueFields(), Aggregations(), KeySize(0), Keys(), Rows(), Values() {}
+
+    size_t Groups() const noexcept { return Rows.size(); }
+    const unsigned char* Key(size_t group) const noexcept { return Keys.data() + group * KeySize; }
+    double Value(size_t group, size_t aggregation) const noexcept { return Values[group * Aggregations.size() + aggregation]; }
+
+    /// <summary>
+    /// Create a new in memory DBASE with a record per group, the key fields
+    /// are followed by a field per aggregation.
+    /// </summary>
+    DBase* ToDBase() const noexcept
+    {
+        auto fields = KeyFields;
+        fields.insert(fields.end(), ValueFields.begin(), ValueFields.end());
+
+        const auto dbase = DBaseUtils::Create(fields, Groups());
+
+        for (size_t group = 0; group < Groups(); ++group)
+        {
+            auto record = dbase->Records[group];
+            if (KeySize) memcpy(record, Key(group), KeySize);
+            record += KeySize;
+
+            for (size_t a = 0; a < Aggregations.size(); ++a)
+            {
+                const auto& field = ValueFields[a];
+                const auto size = (unsigned char)field.Lenght;
+                const auto value = Value(group, a);
+
+                if (!std::isnan(value))
+                {
+                    if (field.Decimals) DBaseNumeric::FormatFloat(record, size, value, field.Decimals);
+                    else DBaseNumeric::FormatInt(record, size, (long long)value);
+                }
+
+                record += size;
+            }
+        }
+
+        return dbase;
+    }
+};
+
+/// <summary>
+/// Hash based group by over the records of a DBASE.
+/// </summary>
+class DBaseGroupBy
+{
+    const DBase* dBase;
+    std::vector<const DBaseHandle*> KeyHandles;
+    bool IsValid;
+
+public:
+    /// <param name="dbase">Loaded DBASE.</param>
+    /// <param name="keys">Columns to group by, may be empty to aggregate all records into one group.</param>
+    DBaseGroupBy(const DBase* dbase, const std::vector<std::string>& keys)
+        : dBase(dbase),
+        KeyHandles(),
+        IsValid(true)
+    {
+        for (const auto& key : keys)
+        {
+            const auto handle = DBaseUtils::Find(dbase, key);
+            IsValid &= handle != nullptr;
+            KeyHandles.push_back(handle);
+        }
+    }
+
+    /// <summary>
+    /// Returns false if a key column does not exist.
+    /// </summary>
+    constexpr bool Valid() const noexcept { return IsValid; }
+
+    /// <summary>
+    /// Group the records and aggregate the given columns. Blank and invalid numbers
+    /// are skipped. Every thread fills its own table, they are merged at the end.
+    /// </summary>
+    /// <param name="aggregations">Aggregations to compute per group.</param>
+    /// <returns>The groups, empty if a column does not exist or an operation is unknown.</returns>
+    DBaseGroupResult Aggregate(const std::vector<DBaseAggregation>& aggregations) const noexcept
+    {
+        DBaseGroupResult result;
+        if (!IsValid) return result;
+
+        std::vector<const DBaseHandle*> valueHandles;
+
+        for (const auto& aggregation : aggregations)
+        {
+            if (aggregation.Op < DBaseAggregate::Sum || aggregation.Op > DBaseAggregate::Avg) return result;
+
+            const auto handle = aggregation.Column.empty() ? nullptr : DBaseUtils::Find(dBase, aggregation.Column);
+            if (!handle && aggregation.Op != DBaseAggregate::Count) return result;
+
+            valueHandles.push_back(handle);
+            result.ValueFields.push_back(MakeValueField(aggregation, handle));
+        }
+
+        for (const auto handle : KeyHandles)
+        {
+            result.KeyFields.push_back(DBaseUtils::MakeField(handle));
+            result.KeySize += handle->Size();
+        }
+
+        result.Aggregations = aggregations;
+
+        DBaseCounters::Scope scope(dBase->Counters, DBasePhase::GroupBy);
+        dBase->Counters.Scanned(dBase->RecordCount());
+        dBase->Counters.Parsed(dBase->RecordCount() * (size_t)std::count_if(valueHandles.begin(), valueHandles.end(), [](const auto handle) { return handle != nullptr; }));
+
+        const auto keySize = result.KeySize;
+        const auto aggregateCount = aggregations.size();
+
+        std::vector<DBaseGroupTable> tables(DBaseParallel::Concurrency(), DBaseGroupTable(keySize, aggregateCount));
+
+        DBaseParallel::For(dBase->RecordCount(), [&](size_t begin, size_t end, size_t slot)
+        {
+            auto& table = tables[slot];
+            std::vector<unsigned char> key(keySize + 1);
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                const auto record = dBase->Records[i];
+                auto out = key.data();
+
+                for (const auto handle : KeyHandles)
+                {
+                    memcpy(out, record + handle->Offset(), handle->Size());
+                    out += handle->Size();
+                }
+
+                const auto group = table.FindOrInsert(key.data(), DBaseHash::Hash(key.data(), keySize));
+                const auto states = table.States.data() + group * aggregateCount;
+                ++table.Rows[group];
+
+                for (size_t a = 0; a < aggregateCount; ++a)
+                {
+                    const auto handle = valueHandles[a];
+                    double value = 0.0;
+
+                    if (!handle || DBaseNumeric::ParseFloat(record + handle->Offset(), handle->Size(), value))
+                    {
+                        states[a].Add(value);
+                    }
+                }
+            }
+        });
+
+        auto& merged = tables[0];
+        for (size_t i = 1; i < tables.size(); ++i) merged.Merge(tables[i]);
+
+        std::vector<size_t> order(merged.Groups());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return keySize && memcmp(merged.Keys.data() + a * keySize, merged.Keys.data() + b * keySize, keySize) < 0;
+        });
+
+        result.Keys.reserve(merged.Keys.size());
+        result.Rows.reserve(order.size());
+        result.Values.reserve(order.size() * aggregateCount);
+
+        for (const auto group : order)
+        {
+            result.Keys.insert(result.Keys.end(), merged.Keys.data() + group * keySize, merged.Keys.data() + (group + 1) * keySize);
+            result.Rows.push_back(merged.Rows[group]);
+
+            for (size_t a = 0; a < aggregateCount; ++a)
+            {
+                const auto& state = merged.States[group * aggregateCount + a];
+                result.Values.push_back(Finish(aggregations[a].Op, state));
+            }
+        }
+
+        return result;
+    }
+
+private:
+    static double Finish(DBaseAggregate op, const DBaseAggregateState& state) noexcept
+    {
+        constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+
+        switch (op)
+        {
+        case DBaseAggregate::Sum: return state.Sum;
+        case DBaseAggregate::Min: return state.Count ? state.Min : nan;
+        case DBaseAggregate::Max: return state.Count ? state.Max : nan;
+        case DBaseAggregate::Count: return (double)state.Count;
+        case DBaseAggregate::Avg: return state.Count ? state.Sum / state.Count : nan;
+        default: return nan;
+        }
+    }
+
+    static DBase3FieldDescriptor MakeValueField(const DBaseAggregation& aggregation, const DBaseHandle* handle) noexcept
+    {
+        constexpr const char* prefixes[] = { "SUM_", "MIN_", "MAX_", "CNT_", "AVG_" };
+
+        auto name = aggregation.Name;
+        if (name.empty()) name = std::string(prefixes[(int)aggregation.Op]) + (handle ? handle->Name() : "ROWS");
+
+        const auto decimals = handle ? handle->Decimals() : 0;
+
+        switch (aggregation.Op)
+        {
+        case DBaseAggregate::Count:
+            return DBaseUtils::MakeField(name, 'N', 10);
+
+        case DBaseAggregate::Min:
+        case DBaseAggregate::Max:
+            // min and max always fit into the source field
+            return DBaseUtils::MakeField(name, handle->Type() == 'D' ? 'D' : 'N', handle->Size(), decimals);
+
+        case DBaseAggregate::Avg:
+            return DBaseUtils::MakeField(name, 'N', 20, std::min<size_t>(decimals + 2, 15));
+
+        default:
+            return DBaseUtils::MakeField(name, 'N', 20, decimals);
+        }
+    }
+};
+
+/// <summary>
+/// Start a group by over the given key columns.
+/// </summary>
+inline DBaseGroupBy GroupBy(const DBase* dbase, const std::vector<std::string>& keys) noexcept
+{
+    return DBaseGroupBy(dbase, keys);
+}
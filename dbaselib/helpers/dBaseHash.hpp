@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+/// <summary>
+/// Fast non cryptographic hashing of raw field bytes (wyhash construction).
+/// </summary>
+namespace DBaseHash
+{
+    constexpr uint64_t P0 = 0xa0761d6478bd642full;
+    constexpr uint64_t P1 = 0xe7037ed1a0b428dbull;
+    constexpr uint64_t P2 = 0x8ebc6af09c88c6e3ull;
+    constexpr uint64_t P3 = 0x589965cc75374cc3ull;
+
+    /// <summary>
+    /// 64x64 bit multiply, a receives the low and b the high half.
+    /// </summary>
+    inline void Mum(uint64_t& a, uint64_t& b) noexcept
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        a = _umul128(a, b, &b);
+#elif defined(__SIZEOF_INT128__)
+        const auto r = (unsigned __int128)a * b;
+        a = (uint64_t)r;
+        b = (uint64_t)(r >> 64);
+#else
+        const uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+        const uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        const uint64_t t = rl + (rm0 << 32);
+        const uint64_t lo = t + (rm1 << 32);
+        b = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+        a = lo;
+#endif
+    }
+
+    /// <summary>
+    /// 64x64 bit multiply, returns the high and low half xor'ed together.
+    /// </summary>
+    inline uint64_t Mix(uint64_t a, uint64_t b) noexcept
+    {
+        Mum(a, b);
+        return a ^ b;
+    }
+
+    inline uint64_t Read64(const unsigned char* p) noexcept { uint64_t v; memcpy(&v, p, 8); return v; }
+    inline uint64_t Read32(const unsigned char* p) noexcept { uint32_t v; memcpy(&v, p, 4); return v; }
+
+    /// <summary>
+    /// Hash a block of bytes.
+    /// </summary>
+    /// <param name="data">Data to hash.</param>
+    /// <param name="size">Size of the data.</param>
+    /// <param name="seed">Seed, use different seeds for independent hashes.</param>
+    inline uint64_t Hash(const void* data, size_t size, uint64_t seed = 0) noexcept
+    {
+        auto p = static_cast<const unsigned char*>(data);
+        uint64_t a, b;
+
+        seed ^= Mix(seed ^ P0, P1);
+
+        if (size <= 16)
+        {
+            if (size >= 4)
+            {
+                const auto shift = (size >> 3) << 2;
+                a = (Read32(p) << 32) | Read32(p + shift);
+                b = (Read32(p + size - 4) << 32) | Read32(p + size - 4 - shift);
+            }
+            else if (size > 0)
+            {
+                a = ((uint64_t)p[0] << 16) | ((uint64_t)p[size >> 1] << 8) | p[size - 1];
+                b = 0;
+            }
+            else
+            {
+                a = b = 0;
+            }
+        }
+        else
+        {
+            auto i = size;
+
+            if (i > 48)
+            {
+                auto s1 = seed, s2 = seed;
+
+                do
+                {
+                    seed = Mix(Read64(p) ^ P1, Read64(p + 8) ^ seed);
+                    s1 = Mix(Read64(p + 16) ^ P2, Read64(p + 24) ^ s1);
+                    s2 = Mix(Read64(p + 32) ^ P3, Read64(p + 40) ^ s2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+
+                seed ^= s1 ^ s2;
+            }
+
+            while (i > 16)
+            {
+                seed = Mix(Read64(p) ^ P1, Read64(p + 8) ^ seed);
+                p += 16;
+                i -= 16;
+            }
+
+            a = Read64(p + i - 16);
+            b = Read64(p + i - 8);
+        }
+
+        a ^= P1;
+        b ^= seed;
+        Mum(a, b);
+        return Mix(a ^ P0 ^ size, b ^ P1);
+    }
+}
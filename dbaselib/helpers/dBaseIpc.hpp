@@ -0,0 +1,727 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <algorithm>
+#include <filesystem>
+#include <condition_variable>
+
+#include "dBase.hpp"
+#include "dBaseFile.hpp"
+#include "dBaseArrow.hpp"
+#include "dBaseReader.hpp"
+
+/// <summary>
+/// How a DBASE is written as an Arrow IPC file.
+/// </summary>
+struct DBaseIpcOptions
+{
+    /// <summary>
+    /// Records per record batch, the memory used is a few batches regardless of the table size.
+    /// </summary>
+    size_t BatchRows = 64 * 1024;
+
+    /// <summary>
+    /// Write character fields as utf8, otherwise as binary for code pages that are not utf-8.
+    /// </summary>
+    bool Utf8 = true;
+};
+
+/// <summary>
+/// Builds a flatbuffer front to back. Objects are described first and laid out
+/// by Finish, every object is written before the objects it refers to so all
+/// offsets point forward, vtables are written right before their tables.
+/// </summary>
+class DBaseFlatBuffer
+{
+public:
+    /// <summary>
+    /// A field of a table, either a scalar or an offset to another object.
+    /// </summary>
+    struct Slot
+    {
+        uint16_t Id;
+        uint8_t Size;
+        uint64_t Value;
+        size_t Object;
+    };
+
+private:
+    enum class Kind { Table, Vector, Structs, String };
+
+    struct Object
+    {
+        Kind Type;
+        std::vector<Slot> Slots;
+        std::vector<size_t> Elements;
+        std::string Bytes;
+        size_t Count;
+        size_t Alignment;
+    };
+
+    static constexpr size_t NONE = SIZE_MAX;
+
+    std::vector<Object> Objects;
+    std::vector<uint8_t> Buffer;
+
+    void Align(size_t alignment) noexcept { Buffer.resize((Buffer.size() + alignment - 1) / alignment * alignment, 0); }
+
+    template<typename T>
+    void Put(size_t position, T value) noexcept { memcpy(Buffer.data() + position, &value, sizeof(T)); }
+
+    void Patch(size_t position, size_t target) noexcept { Put<uint32_t>(position, (uint32_t)(target - position)); }
+
+    /// <summary>
+    /// Write an object and everything it refers to at the end of the buffer.
+    /// </summary>
+    /// <returns>Position an offset to the object points to.</returns>
+    size_t Write(size_t index) noexcept
+    {
+        const auto& object = Objects[index];
+
+        switch (object.Type)
+        {
+        case Kind::Table:
+        {
+            // larger fields first so they are aligned without padding in between
+            std::vector<Slot> slots(object.Slots);
+            std::stable_sort(slots.begin(), slots.end(), [](const Slot& a, const Slot& b) { return a.Size > b.Size; });
+
+            size_t fields = 0, alignment = 4, size = 4;
+            std::vector<uint16_t> offsets(slots.size());
+
+            for (size_t i = 0; i < slots.size(); ++i)
+            {
+                fields = std::max<size_t>(fields, slots[i].Id + 1u);
+                alignment = std::max<size_t>(alignment, slots[i].Size);
+                size = (size + slots[i].Size - 1) / slots[i].Size * slots[i].Size;
+                offsets[i] = (uint16_t)size;
+                size += slots[i].Size;
+            }
+
+            Align(2);
+            const auto vtable = Buffer.size();
+            Buffer.resize(vtable + 4 + fields * 2, 0);
+            Put<uint16_t>(vtable, (uint16_t)(4 + fields * 2));
+            Put<uint16_t>(vtable + 2, (uint16_t)size);
+            for (size_t i = 0; i < slots.size(); ++i) Put<uint16_t>(vtable + 4 + slots[i].Id * 2u, offsets[i]);
+
+            Align(alignment);
+            const auto table = Buffer.size();
+            Buffer.resize(table + size, 0);
+            Put<int32_t>(table, (int32_t)(table - vtable));
+
+            for (size_t i = 0; i < slots.size(); ++i)
+            {
+                if (slots[i].Object == NONE) memcpy(Buffer.data() + table + offsets[i], &slots[i].Value, slots[i].Size);
+            }
+
+            for (size_t i = 0; i < slots.size(); ++i)
+            {
+                if (slots[i].Object != NONE) Patch(table + offsets[i], Write(slots[i].Object));
+            }
+
+            return table;
+        }
+
+        case Kind::Vector:
+        {
+            Align(4);
+            const auto vector = Buffer.size();
+            Buffer.resize(vector + 4 + object.Elements.size() * 4, 0);
+            Put<uint32_t>(vector, (uint32_t)object.Elements.size());
+
+            for (size_t i = 0; i < object.Elements.size(); ++i) Patch(vector + 4 + i * 4, Write(object.Elements[i]));
+            return vector;
+        }
+
+        case Kind::Structs:
+        {
+            // the elements follow the length and are aligned themselves
+            Buffer.resize(Buffer.size() + 4);
+            Align(object.Alignment);
+            const auto vector = Buffer.size() - 4;
+            Put<uint32_t>(vector, (uint32_t)object.Count);
+            Buffer.insert(Buffer.end(), object.Bytes.begin(), object.Bytes.end());
+            return vector;
+        }
+
+        default:
+        {
+            Align(4);
+            const auto string = Buffer.size();
+            Buffer.resize(string + 4, 0);
+            Put<uint32_t>(string, (uint32_t)object.Bytes.size());
+            Buffer.insert(Buffer.end(), object.Bytes.begin(), object.Bytes.end());
+            Buffer.push_back(0);
+            return string;
+        }
+        }
+    }
+
+public:
+    template<typename T>
+    static Slot Scalar(uint16_t id, T value) noexcept
+    {
+        uint64_t bits = 0;
+        memcpy(&bits, &value, sizeof(T));
+        return { id, (uint8_t)sizeof(T), bits, NONE };
+    }
+
+    static Slot Offset(uint16_t id, size_t object) noexcept { return { id, 4, 0, object }; }
+
+    size_t Table(std::vector<Slot> slots) noexcept
+    {
+        Objects.push_back({ Kind::Table, std::move(slots), {}, {}, 0, 0 });
+        return Objects.size() - 1;
+    }
+
+    size_t Vector(std::vector<size_t> elements) noexcept
+    {
+        Objects.push_back({ Kind::Vector, {}, std::move(elements), {}, 0, 0 });
+        return Objects.size() - 1;
+    }
+
+    /// <summary>
+    /// A vector of structs given as their packed bytes.
+    /// </summary>
+    size_t Structs(std::string bytes, size_t count, size_t alignment) noexcept
+    {
+        Objects.push_back({ Kind::Structs, {}, {}, std::move(bytes), count, alignment });
+        return Objects.size() - 1;
+    }
+
+    size_t String(std::string text) noexcept
+    {
+        Objects.push_back({ Kind::String, {}, {}, std::move(text), 0, 0 });
+        return Objects.size() - 1;
+    }
+
+    /// <summary>
+    /// Lay out the buffer with the given root table.
+    /// </summary>
+    /// <returns>The buffer, padded to a multiple of 8 bytes.</returns>
+    std::vector<uint8_t> Finish(size_t root) noexcept
+    {
+        Buffer.assign(4, 0);
+        Patch(0, Write(root));
+        Align(8);
+        return std::move(Buffer);
+    }
+};
+
+namespace DBaseIpc
+{
+    // values of the Arrow flatbuffer schema, see https://github.com/apache/arrow/tree/main/format
+    constexpr int16_t METADATA_V5 = 4;
+    constexpr uint8_t HEADER_SCHEMA = 1;
+    constexpr uint8_t HEADER_RECORD_BATCH = 3;
+    constexpr uint32_t CONTINUATION = 0xFFFFFFFF;
+    constexpr size_t ALIGNMENT = 8;
+
+    /// <summary>
+    /// The arrays of one record batch, released when the batch goes away.
+    /// </summary>
+    struct Batch
+    {
+        size_t Rows = 0;
+        std::vector<ArrowArray> Columns;
+
+        Batch() = default;
+        Batch(Batch&&) = default;
+        Batch& operator=(Batch&&) = default;
+
+        ~Batch()
+        {
+            for (auto& column : Columns)
+            {
+                if (column.release) column.release(&column);
+            }
+        }
+    };
+
+    /// <summary>
+    /// Add the flatbuffer type of an Arrow format string.
+    /// </summary>
+    /// <param name="type">Value of the Type union.</param>
+    /// <returns>The type table.</returns>
+    inline size_t AddType(DBaseFlatBuffer& flat, const std::string& format, uint8_t& type) noexcept
+    {
+        if (format == "l")
+        {
+            type = 2;
+            return flat.Table({ DBaseFlatBuffer::Scalar<int32_t>(0, 64), DBaseFlatBuffer::Scalar<uint8_t>(1, 1) });
+        }
+
+        if (format == "g")
+        {
+            type = 3;
+            return flat.Table({ DBaseFlatBuffer::Scalar<int16_t>(0, 2) });
+        }
+
+        if (format == "tdD")
+        {
+            // the default unit is milliseconds, so days have to be written
+            type = 8;
+            return flat.Table({ DBaseFlatBuffer::Scalar<int16_t>(0, 0) });
+        }
+
+        type = format == "b" ? 6 : format == "u" ? 5 : format == "z" ? 4 : format == "U" ? 20 : 19;
+        return flat.Table({});
+    }
+
+    /// <summary>
+    /// Add a Schema table with nullable fields.
+    /// </summary>
+    inline size_t AddSchema(DBaseFlatBuffer& flat, const std::vector<std::string>& names, const std::vector<std::string>& formats) noexcept
+    {
+        std::vector<size_t> fields;
+
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            uint8_t type;
+            const auto table = AddType(flat, formats[i], type);
+
+            fields.push_back(flat.Table({
+                DBaseFlatBuffer::Offset(0, flat.String(names[i])),
+                DBaseFlatBuffer::Scalar<uint8_t>(1, 1),
+                DBaseFlatBuffer::Scalar<uint8_t>(2, type),
+                DBaseFlatBuffer::Offset(3, table),
+                DBaseFlatBuffer::Offset(5, flat.Vector({})),
+            }));
+        }
+
+        return flat.Table({ DBaseFlatBuffer::Scalar<int16_t>(0, 0), DBaseFlatBuffer::Offset(1, flat.Vector(fields)) });
+    }
+
+    /// <summary>
+    /// Returns the buffers of an exported array as pointer and size, the validity
+    /// buffer is empty without nulls.
+    /// </summary>
+    inline std::vector<std::pair<const void*, size_t>> Buffers(const ArrowArray& array, const std::string& format) noexcept
+    {
+        const auto rows = (size_t)array.length;
+        const auto bits = (rows + 7) / 8;
+
+        std::vector<std::pair<const void*, size_t>> buffers;
+        buffers.emplace_back(array.buffers[0], array.null_count ? bits : 0);
+
+        if (format == "u" || format == "z")
+        {
+            const auto offsets = static_cast<const int32_t*>(array.buffers[1]);
+            buffers.emplace_back(offsets, (rows + 1) * sizeof(int32_t));
+            buffers.emplace_back(array.buffers[2], (size_t)offsets[rows]);
+        }
+        else if (format == "U" || format == "Z")
+        {
+            const auto offsets = static_cast<const int64_t*>(array.buffers[1]);
+            buffers.emplace_back(offsets, (rows + 1) * sizeof(int64_t));
+            buffers.emplace_back(array.buffers[2], (size_t)offsets[rows]);
+        }
+        else
+        {
+            buffers.emplace_back(array.buffers[1], format == "b" ? bits : format == "tdD" ? rows * 4 : rows * 8);
+        }
+
+        return buffers;
+    }
+
+    /// <summary>
+    /// Writes an Arrow IPC file (Feather v2): the magic, a schema message, one
+    /// message per record batch and a footer with the position of every batch.
+    /// </summary>
+    class Writer
+    {
+        static constexpr size_t BUFFER_SIZE = 4 * 1024 * 1024;
+
+        DBaseFile::Native Handle = DBaseFile::INVALID;
+        uint64_t Offset = 0;
+        std::vector<char> Pending;
+        std::vector<std::string> Names;
+        std::vector<std::string> Formats;
+
+        // offset, metadata length and body length of every record batch
+        std::vector<std::tuple<int64_t, int32_t, int64_t>> Blocks;
+
+        bool Flush() noexcept
+        {
+            const auto ok = Pending.empty() || DBaseFile::WriteAt(Handle, Offset, Pending.data(), Pending.size());
+            Offset += Pending.size();
+            Pending.clear();
+            return ok;
+        }
+
+        bool Append(const void* data, size_t size) noexcept
+        {
+            if (Pending.size() + size > BUFFER_SIZE && !Flush()) return false;
+
+            // large buffers go straight to the file
+            if (size >= BUFFER_SIZE)
+            {
+                const auto ok = DBaseFile::WriteAt(Handle, Offset, static_cast<const char*>(data), size);
+                Offset += size;
+                return ok;
+            }
+
+            Pending.insert(Pending.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+            return true;
+        }
+
+        bool Pad(size_t size) noexcept
+        {
+            static const char zeros[ALIGNMENT] = {};
+            return Append(zeros, (ALIGNMENT - size % ALIGNMENT) % ALIGNMENT);
+        }
+
+        uint64_t Position() const noexcept { return Offset + Pending.size(); }
+
+        /// <summary>
+        /// Write the continuation marker, the length of the metadata and the metadata.
+        /// </summary>
+        /// <returns>Length of the message metadata including the prefix.</returns>
+        int32_t WriteMetadata(const std::vector<uint8_t>& metadata, bool& ok) noexcept
+        {
+            const auto length = (int32_t)metadata.size();
+            ok = Append(&CONTINUATION, 4) && Append(&length, 4) && Append(metadata.data(), metadata.size());
+            return length + 8;
+        }
+
+    public:
+        ~Writer()
+        {
+            if (Handle != DBaseFile::INVALID) DBaseFile::Close(Handle);
+        }
+
+        /// <summary>
+        /// Create the file and write the magic and the schema.
+        /// </summary>
+        bool Open(const std::filesystem::path& file, std::vector<std::string> names, std::vector<std::string> formats) noexcept
+        {
+            Handle = DBaseFile::Open(file, false);
+            if (Handle == DBaseFile::INVALID) return false;
+
+            Names = std::move(names);
+            Formats = std::move(formats);
+
+            DBaseFlatBuffer flat;
+            const auto schema = AddSchema(flat, Names, Formats);
+            const auto message = flat.Table({
+                DBaseFlatBuffer::Scalar<int16_t>(0, METADATA_V5),
+                DBaseFlatBuffer::Scalar<uint8_t>(1, HEADER_SCHEMA),
+                DBaseFlatBuffer::Offset(2, schema),
+                DBaseFlatBuffer::Scalar<int64_t>(3, 0),
+            });
+
+            bool ok;
+            return Append("ARROW1\0\0", 8) && (WriteMetadata(flat.Finish(message), ok), ok);
+        }
+
+        /// <summary>
+        /// Write a record batch, its columns have to match the schema.
+        /// </summary>
+        bool Write(const Batch& batch) noexcept
+        {
+            std::string nodes, buffers;
+            int64_t body = 0;
+
+            std::vector<std::vector<std::pair<const void*, size_t>>> columns;
+
+            for (size_t i = 0; i < batch.Columns.size(); ++i)
+            {
+                const auto& array = batch.Columns[i];
+                const int64_t node[2] = { array.length, array.null_count };
+                nodes.append(reinterpret_cast<const char*>(node), sizeof(node));
+
+                columns.push_back(Buffers(array, Formats[i]));
+
+                for (const auto& buffer : columns.back())
+                {
+                    const int64_t entry[2] = { body, (int64_t)buffer.second };
+                    buffers.append(reinterpret_cast<const char*>(entry), sizeof(entry));
+                    body += (int64_t)((buffer.second + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+                }
+            }
+
+            DBaseFlatBuffer flat;
+            const auto nodeCount = nodes.size() / 16;
+            const auto bufferCount = buffers.size() / 16;
+            const auto header = flat.Table({
+                DBaseFlatBuffer::Scalar<int64_t>(0, (int64_t)batch.Rows),
+                DBaseFlatBuffer::Offset(1, flat.Structs(std::move(nodes), nodeCount, 8)),
+                DBaseFlatBuffer::Offset(2, flat.Structs(std::move(buffers), bufferCount, 8)),
+            });
+            const auto message = flat.Table({
+                DBaseFlatBuffer::Scalar<int16_t>(0, METADATA_V5),
+                DBaseFlatBuffer::Scalar<uint8_t>(1, HEADER_RECORD_BATCH),
+                DBaseFlatBuffer::Offset(2, header),
+                DBaseFlatBuffer::Scalar<int64_t>(3, body),
+            });
+
+            const auto start = (int64_t)Position();
+            bool ok;
+            const auto metadata = WriteMetadata(flat.Finish(message), ok);
+
+            for (const auto& column : columns)
+            {
+                for (const auto& buffer : column)
+                {
+                    ok = ok && Append(buffer.first, buffer.second) && Pad(buffer.second);
+                }
+            }
+
+            Blocks.emplace_back(start, metadata, body);
+            return ok;
+        }
+
+        /// <summary>
+        /// Write the end of stream marker and the footer, then close the file.
+        /// </summary>
+        bool Close() noexcept
+        {
+            const uint32_t end[2] = { CONTINUATION, 0 };
+            auto ok = Append(end, sizeof(end));
+
+            std::string blocks;
+
+            for (const auto& [offset, metadata, body] : Blocks)
+            {
+                // struct Block { long offset; int metaDataLength; long bodyLength; }
+                char block[24] = {};
+                memcpy(block, &offset, 8);
+                memcpy(block + 8, &metadata, 4);
+                memcpy(block + 16, &body, 8);
+                blocks.append(block, sizeof(block));
+            }
+
+            DBaseFlatBuffer flat;
+            const auto count = Blocks.size();
+            const auto footer = flat.Table({
+                DBaseFlatBuffer::Scalar<int16_t>(0, METADATA_V5),
+                DBaseFlatBuffer::Offset(1, AddSchema(flat, Names, Formats)),
+                DBaseFlatBuffer::Offset(2, flat.Structs({}, 0, 8)),
+                DBaseFlatBuffer::Offset(3, flat.Structs(std::move(blocks), count, 8)),
+            });
+
+            const auto buffer = flat.Finish(footer);
+            const auto length = (int32_t)buffer.size();
+
+            ok = ok && Append(buffer.data(), buffer.size()) && Append(&length, 4) && Append("ARROW1", 6) && Flush();
+
+            DBaseFile::Close(Handle);
+            Handle = DBaseFile::INVALID;
+            return ok;
+        }
+
+        uint64_t Written() const noexcept { return Position(); }
+    };
+
+    /// <summary>
+    /// Decode a range of records into a batch with the column decoders of the C data export.
+    /// </summary>
+    /// <param name="formats">Formats of the columns, filled if empty and checked otherwise.</param>
+    /// <returns>False if a column does not match the formats.</returns>
+    inline bool Decode(const DBase* dbase, const std::vector<const DBaseHandle*>& handles, size_t first, size_t rows, const DBaseIpcOptions& options, std::vector<std::string>& formats, Batch& batch) noexcept
+    {
+        DBaseArrowOptions arrowOptions;
+        arrowOptions.Utf8 = options.Utf8;
+
+        const auto check = !formats.empty();
+        batch.Rows = rows;
+        batch.Columns.resize(handles.size());
+
+        for (size_t i = 0; i < handles.size(); ++i)
+        {
+            ArrowSchema schema;
+            DBaseArrow::ExportField(dbase, handles[i], first, rows, arrowOptions, &schema, &batch.Columns[i]);
+
+            // text of a batch that outgrows 32 bit offsets changes the type
+            const std::string format = schema.format;
+            schema.release(&schema);
+
+            if (!check) formats.push_back(format);
+            else if (formats[i] != format) return false;
+        }
+
+        dbase->Counters.Scanned(rows);
+        dbase->Counters.Parsed((uint64_t)rows * handles.size());
+        return true;
+    }
+
+    /// <summary>
+    /// Returns the handles of the fields, all fields if none are given.
+    /// </summary>
+    inline bool Handles(const DBase* dbase, const std::vector<std::string>& fields, std::vector<const DBaseHandle*>& handles, std::vector<std::string>& names) noexcept
+    {
+        names = fields.empty() ? dbase->Fields() : fields;
+
+        for (const auto& name : names)
+        {
+            const auto handle = DBaseUtils::Find(dbase, name);
+            if (!handle) return false;
+
+            handles.push_back(handle);
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Decode batches on the calling thread while a writer thread writes the
+    /// previous ones. At most one decoded batch waits for the writer.
+    /// </summary>
+    /// <param name="next">Called as next(batch, formats), returns false once there are no more batches.</param>
+    /// <returns>Bytes written or 0 on an error.</returns>
+    template<typename Next>
+    uint64_t Pipeline(const std::filesystem::path& file, const std::vector<std::string>& names, Next&& next) noexcept
+    {
+        std::vector<std::string> formats;
+        Batch first;
+        auto more = next(first, formats);
+        if (formats.size() != names.size()) return 0;
+
+        Writer writer;
+        if (!writer.Open(file, names, formats)) return 0;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::optional<Batch> pending;
+        bool closed = false, failed = false;
+
+        if (first.Rows) pending.emplace(std::move(first));
+
+        std::thread thread([&]()
+        {
+            while (true)
+            {
+                std::optional<Batch> batch;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    condition.wait(lock, [&]() { return pending || closed; });
+                    if (!pending) return;
+
+                    batch.swap(pending);
+                }
+
+                condition.notify_all();
+                const auto ok = writer.Write(*batch);
+                batch.reset();
+
+                if (!ok)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    failed = true;
+                    closed = true;
+                }
+            }
+        });
+
+        while (more)
+        {
+            Batch batch;
+            more = next(batch, formats);
+
+            if (batch.Rows == 0) continue;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&]() { return !pending || failed; });
+            if (failed) break;
+
+            pending.emplace(std::move(batch));
+            lock.unlock();
+            condition.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+
+        condition.notify_all();
+        thread.join();
+
+        const auto ok = !failed && writer.Close();
+        return ok ? writer.Written() : 0;
+    }
+
+    /// <summary>
+    /// Write fields of a loaded DBASE as an Arrow IPC file (Feather v2) in record
+    /// batches, with the types of the C data export.
+    /// </summary>
+    /// <param name="fields">Fields to write in this order, empty for all fields.</param>
+    /// <returns>True if written, false if a field does not exist or the file could not be written.</returns>
+    static bool Write(const DBase* dbase, const std::filesystem::path& file, const std::vector<std::string>& fields, const DBaseIpcOptions& options = {}) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Columnar);
+
+        std::vector<const DBaseHandle*> handles;
+        std::vector<std::string> names;
+        if (!Handles(dbase, fields, handles, names)) return false;
+
+        const auto rows = dbase->RecordCount();
+        const auto batchRows = std::max<size_t>(options.BatchRows, 1);
+        size_t first = 0;
+        bool ok = true;
+
+        const auto written = Pipeline(file, names, [&](Batch& batch, std::vector<std::string>& formats)
+        {
+            const auto count = std::min(batchRows, rows - first);
+            ok = ok && Decode(dbase, handles, first, count, options, formats, batch);
+            first += count;
+            return ok && first < rows;
+        });
+
+        if (written) dbase->Counters.Written(written);
+        return written != 0 && ok;
+    }
+
+    /// <summary>
+    /// Convert a DBASE file that may be larger than memory to an Arrow IPC file
+    /// (Feather v2). Chunks of records are read, decoded and written one after
+    /// another, deleted records are dropped.
+    /// </summary>
+    /// <param name="fields">Fields to write in this order, empty for all fields.</param>
+    /// <returns>Number of records written or -1 on an error.</returns>
+    static int64_t Convert(const std::filesystem::path& dbf, const std::filesystem::path& file, const std::vector<std::string>& fields, const DBaseIpcOptions& options = {}) noexcept
+    {
+        DBaseReader reader;
+        if (!reader.Open(dbf)) return -1;
+
+        const auto batchRows = std::max<size_t>(options.BatchRows, 1);
+        std::unique_ptr<DBase> chunk(reader.Next(batchRows));
+        if (reader.Failed()) return -1;
+
+        // an empty file has no chunk, the header alone has the fields
+        if (!chunk) chunk.reset(DBaseUtils::FromFile(dbf));
+        if (!chunk || (!chunk->RecordSize() && !chunk->Load())) return -1;
+
+        std::vector<const DBaseHandle*> handles;
+        std::vector<std::string> names;
+        if (!Handles(chunk.get(), fields, handles, names)) return -1;
+
+        int64_t records = 0;
+        bool ok = true;
+
+        const auto written = Pipeline(file, names, [&](Batch& batch, std::vector<std::string>& formats)
+        {
+            ok = ok && Decode(chunk.get(), handles, 0, chunk->RecordCount(), options, formats, batch);
+            records += (int64_t)batch.Rows;
+            if (!ok) return false;
+
+            chunk.reset(reader.Next(batchRows));
+            ok = !reader.Failed();
+            if (!chunk) return false;
+
+            // every chunk has handles of its own
+            handles.clear();
+            return Handles(chunk.get(), fields, handles, names);
+        });
+
+        return written && ok ? records : -1;
+    }
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include "dBase.hpp"
+#include "dBaseHash.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseNumeric.hpp"
+#include "dBaseGroupBy.hpp"
+#include "dBaseParallel.hpp"
+
+/// <summary>
+/// Column to copy from the source to the target of a lookup update.
+/// </summary>
+struct DBaseJoinColumn
+{
+    std::string Source;
+    std::string Target;
+};
+
+/// <summary>
+/// Builds fixed size keys that compare equal across two DBASE files even if
+/// the key fields differ in size. Text is padded with spaces to the larger
+/// size, numbers are compared by their parsed value.
+/// </summary>
+class DBaseJoinKey
+{
+    struct Part
+    {
+        size_t Offset;
+        size_t Size;
+        size_t Width;
+        bool Numeric;
+    };
+
+    std::vector<Part> Parts;
+    size_t KeyBytes;
+
+public:
+    DBaseJoinKey() : Parts(), KeyBytes(0) {}
+
+    /// <summary>
+    /// Build matching keys for both sides of a join.
+    /// </summary>
+    /// <returns>True if all columns were found, false if not.</returns>
+    static bool Make(const DBase* a, const std::vector<std::string>& keysA, const DBase* b, const std::vector<std::string>& keysB, DBaseJoinKey& keyA, DBaseJoinKey& keyB) noexcept
+    {
+        if (keysA.empty() || keysA.size() != keysB.size()) return false;
+
+        for (size_t i = 0; i < keysA.size(); ++i)
+        {
+            const auto handleA = DBaseUtils::Find(a, keysA[i]);
+            const auto handleB = DBaseUtils::Find(b, keysB[i]);
+            if (!handleA || !handleB) return false;
+
+            const auto numeric = handleA->Type() == 'N' || handleA->Type() == 'F' || handleB->Type() == 'N' || handleB->Type() == 'F';
+            const auto width = numeric ? sizeof(double) : std::max(handleA->Size(), handleB->Size());
+
+            keyA.Parts.push_back({ handleA->Offset(), handleA->Size(), width, numeric });
+            keyB.Parts.push_back({ handleB->Offset(), handleB->Size(), width, numeric });
+            keyA.KeyBytes += width;
+            keyB.KeyBytes += width;
+        }
+
+        return true;
+    }
+
+    constexpr size_t KeySize() const noexcept { return KeyBytes; }
+
+    /// <summary>
+    /// Encode the key of a record.
+    /// </summary>
+    /// <param name="record">Pointer to the record (after the deleted flag).</param>
+    /// <param name="out">Buffer of KeySize() bytes.</param>
+    /// <returns>False if a numeric part is blank or invalid, such a key matches nothing.</returns>
+    bool Encode(const char* record, unsigned char* out) const noexcept
+    {
+        for (const auto& part : Parts)
+        {
+            if (part.Numeric)
+            {
+                double value;
+                if (!DBaseNumeric::ParseFloat(record + part.Offset, part.Size, value)) return false;
+
+                // -0 and 0 must produce the same bytes
+                if (value == 0.0) value = 0.0;
+                memcpy(out, &value, sizeof(double));
+            }
+            else
+            {
+                memcpy(out, record + part.Offset, part.Size);
+                memset(out + part.Size, ' ', part.Width - part.Size);
+            }
+
+            out += part.Width;
+        }
+
+        return true;
+    }
+};
+
+namespace DBaseJoin
+{
+    /// <summary>
+    /// Copy columns from the source to every target record with a matching key,
+    /// like a VLOOKUP. If several source records share a key the first one wins.
+    /// Records with a blank or invalid number in a key are skipped on both sides.
+    /// A hash table is built on the smaller side and probed in parallel by the
+    /// other side. Numbers and dates are copied using CopyR, everything else
+    /// using Copy.
+    /// </summary>
+    /// <param name="target">DBASE to update.</param>
+    /// <param name="targetKeys">Key columns of the target.</param>
+    /// <param name="source">DBASE to read the values from.</param>
+    /// <param name="sourceKeys">Key columns of the source, same order as the target keys.</param>
+    /// <param name="columns">Columns to copy.</param>
+    /// <returns>Number of updated target records, -1 if a column does not exist.</returns>
+    static long long LookupUpdate(DBase* target, const std::vector<std::string>& targetKeys, const DBase* source, const std::vector<std::string>& sourceKeys, const std::vector<DBaseJoinColumn>& columns) noexcept
+    {
+        DBaseJoinKey targetKey, sourceKey;
+        if (!DBaseJoinKey::Make(target, targetKeys, source, sourceKeys, targetKey, sourceKey)) return -1;
+
+        struct Copy
+        {
+            const DBaseHandle* Source;
+            const DBaseHandle* Target;
+            void (DBaseHandle::* Fn)(int, const DBaseHandle*, int) const noexcept;
+        };
+
+        std::vector<Copy> copies;
+
+        for (const auto& column : columns)
+        {
+            const auto src = DBaseUtils::Find(source, column.Source);
+            const auto dst = DBaseUtils::Find(target, column.Target);
+            if (!src || !dst) return -1;
+
+            const auto type = src->Type();
+            copies.push_back({ src, dst, type == 'N' || type == 'D' ? &DBaseHandle::CopyR : &DBaseHandle::Copy });
+        }
+
+        const auto apply = [&copies](size_t targetRow, size_t sourceRow)
+        {
+            for (const auto& copy : copies)
+            {
+                (*copy.Target.*copy.Fn)((int)targetRow, copy.Source, (int)sourceRow);
+            }
+        };
+
+        DBaseCounters::Scope scope(target->Counters, DBasePhase::Join);
+        target->Counters.Scanned(target->RecordCount());
+        source->Counters.Scanned(source->RecordCount());
+
+        const auto keySize = targetKey.KeySize();
+        std::atomic<long long> updated{ 0 };
+
+        if (source->RecordCount() <= target->RecordCount())
+        {
+            // build on the source, remember the first record of every key
+            DBaseGroupTable table(keySize, 0);
+            std::vector<size_t> first;
+            std::vector<unsigned char> key(keySize + 1);
+
+            for (size_t i = 0; i < source->RecordCount(); ++i)
+            {
+                if (!sourceKey.Encode(source->Records[i], key.data())) continue;
+
+                if (table.FindOrInsert(key.data(), DBaseHash::Hash(key.data(), keySize)) == first.size())
+                {
+                    first.push_back(i);
+                }
+            }
+
+            // probe with the target, every target record is written by a single thread
+            DBaseParallel::For(target->RecordCount(), [&](size_t begin, size_t end, size_t)
+            {
+                std::vector<unsigned char> key(keySize + 1);
+                long long count = 0;
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (!targetKey.Encode(target->Records[i], key.data())) continue;
+
+                    const auto group = table.Find(key.data(), DBaseHash::Hash(key.data(), keySize));
+
+                    if (group != SIZE_MAX)
+                    {
+                        apply(i, first[group]);
+                        ++count;
+                    }
+                }
+
+                updated += count;
+            });
+        }
+        else
+        {
+            // build on the target, records sharing a key are chained
+            DBaseGroupTable table(keySize, 0);
+            std::vector<size_t> head, next(target->RecordCount());
+            std::vector<unsigned char> key(keySize + 1);
+
+            for (size_t i = target->RecordCount(); i-- > 0;)
+            {
+                if (!targetKey.Encode(target->Records[i], key.data())) continue;
+
+                const auto group = table.FindOrInsert(key.data(), DBaseHash::Hash(key.data(), keySize));
+
+                if (group == head.size()) head.push_back(SIZE_MAX);
+                next[i] = head[group];
+                head[group] = i;
+            }
+
+            // probe with the source, keep the first matching source record per key
+            std::vector<std::atomic<size_t>> match(head.size());
+            for (auto& m : match) m = SIZE_MAX;
+
+            DBaseParallel::For(source->RecordCount(), [&](size_t begin, size_t end, size_t)
+            {
+                std::vector<unsigned char> key(keySize + 1);
+
+                for (size_t i = begin; i < end; ++i)
+                {
+                    if (!sourceKey.Encode(source->Records[i], key.data())) continue;
+
+                    const auto group = table.Find(key.data(), DBaseHash::Hash(key.data(), keySize));
+                    if (group == SIZE_MAX) continue;
+
+                    auto current = match[group].load(std::memory_order_relaxed);
+                    while (i < current && !match[group].compare_exchange_weak(current, i, std::memory_order_relaxed));
+                }
+            });
+
+            DBaseParallel::For(head.size(), [&](size_t begin, size_t end, size_t)
+            {
+                long long count = 0;
+
+                for (size_t group = begin; group < end; ++group)
+                {
+                    const auto sourceRow = match[group].load(std::memory_order_relaxed);
+                    if (sourceRow == SIZE_MAX) continue;
+
+                    for (auto row = head[group]; row != SIZE_MAX; row = next[row])
+                    {
+                        apply(row, sourceRow);
+                        ++count;
+                    }
+                }
+
+                updated += count;
+            });
+        }
+
+        return updated;
+    }
+}
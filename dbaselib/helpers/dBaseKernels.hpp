@@ -0,0 +1,865 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define DBASE_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// msvc allows every intrinsic without flags, gcc and clang need the target per function
+#if defined(_MSC_VER) && !defined(__clang__)
+#define DBASE_TARGET(isa)
+#else
+#define DBASE_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+enum class DBaseIsa : int
+{
+    Scalar = 0,
+    SSE2 = 1,
+    AVX2 = 2,
+    AVX512 = 3,
+};
+
+/// <summary>
+/// Hot loops of the library, built for several instruction sets. The best
+/// table for the cpu is picked once when the library is loaded.
+/// </summary>
+struct DBaseKernelTable
+{
+    DBaseIsa Isa;
+
+    /// <summary>
+    /// Returns the index of the first byte that is not a space, size if there is none.
+    /// </summary>
+    size_t(*SkipSpaces)(const char* data, size_t size) noexcept;
+
+    /// <summary>
+    /// Returns the index after the last byte that is not a space, 0 if there is none.
+    /// </summary>
+    size_t(*TrimRight)(const char* data, size_t size) noexcept;
+
+    /// <summary>
+    /// Copy min(size, srcSize) bytes to the start of a field and fill the rest with spaces.
+    /// </summary>
+    void(*FillCopy)(char* dst, size_t size, const char* src, size_t srcSize) noexcept;
+
+    /// <summary>
+    /// Copy min(size, srcSize) bytes to the end of a field and fill the start with spaces.
+    /// </summary>
+    void(*FillCopyRight)(char* dst, size_t size, const char* src, size_t srcSize) noexcept;
+
+    /// <summary>
+    /// Returns the index of the first occurrence of needle or SIZE_MAX.
+    /// </summary>
+    size_t(*Find)(const char* data, size_t size, const char* needle, size_t needleSize) noexcept;
+
+    /// <summary>
+    /// Collect every stride'th byte, used to read the deleted flags of all records.
+    /// </summary>
+    void(*GatherFlags)(const char* data, size_t stride, size_t count, char* flags) noexcept;
+
+    /// <summary>
+    /// Parse a run of decimal digits.
+    /// </summary>
+    /// <returns>Number of digits consumed.</returns>
+    size_t(*ParseDigits)(const char* data, size_t size, uint64_t& value) noexcept;
+
+    /// <summary>
+    /// Write the decimal digits of a value, digits has room for 20 of them.
+    /// </summary>
+    /// <returns>Number of digits written.</returns>
+    size_t(*FormatDigits)(uint64_t value, char* digits) noexcept;
+
+    /// <summary>
+    /// Returns the index of the first quote, delimiter, carriage return or line feed, size if there is none.
+    /// </summary>
+    size_t(*FindStructural)(const char* data, size_t size, char delimiter) noexcept;
+};
+
+namespace DBaseKernels
+{
+    inline unsigned Ctz32(uint32_t x) noexcept
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanForward(&index, x);
+        return index;
+#else
+        return (unsigned)__builtin_ctz(x);
+#endif
+    }
+
+    inline unsigned Ctz64(uint64_t x) noexcept
+    {
+        return (uint32_t)x ? Ctz32((uint32_t)x) : 32 + Ctz32((uint32_t)(x >> 32));
+    }
+
+    inline unsigned Msb32(uint32_t x) noexcept
+    {
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index;
+        _BitScanReverse(&index, x);
+        return index;
+#else
+        return 31 - (unsigned)__builtin_clz(x);
+#endif
+    }
+
+    inline unsigned Msb64(uint64_t x) noexcept
+    {
+        return (x >> 32) ? 32 + Msb32((uint32_t)(x >> 32)) : Msb32((uint32_t)x);
+    }
+
+    namespace Scalar
+    {
+        inline size_t SkipSpaces(const char* data, size_t size) noexcept
+        {
+            size_t i = 0;
+            while (i < size && data[i] == ' ') ++i;
+            return i;
+        }
+
+        inline size_t TrimRight(const char* data, size_t size) noexcept
+        {
+            while (size > 0 && data[size - 1] == ' ') --size;
+            return size;
+        }
+
+        inline void FillCopy(char* dst, size_t size, const char* src, size_t srcSize) noexcept
+        {
+            const auto n = std::min(size, srcSize);
+            memcpy(dst, src, n);
+            memset(dst + n, ' ', size - n);
+        }
+
+        inline void FillCopyRight(char* dst, size_t size, const char* src, size_t srcSize) noexcept
+        {
+            const auto n = std::min(size, srcSize);
+            memset(dst, ' ', size - n);
+            memcpy(dst + (size - n), src, n);
+        }
+
+        inline size_t Find(const char* data, size_t size, const char* needle, size_t needleSize) noexcept
+        {
+            const auto index = std::string_view(data, size).find(std::string_view(needle, needleSize));
+            return index == std::string_view::npos ? SIZE_MAX : index;
+        }
+
+        inline void GatherFlags(const char* data, size_t stride, size_t count, char* flags) noexcept
+        {
+            for (size_t i = 0; i < count; ++i) flags[i] = data[i * stride];
+        }
+
+        inline size_t ParseDigits(const char* data, size_t size, uint64_t& value) noexcept
+        {
+            size_t i = 0;
+            value = 0;
+
+            while (i < size && data[i] >= '0' && data[i] <= '9')
+            {
+                value = value * 10 + (uint64_t)(data[i] - '0');
+                ++i;
+            }
+
+            return i;
+        }
+
+        inline size_t FormatDigits(uint64_t value, char* digits) noexcept
+        {
+            char buffer[20];
+            size_t i = sizeof(buffer);
+
+            do
+            {
+                buffer[--i] = (char)('0' + value % 10);
+                value /= 10;
+            } while (value);
+
+            memcpy(digits, buffer + i, sizeof(buffer) - i);
+            return sizeof(buffer) - i;
+        }
+
+        inline size_t FindStructural(const char* data, size_t size, char delimiter) noexcept
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                const auto c = data[i];
+                if (c == '"' || c == delimiter || c == '\r' || c == '\n') return i;
+            }
+
+            return size;
+        }
+
+        constexpr DBaseKernelTable Table{ DBaseIsa::Scalar, SkipSpaces, TrimRight, FillCopy, FillCopyRight, Find, GatherFlags, ParseDigits, FormatDigits, FindStructural };
+    }
+
+#if DBASE_KERNELS_X86
+    namespace SSE2
+    {
+        // copy n bytes using overlapping loads and stores instead of a memcpy call
+        DBASE_TARGET("sse2") inline void Copy(char* dst, const char* src, size_t n) noexcept
+        {
+            if (n >= 16)
+            {
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16) _mm_storeu_si128((__m128i*)(dst + i), _mm_loadu_si128((const __m128i*)(src + i)));
+                if (i < n) _mm_storeu_si128((__m128i*)(dst + n - 16), _mm_loadu_si128((const __m128i*)(src + n - 16)));
+            }
+            else if (n >= 8)
+            {
+                uint64_t a, b;
+                memcpy(&a, src, 8);
+                memcpy(&b, src + n - 8, 8);
+                memcpy(dst, &a, 8);
+                memcpy(dst + n - 8, &b, 8);
+            }
+            else if (n >= 4)
+            {
+                uint32_t a, b;
+                memcpy(&a, src, 4);
+                memcpy(&b, src + n - 4, 4);
+                memcpy(dst, &a, 4);
+                memcpy(dst + n - 4, &b, 4);
+            }
+            else if (n > 0)
+            {
+                const char a = src[0], b = src[n / 2], c = src[n - 1];
+                dst[0] = a;
+                dst[n / 2] = b;
+                dst[n - 1] = c;
+            }
+        }
+
+        DBASE_TARGET("sse2") inline void Fill(char* dst, size_t n) noexcept
+        {
+            constexpr uint64_t SPACES = 0x2020202020202020ull;
+
+            if (n >= 16)
+            {
+                const auto spaces = _mm_set1_epi8(' ');
+                size_t i = 0;
+                for (; i + 16 <= n; i += 16) _mm_storeu_si128((__m128i*)(dst + i), spaces);
+                if (i < n) _mm_storeu_si128((__m128i*)(dst + n - 16), spaces);
+            }
+            else if (n >= 8)
+            {
+                memcpy(dst, &SPACES, 8);
+                memcpy(dst + n - 8, &SPACES, 8);
+            }
+            else if (n >= 4)
+            {
+                memcpy(dst, &SPACES, 4);
+                memcpy(dst + n - 4, &SPACES, 4);
+            }
+            else if (n > 0)
+            {
+                dst[0] = dst[n / 2] = dst[n - 1] = ' ';
+            }
+        }
+
+        DBASE_TARGET("sse2") inline size_t SkipSpaces(const char* data, size_t size) noexcept
+        {
+            const auto spaces = _mm_set1_epi8(' ');
+            size_t i = 0;
+
+            for (; i + 16 <= size; i += 16)
+            {
+                const auto v = _mm_loadu_si128((const __m128i*)(data + i));
+                const auto mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, spaces)) ^ 0xFFFF;
+                if (mask) return i + Ctz32(mask);
+            }
+
+            while (i < size && data[i] == ' ') ++i;
+            return i;
+        }
+
+        DBASE_TARGET("sse2") inline size_t TrimRight(const char* data, size_t size) noexcept
+        {
+            const auto spaces = _mm_set1_epi8(' ');
+
+            for (; size >= 16; size -= 16)
+            {
+                const auto v = _mm_loadu_si128((const __m128i*)(data + size - 16));
+                const auto mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, spaces)) ^ 0xFFFF;
+                if (mask) return size - 16 + Msb32(mask) + 1;
+            }
+
+            while (size > 0 && data[size - 1] == ' ') --size;
+            return size;
+        }
+
+        DBASE_TARGET("sse2") inline void FillCopy(char* dst, size_t size, const char* src, size_t srcSize) noexcept
+        {
+            const auto n = std::min(size, srcSize);
+            Copy(dst, src, n);
+            Fill(dst + n, size - n);
+        }
+
+        DBASE_TARGET("sse2") inline void FillCopyRight(char* dst, size_t size, const char* src, size_t srcSize) noexcept
+        {
+            const auto n = std::min(size, srcSize);
+            Fill(dst, size - n);
+            Copy(dst + (size - n), src, n);
+        }
+
+        // compares the first and last needle byte for 16 positions at once, only candidates are memcmp'ed
+        DBASE_TARGET("sse2") inline size_t Find(const char* data, size_t size, const char* needle, size_t needleSize) noexcept
+        {
+            if (needleSize == 0) return 0;
+            if (needleSize > size) return SIZE_MAX;
+
+            const auto first = _mm_set1_epi8(needle[0]);
+            const auto last = _mm_set1_epi8(needle[needleSize - 1]);
+            size_t i = 0;
+
+            for (; i + needleSize - 1 + 16 <= size; i += 16)
+            {
+                const auto a = _mm_loadu_si128((const __m128i*)(data + i));
+                const auto b = _mm_loadu_si128((const __m128i*)(data + i + needleSize - 1));
+                auto mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+
+                while (mask)
+                {
+                    const auto index = i + Ctz32(mask);
+                    if (memcmp(data + index, needle, needleSize) == 0) return index;
+                    mask &= mask - 1;
+                }
+            }
+
+            const auto index = Scalar::Find(data + i, size - i, needle, needleSize);
+            return index == SIZE_MAX ? SIZE_MAX : i + index;
+        }
+
+        // converts up to 16 right aligned digits with multiply-adds
+        DBASE_TARGET("sse2") inline uint64_t Digits16(const char* digits) noexcept
+        {
+            const auto v = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)digits), _mm_set1_epi8('0'));
+            const auto zero = _mm_setzero_si128();
+
+            const auto m10 = _mm_setr_epi16(10, 1, 10, 1, 10, 1, 10, 1);
+            const auto lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), m10);
+            const auto hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), m10);
+
+            const auto m100 = _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1);
+            const auto r4 = _mm_madd_epi16(_mm_packs_epi32(lo, hi), m100);
+
+            const auto m10000 = _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1);
+            const auto r8 = _mm_madd_epi16(_mm_packs_epi32(r4, r4), m10000);
+
+            const auto a = (uint32_t)_mm_cvtsi128_si32(r8);
+            const auto b = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(r8, 4));
+            return (uint64_t)a * 100000000ull + b;
+        }
+
+        DBASE_TARGET("sse2") inline size_t CountDigits(const char* data, size_t size) noexcept
+        {
+            char buffer[16]{ 0 };
+            memcpy(buffer, data, std::min<size_t>(size, 16));
+
+            // a byte is a digit if (byte - '0') is at most 9 when treated as unsigned
+            const auto v = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)buffer), _mm_set1_epi8('0'));
+            const auto digits = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(v, _mm_set1_epi8(9)), _mm_setzero_si128()));
+            return std::min<size_t>(size, Ctz32(~digits));
+        }
+
+        template<uint64_t(*Convert)(const char*) noexcept>
+        inline size_t ParseDigitsWith(const char* data, size_t size, uint64_t& value, size_t count) noexcept
+        {
+            // right align the digits in a buffer of zeros so a single conversion handles any length
+            char buffer[16];
+            memset(buffer, '0', 16);
+            memcpy(buffer + 16 - count, data, count);
+            value = Convert(buffer);
+
+            if (count == 16 && size > 16)
+            {
+                uint64_t rest;
+                const auto more = Scalar::ParseDigits(data + 16, size - 16, rest);
+
+                for (size_t i = 0; i < more; ++i) value *= 10;
+                value += rest;
+                return 16 + more;
+            }
+
+            return count;
+        }
+
+        DBASE_TARGET("sse2") inline size_t ParseDigits(const char* data, size_t size, uint64_t& value) noexcept
+        {
+            return ParseDigitsWith<Digits16>(data, size, value, CountDigits(data, size));
+        }
+
+        // splits a value below 10^8 into eight 16 bit digits, dividing by powers of ten with multiply-highs
+        DBASE_TARGET("sse2") inline __m128i Digits8(uint32_t value) noexcept
+        {
+            const auto abcdefgh = _mm_cvtsi32_si128((int)value);
+            const auto abcd = _mm_srli_epi64(_mm_mul_epu32(abcdefgh, _mm_set1_epi32((int)0xd1b71759)), 45);
+            const auto efgh = _mm_sub_epi32(abcdefgh, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+
+            // both halves times 4 in every lane of their half
+            const auto halves = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+            const auto spread = _mm_unpacklo_epi32(_mm_unpacklo_epi16(halves, halves), _mm_unpacklo_epi16(halves, halves));
+
+            // a, ab, abc, abcd, e, ef, efg, efgh
+            const auto prefixes = _mm_mulhi_epu16(_mm_mulhi_epu16(spread, _mm_setr_epi16(8389, 5243, 13108, (short)32768, 8389, 5243, 13108, (short)32768)),
+                _mm_setr_epi16(128, 2048, 8192, (short)32768, 128, 2048, 8192, (short)32768));
+
+            return _mm_sub_epi16(prefixes, _mm_slli_epi64(_mm_mullo_epi16(prefixes, _mm_set1_epi16(10)), 16));
+        }
+
+        DBASE_TARGET("sse2") inline size_t FormatDigits(uint64_t value, char* digits) noexcept
+        {
+            size_t length = 0;
+            auto low = value;
+
+            // the 16 low digits are converted at once, anything above them is at most 4 digits
+            if (value >= 10000000000000000ull)
+            {
+                length = Scalar::FormatDigits(value / 10000000000000000ull, digits);
+                low = value % 10000000000000000ull;
+            }
+
+            const auto ascii = _mm_add_epi8(_mm_packus_epi16(Digits8((uint32_t)(low / 100000000)), Digits8((uint32_t)(low % 100000000))), _mm_set1_epi8('0'));
+            const auto zeros = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ascii, _mm_set1_epi8('0')));
+            const auto skip = length ? 0 : std::min(Ctz32(~zeros), 15u);
+
+            char buffer[16];
+            _mm_storeu_si128((__m128i*)buffer, ascii);
+            memcpy(digits + length, buffer + skip, 16 - skip);
+            return length + 16 - skip;
+        }
+
+        DBASE_TARGET("sse2") inline size_t FindStructural(const char* data, size_t size, char delimiter) noexcept
+        {
+            const auto quote = _mm_set1_epi8('"');
+            const auto separator = _mm_set1_epi8(delimiter);
+            const auto cr = _mm_set1_epi8('\r');
+            const auto lf = _mm_set1_epi8('\n');
+            size_t i = 0;
+
+            for (; i + 16 <= size; i += 16)
+            {
+                const auto v = _mm_loadu_si128((const __m128i*)(data + i));
+                const auto hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, separator)), _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)));
+                const auto mask = (uint32_t)_mm_movemask_epi8(hits);
+                if (mask) return i + Ctz32(mask);
+            }
+
+            return i + Scalar::FindStructural(data + i, size - i, delimiter);
+        }
+
+        constexpr DBaseKernelTable Table{ DBaseIsa::SSE2, SkipSpaces, TrimRight, FillCopy, FillCopyRight, Find, Scalar::GatherFlags, ParseDigits, FormatDigits, FindStructural };
+    }
+
+    namespace AVX2
+    {
+        DBASE_TARGET("avx2") inline void Copy(char* dst, const char* src, size_t n) noexcept
+        {
+            if (n < 32) return SSE2::Copy(dst, src, n);
+
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) _mm256_storeu_si256((__m256i*)(dst + i), _mm256_loadu_si256((const __m256i*)(src + i)));
+            if (i < n) _mm256_storeu_si256((__m256i*)(dst + n - 32), _mm256_loadu_si256((const __m256i*)(src + n - 32)));
+        }
+
+        DBASE_TARGET("avx2") inline void Fill(char* dst, size_t n) noexcept
+        {
+            if (n < 32) return SSE2::Fill(dst, n);
+
+            const auto spaces = _mm256_set1_epi8(' ');
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) _mm256_storeu_si256((__m256i*)(dst + i), spaces);
+            if (i < n) _mm256_storeu_si256((__m256i*)(dst + n - 32), spaces);
+        }
+
+        DBASE_TARGET("avx2") inline size_t SkipSpaces(const char* data, size_t size) noexcept
+        {
+            const auto spaces = _mm256_set1_epi8(' ');
+            size_t i = 0;
+
+            for (; i + 32 <= size; i += 32)
+            {
+                const auto v = _mm256_loadu_si256((const __m256i*)(data + i));
+                const auto mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, spaces));
+                if (mask) return i + Ctz32(mask);
+            }
+
+            return i + SSE2::SkipSpaces(data + i, size - i);
+        }
+
+        DBASE_TARGET("avx2") inline size_t TrimRight(const char* data, size_t size) noexcept
+        {
+            const auto spaces = _mm256_set1_epi8(' ');
+
+            for (; size >= 32; size -= 32)
+            {
+                const auto v = _mm256_loadu_si256((const __m256i*)(data + size - 32));
+                const auto mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, spaces));
+                if (mask) return size - 32 + Msb32(mask) + 1;
+            }
+
+            return SSE2::TrimRight(data, size);
+        }
+
+        DBASE_TARGET("avx2") inline void FillCopy(char* dst, size_t size, const char* src, size_t srcSize) noexcept
+        {
+            const auto n = std::min(size, srcSize);
+            Copy(dst, src, n);
+            Fill(dst + n, size - n);
+        }
+
+        DBASE_TARGET("avx2") inline void FillCopyRight(char* dst, size_t size, const char* src, size_t srcSize) noexcept
+        {
+            const auto n = std::min(size, srcSize);
+            Fill(dst, size - n);
+            Copy(dst + (size - n), src, n);
+        }
+
+        DBASE_TARGET("avx2") inline size_t Find(const char* data, size_t size, const char* needle, size_t needleSize) noexcept
+        {
+            if (needleSize == 0) return 0;
+            if (needleSize > size) return SIZE_MAX;
+
+            const auto first = _mm256_set1_epi8(needle[0]);
+            const auto last = _mm256_set1_epi8(needle[needleSize - 1]);
+            size_t i = 0;
+
+            for (; i + needleSize - 1 + 32 <= size; i += 32)
+            {
+                const auto a = _mm256_loadu_si256((const __m256i*)(data + i));
+                const auto b = _mm256_loadu_si256((const __m256i*)(data + i + needleSize - 1));
+                auto mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+
+                while (mask)
+                {
+                    const auto index = i + Ctz32(mask);
+                    if (memcmp(data + index, needle, needleSize) == 0) return index;
+                    mask &= mask - 1;
+                }
+            }
+
+            const auto index = SSE2::Find(data + i, size - i, needle, needleSize);
+            return index == SIZE_MAX ? SIZE_MAX : i + index;
+        }
+
+        DBASE_TARGET("avx2") inline void GatherFlags(const char* data, size_t stride, size_t count, char* flags) noexcept
+        {
+            size_t i = 0;
+
+            // every gather reads 4 bytes per record, keep the last records scalar so we never read past the data
+            if (stride >= 4 && stride <= INT32_MAX / 8)
+            {
+                const auto offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)stride));
+                const auto lowBytes = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+
+                for (; i + 8 < count; i += 8)
+                {
+                    const auto values = _mm256_i32gather_epi32((const int*)(data + i * stride), offsets, 1);
+                    const auto packed = _mm256_shuffle_epi8(values, lowBytes);
+
+                    const auto a = (uint32_t)_mm_cvtsi128_si32(_mm256_castsi256_si128(packed));
+                    const auto b = (uint32_t)_mm_cvtsi128_si32(_mm256_extracti128_si256(packed, 1));
+                    memcpy(flags + i, &a, 4);
+                    memcpy(flags + i + 4, &b, 4);
+                }
+            }
+
+            Scalar::GatherFlags(data + i * stride, stride, count - i, flags + i);
+        }
+
+        DBASE_TARGET("ssse3,sse4.1") inline uint64_t Digits16(const char* digits) noexcept
+        {
+            const auto v = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)digits), _mm_set1_epi8('0'));
+
+            const auto r2 = _mm_maddubs_epi16(v, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+            const auto r4 = _mm_madd_epi16(r2, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+            const auto r8 = _mm_madd_epi16(_mm_packus_epi32(r4, r4), _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+            const auto a = (uint32_t)_mm_cvtsi128_si32(r8);
+            const auto b = (uint32_t)_mm_extract_epi32(r8, 1);
+            return (uint64_t)a * 100000000ull + b;
+        }
+
+        DBASE_TARGET("avx2") inline size_t ParseDigits(const char* data, size_t size, uint64_t& value) noexcept
+        {
+            return SSE2::ParseDigitsWith<Digits16>(data, size, value, SSE2::CountDigits(data, size));
+        }
+
+        DBASE_TARGET("avx2") inline size_t FindStructural(const char* data, size_t size, char delimiter) noexcept
+        {
+            const auto quote = _mm256_set1_epi8('"');
+            const auto separator = _mm256_set1_epi8(delimiter);
+            const auto cr = _mm256_set1_epi8('\r');
+            const auto lf = _mm256_set1_epi8('\n');
+            size_t i = 0;
+
+            for (; i + 32 <= size; i += 32)
+            {
+                const auto v = _mm256_loadu_si256((const __m256i*)(data + i));
+                const auto hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, separator)), _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)));
+                const auto mask = (uint32_t)_mm256_movemask_epi8(hits);
+                if (mask) return i + Ctz32(mask);
+            }
+
+            return i + SSE2::FindStructural(data + i, size - i, delimiter);
+        }
+
+        constexpr DBaseKernelTable Table{ DBaseIsa::AVX2, SkipSpaces, TrimRight, FillCopy, FillCopyRight, Find, GatherFlags, ParseDigits, SSE2::FormatDigits, FindStructural };
+    }
+
+    namespace AVX512
+    {
+        constexpr uint64_t Mask(size_t n) noexcept { return n >= 64 ? ~0ull : (1ull << n) - 1; }
+
+        // masked loads never fault on masked out bytes, so fields need no scalar tail
+        DBASE_TARGET("avx512f,avx512bw") inline size_t SkipSpaces(const char* data, size_t size) noexcept
+        {
+            const auto spaces = _mm512_set1_epi8(' ');
+
+            for (size_t i = 0; i < size; i += 64)
+            {
+                const auto valid = Mask(size - i);
+                const auto v = _mm512_maskz_loadu_epi8(valid, data + i);
+                const auto mask = _mm512_mask_cmpneq_epi8_mask(valid, v, spaces);
+                if (mask) return i + Ctz64(mask);
+            }
+
+            return size;
+        }
+
+        DBASE_TARGET("avx512f,avx512bw") inline size_t TrimRight(const char* data, size_t size) noexcept
+        {
+            const auto spaces = _mm512_set1_epi8(' ');
+
+            while (size > 0)
+            {
+                const auto chunk = std::min<size_t>(size, 64);
+                const auto start = data + size - chunk;
+                const auto valid = Mask(chunk);
+                const auto mask = _mm512_mask_cmpneq_epi8_mask(valid, _mm512_maskz_loadu_epi8(valid, start), spaces);
+
+                if (mask) return size - chunk + Msb64(mask) + 1;
+                size -= chunk;
+            }
+
+            return 0;
+        }
+
+        DBASE_TARGET("avx512f,avx512bw") inline void FillCopy(char* dst, size_t size, const char* src, size_t srcSize) noexcept
+        {
+            const auto spaces = _mm512_set1_epi8(' ');
+            auto n = std::min(size, srcSize);
+
+            while (size > 0)
+            {
+                const auto chunk = std::min<size_t>(size, 64);
+                const auto take = std::min(n, chunk);
+
+                _mm512_mask_storeu_epi8(dst, Mask(chunk), _mm512_mask_loadu_epi8(spaces, Mask(take), src));
+
+                dst += chunk;
+                src += take;
+                size -= chunk;
+                n -= take;
+            }
+        }
+
+        DBASE_TARGET("avx512f,avx512bw") inline void FillCopyRight(char* dst, size_t size, const char* src, size_t srcSize) noexcept
+        {
+            const auto spaces = _mm512_set1_epi8(' ');
+            const auto n = std::min(size, srcSize);
+            const auto pad = size - n;
+
+            for (size_t offset = 0; offset < size; offset += 64)
+            {
+                const auto chunk = std::min<size_t>(size - offset, 64);
+
+                // lanes before the padding end are masked, the load address may point before src
+                const auto skip = pad > offset ? std::min<size_t>(pad - offset, 64) : 0;
+                const auto lanes = Mask(chunk) & ~Mask(skip);
+                const auto from = reinterpret_cast<const char*>(reinterpret_cast<uintptr_t>(src) + offset - pad);
+
+                _mm512_mask_storeu_epi8(dst + offset, Mask(chunk), _mm512_mask_loadu_epi8(spaces, lanes, from));
+            }
+        }
+
+        DBASE_TARGET("avx512f,avx512bw") inline size_t Find(const char* data, size_t size, const char* needle, size_t needleSize) noexcept
+        {
+            if (needleSize == 0) return 0;
+            if (needleSize > size) return SIZE_MAX;
+
+            const auto first = _mm512_set1_epi8(needle[0]);
+            const auto last = _mm512_set1_epi8(needle[needleSize - 1]);
+            const auto positions = size - needleSize + 1;
+
+            for (size_t i = 0; i < positions; i += 64)
+            {
+                const auto valid = Mask(positions - i);
+                const auto a = _mm512_maskz_loadu_epi8(valid, data + i);
+                const auto b = _mm512_maskz_loadu_epi8(valid, data + i + needleSize - 1);
+                auto mask = _mm512_mask_cmpeq_epi8_mask(_mm512_mask_cmpeq_epi8_mask(valid, a, first), b, last);
+
+                while (mask)
+                {
+                    const auto index = i + Ctz64(mask);
+                    if (memcmp(data + index, needle, needleSize) == 0) return index;
+                    mask &= mask - 1;
+                }
+            }
+
+            return SIZE_MAX;
+        }
+
+        DBASE_TARGET("avx512f,avx512bw") inline void GatherFlags(const char* data, size_t stride, size_t count, char* flags) noexcept
+        {
+            size_t i = 0;
+
+            if (stride >= 4 && stride <= INT32_MAX / 16)
+            {
+                const auto offsets = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), _mm512_set1_epi32((int)stride));
+
+                for (; i + 16 < count; i += 16)
+                {
+                    const auto values = _mm512_i32gather_epi32(offsets, (const void*)(data + i * stride), 1);
+                    _mm_storeu_si128((__m128i*)(flags + i), _mm512_cvtepi32_epi8(values));
+                }
+            }
+
+            Scalar::GatherFlags(data + i * stride, stride, count - i, flags + i);
+        }
+
+        DBASE_TARGET("avx512f,avx512bw") inline size_t FindStructural(const char* data, size_t size, char delimiter) noexcept
+        {
+            const auto quote = _mm512_set1_epi8('"');
+            const auto separator = _mm512_set1_epi8(delimiter);
+            const auto cr = _mm512_set1_epi8('\r');
+            const auto lf = _mm512_set1_epi8('\n');
+
+            for (size_t i = 0; i < size; i += 64)
+            {
+                const auto valid = Mask(size - i);
+                const auto v = _mm512_maskz_loadu_epi8(valid, data + i);
+                const auto mask = (_mm512_cmpeq_epi8_mask(v, quote) | _mm512_cmpeq_epi8_mask(v, separator) | _mm512_cmpeq_epi8_mask(v, cr) | _mm512_cmpeq_epi8_mask(v, lf)) & valid;
+                if (mask) return i + Ctz64(mask);
+            }
+
+            return size;
+        }
+
+        constexpr DBaseKernelTable Table{ DBaseIsa::AVX512, SkipSpaces, TrimRight, FillCopy, FillCopyRight, Find, GatherFlags, AVX2::ParseDigits, SSE2::FormatDigits, FindStructural };
+    }
+
+    /// <summary>
+    /// Returns the best instruction set supported by the cpu and the os.
+    /// </summary>
+    inline DBaseIsa Detect() noexcept
+    {
+        const auto cpuid = [](int leaf, int sub, int regs[4])
+        {
+#if defined(_MSC_VER)
+            __cpuidex(regs, leaf, sub);
+#else
+            __cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+        };
+
+        int regs[4];
+        cpuid(0, 0, regs);
+        const auto maxLeaf = regs[0];
+
+        cpuid(1, 0, regs);
+        const auto sse2 = (regs[3] >> 26) & 1;
+        const auto ssse3 = (regs[2] >> 9) & 1;
+        const auto sse41 = (regs[2] >> 19) & 1;
+        const auto osxsave = (regs[2] >> 27) & 1;
+
+        if (!sse2) return DBaseIsa::Scalar;
+        if (!osxsave || maxLeaf < 7 || !ssse3 || !sse41) return DBaseIsa::SSE2;
+
+#if defined(_MSC_VER)
+        const auto xcr0 = (uint64_t)_xgetbv(0);
+#else
+        uint32_t eax, edx;
+        __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        const auto xcr0 = ((uint64_t)edx << 32) | eax;
+#endif
+
+        cpuid(7, 0, regs);
+        const auto avx2 = (regs[1] >> 5) & 1;
+        const auto avx512f = (regs[1] >> 16) & 1;
+        const auto avx512bw = (regs[1] >> 30) & 1;
+
+        // the os has to save the ymm (and zmm) registers on context switches
+        if (avx512f && avx512bw && avx2 && (xcr0 & 0xE6) == 0xE6) return DBaseIsa::AVX512;
+        if (avx2 && (xcr0 & 0x6) == 0x6) return DBaseIsa::AVX2;
+        return DBaseIsa::SSE2;
+    }
+#endif
+
+    /// <summary>
+    /// Returns the kernel table of an instruction set.
+    /// </summary>
+    inline const DBaseKernelTable& Table(DBaseIsa isa) noexcept
+    {
+        switch (isa)
+        {
+#if DBASE_KERNELS_X86
+        case DBaseIsa::AVX512: return AVX512::Table;
+        case DBaseIsa::AVX2: return AVX2::Table;
+        case DBaseIsa::SSE2: return SSE2::Table;
+#endif
+        default: return Scalar::Table;
+        }
+    }
+
+    /// <summary>
+    /// Pick the kernels for this cpu. The DBASELIB_ISA environment variable
+    /// (scalar, sse2, avx2, avx512) may lower the choice for testing.
+    /// </summary>
+    inline const DBaseKernelTable& Select() noexcept
+    {
+#if DBASE_KERNELS_X86
+        auto isa = Detect();
+#else
+        auto isa = DBaseIsa::Scalar;
+#endif
+
+        if (const auto env = std::getenv("DBASELIB_ISA"))
+        {
+            const std::string_view name(env);
+            auto requested = isa;
+
+            if (name == "scalar") requested = DBaseIsa::Scalar;
+            else if (name == "sse2") requested = DBaseIsa::SSE2;
+            else if (name == "avx2") requested = DBaseIsa::AVX2;
+            else if (name == "avx512") requested = DBaseIsa::AVX512;
+
+            isa = std::min(isa, requested);
+        }
+
+        return Table(isa);
+    }
+
+    /// <summary>
+    /// Returns the kernels picked for this cpu.
+    /// </summary>
+    inline const DBaseKernelTable& Active() noexcept
+    {
+        static const auto& table = Select();
+        return table;
+    }
+
+    // resolve the kernels while the library is loaded instead of on first use
+    inline const DBaseIsa LoadedIsa = Active().Isa;
+}
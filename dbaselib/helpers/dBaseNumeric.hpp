@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <charconv>
+#include <type_traits>
+#include <system_error>
+
+#include "dBaseKernels.hpp"
+#include "fast_float/fast_float.h"
+
+/// <summary>
+/// Decoders for the textual numbers stored in DBASE fields. These are shared
+/// by the handles and the bulk operations so every path reads the same value.
+/// </summary>
+namespace DBaseNumeric
+{
+    constexpr fast_float::parse_options FFOptions{ fast_float::chars_format::general };
+
+    /// <summary>
+    /// Returns a pointer to the first non space character or end.
+    /// </summary>
+    constexpr const char* SkipSpaces(const char* begin, const char* end) noexcept
+    {
+        if (std::is_constant_evaluated())
+        {
+            while (begin < end && *begin == ' ') ++begin;
+            return begin;
+        }
+
+        return begin + DBaseKernels::Active().SkipSpaces(begin, (size_t)(end - begin));
+    }
+
+    /// <summary>
+    /// Parse a floating point number from a field.
+    /// </summary>
+    /// <param name="data">Pointer to the fields data.</param>
+    /// <param name="size">Size of the field.</param>
+    /// <param name="value">Parsed value, 0 if the field is blank or invalid.</param>
+    /// <returns>True if a number was parsed, false if the field is blank or invalid.</returns>
+    template<typename T>
+    inline bool ParseFloat(const char* data, size_t size, T& value) noexcept
+    {
+        const auto end = data + size;
+        const auto first = SkipSpaces(data, end);
+
+        if (first == end || fast_float::from_chars_advanced(first, end, value, FFOptions).ec != std::errc())
+        {
+            value = T(0);
+            return false;
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Parse an integer from a field, parsing stops at the first non digit.
+    /// </summary>
+    /// <param name="data">Pointer to the fields data.</param>
+    /// <param name="size">Size of the field.</param>
+    /// <returns>The parsed integer, 0 if the field is blank.</returns>
+    template<typename T = int>
+    constexpr T ParseInt(const char* data, size_t size) noexcept
+    {
+        const auto end = data + size;
+        const char* p = SkipSpaces(data, end);
+
+        T x = 0;
+        bool negative = false;
+
+        if (p < end && *p == '-')
+        {
+            negative = true;
+            ++p;
+        }
+
+        if (std::is_constant_evaluated())
+        {
+            while (p < end && *p >= '0' && *p <= '9')
+            {
+                x = (x * 10) + (*p - '0');
+                ++p;
+            }
+        }
+        else
+        {
+            uint64_t digits;
+            DBaseKernels::Active().ParseDigits(p, (size_t)(end - p), digits);
+            x = (T)digits;
+        }
+
+        return negative ? -x : x;
+    }
+
+    /// <summary>
+    /// Copy a formatted number right aligned into a field. Numbers that
+    /// do not fit are written as asterisks like dBase does.
+    /// </summary>
+    /// <returns>True if the number did fit, false if not.</returns>
+    inline bool WriteRight(char* data, size_t size, const char* text, size_t length) noexcept
+    {
+        if (length > size)
+        {
+            memset(data, '*', size);
+            return false;
+        }
+
+        DBaseKernels::Active().FillCopyRight(data, size, text, length);
+        return true;
+    }
+
+    /// <summary>
+    /// Format a floating point number into a field.
+    /// </summary>
+    /// <param name="data">Pointer to the fields data.</param>
+    /// <param name="size">Size of the field.</param>
+    /// <param name="value">Value to format.</param>
+    /// <param name="decimals">Number of decimals to write.</param>
+    inline bool FormatFloat(char* data, size_t size, double value, int decimals) noexcept
+    {
+        char buffer[352];
+        const auto r = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, decimals);
+        return WriteRight(data, size, buffer, r.ec == std::errc() ? r.ptr - buffer : sizeof(buffer));
+    }
+
+    /// <summary>
+    /// Format an integer into a field.
+    /// </summary>
+    /// <param name="data">Pointer to the fields data.</param>
+    /// <param name="size">Size of the field.</param>
+    /// <param name="value">Value to format.</param>
+    inline bool FormatInt(char* data, size_t size, long long value) noexcept
+    {
+        char buffer[24];
+        size_t length = 0;
+
+        if (value < 0) buffer[length++] = '-';
+        length += DBaseKernels::Active().FormatDigits(value < 0 ? 0 - (uint64_t)value : (uint64_t)value, buffer + length);
+
+        return WriteRight(data, size, buffer, length);
+    }
+}
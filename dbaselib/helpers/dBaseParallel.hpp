@@ -0,0 +1,190 @@
+#pragma once
+
+#include <queue>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+/// <summary>
+/// Small thread pool shared by all bulk operations.
+/// </summary>
+class DBaseThreadPool
+{
+    std::vector<std::thread> Workers;
+    std::queue<std::function<void()>> Tasks;
+    std::mutex Mutex;
+    std::condition_variable Condition;
+    bool Stopping;
+
+public:
+    explicit DBaseThreadPool(size_t threads)
+        : Workers(),
+        Tasks(),
+        Stopping(false)
+    {
+        for (size_t i = 0; i < threads; ++i)
+        {
+            Workers.emplace_back([this]()
+            {
+                for (;;)
+                {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock<std::mutex> lock(Mutex);
+                        Condition.wait(lock, [this]() { return Stopping || !Tasks.empty(); });
+
+                        if (Stopping && Tasks.empty()) return;
+
+                        task = std::move(Tasks.front());
+                        Tasks.pop();
+                    }
+
+                    task();
+                }
+            });
+        }
+    }
+
+    ~DBaseThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Stopping = true;
+        }
+
+        Condition.notify_all();
+        for (auto& worker : Workers) worker.join();
+    }
+
+    /// <summary>
+    /// Returns the number of threads that take part in a ParallelFor
+    /// including the calling thread.
+    /// </summary>
+    size_t Concurrency() const noexcept { return Workers.size() + 1; }
+
+    /// <summary>
+    /// Queue a task to be run on a worker thread.
+    /// </summary>
+    void Submit(std::function<void()> task) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            Tasks.push(std::move(task));
+        }
+
+        Condition.notify_one();
+    }
+
+    /// <summary>
+    /// Split [0, count) into blocks and run them in parallel. The calling thread
+    /// takes part, so this never waits on workers that are busy with other work.
+    /// </summary>
+    /// <param name="count">Number of items (usually records).</param>
+    /// <param name="blockSize">Number of items per block.</param>
+    /// <param name="fn">Called as fn(begin, end, slot), slot is unique per thread and below Concurrency().</param>
+    template<typename Fn>
+    void ParallelFor(size_t count, size_t blockSize, Fn&& fn) noexcept
+    {
+        if (count == 0) return;
+
+        blockSize = std::max<size_t>(1, blockSize);
+        const auto blocks = (count + blockSize - 1) / blockSize;
+        const auto helpers = std::min(Workers.size(), blocks - 1);
+
+        if (helpers == 0)
+        {
+            fn(size_t(0), count, size_t(0));
+            return;
+        }
+
+        // shared so late helpers that find no work left never touch the callers stack
+        struct State
+        {
+            std::atomic<size_t> Next{ 0 };
+            std::atomic<size_t> Done{ 0 };
+            std::mutex Mutex;
+            std::condition_variable Condition;
+        };
+
+        const auto state = std::make_shared<State>();
+        const std::function<void(size_t, size_t, size_t)> body = fn;
+
+        const auto run = [state, blocks, blockSize, count, body = &body](size_t slot)
+        {
+            for (;;)
+            {
+                const auto block = state->Next.fetch_add(1);
+                if (block >= blocks) return;
+
+                const auto begin = block * blockSize;
+                (*body)(begin, std::min(count, begin + blockSize), slot);
+
+                if (state->Done.fetch_add(1) + 1 == blocks)
+                {
+                    std::lock_guard<std::mutex> lock(state->Mutex);
+                    state->Condition.notify_all();
+                }
+            }
+        };
+
+        for (size_t i = 1; i <= helpers; ++i)
+        {
+            Submit([run, i]() { run(i); });
+        }
+
+        run(0);
+
+        std::unique_lock<std::mutex> lock(state->Mutex);
+        state->Condition.wait(lock, [&]() { return state->Done.load() == blocks; });
+    }
+};
+
+namespace DBaseParallel
+{
+    constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    /// <summary>
+    /// Returns the number of threads of the shared pool, one per cpu. The
+    /// DBASELIB_THREADS environment variable sets another count for testing.
+    /// </summary>
+    inline size_t Threads() noexcept
+    {
+        if (const auto env = std::getenv("DBASELIB_THREADS"))
+        {
+            const auto threads = std::strtoul(env, nullptr, 10);
+            if (threads > 0) return std::min<size_t>(threads, 256);
+        }
+
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    /// <summary>
+    /// Returns the shared thread pool. The pool is intentionally never destroyed,
+    /// joining threads while the library gets unloaded may deadlock.
+    /// </summary>
+    inline DBaseThreadPool& Pool() noexcept
+    {
+        static auto pool = new DBaseThreadPool(Threads() - 1);
+        return *pool;
+    }
+
+    /// <summary>
+    /// Run fn(begin, end, slot) over [0, count) in blocks on the shared pool.
+    /// </summary>
+    template<typename Fn>
+    inline void For(size_t count, Fn&& fn, size_t blockSize = DEFAULT_BLOCK_SIZE) noexcept
+    {
+        Pool().ParallelFor(count, blockSize, std::forward<Fn>(fn));
+    }
+
+    /// <summary>
+    /// Returns the number of slots a For() call may use.
+    /// </summary>
+    inline size_t Concurrency() noexcept { return Pool().Concurrency(); }
+}
@@ -0,0 +1,871 @@
+#pragma once
+
+#include <bit>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+
+#include "dBase.hpp"
+#include "dBaseFile.hpp"
+#include "dBaseArrow.hpp"
+#include "dBaseReader.hpp"
+#include "dBaseParallel.hpp"
+
+/// <summary>
+/// How a DBASE is written as a Parquet file.
+/// </summary>
+struct DBaseParquetOptions
+{
+    /// <summary>
+    /// Records per row group, the memory used is about one row group regardless of the table size.
+    /// </summary>
+    size_t RowGroupRows = 1024 * 1024;
+
+    /// <summary>
+    /// Values per data page, rounded up to a multiple of 8.
+    /// </summary>
+    size_t PageRows = 64 * 1024;
+
+    /// <summary>
+    /// Character columns with at most this many distinct values in a row group
+    /// are dictionary encoded, 0 to never use a dictionary.
+    /// </summary>
+    size_t DictionaryLimit = 4096;
+
+    /// <summary>
+    /// Write character fields as utf8 strings, otherwise as plain byte arrays for code pages that are not utf-8.
+    /// </summary>
+    bool Utf8 = true;
+};
+
+/// <summary>
+/// Writes structs with the Thrift compact protocol, the encoding of the Parquet metadata.
+/// </summary>
+class DBaseThrift
+{
+    std::vector<int16_t> Ids;
+    int16_t Last = 0;
+
+public:
+    // types of the compact protocol
+    static constexpr uint8_t BOOL_TRUE = 1;
+    static constexpr uint8_t BOOL_FALSE = 2;
+    static constexpr uint8_t I32 = 5;
+    static constexpr uint8_t I64 = 6;
+    static constexpr uint8_t BINARY = 8;
+    static constexpr uint8_t LIST = 9;
+    static constexpr uint8_t STRUCT = 12;
+
+    std::string Out;
+
+    void Varint(uint64_t value) noexcept
+    {
+        for (; value >= 0x80; value >>= 7) Out.push_back((char)(value | 0x80));
+        Out.push_back((char)value);
+    }
+
+    void ZigZag(int64_t value) noexcept { Varint(((uint64_t)value << 1) ^ (uint64_t)(value >> 63)); }
+
+    void Field(int16_t id, uint8_t type) noexcept
+    {
+        // short form with the delta to the previous field id
+        if (id > Last && id - Last <= 15) Out.push_back((char)((id - Last) << 4 | type));
+        else
+        {
+            Out.push_back((char)type);
+            ZigZag(id);
+        }
+
+        Last = id;
+    }
+
+    void Int(int16_t id, int32_t value) noexcept { Field(id, I32); ZigZag(value); }
+    void Long(int16_t id, int64_t value) noexcept { Field(id, I64); ZigZag(value); }
+    void Bool(int16_t id, bool value) noexcept { Field(id, value ? BOOL_TRUE : BOOL_FALSE); }
+    void Binary(int16_t id, std::string_view value) noexcept { Field(id, BINARY); Value(value); }
+
+    void Value(int32_t value) noexcept { ZigZag(value); }
+
+    void Value(std::string_view value) noexcept
+    {
+        Varint(value.size());
+        Out.append(value);
+    }
+
+    /// <summary>
+    /// Start a struct, the top level one or the elements of a list.
+    /// </summary>
+    void Begin() noexcept
+    {
+        Ids.push_back(Last);
+        Last = 0;
+    }
+
+    void Begin(int16_t id) noexcept
+    {
+        Field(id, STRUCT);
+        Begin();
+    }
+
+    void End() noexcept
+    {
+        Out.push_back(0);
+        Last = Ids.back();
+        Ids.pop_back();
+    }
+
+    void List(int16_t id, uint8_t type, size_t size) noexcept
+    {
+        Field(id, LIST);
+
+        if (size < 15) Out.push_back((char)(size << 4 | type));
+        else
+        {
+            Out.push_back((char)(0xF0 | type));
+            Varint(size);
+        }
+    }
+};
+
+namespace DBaseParquet
+{
+    // values of the Parquet format, see https://github.com/apache/parquet-format
+    enum Type : int32_t { TYPE_BOOLEAN = 0, TYPE_INT32 = 1, TYPE_INT64 = 2, TYPE_DOUBLE = 5, TYPE_BYTE_ARRAY = 6 };
+    enum Encoding : int32_t { ENCODING_PLAIN = 0, ENCODING_RLE = 3, ENCODING_DELTA_BINARY_PACKED = 5, ENCODING_RLE_DICTIONARY = 8 };
+    enum PageType : int32_t { PAGE_DATA = 0, PAGE_DICTIONARY = 2 };
+
+    constexpr int32_t CONVERTED_UTF8 = 0;
+    constexpr int32_t CONVERTED_DATE = 6;
+    constexpr int32_t REPETITION_OPTIONAL = 1;
+
+    /// <summary>
+    /// Bit pack values LSB first, as used by the hybrid and the delta encodings.
+    /// </summary>
+    template<typename T>
+    inline void PackBits(std::string& out, const T* values, size_t count, int width) noexcept
+    {
+        uint64_t bits = 0;
+        int used = 0;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            // at most 32 bits at a time so the pending bits never overflow
+            const auto value = (uint64_t)values[i];
+
+            for (int shift = 0; shift < width; shift += 32)
+            {
+                const auto size = std::min(32, width - shift);
+                bits |= (value >> shift & ((1ull << size) - 1)) << used;
+                used += size;
+
+                for (; used >= 8; used -= 8, bits >>= 8) out.push_back((char)bits);
+            }
+        }
+
+        if (used) out.push_back((char)bits);
+    }
+
+    /// <summary>
+    /// RLE / bit packing hybrid: runs of at least 8 equal values become RLE runs,
+    /// everything else is bit packed in groups of 8.
+    /// </summary>
+    inline void EncodeHybrid(std::string& out, const std::vector<uint32_t>& values, int width) noexcept
+    {
+        DBaseThrift varint;
+        std::vector<uint32_t> packed;
+
+        const auto flush = [&]()
+        {
+            if (packed.empty()) return;
+
+            const auto groups = (packed.size() + 7) / 8;
+            packed.resize(groups * 8, 0);
+
+            varint.Out.clear();
+            varint.Varint(groups << 1 | 1);
+            out += varint.Out;
+
+            PackBits(out, packed.data(), packed.size(), width);
+            packed.clear();
+        };
+
+        for (size_t i = 0; i < values.size();)
+        {
+            size_t run = 1;
+            while (i + run < values.size() && values[i + run] == values[i]) ++run;
+
+            if (run >= 8)
+            {
+                flush();
+
+                varint.Out.clear();
+                varint.Varint((uint64_t)run << 1);
+                out += varint.Out;
+
+                for (int byte = 0; byte < (width + 7) / 8; ++byte) out.push_back((char)(values[i] >> (byte * 8)));
+                i += run;
+            }
+            else
+            {
+                // groups stay whole, only the last one is padded
+                const auto count = std::min<size_t>(8, values.size() - i);
+                packed.insert(packed.end(), values.begin() + i, values.begin() + i + count);
+                i += count;
+            }
+        }
+
+        flush();
+    }
+
+    /// <summary>
+    /// DELTA_BINARY_PACKED with blocks of 128 values in 4 miniblocks.
+    /// </summary>
+    template<typename T>
+    inline void EncodeDelta(std::string& out, const std::vector<T>& values) noexcept
+    {
+        constexpr size_t BLOCK = 128, MINIBLOCKS = 4, MINIBLOCK = BLOCK / MINIBLOCKS;
+
+        DBaseThrift header;
+        header.Varint(BLOCK);
+        header.Varint(MINIBLOCKS);
+        header.Varint(values.size());
+        header.ZigZag(values.empty() ? 0 : (int64_t)values[0]);
+        out += header.Out;
+
+        uint64_t deltas[BLOCK];
+
+        for (size_t block = 1; block < values.size(); block += BLOCK)
+        {
+            const auto count = std::min(BLOCK, values.size() - block);
+
+            // wrapping differences, as the readers add them back
+            int64_t minDelta = INT64_MAX;
+            for (size_t i = 0; i < count; ++i)
+            {
+                deltas[i] = (uint64_t)(int64_t)values[block + i] - (uint64_t)(int64_t)values[block + i - 1];
+                minDelta = std::min(minDelta, (int64_t)deltas[i]);
+            }
+
+            std::fill(deltas + count, deltas + BLOCK, (uint64_t)minDelta);
+
+            header.Out.clear();
+            header.ZigZag(minDelta);
+            out += header.Out;
+
+            int widths[MINIBLOCKS] = {};
+            for (size_t i = 0; i < BLOCK; ++i)
+            {
+                deltas[i] -= (uint64_t)minDelta;
+                if (i < count) widths[i / MINIBLOCK] = std::max(widths[i / MINIBLOCK], (int)std::bit_width(deltas[i]));
+            }
+
+            for (const auto width : widths) out.push_back((char)width);
+
+            // miniblocks without values are left out
+            for (size_t i = 0; i * MINIBLOCK < count; ++i) PackBits(out, deltas + i * MINIBLOCK, MINIBLOCK, widths[i]);
+        }
+    }
+
+    template<typename T>
+    inline std::string PlainBytes(T value) noexcept { return std::string(reinterpret_cast<const char*>(&value), sizeof(T)); }
+
+    inline std::string PlainBytes(std::string_view value) noexcept { return std::string(value); }
+
+    /// <summary>
+    /// Smallest and largest value of a page or a column chunk, NaNs are left out.
+    /// </summary>
+    template<typename T>
+    struct Range
+    {
+        T Min{}, Max{};
+        bool Any = false;
+
+        void Add(const T& value) noexcept
+        {
+            if (!(value == value)) return;
+
+            if (!Any || value < Min) Min = value;
+            if (!Any || Max < value) Max = value;
+            Any = true;
+        }
+
+        void Add(const Range& other) noexcept
+        {
+            if (other.Any)
+            {
+                Add(other.Min);
+                Add(other.Max);
+            }
+        }
+    };
+
+    /// <summary>
+    /// Encoded pages of a column in a row group and what its metadata needs.
+    /// Offsets are relative to the start of the chunk until it is written.
+    /// </summary>
+    struct Chunk
+    {
+        std::string Bytes;
+        std::vector<int32_t> Encodings;
+        int64_t Values = 0;
+        int64_t Nulls = 0;
+        int64_t Offset = 0;
+        int64_t Size = 0;
+        int64_t DataPage = 0;
+        int64_t DictionaryPage = -1;
+        bool HasRange = false;
+        std::string Min, Max;
+    };
+
+    inline void WriteStatistics(DBaseThrift& thrift, int16_t id, int64_t nulls, bool hasRange, const std::string& min, const std::string& max) noexcept
+    {
+        thrift.Begin(id);
+        thrift.Long(3, nulls);
+
+        if (hasRange)
+        {
+            thrift.Binary(5, max);
+            thrift.Binary(6, min);
+        }
+
+        thrift.End();
+    }
+
+    /// <summary>
+    /// Append a page header and the page to a chunk.
+    /// </summary>
+    template<typename T>
+    inline void AppendPage(Chunk& chunk, const std::string& page, size_t rows, size_t nulls, Encoding encoding, const Range<T>& range) noexcept
+    {
+        DBaseThrift thrift;
+        thrift.Begin();
+        thrift.Int(1, PAGE_DATA);
+        thrift.Int(2, (int32_t)page.size());
+        thrift.Int(3, (int32_t)page.size());
+        thrift.Begin(5);
+        thrift.Int(1, (int32_t)rows);
+        thrift.Int(2, encoding);
+        thrift.Int(3, ENCODING_RLE);
+        thrift.Int(4, ENCODING_RLE);
+        WriteStatistics(thrift, 5, (int64_t)nulls, range.Any, range.Any ? PlainBytes(range.Min) : std::string(), range.Any ? PlainBytes(range.Max) : std::string());
+        thrift.End();
+        thrift.End();
+
+        chunk.Bytes += thrift.Out;
+        chunk.Bytes += page;
+    }
+
+    /// <summary>
+    /// Encode the values of an array in data pages. Every page starts with the
+    /// definition levels (1 for a value, 0 for a null) and holds the values that are not null.
+    /// </summary>
+    /// <param name="get">Called as get(i), returns the value of row i.</param>
+    /// <param name="encode">Called as encode(page, values), appends the encoded values.</param>
+    template<typename T, typename Get, typename Encode>
+    inline void EncodePages(Chunk& chunk, const ArrowArray& array, size_t pageRows, Encoding encoding, Get&& get, Encode&& encode) noexcept
+    {
+        const auto rows = (size_t)array.length;
+        const auto validity = static_cast<const uint8_t*>(array.buffers[0]);
+
+        Range<T> total;
+        std::vector<T> values;
+        std::vector<uint32_t> levels;
+
+        chunk.DataPage = (int64_t)chunk.Bytes.size();
+        chunk.Values = (int64_t)rows;
+        chunk.Nulls = array.null_count;
+
+        for (size_t begin = 0; begin < rows; begin += pageRows)
+        {
+            const auto end = std::min(rows, begin + pageRows);
+
+            Range<T> range;
+            values.clear();
+            levels.assign(end - begin, 1);
+
+            for (auto i = begin; i < end; ++i)
+            {
+                if (validity && !(validity[i / 8] >> (i % 8) & 1))
+                {
+                    levels[i - begin] = 0;
+                    continue;
+                }
+
+                values.push_back(get(i));
+                range.Add(values.back());
+            }
+
+            std::string page(4, '\0');
+            EncodeHybrid(page, levels, 1);
+
+            const auto length = (uint32_t)(page.size() - 4);
+            memcpy(page.data(), &length, 4);
+
+            encode(page, values);
+            AppendPage(chunk, page, end - begin, (end - begin) - values.size(), encoding, range);
+            total.Add(range);
+        }
+
+        chunk.HasRange = total.Any;
+        if (total.Any)
+        {
+            chunk.Min = PlainBytes(total.Min);
+            chunk.Max = PlainBytes(total.Max);
+        }
+    }
+
+    /// <summary>
+    /// Returns the physical type of an Arrow format of the C data export.
+    /// </summary>
+    inline Type PhysicalType(const std::string& format) noexcept
+    {
+        if (format == "l") return TYPE_INT64;
+        if (format == "tdD") return TYPE_INT32;
+        if (format == "g") return TYPE_DOUBLE;
+        if (format == "b") return TYPE_BOOLEAN;
+        return TYPE_BYTE_ARRAY;
+    }
+
+    /// <summary>
+    /// Encode the character values of an array, with a dictionary if they have few distinct values.
+    /// </summary>
+    template<typename Offset>
+    inline void EncodeText(Chunk& chunk, const ArrowArray& array, const DBaseParquetOptions& options) noexcept
+    {
+        const auto offsets = static_cast<const Offset*>(array.buffers[1]);
+        const auto text = static_cast<const char*>(array.buffers[2]);
+        const auto validity = static_cast<const uint8_t*>(array.buffers[0]);
+        const auto rows = (size_t)array.length;
+
+        const auto get = [&](size_t i) { return std::string_view(text + offsets[i], (size_t)(offsets[i + 1] - offsets[i])); };
+
+        // collect the distinct values until there are too many
+        std::unordered_map<std::string_view, uint32_t> dictionary;
+        std::vector<std::string_view> entries;
+        const auto present = rows - (size_t)array.null_count;
+
+        for (size_t i = 0; i < rows && options.DictionaryLimit; ++i)
+        {
+            if (validity && !(validity[i / 8] >> (i % 8) & 1)) continue;
+
+            const auto value = get(i);
+            if (dictionary.emplace(value, (uint32_t)entries.size()).second) entries.push_back(value);
+            if (entries.size() > options.DictionaryLimit) break;
+        }
+
+        // a dictionary only pays off if values repeat
+        if (entries.empty() || entries.size() > options.DictionaryLimit || entries.size() * 2 > present)
+        {
+            chunk.Encodings = { ENCODING_RLE, ENCODING_PLAIN };
+            EncodePages<std::string_view>(chunk, array, options.PageRows, ENCODING_PLAIN, get, [](std::string& page, const std::vector<std::string_view>& values)
+            {
+                for (const auto value : values)
+                {
+                    const auto length = (uint32_t)value.size();
+                    page.append(reinterpret_cast<const char*>(&length), 4);
+                    page.append(value);
+                }
+            });
+            return;
+        }
+
+        std::string values;
+        for (const auto value : entries)
+        {
+            const auto length = (uint32_t)value.size();
+            values.append(reinterpret_cast<const char*>(&length), 4);
+            values.append(value);
+        }
+
+        DBaseThrift thrift;
+        thrift.Begin();
+        thrift.Int(1, PAGE_DICTIONARY);
+        thrift.Int(2, (int32_t)values.size());
+        thrift.Int(3, (int32_t)values.size());
+        thrift.Begin(7);
+        thrift.Int(1, (int32_t)entries.size());
+        thrift.Int(2, ENCODING_PLAIN);
+        thrift.End();
+        thrift.End();
+
+        chunk.DictionaryPage = 0;
+        chunk.Bytes = thrift.Out + values;
+        chunk.Encodings = { ENCODING_RLE, ENCODING_PLAIN, ENCODING_RLE_DICTIONARY };
+
+        const auto width = std::max(1, (int)std::bit_width(entries.size() - 1));
+        std::vector<uint32_t> indices;
+
+        EncodePages<std::string_view>(chunk, array, options.PageRows, ENCODING_RLE_DICTIONARY, get, [&](std::string& page, const std::vector<std::string_view>& values)
+        {
+            indices.clear();
+            for (const auto value : values) indices.push_back(dictionary.find(value)->second);
+
+            page.push_back((char)width);
+            EncodeHybrid(page, indices, width);
+        });
+    }
+
+    /// <summary>
+    /// Encode an exported array as a column chunk: integers and dates delta
+    /// encoded, doubles and booleans plain, character values plain or with a dictionary.
+    /// </summary>
+    inline Chunk EncodeColumn(const ArrowArray& array, const std::string& format, const DBaseParquetOptions& options) noexcept
+    {
+        Chunk chunk;
+
+        switch (PhysicalType(format))
+        {
+        case TYPE_INT64:
+        {
+            const auto data = static_cast<const int64_t*>(array.buffers[1]);
+            chunk.Encodings = { ENCODING_RLE, ENCODING_DELTA_BINARY_PACKED };
+            EncodePages<int64_t>(chunk, array, options.PageRows, ENCODING_DELTA_BINARY_PACKED, [&](size_t i) { return data[i]; }, EncodeDelta<int64_t>);
+            break;
+        }
+
+        case TYPE_INT32:
+        {
+            const auto data = static_cast<const int32_t*>(array.buffers[1]);
+            chunk.Encodings = { ENCODING_RLE, ENCODING_DELTA_BINARY_PACKED };
+            EncodePages<int32_t>(chunk, array, options.PageRows, ENCODING_DELTA_BINARY_PACKED, [&](size_t i) { return data[i]; }, EncodeDelta<int32_t>);
+            break;
+        }
+
+        case TYPE_DOUBLE:
+        {
+            const auto data = static_cast<const double*>(array.buffers[1]);
+            chunk.Encodings = { ENCODING_RLE, ENCODING_PLAIN };
+            EncodePages<double>(chunk, array, options.PageRows, ENCODING_PLAIN, [&](size_t i) { return data[i]; }, [](std::string& page, const std::vector<double>& values)
+            {
+                page.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+            });
+            break;
+        }
+
+        case TYPE_BOOLEAN:
+        {
+            const auto data = static_cast<const uint8_t*>(array.buffers[1]);
+            chunk.Encodings = { ENCODING_RLE, ENCODING_PLAIN };
+            EncodePages<uint8_t>(chunk, array, options.PageRows, ENCODING_PLAIN, [&](size_t i) { return (uint8_t)(data[i / 8] >> (i % 8) & 1); }, [](std::string& page, const std::vector<uint8_t>& values)
+            {
+                PackBits(page, values.data(), values.size(), 1);
+            });
+            break;
+        }
+
+        default:
+            if (format == "U" || format == "Z") EncodeText<int64_t>(chunk, array, options);
+            else EncodeText<int32_t>(chunk, array, options);
+            break;
+        }
+
+        chunk.Size = (int64_t)chunk.Bytes.size();
+        return chunk;
+    }
+
+    /// <summary>
+    /// Writes a Parquet file: the magic, the column chunks of every row group
+    /// and the file metadata with the schema and the position of every chunk.
+    /// </summary>
+    class Writer
+    {
+        DBaseFile::Native Handle = DBaseFile::INVALID;
+        uint64_t Offset = 0;
+        int64_t Rows = 0;
+
+        // metadata of the chunks of every row group and its number of rows
+        std::vector<std::pair<std::vector<Chunk>, int64_t>> Groups;
+
+    public:
+        ~Writer()
+        {
+            if (Handle != DBaseFile::INVALID) DBaseFile::Close(Handle);
+        }
+
+        bool Open(const std::filesystem::path& file) noexcept
+        {
+            Handle = DBaseFile::Open(file, false);
+            if (Handle == DBaseFile::INVALID) return false;
+
+            Offset = 4;
+            return DBaseFile::WriteAt(Handle, 0, "PAR1", 4);
+        }
+
+        /// <summary>
+        /// Write the chunks of a row group one after another, only their metadata is kept.
+        /// </summary>
+        bool Write(std::vector<Chunk> chunks, size_t rows) noexcept
+        {
+            for (auto& chunk : chunks)
+            {
+                if (!DBaseFile::WriteAt(Handle, Offset, chunk.Bytes.data(), chunk.Bytes.size())) return false;
+
+                chunk.Offset = (int64_t)Offset;
+                Offset += chunk.Bytes.size();
+                std::string().swap(chunk.Bytes);
+            }
+
+            Rows += (int64_t)rows;
+            Groups.emplace_back(std::move(chunks), (int64_t)rows);
+            return true;
+        }
+
+        /// <summary>
+        /// Write the file metadata and close the file.
+        /// </summary>
+        bool Close(const std::vector<std::string>& names, const std::vector<std::string>& formats) noexcept
+        {
+            DBaseThrift thrift;
+            thrift.Begin();
+            thrift.Int(1, 1);
+
+            thrift.List(2, DBaseThrift::STRUCT, names.size() + 1);
+            thrift.Begin();
+            thrift.Binary(4, "schema");
+            thrift.Int(5, (int32_t)names.size());
+            thrift.End();
+
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                const auto type = PhysicalType(formats[i]);
+
+                thrift.Begin();
+                thrift.Int(1, type);
+                thrift.Int(3, REPETITION_OPTIONAL);
+                thrift.Binary(4, names[i]);
+
+                // converted types for older readers, logical types for newer ones
+                if (type == TYPE_INT32 || formats[i] == "u" || formats[i] == "U")
+                {
+                    thrift.Int(6, type == TYPE_INT32 ? CONVERTED_DATE : CONVERTED_UTF8);
+                    thrift.Begin(10);
+                    thrift.Begin(type == TYPE_INT32 ? 6 : 1);
+                    thrift.End();
+                    thrift.End();
+                }
+
+                thrift.End();
+            }
+
+            thrift.Long(3, Rows);
+            thrift.List(4, DBaseThrift::STRUCT, Groups.size());
+
+            for (size_t group = 0; group < Groups.size(); ++group)
+            {
+                const auto& [chunks, rows] = Groups[group];
+                int64_t size = 0;
+
+                thrift.Begin();
+                thrift.List(1, DBaseThrift::STRUCT, chunks.size());
+
+                for (size_t i = 0; i < chunks.size(); ++i)
+                {
+                    const auto& chunk = chunks[i];
+                    size += chunk.Size;
+
+                    thrift.Begin();
+                    thrift.Long(2, chunk.Offset);
+                    thrift.Begin(3);
+                    thrift.Int(1, PhysicalType(formats[i]));
+                    thrift.List(2, DBaseThrift::I32, chunk.Encodings.size());
+                    for (const auto encoding : chunk.Encodings) thrift.Value(encoding);
+                    thrift.List(3, DBaseThrift::BINARY, 1);
+                    thrift.Value(names[i]);
+                    thrift.Int(4, 0);
+                    thrift.Long(5, chunk.Values);
+                    thrift.Long(6, chunk.Size);
+                    thrift.Long(7, chunk.Size);
+                    thrift.Long(9, chunk.Offset + chunk.DataPage);
+                    if (chunk.DictionaryPage >= 0) thrift.Long(11, chunk.Offset + chunk.DictionaryPage);
+                    WriteStatistics(thrift, 12, chunk.Nulls, chunk.HasRange, chunk.Min, chunk.Max);
+                    thrift.End();
+                    thrift.End();
+                }
+
+                thrift.Long(2, size);
+                thrift.Long(3, rows);
+                if (!chunks.empty()) thrift.Long(5, chunks.front().Offset);
+                thrift.Long(6, size);
+                thrift.Field(7, 4);
+                thrift.ZigZag((int64_t)group);
+                thrift.End();
+            }
+
+            thrift.Binary(6, "dbaselib");
+
+            // min and max values are ordered by the type, strings as unsigned bytes
+            thrift.List(7, DBaseThrift::STRUCT, names.size());
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                thrift.Begin();
+                thrift.Begin(1);
+                thrift.End();
+                thrift.End();
+            }
+
+            thrift.End();
+
+            const auto length = (uint32_t)thrift.Out.size();
+            thrift.Out.append(reinterpret_cast<const char*>(&length), 4);
+            thrift.Out.append("PAR1");
+
+            const auto ok = DBaseFile::WriteAt(Handle, Offset, thrift.Out.data(), thrift.Out.size());
+            Offset += thrift.Out.size();
+
+            DBaseFile::Close(Handle);
+            Handle = DBaseFile::INVALID;
+            return ok;
+        }
+
+        uint64_t Written() const noexcept { return Offset; }
+    };
+
+    /// <summary>
+    /// Decode and encode the columns of a range of records in parallel, one column per block.
+    /// </summary>
+    /// <param name="formats">Arrow formats of the columns, filled if empty.</param>
+    inline std::vector<Chunk> EncodeRowGroup(const DBase* dbase, const std::vector<const DBaseHandle*>& handles, size_t first, size_t rows, const DBaseParquetOptions& options, std::vector<std::string>& formats) noexcept
+    {
+        DBaseArrowOptions arrowOptions;
+        arrowOptions.Utf8 = options.Utf8;
+
+        std::vector<Chunk> chunks(handles.size());
+        std::vector<std::string> columnFormats(handles.size());
+
+        DBaseParallel::For(handles.size(), [&](size_t begin, size_t end, size_t)
+        {
+            for (auto i = begin; i < end; ++i)
+            {
+                ArrowSchema schema;
+                ArrowArray array;
+                DBaseArrow::ExportField(dbase, handles[i], first, rows, arrowOptions, &schema, &array);
+
+                columnFormats[i] = schema.format;
+                chunks[i] = EncodeColumn(array, columnFormats[i], options);
+
+                schema.release(&schema);
+                array.release(&array);
+            }
+        }, 1);
+
+        if (formats.empty()) formats = std::move(columnFormats);
+
+        dbase->Counters.Scanned(rows);
+        dbase->Counters.Parsed((uint64_t)rows * handles.size());
+        dbase->Counters.Formatted((uint64_t)rows * handles.size());
+        return chunks;
+    }
+
+    /// <summary>
+    /// Returns the handles of the fields, all fields if none are given.
+    /// </summary>
+    inline bool Handles(const DBase* dbase, const std::vector<std::string>& fields, std::vector<const DBaseHandle*>& handles, std::vector<std::string>& names) noexcept
+    {
+        names = fields.empty() ? dbase->Fields() : fields;
+        handles.clear();
+
+        for (const auto& name : names)
+        {
+            const auto handle = DBaseUtils::Find(dbase, name);
+            if (!handle) return false;
+
+            handles.push_back(handle);
+        }
+
+        return true;
+    }
+
+    inline DBaseParquetOptions Normalize(DBaseParquetOptions options) noexcept
+    {
+        options.RowGroupRows = std::max<size_t>(options.RowGroupRows, 1);
+        options.PageRows = std::max<size_t>((options.PageRows + 7) / 8 * 8, 8);
+        return options;
+    }
+
+    /// <summary>
+    /// Write fields of a loaded DBASE as a Parquet file, with the types of the
+    /// Arrow export. Every field is an optional column, blank and invalid values are nulls.
+    /// </summary>
+    /// <param name="fields">Fields to write in this order, empty for all fields.</param>
+    /// <returns>True if written, false if a field does not exist or the file could not be written.</returns>
+    static bool Write(const DBase* dbase, const std::filesystem::path& file, const std::vector<std::string>& fields, const DBaseParquetOptions& parquetOptions = {}) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Columnar);
+
+        const auto options = Normalize(parquetOptions);
+
+        std::vector<const DBaseHandle*> handles;
+        std::vector<std::string> names, formats;
+        if (!Handles(dbase, fields, handles, names)) return false;
+
+        Writer writer;
+        if (!writer.Open(file)) return false;
+
+        const auto rows = dbase->RecordCount();
+        auto ok = true;
+
+        // the formats of an empty table come from an empty range
+        if (rows == 0) EncodeRowGroup(dbase, handles, 0, 0, options, formats);
+
+        for (size_t first = 0; ok && first < rows; first += options.RowGroupRows)
+        {
+            const auto count = std::min(options.RowGroupRows, rows - first);
+            ok = writer.Write(EncodeRowGroup(dbase, handles, first, count, options, formats), count);
+        }
+
+        ok = ok && writer.Close(names, formats);
+        if (ok) dbase->Counters.Written(writer.Written());
+        return ok;
+    }
+
+    /// <summary>
+    /// Convert a DBASE file that may be larger than memory to a Parquet file.
+    /// Every chunk of RowGroupRows records becomes a row group of its live records.
+    /// </summary>
+    /// <param name="fields">Fields to write in this order, empty for all fields.</param>
+    /// <returns>Number of records written or -1 on an error.</returns>
+    static int64_t Convert(const std::filesystem::path& dbf, const std::filesystem::path& file, const std::vector<std::string>& fields, const DBaseParquetOptions& parquetOptions = {}) noexcept
+    {
+        const auto options = Normalize(parquetOptions);
+
+        DBaseReader reader;
+        if (!reader.Open(dbf)) return -1;
+
+        Writer writer;
+        if (!writer.Open(file)) return -1;
+
+        std::vector<const DBaseHandle*> handles;
+        std::vector<std::string> names, formats;
+        int64_t records = 0;
+
+        while (std::unique_ptr<DBase> chunk{ reader.Next(options.RowGroupRows) })
+        {
+            if (!Handles(chunk.get(), fields, handles, names)) return -1;
+
+            const auto rows = chunk->RecordCount();
+            auto chunks = EncodeRowGroup(chunk.get(), handles, 0, rows, options, formats);
+
+            if (rows && !writer.Write(std::move(chunks), rows)) return -1;
+            records += (int64_t)rows;
+        }
+
+        if (reader.Failed()) return -1;
+
+        // an empty file has no chunk, the header alone has the fields
+        if (formats.empty())
+        {
+            std::unique_ptr<DBase> header(DBaseUtils::FromFile(dbf));
+            if (!header || !header->Load() || !Handles(header.get(), fields, handles, names)) return -1;
+
+            EncodeRowGroup(header.get(), handles, 0, 0, options, formats);
+        }
+
+        return writer.Close(names, formats) ? records : -1;
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <string_view>
+
+#include "dBase.hpp"
+#include "dBaseHash.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseSketch.hpp"
+#include "dBaseParallel.hpp"
+
+/// <summary>
+/// Approximate profile of a column.
+/// </summary>
+struct DBaseColumnProfile
+{
+    std::string Name;
+
+    /// <summary>
+    /// Estimated number of distinct raw values, blank values count as a value.
+    /// </summary>
+    double Distinct = 0.0;
+
+    /// <summary>
+    /// Most frequent raw values, highest estimated count first.
+    /// </summary>
+    std::vector<DBaseTopK::Entry> Top;
+};
+
+namespace DBaseProfile
+{
+    /// <summary>
+    /// Profile columns using sketches of constant size per column. Every thread
+    /// hashes the raw field bytes into its own sketches, they are merged at the end.
+    /// </summary>
+    /// <param name="dbase">Loaded DBASE.</param>
+    /// <param name="columns">Columns to profile, columns that do not exist are skipped.</param>
+    /// <param name="k">Number of most frequent values to keep per column.</param>
+    static std::vector<DBaseColumnProfile> Profile(const DBase* dbase, const std::vector<std::string>& columns, size_t k = 10) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Profile);
+        dbase->Counters.Scanned(dbase->RecordCount());
+
+        std::vector<const DBaseHandle*> handles;
+        std::vector<DBaseColumnProfile> profiles;
+
+        for (const auto& column : columns)
+        {
+            if (const auto handle = DBaseUtils::Find(dbase, column))
+            {
+                handles.push_back(handle);
+                profiles.push_back({ column, 0.0, {} });
+            }
+        }
+
+        struct Sketches
+        {
+            std::vector<DBaseHyperLogLog> Distinct;
+            std::vector<DBaseTopK> Top;
+        };
+
+        const auto columnCount = handles.size();
+        std::vector<Sketches> slots(DBaseParallel::Concurrency(), { std::vector<DBaseHyperLogLog>(columnCount), std::vector<DBaseTopK>(columnCount, DBaseTopK(k)) });
+
+        DBaseParallel::For(dbase->RecordCount(), [&](size_t begin, size_t end, size_t slot)
+        {
+            auto& sketches = slots[slot];
+
+            for (size_t i = begin; i < end; ++i)
+            {
+                const auto record = dbase->Records[i];
+
+                for (size_t c = 0; c < columnCount; ++c)
+                {
+                    const auto value = std::string_view(record + handles[c]->Offset(), handles[c]->Size());
+                    const auto hash = DBaseHash::Hash(value.data(), value.size());
+
+                    sketches.Distinct[c].Add(hash);
+                    sketches.Top[c].Add(value, hash);
+                }
+            }
+        });
+
+        for (size_t c = 0; c < columnCount; ++c)
+        {
+            for (size_t slot = 1; slot < slots.size(); ++slot)
+            {
+                slots[0].Distinct[c].Merge(slots[slot].Distinct[c]);
+                slots[0].Top[c].Merge(slots[slot].Top[c]);
+            }
+
+            profiles[c].Distinct = dbase->RecordCount() ? slots[0].Distinct[c].Estimate() : 0.0;
+            profiles[c].Top = slots[0].Top[c].Top();
+        }
+
+        return profiles;
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#include "dBase.hpp"
+#include "dBase3.hpp"
+#include "dBaseUtils.hpp"
+
+/// <summary>
+/// Reads a DBASE file that may be larger than memory in chunks of records.
+/// Every chunk is a loaded DBASE of its own that starts with the header of the
+/// file, so everything that works on a DBASE works on a chunk.
+/// </summary>
+class DBaseReader
+{
+    std::ifstream Stream;
+    std::vector<char> Header;
+    std::unique_ptr<DBase> Schema;
+    size_t RowSize = 0;
+    uint64_t Total = 0;
+    uint64_t Remaining = 0;
+    bool Error = false;
+
+public:
+    /// <summary>
+    /// Open a file and read its header.
+    /// </summary>
+    /// <returns>True if the file is a DBASE that can be loaded, false if not.</returns>
+    bool Open(const std::filesystem::path& file) noexcept
+    {
+        std::error_code error;
+        const auto fileSize = (uint64_t)std::filesystem::file_size(file, error);
+        if (error) return false;
+
+        Stream.open(file, std::ifstream::in | std::ifstream::binary);
+
+        DBase3Header fileHeader;
+        if (!Stream.read(reinterpret_cast<char*>(&fileHeader), sizeof(DBase3Header))) return false;
+
+        const size_t headerSize = std::max<size_t>(fileHeader.HeaderBytes, sizeof(DBase3Header));
+        if (headerSize > fileSize) return false;
+
+        Header.resize(headerSize);
+        memcpy(Header.data(), &fileHeader, sizeof(DBase3Header));
+        if (!Stream.read(Header.data() + sizeof(DBase3Header), headerSize - sizeof(DBase3Header))) return false;
+
+        // load the header alone to learn the record size
+        const auto data = new char[headerSize];
+        memcpy(data, Header.data(), headerSize);
+
+        Schema.reset(DBaseUtils::FromBuffer(data, headerSize));
+        if (!Schema) delete[] data;
+        if (!Schema || !Schema->Load()) return false;
+
+        RowSize = Schema->RecordSize();
+        Total = Remaining = (fileSize - headerSize) / RowSize;
+        return true;
+    }
+
+    /// <summary>
+    /// The header alone as a DBASE without records, for its fields.
+    /// </summary>
+    const DBase* Fields() const noexcept { return Schema.get(); }
+
+    /// <summary>
+    /// Size of the header including the field descriptors.
+    /// </summary>
+    size_t HeaderSize() const noexcept { return Header.size(); }
+
+    /// <summary>
+    /// Size of a record including its deleted flag.
+    /// </summary>
+    size_t RecordSize() const noexcept { return RowSize; }
+
+    /// <summary>
+    /// Number of records in the file, deleted ones included.
+    /// </summary>
+    uint64_t Records() const noexcept { return Total; }
+
+    /// <summary>
+    /// True if a chunk could not be read or loaded.
+    /// </summary>
+    bool Failed() const noexcept { return Error; }
+
+    /// <summary>
+    /// Read the next chunk of records. Deleted records count towards the chunk
+    /// but are not among its live records.
+    /// </summary>
+    /// <param name="records">Maximum number of records to read.</param>
+    /// <returns>The loaded chunk owned by the caller, or nullptr at the end of the file or on an error.</returns>
+    DBase* Next(size_t records) noexcept
+    {
+        const auto count = (size_t)std::min<uint64_t>(std::max<size_t>(records, 1), Remaining);
+        if (count == 0) return nullptr;
+
+        // header, records and the eof marker
+        const auto size = Header.size() + count * RowSize + 1;
+        const auto data = new char[size];
+
+        memcpy(data, Header.data(), Header.size());
+        data[size - 1] = 0x1A;
+
+        if (!Stream.read(data + Header.size(), count * RowSize))
+        {
+            delete[] data;
+            Remaining = 0;
+            Error = true;
+            return nullptr;
+        }
+
+        Remaining -= count;
+
+        const auto chunk = DBaseUtils::FromBuffer(data, size);
+        if (!chunk) delete[] data;
+
+        if (!chunk || !chunk->Load())
+        {
+            delete chunk;
+            Remaining = 0;
+            Error = true;
+            return nullptr;
+        }
+
+        chunk->Counters.Read(count * RowSize);
+        return chunk;
+    }
+};
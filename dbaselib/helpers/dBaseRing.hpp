@@ -0,0 +1,551 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+
+#include "dBase.hpp"
+#include "dBaseFile.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseParallel.hpp"
+
+// io_uring is used when the kernel headers are there, define DBASELIB_IO_URING=0 to leave it out
+#if !defined(DBASELIB_IO_URING) && defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define DBASELIB_IO_URING 1
+#endif
+#endif
+
+#ifndef DBASELIB_IO_URING
+#define DBASELIB_IO_URING 0
+#endif
+
+#if DBASELIB_IO_URING
+#include <atomic>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+/// <summary>
+/// Settings of the batched file I/O.
+/// </summary>
+struct DBaseRingOptions
+{
+    /// <summary>
+    /// Size of the submission queue, also the most requests in flight.
+    /// </summary>
+    unsigned Entries = 256;
+
+    /// <summary>
+    /// Bytes per request, larger files are split so the device works on them in parallel.
+    /// </summary>
+    size_t ChunkSize = 1024 * 1024;
+
+    /// <summary>
+    /// Register the file buffers with the kernel once per batch so single
+    /// requests do not have to map and pin their pages.
+    /// </summary>
+    bool FixedBuffers = true;
+
+    /// <summary>
+    /// Let a kernel thread poll the submission queue, requests are then
+    /// submitted without any syscall. Falls back if not permitted.
+    /// </summary>
+    bool SqPoll = false;
+
+    /// <summary>
+    /// Completion queue checks in user space before sleeping in the kernel.
+    /// </summary>
+    unsigned SpinCount = 256;
+
+    /// <summary>
+    /// Use io_uring if the kernel supports it, false always uses pread/pwrite.
+    /// </summary>
+    bool Ring = true;
+};
+
+#if DBASELIB_IO_URING
+
+/// <summary>
+/// Minimal io_uring on top of the raw syscalls: one submission and one completion
+/// queue shared with the kernel, requests are queued in user space and handed
+/// over in batches, completions are polled from user space.
+/// </summary>
+class DBaseRing
+{
+    int Fd;
+    bool Polling;
+
+    void* SqRing;
+    size_t SqRingSize;
+    void* CqRing;
+    size_t CqRingSize;
+    io_uring_sqe* Sqes;
+    size_t SqesSize;
+
+    unsigned* SqHead;
+    unsigned* SqTail;
+    unsigned* SqFlags;
+    unsigned* SqArray;
+    unsigned SqMask;
+    unsigned SqEntries;
+    unsigned LocalTail;
+
+    unsigned* CqHead;
+    unsigned* CqTail;
+    io_uring_cqe* Cqes;
+    unsigned CqMask;
+
+public:
+    DBaseRing()
+        : Fd(-1), Polling(false),
+        SqRing(nullptr), SqRingSize(0), CqRing(nullptr), CqRingSize(0), Sqes(nullptr), SqesSize(0),
+        SqHead(nullptr), SqTail(nullptr), SqFlags(nullptr), SqArray(nullptr), SqMask(0), SqEntries(0), LocalTail(0),
+        CqHead(nullptr), CqTail(nullptr), Cqes(nullptr), CqMask(0)
+    {}
+
+    DBaseRing(const DBaseRing&) = delete;
+    DBaseRing& operator=(const DBaseRing&) = delete;
+
+    ~DBaseRing()
+    {
+        if (Sqes) munmap(Sqes, SqesSize);
+        if (CqRing && CqRing != SqRing) munmap(CqRing, CqRingSize);
+        if (SqRing) munmap(SqRing, SqRingSize);
+        if (Fd >= 0) ::close(Fd);
+    }
+
+    /// <summary>
+    /// Create the ring.
+    /// </summary>
+    /// <returns>True if the kernel supports io_uring, false if not.</returns>
+    bool Init(const DBaseRingOptions& options) noexcept
+    {
+        io_uring_params params{};
+
+        if (options.SqPoll)
+        {
+            params.flags = IORING_SETUP_SQPOLL;
+            params.sq_thread_idle = 50;
+            Fd = (int)syscall(__NR_io_uring_setup, options.Entries, &params);
+        }
+
+        if (Fd < 0)
+        {
+            params = {};
+            Fd = (int)syscall(__NR_io_uring_setup, options.Entries, &params);
+        }
+
+        if (Fd < 0) return false;
+
+        Polling = params.flags & IORING_SETUP_SQPOLL;
+        SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        SqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+        // newer kernels map both rings with a single mmap
+        const auto single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) SqRingSize = CqRingSize = std::max(SqRingSize, CqRingSize);
+
+        SqRing = Map(SqRingSize, IORING_OFF_SQ_RING);
+        CqRing = single ? SqRing : Map(CqRingSize, IORING_OFF_CQ_RING);
+        Sqes = static_cast<io_uring_sqe*>(Map(SqesSize, IORING_OFF_SQES));
+        if (!SqRing || !CqRing || !Sqes) return false;
+
+        const auto sq = static_cast<char*>(SqRing);
+        SqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        SqFlags = reinterpret_cast<unsigned*>(sq + params.sq_off.flags);
+        SqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        SqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        SqEntries = params.sq_entries;
+        LocalTail = *SqTail;
+
+        const auto cq = static_cast<char*>(CqRing);
+        CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        CqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+
+        return true;
+    }
+
+    constexpr unsigned Capacity() const noexcept { return SqEntries; }
+
+    /// <summary>
+    /// Register buffers, requests then refer to them by index.
+    /// </summary>
+    bool RegisterBuffers(const iovec* buffers, unsigned count) noexcept
+    {
+        return syscall(__NR_io_uring_register, Fd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+    }
+
+    void UnregisterBuffers() noexcept
+    {
+        syscall(__NR_io_uring_register, Fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    }
+
+    /// <summary>
+    /// Queue a read or write, it is not handed to the kernel until Submit.
+    /// </summary>
+    /// <param name="bufferIndex">Index of the registered buffer that holds data, -1 if none.</param>
+    /// <returns>True if queued, false if the submission queue is full.</returns>
+    bool Queue(bool write, int fd, void* data, unsigned size, uint64_t offset, uint64_t userData, int bufferIndex = -1) noexcept
+    {
+        const auto head = std::atomic_ref<unsigned>(*SqHead).load(std::memory_order_acquire);
+        if (LocalTail - head >= SqEntries) return false;
+
+        const auto index = LocalTail & SqMask;
+        auto sqe = &Sqes[index];
+        memset(sqe, 0, sizeof(io_uring_sqe));
+
+        if (bufferIndex >= 0)
+        {
+            sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe->buf_index = (uint16_t)bufferIndex;
+        }
+        else
+        {
+            sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+        }
+
+        sqe->fd = fd;
+        sqe->addr = reinterpret_cast<uint64_t>(data);
+        sqe->len = size;
+        sqe->off = offset;
+        sqe->user_data = userData;
+
+        SqArray[index] = index;
+        ++LocalTail;
+        return true;
+    }
+
+    /// <summary>
+    /// Hand all queued requests to the kernel.
+    /// </summary>
+    /// <param name="waitFor">Completions to wait for, 0 to return right away.</param>
+    /// <returns>False if the kernel rejected the call.</returns>
+    bool Submit(unsigned waitFor = 0) noexcept
+    {
+        std::atomic_ref<unsigned>(*SqTail).store(LocalTail, std::memory_order_release);
+
+        auto flags = waitFor ? IORING_ENTER_GETEVENTS : 0u;
+        unsigned count = 0;
+
+        if (Polling)
+        {
+            // the poll thread goes to sleep when idle and has to be woken up
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (std::atomic_ref<unsigned>(*SqFlags).load(std::memory_order_relaxed) & IORING_SQ_NEED_WAKEUP) flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        else
+        {
+            count = LocalTail - std::atomic_ref<unsigned>(*SqHead).load(std::memory_order_acquire);
+        }
+
+        if (!count && !flags) return true;
+
+        long result;
+        do result = syscall(__NR_io_uring_enter, Fd, count, waitFor, flags, nullptr, 0); while (result < 0 && errno == EINTR);
+
+        return result >= 0 || errno == EAGAIN || errno == EBUSY;
+    }
+
+    /// <summary>
+    /// Pass every available completion to fn(userData, result) without a syscall.
+    /// </summary>
+    /// <returns>Number of completions.</returns>
+    template<typename Fn>
+    unsigned Reap(Fn&& fn) noexcept
+    {
+        auto head = *CqHead;
+        const auto tail = std::atomic_ref<unsigned>(*CqTail).load(std::memory_order_acquire);
+        unsigned count = 0;
+
+        for (; head != tail; ++head, ++count)
+        {
+            const auto& cqe = Cqes[head & CqMask];
+            fn(cqe.user_data, cqe.res);
+        }
+
+        std::atomic_ref<unsigned>(*CqHead).store(head, std::memory_order_release);
+        return count;
+    }
+
+    /// <summary>
+    /// Reap at least one completion, polls the queue spinCount times before sleeping in the kernel.
+    /// </summary>
+    template<typename Fn>
+    unsigned Wait(Fn&& fn, unsigned spinCount) noexcept
+    {
+        for (unsigned i = 0; i < spinCount; ++i)
+        {
+            if (const auto count = Reap(fn)) return count;
+        }
+
+        if (!Submit(1)) return 0;
+        return Reap(fn);
+    }
+
+private:
+    void* Map(size_t size, uint64_t offset) noexcept
+    {
+        const auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, Fd, (off_t)offset);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+};
+
+#endif
+
+/// <summary>
+/// A file that is read into or written from a single buffer.
+/// </summary>
+struct DBaseRingTransfer
+{
+    DBaseFile::Native Handle;
+    char* Data;
+    size_t Size;
+    bool Failed;
+    size_t Pending;
+    std::chrono::steady_clock::time_point Done;
+};
+
+namespace DBaseRingIO
+{
+    /// <summary>
+    /// Returns true if io_uring can be used on this system.
+    /// </summary>
+    inline bool Supported() noexcept
+    {
+#if DBASELIB_IO_URING
+        static const bool supported = DBaseRing().Init({});
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    /// <summary>
+    /// Fallback for systems without io_uring, one pread/pwrite per file from the pool threads.
+    /// </summary>
+    static void TransferSync(std::vector<DBaseRingTransfer>& transfers, bool write) noexcept
+    {
+        DBaseParallel::For(transfers.size(), [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                auto& transfer = transfers[i];
+                const auto done = write ? DBaseFile::WriteAt(transfer.Handle, 0, transfer.Data, transfer.Size) : DBaseFile::ReadAt(transfer.Handle, 0, transfer.Data, transfer.Size);
+
+                transfer.Failed = !done;
+                transfer.Done = std::chrono::steady_clock::now();
+            }
+        }, 1);
+    }
+
+#if DBASELIB_IO_URING
+    static void TransferRing(DBaseRing& ring, std::vector<DBaseRingTransfer>& transfers, bool write, const DBaseRingOptions& options) noexcept
+    {
+        // io_uring limits: 16K registered buffers of at most 1 GB each
+        constexpr size_t MAX_BUFFERS = 16384;
+        constexpr size_t MAX_REQUEST = 1024 * 1024 * 1024;
+        constexpr unsigned CHUNK_BITS = 40;
+
+        const auto chunkSize = std::clamp<size_t>(options.ChunkSize, 4096, MAX_REQUEST);
+        auto fixed = options.FixedBuffers && !transfers.empty() && transfers.size() <= MAX_BUFFERS;
+
+        if (fixed)
+        {
+            std::vector<iovec> buffers;
+
+            for (const auto& transfer : transfers)
+            {
+                fixed = fixed && transfer.Size > 0 && transfer.Size <= MAX_REQUEST;
+                buffers.push_back({ transfer.Data, transfer.Size });
+            }
+
+            // registering fails when the locked memory limit is too low, plain requests work anyway
+            fixed = fixed && ring.RegisterBuffers(buffers.data(), (unsigned)buffers.size());
+        }
+
+        size_t inflight = 0;
+
+        const auto complete = [&](uint64_t userData, int result)
+        {
+            auto& transfer = transfers[userData >> CHUNK_BITS];
+            const auto offset = (userData & ((uint64_t(1) << CHUNK_BITS) - 1)) * chunkSize;
+            const auto length = std::min(chunkSize, transfer.Size - offset);
+
+            // short transfers and errors (e.g. unsupported opcodes on old kernels) are finished synchronously
+            if (result != (int)length)
+            {
+                const auto done = (size_t)std::max(result, 0);
+                const auto rest = length - done;
+                const auto ok = write ? DBaseFile::WriteAt(transfer.Handle, offset + done, transfer.Data + offset + done, rest) : DBaseFile::ReadAt(transfer.Handle, offset + done, transfer.Data + offset + done, rest);
+
+                if (!ok) transfer.Failed = true;
+            }
+
+            if (--transfer.Pending == 0) transfer.Done = std::chrono::steady_clock::now();
+            --inflight;
+        };
+
+        for (size_t t = 0; t < transfers.size(); ++t)
+        {
+            auto& transfer = transfers[t];
+            const auto chunks = (transfer.Size + chunkSize - 1) / chunkSize;
+
+            // completions of this transfer may arrive while its later chunks are queued
+            transfer.Pending = chunks;
+            if (!chunks) transfer.Done = std::chrono::steady_clock::now();
+
+            for (size_t c = 0; c < chunks; ++c)
+            {
+                const auto offset = c * chunkSize;
+                const auto length = (unsigned)std::min(chunkSize, transfer.Size - offset);
+
+                // keep the completions within the completion queue
+                while (inflight >= ring.Capacity() || !ring.Queue(write, transfer.Handle, transfer.Data + offset, length, offset, ((uint64_t)t << CHUNK_BITS) | c, fixed ? (int)t : -1))
+                {
+                    ring.Submit();
+                    if (!ring.Reap(complete) && inflight) ring.Wait(complete, options.SpinCount);
+                }
+
+                ++inflight;
+            }
+        }
+
+        ring.Submit();
+        while (inflight) ring.Wait(complete, options.SpinCount);
+
+        if (fixed) ring.UnregisterBuffers();
+    }
+#endif
+
+    /// <summary>
+    /// Read or write every transfer with as few syscalls as possible, uses
+    /// io_uring if available and pread/pwrite if not.
+    /// </summary>
+    static void Transfer(std::vector<DBaseRingTransfer>& transfers, bool write, [[maybe_unused]] const DBaseRingOptions& options = {}) noexcept
+    {
+#if DBASELIB_IO_URING
+        DBaseRing ring;
+
+        if (options.Ring && ring.Init(options))
+        {
+            TransferRing(ring, transfers, write, options);
+            return;
+        }
+#endif
+
+        TransferSync(transfers, write);
+    }
+
+    /// <summary>
+    /// Read and load many DBASE files at once.
+    /// </summary>
+    /// <returns>A loaded DBASE per file, nullptr for files that could not be read or loaded.</returns>
+    static std::vector<DBase*> LoadFiles(const std::vector<std::filesystem::path>& files, const DBaseRingOptions& options = {}) noexcept
+    {
+        const auto start = std::chrono::steady_clock::now();
+
+        std::vector<DBaseRingTransfer> transfers;
+        std::vector<size_t> transferOf(files.size(), SIZE_MAX);
+
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            uint64_t size;
+            const auto handle = DBaseFile::OpenRead(files[i], size);
+            if (handle == DBaseFile::INVALID) continue;
+
+            const auto data = new (std::nothrow) char[std::max<size_t>(size, 1)];
+
+            if (!data)
+            {
+                DBaseFile::Close(handle);
+                continue;
+            }
+
+            transferOf[i] = transfers.size();
+            transfers.push_back({ handle, data, (size_t)size, false, 0, start });
+        }
+
+        Transfer(transfers, false, options);
+        for (const auto& transfer : transfers) DBaseFile::Close(transfer.Handle);
+
+        std::vector<DBase*> dbases(files.size(), nullptr);
+
+        DBaseParallel::For(files.size(), [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                if (transferOf[i] == SIZE_MAX) continue;
+
+                const auto& transfer = transfers[transferOf[i]];
+                const auto dbase = transfer.Failed ? nullptr : DBaseUtils::FromBuffer(transfer.Data, transfer.Size);
+
+                if (!dbase)
+                {
+                    delete[] transfer.Data;
+                    continue;
+                }
+
+                dbase->Counters.Read(transfer.Size);
+                dbase->Counters.Record(DBasePhase::Read, start, transfer.Done);
+
+                if (dbase->Load()) dbases[i] = dbase;
+                else delete dbase;
+            }
+        }, 1);
+
+        return dbases;
+    }
+
+    /// <summary>
+    /// Save many DBASE files at once, every file is created or truncated.
+    /// </summary>
+    /// <param name="dbases">DBASE files to save, nullptr entries are skipped with OpenFailed.</param>
+    /// <param name="files">Path to save every DBASE to.</param>
+    /// <returns>The status of every file.</returns>
+    static std::vector<DBaseSaveStatus> SaveFiles(const std::vector<const DBase*>& dbases, const std::vector<std::filesystem::path>& files, const DBaseRingOptions& options = {}) noexcept
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const auto count = std::min(dbases.size(), files.size());
+
+        std::vector<DBaseSaveStatus> statuses(count, DBaseSaveStatus::OpenFailed);
+        std::vector<DBaseRingTransfer> transfers;
+        std::vector<size_t> fileOf;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!dbases[i]) continue;
+
+            const auto handle = DBaseFile::Open(files[i], false);
+            if (handle == DBaseFile::INVALID) continue;
+
+            fileOf.push_back(i);
+            transfers.push_back({ handle, const_cast<char*>(dbases[i]->Data), dbases[i]->Size, false, 0, start });
+        }
+
+        Transfer(transfers, true, options);
+
+        for (size_t t = 0; t < transfers.size(); ++t)
+        {
+            const auto& transfer = transfers[t];
+            const auto dbase = dbases[fileOf[t]];
+
+            DBaseFile::Close(transfer.Handle);
+            statuses[fileOf[t]] = transfer.Failed ? DBaseSaveStatus::WriteFailed : DBaseSaveStatus::Ok;
+
+            if (!transfer.Failed) dbase->Counters.Written(transfer.Size);
+            dbase->Counters.Record(DBasePhase::Save, start, transfer.Done);
+        }
+
+        return statuses;
+    }
+}
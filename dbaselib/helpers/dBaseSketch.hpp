@@ -0,0 +1,262 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+/// <summary>
+/// HyperLogLog distinct counter, uses 2^Precision bytes no matter how many
+/// values are added. Sketches with the same precision can be merged.
+/// </summary>
+class DBaseHyperLogLog
+{
+    std::vector<uint8_t> Registers;
+    unsigned Precision;
+
+public:
+    static constexpr unsigned DEFAULT_PRECISION = 12;
+
+    explicit DBaseHyperLogLog(unsigned precision = DEFAULT_PRECISION)
+        : Registers(size_t(1) << precision, 0),
+        Precision(precision)
+    {}
+
+    /// <summary>
+    /// Add a hashed value.
+    /// </summary>
+    void Add(uint64_t hash) noexcept
+    {
+        const auto index = hash >> (64 - Precision);
+        const auto rest = (hash << Precision) | (uint64_t(1) << (Precision - 1));
+
+        uint8_t rank = 1;
+        for (auto bit = uint64_t(1) << 63; !(rest & bit); bit >>= 1) ++rank;
+
+        Registers[index] = std::max(Registers[index], rank);
+    }
+
+    /// <summary>
+    /// Merge another sketch with the same precision into this one.
+    /// </summary>
+    void Merge(const DBaseHyperLogLog& other) noexcept
+    {
+        for (size_t i = 0; i < Registers.size(); ++i)
+        {
+            Registers[i] = std::max(Registers[i], other.Registers[i]);
+        }
+    }
+
+    /// <summary>
+    /// Returns the estimated number of distinct values.
+    /// </summary>
+    double Estimate() const noexcept
+    {
+        const auto m = (double)Registers.size();
+
+        double sum = 0.0;
+        size_t zeros = 0;
+
+        for (const auto r : Registers)
+        {
+            sum += std::ldexp(1.0, -(int)r);
+            zeros += r == 0;
+        }
+
+        const auto alpha = 0.7213 / (1.0 + 1.079 / m);
+        const auto estimate = alpha * m * m / sum;
+
+        // small cardinalities are more accurate using linear counting
+        if (estimate <= 2.5 * m && zeros)
+        {
+            return m * std::log(m / (double)zeros);
+        }
+
+        return estimate;
+    }
+
+    const std::vector<uint8_t>& Data() const noexcept { return Registers; }
+    std::vector<uint8_t>& Data() noexcept { return Registers; }
+};
+
+/// <summary>
+/// Count-min sketch, estimates how often a hashed value was added. Estimates
+/// never undercount. Sketches with the same dimensions can be merged.
+/// </summary>
+class DBaseCountMin
+{
+    std::vector<uint32_t> Counters;
+    size_t Width;
+    size_t Depth;
+
+public:
+    static constexpr size_t DEFAULT_WIDTH = 8192;
+    static constexpr size_t DEFAULT_DEPTH = 4;
+
+    explicit DBaseCountMin(size_t width = DEFAULT_WIDTH, size_t depth = DEFAULT_DEPTH)
+        : Counters(width * depth, 0),
+        Width(width),
+        Depth(depth)
+    {}
+
+    /// <summary>
+    /// Add a hashed value. Uses conservative updates, only the counters
+    /// that hold the current estimate are raised.
+    /// </summary>
+    /// <returns>The new estimate of the value.</returns>
+    uint32_t Add(uint64_t hash, uint32_t count = 1) noexcept
+    {
+        const auto estimate = Estimate(hash) + count;
+
+        for (size_t d = 0; d < Depth; ++d)
+        {
+            auto& counter = Counters[d * Width + Index(hash, d)];
+            counter = std::max(counter, estimate);
+        }
+
+        return estimate;
+    }
+
+    /// <summary>
+    /// Returns the estimated count of a hashed value.
+    /// </summary>
+    uint32_t Estimate(uint64_t hash) const noexcept
+    {
+        auto estimate = UINT32_MAX;
+
+        for (size_t d = 0; d < Depth; ++d)
+        {
+            estimate = std::min(estimate, Counters[d * Width + Index(hash, d)]);
+        }
+
+        return estimate;
+    }
+
+    void Merge(const DBaseCountMin& other) noexcept
+    {
+        for (size_t i = 0; i < Counters.size(); ++i) Counters[i] += other.Counters[i];
+    }
+
+private:
+    // derive the row hashes from the two halves of a single hash (Kirsch-Mitzenmacher)
+    size_t Index(uint64_t hash, size_t row) const noexcept
+    {
+        return (size_t)(((hash & 0xFFFFFFFF) + row * (hash >> 32)) % Width);
+    }
+};
+
+/// <summary>
+/// Most frequent values of a stream. Counts come from a count-min sketch, the
+/// K values with the highest estimates are kept. Memory does not depend on
+/// the number of values added.
+/// </summary>
+class DBaseTopK
+{
+public:
+    struct Entry
+    {
+        std::string Value;
+        uint64_t Hash;
+        uint64_t Count;
+    };
+
+private:
+    DBaseCountMin Sketch;
+    std::vector<Entry> Entries;
+    std::unordered_map<uint64_t, size_t> Index;
+    size_t K;
+    size_t MinEntry;
+
+public:
+    explicit DBaseTopK(size_t k = 10)
+        : Sketch(),
+        Entries(),
+        Index(),
+        K(std::max<size_t>(1, k)),
+        MinEntry(0)
+    {}
+
+    /// <summary>
+    /// Add a value.
+    /// </summary>
+    /// <param name="value">Raw bytes of the value.</param>
+    /// <param name="hash">Hash of the value.</param>
+    void Add(std::string_view value, uint64_t hash, uint32_t count = 1) noexcept
+    {
+        Offer(value, hash, Sketch.Add(hash, count));
+    }
+
+    /// <summary>
+    /// Merge another TopK with the same K into this one.
+    /// </summary>
+    void Merge(const DBaseTopK& other) noexcept
+    {
+        Sketch.Merge(other.Sketch);
+
+        // the merged sketch may raise the estimates of both candidate sets
+        auto candidates = std::move(Entries);
+        candidates.insert(candidates.end(), other.Entries.begin(), other.Entries.end());
+
+        Entries.clear();
+        Index.clear();
+        MinEntry = 0;
+
+        for (const auto& entry : candidates)
+        {
+            Offer(entry.Value, entry.Hash, Sketch.Estimate(entry.Hash));
+        }
+    }
+
+    /// <summary>
+    /// Returns the most frequent values, highest count first.
+    /// </summary>
+    std::vector<Entry> Top() const noexcept
+    {
+        auto top = Entries;
+        std::sort(top.begin(), top.end(), [](const auto& a, const auto& b) { return a.Count > b.Count || (a.Count == b.Count && a.Value < b.Value); });
+        return top;
+    }
+
+private:
+    void Offer(std::string_view value, uint64_t hash, uint64_t estimate) noexcept
+    {
+        const auto it = Index.find(hash);
+
+        if (it != Index.end())
+        {
+            auto& entry = Entries[it->second];
+            entry.Count = std::max(entry.Count, estimate);
+            if (it->second == MinEntry) UpdateMin();
+            return;
+        }
+
+        if (Entries.size() < K)
+        {
+            Index[hash] = Entries.size();
+            Entries.push_back({ std::string(value), hash, estimate });
+            UpdateMin();
+            return;
+        }
+
+        auto& min = Entries[MinEntry];
+        if (estimate <= min.Count) return;
+
+        Index.erase(min.Hash);
+        Index[hash] = MinEntry;
+        min = { std::string(value), hash, estimate };
+        UpdateMin();
+    }
+
+    void UpdateMin() noexcept
+    {
+        MinEntry = 0;
+
+        for (size_t i = 1; i < Entries.size(); ++i)
+        {
+            if (Entries[i].Count < Entries[MinEntry].Count) MinEntry = i;
+        }
+    }
+};
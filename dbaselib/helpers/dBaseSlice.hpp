@@ -0,0 +1,414 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <filesystem>
+#include <unordered_set>
+
+#include "dBase.hpp"
+#include "dBase3.hpp"
+#include "dBaseFile.hpp"
+#include "dBaseHash.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseBuilder.hpp"
+#include "dBaseGroupBy.hpp"
+#include "dBaseCounters.hpp"
+
+/// <summary>
+/// Options for DBaseSlice::PartitionBy.
+/// </summary>
+struct DBasePartitionOptions
+{
+    /// <summary>
+    /// Number of hash buckets, 0 for one file per distinct key.
+    /// </summary>
+    size_t Buckets = 0;
+
+    /// <summary>
+    /// Files kept open at once, the least recently written one is closed when another is needed.
+    /// </summary>
+    size_t MaxOpenFiles = 64;
+
+    /// <summary>
+    /// Write buffer of every open file.
+    /// </summary>
+    size_t BufferSize = 256 * 1024;
+};
+
+namespace DBaseSlice
+{
+    /// <summary>
+    /// A copy from a loaded record (after its deleted flag) into a new record (including its flag).
+    /// </summary>
+    struct Gather
+    {
+        size_t From;
+        size_t To;
+        size_t Size;
+    };
+
+    /// <summary>
+    /// Select the fields and work out the copies that make a new record. Fields
+    /// that are neighbours in both records become a single copy, so selecting
+    /// all fields in order is one copy per record.
+    /// </summary>
+    /// <param name="fields">Fields to keep in this order, all if empty.</param>
+    /// <returns>False if a field does not exist or is selected twice.</returns>
+    inline bool Plan(const DBase* dbase, const std::vector<std::string>& fields, std::vector<const DBaseHandle*>& handles, std::vector<Gather>& gathers) noexcept
+    {
+        size_t to = 1;
+
+        for (const auto& name : fields.empty() ? dbase->Fields() : fields)
+        {
+            const auto handle = DBaseUtils::Find(dbase, name);
+            if (!handle || std::find(handles.begin(), handles.end(), handle) != handles.end()) return false;
+
+            const auto from = handle->Offset();
+            const auto size = handle->Size();
+
+            if (!gathers.empty() && gathers.back().From + gathers.back().Size == from && gathers.back().To + gathers.back().Size == to) gathers.back().Size += size;
+            else gathers.push_back({ from, to, size });
+
+            handles.push_back(handle);
+            to += size;
+        }
+
+        return true;
+    }
+
+    /// <summary>
+    /// Make a new record from a loaded one.
+    /// </summary>
+    inline void Apply(const std::vector<Gather>& gathers, const char* from, char* to) noexcept
+    {
+        *to = ' ';
+        for (const auto& gather : gathers) memcpy(to + gather.To, from + gather.From, gather.Size);
+    }
+
+    /// <summary>
+    /// Write the selected fields of the live records that match a predicate to
+    /// a new file in one pass. Records are gathered straight into the write
+    /// buffer of a DBaseBuilder, the loaded data is never copied as a whole.
+    /// </summary>
+    /// <param name="file">File to write, an existing one is replaced.</param>
+    /// <param name="fields">Fields to keep in this order, all if empty.</param>
+    /// <param name="keep">Called as keep(row) for every live record in order, true to write it.</param>
+    /// <returns>Number of records written or -1 on an error.</returns>
+    template<typename Predicate>
+    int64_t SaveAs(const DBase* dbase, const std::filesystem::path& file, const std::vector<std::string>& fields, Predicate&& keep) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::SaveAs);
+
+        DBaseBuilder builder;
+        std::vector<const DBaseHandle*> handles;
+        std::vector<Gather> gathers;
+        if (!Plan(dbase, fields, handles, gathers)) return -1;
+
+        for (const auto handle : handles) builder.AddField(handle);
+        if (!builder.Open(file)) return -1;
+
+        const auto rows = dbase->RecordCount();
+
+        for (size_t row = 0; row < rows; ++row)
+        {
+            if (!keep(row)) continue;
+
+            const auto record = builder.Reserve();
+            if (!record) break;
+
+            Apply(gathers, dbase->Records[row], record);
+        }
+
+        const auto records = (int64_t)builder.RecordCount();
+        dbase->Counters.Scanned(rows);
+
+        if (!builder.Close()) return -1;
+
+        dbase->Counters.Written(DBaseUtils::HeaderSize(handles.size()) + records * builder.RecordSize() + 1);
+        return records;
+    }
+
+    /// <summary>
+    /// Write the selected fields of all live records to a new file.
+    /// </summary>
+    inline int64_t SaveAs(const DBase* dbase, const std::filesystem::path& file, const std::vector<std::string>& fields) noexcept
+    {
+        return SaveAs(dbase, file, fields, [](size_t) { return true; });
+    }
+
+    /// <summary>
+    /// One output file of PartitionBy. It only holds a handle and a buffer
+    /// while it is open, a closed one is opened again without truncating.
+    /// </summary>
+    struct Partition
+    {
+        std::filesystem::path File;
+        DBaseFile::Native Handle = DBaseFile::INVALID;
+        std::vector<char> Buffer;
+        size_t Used = 0;
+        uint64_t Offset = 0;
+        uint64_t Records = 0;
+        uint64_t LastUse = 0;
+        bool Created = false;
+    };
+
+    /// <summary>
+    /// Buffered writers for many partitions with a bound on the open files.
+    /// </summary>
+    class PartitionWriter
+    {
+        const std::vector<DBase3FieldDescriptor>& Fields;
+        const DBasePartitionOptions& Options;
+        const size_t RowSize;
+        std::vector<size_t> Open;
+        uint64_t Clock = 0;
+        bool Error = false;
+
+    public:
+        std::vector<Partition> Partitions;
+
+        PartitionWriter(const std::vector<DBase3FieldDescriptor>& fields, size_t rowSize, const DBasePartitionOptions& options) noexcept
+            : Fields(fields),
+            Options(options),
+            RowSize(rowSize),
+            Open(),
+            Partitions()
+        {}
+
+        ~PartitionWriter()
+        {
+            for (const auto index : Open) DBaseFile::Close(Partitions[index].Handle);
+        }
+
+        PartitionWriter(const PartitionWriter&) = delete;
+        PartitionWriter& operator=(const PartitionWriter&) = delete;
+
+        bool Failed() const noexcept { return Error; }
+
+        /// <summary>
+        /// Add a partition, its file is created on the first record.
+        /// </summary>
+        size_t Add(const std::filesystem::path& file) noexcept
+        {
+            Partitions.emplace_back();
+            Partitions.back().File = file;
+            return Partitions.size() - 1;
+        }
+
+        /// <summary>
+        /// Write the buffered records of a partition.
+        /// </summary>
+        bool Flush(Partition& partition) noexcept
+        {
+            if (partition.Used && !Error) Error = !DBaseFile::WriteAt(partition.Handle, partition.Offset, partition.Buffer.data(), partition.Used);
+
+            partition.Offset += partition.Used;
+            partition.Used = 0;
+            return !Error;
+        }
+
+        /// <summary>
+        /// Flush and close the least recently written open partition.
+        /// </summary>
+        void Evict() noexcept
+        {
+            const auto oldest = std::min_element(Open.begin(), Open.end(), [&](size_t a, size_t b) { return Partitions[a].LastUse < Partitions[b].LastUse; });
+            auto& partition = Partitions[*oldest];
+
+            Flush(partition);
+            DBaseFile::Close(partition.Handle);
+            partition.Handle = DBaseFile::INVALID;
+            std::vector<char>().swap(partition.Buffer);
+            Open.erase(oldest);
+        }
+
+        /// <summary>
+        /// Make sure a partition is open, the file is created with a header on first use.
+        /// </summary>
+        bool Acquire(size_t index) noexcept
+        {
+            auto& partition = Partitions[index];
+            partition.LastUse = ++Clock;
+            if (partition.Handle != DBaseFile::INVALID) return true;
+
+            if (Open.size() >= std::max<size_t>(Options.MaxOpenFiles, 1)) Evict();
+
+            if (partition.Created)
+            {
+                partition.Handle = DBaseFile::Reopen(partition.File);
+            }
+            else
+            {
+                partition.Handle = DBaseFile::Open(partition.File, false);
+
+                std::vector<char> header(DBaseUtils::HeaderSize(Fields.size()));
+                DBaseUtils::WriteHeader(header.data(), Fields, 0);
+
+                if (partition.Handle != DBaseFile::INVALID && !DBaseFile::WriteAt(partition.Handle, 0, header.data(), header.size())) Error = true;
+
+                partition.Offset = header.size();
+                partition.Created = true;
+            }
+
+            if (partition.Handle == DBaseFile::INVALID) Error = true;
+            if (Error) return false;
+
+            partition.Buffer.resize(std::max(Options.BufferSize / RowSize, size_t(1)) * RowSize);
+            Open.push_back(index);
+            return true;
+        }
+
+        /// <summary>
+        /// Returns room for a new record in a partition or nullptr on an error.
+        /// </summary>
+        char* Reserve(size_t index) noexcept
+        {
+            if (!Acquire(index)) return nullptr;
+
+            auto& partition = Partitions[index];
+            if (partition.Used == partition.Buffer.size() && !Flush(partition)) return nullptr;
+
+            const auto record = partition.Buffer.data() + partition.Used;
+            partition.Used += RowSize;
+            ++partition.Records;
+            return record;
+        }
+
+        /// <summary>
+        /// Write the remaining records, the eof marker and the header with the record count of every partition.
+        /// </summary>
+        bool Close() noexcept
+        {
+            const char eof = 0x1A;
+            std::vector<char> header(DBaseUtils::HeaderSize(Fields.size()));
+
+            for (size_t i = 0; i < Partitions.size() && !Error; ++i)
+            {
+                auto& partition = Partitions[i];
+                if (!Acquire(i) || !Flush(partition)) break;
+
+                DBaseUtils::WriteHeader(header.data(), Fields, (size_t)partition.Records);
+                Error = !DBaseFile::WriteAt(partition.Handle, partition.Offset, &eof, 1) || !DBaseFile::WriteAt(partition.Handle, 0, header.data(), header.size());
+
+                DBaseFile::Close(partition.Handle);
+                partition.Handle = DBaseFile::INVALID;
+                std::vector<char>().swap(partition.Buffer);
+                Open.erase(std::find(Open.begin(), Open.end(), i));
+            }
+
+            return !Error;
+        }
+    };
+
+    /// <summary>
+    /// Name of the file of a key: the trimmed key with everything but letters,
+    /// digits, '-' and '_' replaced by '_'. Names that are empty or already
+    /// taken (case insensitive) get the index of the partition appended, or
+    /// the first number after it that gives a name not taken yet.
+    /// </summary>
+    inline std::string FileName(std::string_view key, size_t index, std::unordered_set<std::string>& taken) noexcept
+    {
+        while (!key.empty() && key.back() == ' ') key.remove_suffix(1);
+        while (!key.empty() && key.front() == ' ') key.remove_prefix(1);
+
+        std::string name;
+        for (const auto c : key) name += std::isalnum((unsigned char)c) || c == '-' || c == '_' ? c : '_';
+
+        auto lower = name;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+        if (!name.empty() && taken.insert(lower).second) return name + ".dbf";
+
+        // the suffixed name may be a key of its own, count up until it is free
+        for (auto suffix = index;; ++suffix)
+        {
+            const auto end = "_" + std::to_string(suffix);
+            if (taken.insert(lower + end).second) return name + end + ".dbf";
+        }
+    }
+
+    /// <summary>
+    /// Split the live records into one file per distinct value of a field, or
+    /// per hash bucket of it, in a single scan. Every partition has its own
+    /// write buffer, at most MaxOpenFiles files are open at a time and the
+    /// headers get their record counts when all records are written.
+    /// </summary>
+    /// <param name="directory">Directory of the files, created if needed. Files are named after the key (see FileName) or the bucket number.</param>
+    /// <param name="col">Field to partition by.</param>
+    /// <param name="fields">Fields to keep in this order, all if empty.</param>
+    /// <param name="files">Receives the file of every partition, in the order the keys first appear.</param>
+    /// <returns>Number of partitions or -1 on an error.</returns>
+    static int64_t PartitionBy(const DBase* dbase, const std::filesystem::path& directory, const std::string& col, const std::vector<std::string>& fields, const DBasePartitionOptions& options, std::vector<std::filesystem::path>* files = nullptr) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Partition);
+
+        const auto key = DBaseUtils::Find(dbase, col);
+
+        std::vector<const DBaseHandle*> handles;
+        std::vector<Gather> gathers;
+        if (!key || !Plan(dbase, fields, handles, gathers)) return -1;
+
+        std::vector<DBase3FieldDescriptor> descriptors;
+        for (const auto handle : handles) descriptors.push_back(DBaseUtils::MakeField(handle));
+
+        size_t rowSize = 1;
+        for (const auto handle : handles) rowSize += handle->Size();
+
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) return -1;
+
+        PartitionWriter writer(descriptors, rowSize, options);
+        DBaseGroupTable table(key->Size(), 0);
+        std::vector<size_t> buckets(options.Buckets, SIZE_MAX);
+        std::unordered_set<std::string> taken;
+
+        const auto rows = dbase->RecordCount();
+        const auto offset = key->Offset();
+        const auto keySize = key->Size();
+
+        for (size_t row = 0; row < rows && !writer.Failed(); ++row)
+        {
+            const auto record = dbase->Records[row];
+            const auto data = reinterpret_cast<const unsigned char*>(record + offset);
+            const auto hash = DBaseHash::Hash(data, keySize);
+
+            // partitions are numbered in the order their keys first appear
+            size_t index;
+
+            if (options.Buckets)
+            {
+                auto& slot = buckets[hash % options.Buckets];
+                if (slot == SIZE_MAX) slot = writer.Add(directory / (std::to_string(hash % options.Buckets) + ".dbf"));
+                index = slot;
+            }
+            else
+            {
+                index = table.FindOrInsert(data, hash);
+                if (index == writer.Partitions.size()) writer.Add(directory / FileName(std::string_view(record + offset, keySize), index, taken));
+            }
+
+            const auto target = writer.Reserve(index);
+            if (target) Apply(gathers, record, target);
+        }
+
+        dbase->Counters.Scanned(rows);
+        if (!writer.Close()) return -1;
+
+        uint64_t written = 0;
+        for (const auto& partition : writer.Partitions) written += partition.Offset + 1;
+        dbase->Counters.Written(written);
+
+        if (files)
+        {
+            files->clear();
+            for (const auto& partition : writer.Partitions) files->push_back(partition.File);
+        }
+
+        return (int64_t)writer.Partitions.size();
+    }
+}
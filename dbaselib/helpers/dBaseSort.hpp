@@ -0,0 +1,580 @@
+#pragma once
+
+#include <bit>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <algorithm>
+#include <filesystem>
+
+#include "dBase.hpp"
+#include "dBase3.hpp"
+#include "dBaseNumeric.hpp"
+
+/// <summary>
+/// Column to order records by.
+/// </summary>
+struct DBaseSortColumn
+{
+    std::string Name;
+    bool Descending;
+};
+
+/// <summary>
+/// Turns the sort columns of a record into a key that can be compared using memcmp.
+/// Text and dates are compared by their raw bytes, numbers by their parsed value.
+/// Blank numbers are ordered before every other number.
+/// </summary>
+class DBaseKeyEncoder
+{
+    struct Part
+    {
+        size_t Offset;
+        size_t Size;
+        bool Numeric;
+        bool Descending;
+    };
+
+    std::vector<Part> Parts;
+    size_t KeyBytes;
+
+public:
+    static constexpr size_t NUMERIC_KEY_SIZE = 1 + sizeof(unsigned long long);
+
+    DBaseKeyEncoder() : Parts(), KeyBytes(0) {}
+
+    /// <summary>
+    /// Build the encoder for the given columns.
+    /// </summary>
+    /// <returns>True if all columns were found, false if not.</returns>
+    bool Init(const DBase* dbase, const std::vector<DBaseSortColumn>& columns) noexcept
+    {
+        Parts.clear();
+        KeyBytes = 0;
+
+        for (const auto& column : columns)
+        {
+            const auto it = std::find(dbase->Fields().begin(), dbase->Fields().end(), column.Name);
+            if (it == dbase->Fields().end()) return false;
+
+            const auto handle = dbase->Select(column.Name);
+            const auto numeric = handle->Type() == 'N' || handle->Type() == 'F';
+
+            Parts.push_back({ handle->Offset(), handle->Size(), numeric, column.Descending });
+            KeyBytes += numeric ? NUMERIC_KEY_SIZE : handle->Size();
+        }
+
+        return !Parts.empty();
+    }
+
+    /// <summary>
+    /// Returns the size of an encoded key.
+    /// </summary>
+    constexpr size_t KeySize() const noexcept { return KeyBytes; }
+
+    /// <summary>
+    /// Encode the key of a record.
+    /// </summary>
+    /// <param name="record">Pointer to the record (after the deleted flag).</param>
+    /// <param name="out">Buffer of KeySize() bytes.</param>
+    void Encode(const char* record, unsigned char* out) const noexcept
+    {
+        for (const auto& part : Parts)
+        {
+            const auto begin = out;
+
+            if (part.Numeric)
+            {
+                double value;
+
+                if (DBaseNumeric::ParseFloat(record + part.Offset, part.Size, value))
+                {
+                    // flip the sign bit for positive numbers and all bits for negative
+                    // ones so the big endian bytes sort the same way as the values
+                    auto bits = std::bit_cast<unsigned long long>(value == 0.0 ? 0.0 : value);
+                    bits = (bits >> 63) ? ~bits : bits | (1ull << 63);
+
+                    *out++ = 1;
+
+                    for (int i = 7; i >= 0; --i)
+                    {
+                        *out++ = (unsigned char)(bits >> (i * 8));
+                    }
+                }
+                else
+                {
+                    memset(out, 0, NUMERIC_KEY_SIZE);
+                    out += NUMERIC_KEY_SIZE;
+                }
+            }
+            else
+            {
+                memcpy(out, record + part.Offset, part.Size);
+                out += part.Size;
+            }
+
+            if (part.Descending)
+            {
+                for (auto p = begin; p < out; ++p) *p = ~*p;
+            }
+        }
+    }
+};
+
+namespace DBaseSort
+{
+    constexpr size_t DEFAULT_MEMORY_BUDGET = 256 * 1024 * 1024;
+    constexpr size_t MIN_RUN_BUFFER = 1024 * 1024;
+
+    /// <summary>
+    /// Sort the records of a loaded DBASE in place. Live records are written to
+    /// the front of the record area in sorted order, deleted ones after them.
+    /// </summary>
+    /// <param name="dbase">Loaded DBASE.</param>
+    /// <param name="columns">Columns to sort by, the first one is the most significant.</param>
+    /// <returns>True if the records were sorted, false if a column does not exist.</returns>
+    static bool Sort(DBase* dbase, const std::vector<DBaseSortColumn>& columns) noexcept
+    {
+        DBaseKeyEncoder encoder;
+        if (!encoder.Init(dbase, columns)) return false;
+
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Sort);
+
+        const auto count = dbase->Records.size();
+        dbase->Counters.Scanned(count);
+        dbase->Counters.Parsed(count * columns.size());
+        const auto keySize = encoder.KeySize();
+        const auto recordSize = dbase->RecordSize();
+
+        std::vector<unsigned char> keys(count * keySize);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            encoder.Encode(dbase->Records[i], keys.data() + i * keySize);
+        }
+
+        std::vector<size_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return memcmp(keys.data() + a * keySize, keys.data() + b * keySize, keySize) < 0;
+        });
+
+        // every record slot in file order, including the deleted flag
+        std::vector<char*> slots;
+        slots.reserve(count + dbase->Deleted.size());
+        std::merge(dbase->Records.begin(), dbase->Records.end(), dbase->Deleted.begin(), dbase->Deleted.end(), std::back_inserter(slots));
+
+        std::vector<char> sorted(slots.size() * recordSize);
+        auto out = sorted.data();
+
+        for (const auto i : order)
+        {
+            memcpy(out, dbase->Records[i] - 1, recordSize);
+            out += recordSize;
+        }
+
+        for (const auto record : dbase->Deleted)
+        {
+            memcpy(out, record - 1, recordSize);
+            out += recordSize;
+        }
+
+        for (size_t i = 0; i < slots.size(); ++i)
+        {
+            memcpy(slots[i] - 1, sorted.data() + i * recordSize, recordSize);
+        }
+
+        dbase->Records.assign(slots.begin(), slots.begin() + count);
+        dbase->Deleted.assign(slots.begin() + count, slots.end());
+        return true;
+    }
+
+    /// <summary>
+    /// Buffered sequential reader for record files.
+    /// </summary>
+    class RecordReader
+    {
+        std::ifstream Stream;
+        std::vector<char> Buffer;
+        size_t RecordSize;
+        size_t Position;
+        size_t Available;
+
+    public:
+        RecordReader(const std::filesystem::path& file, size_t offset, size_t recordSize, size_t bufferSize)
+            : Stream(file, std::ifstream::in | std::ifstream::binary),
+            Buffer(std::max(recordSize, bufferSize / recordSize * recordSize)),
+            RecordSize(recordSize),
+            Position(0),
+            Available(0)
+        {
+            Stream.seekg(offset);
+        }
+
+        bool Good() const noexcept { return Stream.good(); }
+
+        /// <summary>
+        /// Returns the next record including its deleted flag or nullptr at the end.
+        /// </summary>
+        const char* Next() noexcept
+        {
+            if (Position + RecordSize > Available)
+            {
+                Stream.read(Buffer.data(), Buffer.size());
+                Available = (size_t)Stream.gcount() / RecordSize * RecordSize;
+                Position = 0;
+
+                if (Available == 0) return nullptr;
+            }
+
+            const auto record = Buffer.data() + Position;
+            Position += RecordSize;
+            return record;
+        }
+
+        /// <summary>
+        /// Read as many whole records as possible into the buffer.
+        /// </summary>
+        /// <returns>Number of bytes read.</returns>
+        size_t ReadBlock(char* buffer, size_t size) noexcept
+        {
+            Stream.read(buffer, size / RecordSize * RecordSize);
+            return (size_t)Stream.gcount() / RecordSize * RecordSize;
+        }
+    };
+
+    /// <summary>
+    /// Buffered sequential writer for record files.
+    /// </summary>
+    class RecordWriter
+    {
+        std::ofstream Stream;
+        std::vector<char> Buffer;
+        size_t Position;
+
+    public:
+        RecordWriter(const std::filesystem::path& file, size_t bufferSize)
+            : Stream(file, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc),
+            Buffer(bufferSize),
+            Position(0)
+        {}
+
+        ~RecordWriter() { Flush(); }
+
+        bool Good() const noexcept { return Stream.good(); }
+
+        /// <summary>
+        /// Flush and close the file.
+        /// </summary>
+        /// <returns>False if anything could not be written.</returns>
+        bool Close() noexcept
+        {
+            Flush();
+            Stream.close();
+            return !Stream.fail();
+        }
+
+        void Write(const char* data, size_t size) noexcept
+        {
+            if (Position + size > Buffer.size())
+            {
+                Flush();
+
+                if (size > Buffer.size())
+                {
+                    Stream.write(data, size);
+                    return;
+                }
+            }
+
+            memcpy(Buffer.data() + Position, data, size);
+            Position += size;
+        }
+
+        void Flush() noexcept
+        {
+            if (Position)
+            {
+                Stream.write(Buffer.data(), Position);
+                Position = 0;
+            }
+        }
+
+        /// <summary>
+        /// Flush and seek to the given offset, used to fix up the header.
+        /// </summary>
+        void Patch(size_t offset, const void* data, size_t size) noexcept
+        {
+            Flush();
+            Stream.seekp(offset);
+            Stream.write(reinterpret_cast<const char*>(data), size);
+            Stream.seekp(0, std::ofstream::end);
+        }
+    };
+
+    /// <summary>
+    /// Tournament tree of losers used to merge k sorted runs. The winner
+    /// is replaced and replayed against log2(k) losers on every step.
+    /// </summary>
+    class LoserTree
+    {
+        std::vector<size_t> Tree;
+        const std::vector<const unsigned char*>& Keys;
+        const size_t KeySize;
+        const size_t Count;
+
+        // returns true if run a wins over run b, exhausted runs lose, ties go to the lower run
+        bool Wins(size_t a, size_t b) const noexcept
+        {
+            if (a == Count) return true;
+            if (b == Count) return false;
+            if (!Keys[a]) return false;
+            if (!Keys[b]) return true;
+
+            const auto c = memcmp(Keys[a], Keys[b], KeySize);
+            return c < 0 || (c == 0 && a < b);
+        }
+
+    public:
+        /// <param name="keys">Current key of every run, nullptr if the run is exhausted.</param>
+        LoserTree(const std::vector<const unsigned char*>& keys, size_t keySize)
+            : Tree(keys.size(), keys.size()),
+            Keys(keys),
+            KeySize(keySize),
+            Count(keys.size())
+        {
+            for (size_t i = Count; i-- > 0;) Replay(i);
+        }
+
+        /// <summary>
+        /// Returns the run holding the smallest key.
+        /// </summary>
+        constexpr size_t Winner() const noexcept { return Tree[0]; }
+
+        /// <summary>
+        /// Returns true if all runs are exhausted.
+        /// </summary>
+        bool Empty() const noexcept { return Count == 0 || !Keys[Tree[0]]; }
+
+        /// <summary>
+        /// Replay the path of a run after its key changed.
+        /// </summary>
+        void Replay(size_t run) noexcept
+        {
+            for (auto node = (run + Count) / 2; node > 0; node /= 2)
+            {
+                if (Wins(Tree[node], run)) std::swap(Tree[node], run);
+            }
+
+            Tree[0] = run;
+        }
+    };
+
+    static std::filesystem::path TempRunPath(const std::filesystem::path& dir, size_t id) noexcept
+    {
+        static std::mt19937_64 rng{ std::random_device{}() };
+        return dir / ("dbsort_" + std::to_string(rng()) + "_" + std::to_string(id) + ".tmp");
+    }
+
+    /// <summary>
+    /// Merge sorted runs into a writer.
+    /// </summary>
+    /// <returns>Number of records written.</returns>
+    static size_t MergeRuns(const std::vector<std::filesystem::path>& runs, RecordWriter& writer, const DBaseKeyEncoder& encoder, size_t recordSize, size_t bufferSize) noexcept
+    {
+        const auto keySize = encoder.KeySize();
+
+        std::vector<RecordReader> readers;
+        std::vector<const char*> records(runs.size());
+        std::vector<unsigned char> keyBuffer(runs.size() * keySize);
+        std::vector<const unsigned char*> keys(runs.size());
+
+        readers.reserve(runs.size());
+
+        for (size_t i = 0; i < runs.size(); ++i)
+        {
+            readers.emplace_back(runs[i], 0, recordSize, bufferSize);
+            records[i] = readers[i].Next();
+
+            if (records[i])
+            {
+                encoder.Encode(records[i] + 1, keyBuffer.data() + i * keySize);
+                keys[i] = keyBuffer.data() + i * keySize;
+            }
+        }
+
+        LoserTree tree(keys, keySize);
+        size_t written = 0;
+
+        while (!tree.Empty())
+        {
+            const auto run = tree.Winner();
+            writer.Write(records[run], recordSize);
+            ++written;
+
+            records[run] = readers[run].Next();
+
+            if (records[run])
+            {
+                encoder.Encode(records[run] + 1, keyBuffer.data() + run * keySize);
+            }
+            else
+            {
+                keys[run] = nullptr;
+            }
+
+            tree.Replay(run);
+        }
+
+        return written;
+    }
+
+    /// <summary>
+    /// Sort a DBASE file that may be larger than memory. Sorted runs of live records
+    /// are spilled to temporary files in record format and merged with a loser tree.
+    /// Deleted records are dropped. Records with equal keys keep their order, so the
+    /// result matches Sort() on the loaded file.
+    /// </summary>
+    /// <param name="file">File to sort.</param>
+    /// <param name="output">File to write the sorted records to.</param>
+    /// <param name="columns">Columns to sort by, the first one is the most significant.</param>
+    /// <param name="memoryBudget">Upper bound of memory used for buffers and keys.</param>
+    /// <param name="tempDir">Directory for the runs, defaults to the system temp directory.</param>
+    /// <returns>True if the file was sorted, false if not.</returns>
+    static bool SortFile(const std::filesystem::path& file, const std::filesystem::path& output, const std::vector<DBaseSortColumn>& columns, size_t memoryBudget = DEFAULT_MEMORY_BUDGET, std::filesystem::path tempDir = {}) noexcept
+    {
+        std::error_code ec;
+        if (tempDir.empty()) tempDir = std::filesystem::temp_directory_path(ec);
+
+        // load the header only to reuse the field offsets of the handles
+        DBase3Header fileHeader;
+        std::ifstream headerStream(file, std::ifstream::in | std::ifstream::binary);
+        if (!headerStream.read(reinterpret_cast<char*>(&fileHeader), sizeof(DBase3Header))) return false;
+
+        const size_t headerSize = std::max<size_t>(fileHeader.HeaderBytes, sizeof(DBase3Header));
+        auto headerData = new char[headerSize];
+        memcpy(headerData, &fileHeader, sizeof(DBase3Header));
+        headerStream.read(headerData + sizeof(DBase3Header), headerSize - sizeof(DBase3Header));
+        headerStream.close();
+
+        DBase3 header(headerData, headerSize);
+        DBaseKeyEncoder encoder;
+
+        if (!header.Load() || !encoder.Init(&header, columns)) return false;
+
+        const auto recordSize = header.RecordSize();
+        const auto keySize = encoder.KeySize();
+        const auto perRecord = recordSize + keySize + sizeof(size_t);
+        const auto runBuffer = std::min(MIN_RUN_BUFFER * 4, memoryBudget / 8);
+        const auto runRecords = std::max<size_t>(1, (memoryBudget - runBuffer) / perRecord);
+
+        const auto removeRuns = [](const std::vector<std::filesystem::path>& paths)
+        {
+            std::error_code ec;
+            for (const auto& path : paths) std::filesystem::remove(path, ec);
+        };
+
+        // phase one: read budget sized blocks, sort them and spill them as runs
+        std::vector<std::filesystem::path> runs;
+        RecordReader reader(file, headerSize, recordSize, 0);
+
+        {
+            std::vector<char> block(runRecords * recordSize);
+            std::vector<unsigned char> keys(runRecords * keySize);
+            std::vector<size_t> order;
+            order.reserve(runRecords);
+
+            while (const auto read = reader.ReadBlock(block.data(), block.size()))
+            {
+                order.clear();
+
+                for (size_t i = 0; i < read / recordSize; ++i)
+                {
+                    const auto record = block.data() + i * recordSize;
+                    if (*record != ' ') continue;
+
+                    encoder.Encode(record + 1, keys.data() + i * keySize);
+                    order.push_back(i);
+                }
+
+                std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+                {
+                    return memcmp(keys.data() + a * keySize, keys.data() + b * keySize, keySize) < 0;
+                });
+
+                runs.push_back(TempRunPath(tempDir, runs.size()));
+                RecordWriter run(runs.back(), runBuffer);
+
+                for (const auto i : order)
+                {
+                    run.Write(block.data() + i * recordSize, recordSize);
+                }
+
+                if (!run.Close())
+                {
+                    removeRuns(runs);
+                    return false;
+                }
+            }
+        }
+
+        // phase two: merge groups of runs until they fit into a single merge
+        const auto fanIn = std::max<size_t>(2, memoryBudget / MIN_RUN_BUFFER - 1);
+
+        while (runs.size() > fanIn)
+        {
+            std::vector<std::filesystem::path> merged;
+
+            for (size_t i = 0; i < runs.size(); i += fanIn)
+            {
+                const auto end = std::min(runs.size(), i + fanIn);
+                const std::vector<std::filesystem::path> group(runs.begin() + i, runs.begin() + end);
+                const auto bufferSize = memoryBudget / (group.size() + 1);
+
+                merged.push_back(TempRunPath(tempDir, runs.size() + merged.size()));
+
+                RecordWriter writer(merged.back(), bufferSize);
+                MergeRuns(group, writer, encoder, recordSize, bufferSize);
+
+                if (!writer.Close())
+                {
+                    // the runs of this group and the ones after it are still there
+                    removeRuns(merged);
+                    removeRuns(std::vector<std::filesystem::path>(runs.begin() + i, runs.end()));
+                    return false;
+                }
+
+                removeRuns(group);
+            }
+
+            runs = std::move(merged);
+        }
+
+        // final merge straight into the output, the record count is fixed up afterwards
+        const auto bufferSize = memoryBudget / (runs.size() + 1);
+        size_t count = 0;
+        bool good = false;
+        {
+            RecordWriter writer(output, bufferSize);
+            writer.Write(headerData, headerSize);
+
+            count = MergeRuns(runs, writer, encoder, recordSize, bufferSize);
+
+            const char eofMarker = 0x1A;
+            writer.Write(&eofMarker, 1);
+
+            fileHeader.Records = (unsigned int)count;
+            writer.Patch(0, &fileHeader, sizeof(DBase3Header));
+            good = writer.Close();
+        }
+
+        removeRuns(runs);
+        if (!good) std::filesystem::remove(output, ec);
+
+        return good;
+    }
+}
@@ -0,0 +1,493 @@
+#pragma once
+
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+#include "dBase.hpp"
+#include "dBaseHash.hpp"
+#include "dBaseUtils.hpp"
+#include "dBaseSketch.hpp"
+#include "dBaseNumeric.hpp"
+#include "dBaseReader.hpp"
+#include "dBaseParallel.hpp"
+
+/// <summary>
+/// Summary of a column over a range of records. Numbers are summarized by
+/// their parsed value, all other fields by their raw bytes.
+/// </summary>
+struct DBaseZone
+{
+    /// <summary>
+    /// Number of records with a value.
+    /// </summary>
+    size_t Count = 0;
+
+    /// <summary>
+    /// Number of blank records, for numbers this includes invalid values.
+    /// </summary>
+    size_t Blanks = 0;
+
+    double Sum = 0.0;
+    double Min = std::numeric_limits<double>::infinity();
+    double Max = -std::numeric_limits<double>::infinity();
+
+    std::string MinText;
+    std::string MaxText;
+
+    void Merge(const DBaseZone& other) noexcept
+    {
+        if (other.Count)
+        {
+            Sum += other.Sum;
+            Min = std::min(Min, other.Min);
+            Max = std::max(Max, other.Max);
+
+            if (!other.MinText.empty() && (MinText.empty() || other.MinText < MinText)) MinText = other.MinText;
+            if (!other.MaxText.empty() && (MaxText.empty() || other.MaxText > MaxText)) MaxText = other.MaxText;
+        }
+
+        Count += other.Count;
+        Blanks += other.Blanks;
+    }
+};
+
+/// <summary>
+/// Statistics of a single column, the zones summarize blocks of BlockRows records.
+/// </summary>
+struct DBaseColumnStats : DBaseZone
+{
+    std::string Name;
+    char Type = 0;
+    size_t Size = 0;
+    bool Numeric = false;
+
+    /// <summary>
+    /// Estimated number of distinct values (HyperLogLog).
+    /// </summary>
+    double Distinct = 0.0;
+
+    std::vector<DBaseZone> Zones;
+};
+
+/// <summary>
+/// Column statistics and zone maps of a DBASE. Zone maps allow filters to
+/// skip whole blocks of records that can not contain a value.
+/// </summary>
+class DBaseStats
+{
+    static constexpr uint32_t SIDECAR_MAGIC = 0x4D5A4244; // DBZM
+    static constexpr uint32_t SIDECAR_VERSION = 1;
+
+public:
+    static constexpr size_t DEFAULT_BLOCK_ROWS = 64 * 1024;
+
+    size_t BlockRows;
+    size_t Rows;
+    std::vector<DBaseColumnStats> Columns;
+
+    DBaseStats() : BlockRows(DEFAULT_BLOCK_ROWS), Rows(0), Columns() {}
+
+    /// <summary>
+    /// Compute the statistics of every column in a single pass over the records.
+    /// </summary>
+    /// <param name="dbase">Loaded DBASE.</param>
+    /// <param name="blockRows">Records per zone.</param>
+    static DBaseStats Compute(const DBase* dbase, size_t blockRows = DEFAULT_BLOCK_ROWS) noexcept
+    {
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Stats);
+
+        DBaseStats stats;
+        stats.BlockRows = std::max<size_t>(1, blockRows);
+        stats.Rows = dbase->RecordCount();
+        dbase->Counters.Scanned(stats.Rows);
+
+        std::vector<const DBaseHandle*> handles;
+
+        for (const auto& name : dbase->Fields())
+        {
+            const auto handle = dbase->Select(name);
+            handles.push_back(handle);
+
+            DBaseColumnStats column;
+            column.Name = name;
+            column.Type = handle->Type();
+            column.Size = handle->Size();
+            column.Numeric = column.Type == 'N' || column.Type == 'F';
+            column.Zones.resize((stats.Rows + stats.BlockRows - 1) / stats.BlockRows);
+            stats.Columns.push_back(std::move(column));
+        }
+
+        const auto columnCount = handles.size();
+        dbase->Counters.Parsed(stats.Rows * (size_t)std::count_if(stats.Columns.begin(), stats.Columns.end(), [](const auto& column) { return column.Numeric; }));
+
+        std::vector<std::vector<DBaseHyperLogLog>> sketches(DBaseParallel::Concurrency(), std::vector<DBaseHyperLogLog>(columnCount));
+
+        DBaseParallel::For(stats.Rows, [&](size_t begin, size_t end, size_t slot)
+        {
+            auto& blockSketches = sketches[slot];
+
+            // a call may cover several zones, without helpers it gets all records at once
+            for (auto blockBegin = begin; blockBegin < end; blockBegin += stats.BlockRows)
+            {
+                const auto blockEnd = std::min(end, blockBegin + stats.BlockRows);
+
+                std::vector<DBaseZone> zones(columnCount);
+                std::vector<const char*> minText(columnCount, nullptr), maxText(columnCount, nullptr);
+
+                for (auto i = blockBegin; i < blockEnd; ++i)
+                {
+                    const auto record = dbase->Records[i];
+
+                    for (size_t c = 0; c < columnCount; ++c)
+                    {
+                        const auto& column = stats.Columns[c];
+                        const auto data = record + handles[c]->Offset();
+                        auto& zone = zones[c];
+
+                        if (column.Numeric)
+                        {
+                            double value;
+
+                            if (!DBaseNumeric::ParseFloat(data, column.Size, value))
+                            {
+                                ++zone.Blanks;
+                                continue;
+                            }
+
+                            zone.Sum += value;
+                            zone.Min = std::min(zone.Min, value);
+                            zone.Max = std::max(zone.Max, value);
+                        }
+                        else
+                        {
+                            if (DBaseNumeric::SkipSpaces(data, data + column.Size) == data + column.Size)
+                            {
+                                ++zone.Blanks;
+                                continue;
+                            }
+
+                            if (!minText[c] || memcmp(data, minText[c], column.Size) < 0) minText[c] = data;
+                            if (!maxText[c] || memcmp(data, maxText[c], column.Size) > 0) maxText[c] = data;
+                        }
+
+                        ++zone.Count;
+                        blockSketches[c].Add(DBaseHash::Hash(data, column.Size));
+                    }
+                }
+
+                for (size_t c = 0; c < columnCount; ++c)
+                {
+                    if (minText[c]) zones[c].MinText.assign(minText[c], stats.Columns[c].Size);
+                    if (maxText[c]) zones[c].MaxText.assign(maxText[c], stats.Columns[c].Size);
+
+                    stats.Columns[c].Zones[blockBegin / stats.BlockRows] = std::move(zones[c]);
+                }
+            }
+        }, stats.BlockRows);
+
+        for (size_t c = 0; c < columnCount; ++c)
+        {
+            auto& column = stats.Columns[c];
+            for (const auto& zone : column.Zones) column.Merge(zone);
+
+            for (size_t slot = 1; slot < sketches.size(); ++slot) sketches[0][c].Merge(sketches[slot][c]);
+            column.Distinct = column.Count ? sketches[0][c].Estimate() : 0.0;
+        }
+
+        return stats;
+    }
+
+    /// <summary>
+    /// Returns the statistics of a column or nullptr if it does not exist.
+    /// </summary>
+    const DBaseColumnStats* Column(const std::string& name) const noexcept
+    {
+        const auto it = std::find_if(Columns.begin(), Columns.end(), [&](const auto& column) { return column.Name == name; });
+        return it != Columns.end() ? &*it : nullptr;
+    }
+
+    /// <summary>
+    /// Returns the record ranges [begin, end) whose zones may contain a number in [min, max].
+    /// </summary>
+    std::vector<std::pair<size_t, size_t>> Ranges(const std::string& name, double min, double max) const noexcept
+    {
+        return Candidates(name, [&](const DBaseZone& zone) { return zone.Max >= min && zone.Min <= max; });
+    }
+
+    /// <summary>
+    /// Returns the record ranges [begin, end) whose zones may contain a text in [min, max].
+    /// The bounds are padded with spaces to the field size.
+    /// </summary>
+    std::vector<std::pair<size_t, size_t>> Ranges(const std::string& name, std::string min, std::string max) const noexcept
+    {
+        if (const auto column = Column(name))
+        {
+            min.resize(std::max(min.size(), column->Size), ' ');
+            max.resize(std::max(max.size(), column->Size), ' ');
+        }
+
+        return Candidates(name, [&](const DBaseZone& zone) { return zone.MaxText >= min && zone.MinText <= max; });
+    }
+
+    /// <summary>
+    /// Returns the records with a number in [min, max]. Only the ranges of
+    /// zones that may contain such a number are scanned, if the statistics
+    /// do not belong to the DBASE every record is.
+    /// </summary>
+    /// <param name="dbase">Loaded DBASE the statistics were computed from.</param>
+    std::vector<size_t> Find(const DBase* dbase, const std::string& name, double min, double max) const noexcept
+    {
+        return Scan(dbase, name, true, Ranges(name, min, max), [&](const char* data, size_t size)
+        {
+            double value;
+            return DBaseNumeric::ParseFloat(data, size, value) && value >= min && value <= max;
+        });
+    }
+
+    /// <summary>
+    /// Returns the records with a text in [min, max], compared by the raw bytes.
+    /// The bounds are padded with spaces to the field size.
+    /// </summary>
+    std::vector<size_t> Find(const DBase* dbase, const std::string& name, std::string min, std::string max) const noexcept
+    {
+        const auto ranges = Ranges(name, min, max);
+
+        if (const auto handle = DBaseUtils::Find(dbase, name))
+        {
+            min.resize(std::max(min.size(), handle->Size()), ' ');
+            max.resize(std::max(max.size(), handle->Size()), ' ');
+        }
+
+        return Scan(dbase, name, false, ranges, [&](const char* data, size_t size)
+        {
+            const std::string_view value(data, size);
+            return DBaseNumeric::SkipSpaces(data, data + size) != data + size && value >= min && value <= max;
+        });
+    }
+
+    /// <summary>
+    /// Returns the default sidecar path of a DBASE file.
+    /// </summary>
+    static std::filesystem::path SidecarPath(const std::filesystem::path& file) noexcept
+    {
+        auto path = file;
+        path += ".zmap";
+        return path;
+    }
+
+    /// <summary>
+    /// Persist the statistics next to a DBASE file. The sidecar is keyed by the
+    /// files size and modification time so stale statistics are never loaded.
+    /// </summary>
+    /// <param name="sidecar">File to write the statistics to.</param>
+    /// <param name="file">DBASE file the statistics were computed from.</param>
+    bool Save(const std::filesystem::path& sidecar, const std::filesystem::path& file) const noexcept
+    {
+        uint64_t size;
+        int64_t time;
+        if (!FileKey(file, size, time)) return false;
+
+        std::ofstream stream(sidecar, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+
+        const auto write = [&](const auto& value) { stream.write(reinterpret_cast<const char*>(&value), sizeof(value)); };
+        const auto writeZone = [&](const DBaseZone& zone, const DBaseColumnStats& column)
+        {
+            write((uint64_t)zone.Count);
+            write((uint64_t)zone.Blanks);
+            write(zone.Sum);
+            write(zone.Min);
+            write(zone.Max);
+
+            if (!column.Numeric)
+            {
+                const std::string blank(column.Size, ' ');
+                stream.write(zone.MinText.empty() ? blank.data() : zone.MinText.data(), column.Size);
+                stream.write(zone.MaxText.empty() ? blank.data() : zone.MaxText.data(), column.Size);
+            }
+        };
+
+        write(SIDECAR_MAGIC);
+        write(SIDECAR_VERSION);
+        write(size);
+        write(time);
+        write((uint64_t)BlockRows);
+        write((uint64_t)Rows);
+        write((uint32_t)Columns.size());
+
+        for (const auto& column : Columns)
+        {
+            char name[11]{ 0 };
+            memcpy(name, column.Name.data(), std::min(column.Name.size(), sizeof(name) - 1));
+
+            stream.write(name, sizeof(name));
+            write(column.Type);
+            write((uint64_t)column.Size);
+            write(column.Distinct);
+            writeZone(column, column);
+            write((uint64_t)column.Zones.size());
+
+            for (const auto& zone : column.Zones) writeZone(zone, column);
+        }
+
+        return stream.good();
+    }
+
+    /// <summary>
+    /// Load persisted statistics of a DBASE file.
+    /// </summary>
+    /// <param name="sidecar">File to read the statistics from.</param>
+    /// <param name="file">DBASE file the statistics belong to.</param>
+    /// <returns>True if loaded, false if the sidecar is missing, broken or stale.</returns>
+    bool Load(const std::filesystem::path& sidecar, const std::filesystem::path& file) noexcept
+    {
+        uint64_t size;
+        int64_t time;
+        if (!FileKey(file, size, time)) return false;
+
+        std::ifstream stream(sidecar, std::ifstream::in | std::ifstream::binary);
+
+        const auto read = [&](auto& value) { stream.read(reinterpret_cast<char*>(&value), sizeof(value)); return stream.good(); };
+        const auto readZone = [&](DBaseZone& zone, const DBaseColumnStats& column)
+        {
+            uint64_t count, blanks;
+            read(count);
+            read(blanks);
+            read(zone.Sum);
+            read(zone.Min);
+            read(zone.Max);
+
+            zone.Count = (size_t)count;
+            zone.Blanks = (size_t)blanks;
+
+            if (!column.Numeric)
+            {
+                zone.MinText.resize(column.Size);
+                zone.MaxText.resize(column.Size);
+                stream.read(zone.MinText.data(), column.Size);
+                stream.read(zone.MaxText.data(), column.Size);
+
+                if (!zone.Count)
+                {
+                    zone.MinText.clear();
+                    zone.MaxText.clear();
+                }
+            }
+
+            return stream.good();
+        };
+
+        uint32_t magic = 0, version = 0, columnCount = 0;
+        uint64_t fileSize = 0, blockRows = 0, rows = 0;
+        int64_t fileTime = 0;
+
+        if (!read(magic) || magic != SIDECAR_MAGIC || !read(version) || version != SIDECAR_VERSION) return false;
+        if (!read(fileSize) || !read(fileTime) || fileSize != size || fileTime != time) return false;
+        if (!read(blockRows) || !read(rows) || !read(columnCount)) return false;
+
+        // the counts of a broken sidecar must not get to the allocations below
+        DBaseReader reader;
+        if (!reader.Open(file) || !blockRows || rows > reader.Records() || columnCount != reader.Fields()->Fields().size()) return false;
+
+        std::vector<DBaseColumnStats> columns(columnCount);
+
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            auto& column = columns[i];
+            char name[11];
+            uint64_t columnSize, zones;
+
+            stream.read(name, sizeof(name));
+            read(column.Type);
+            read(columnSize);
+            read(column.Distinct);
+
+            if (!stream.good() || columnSize != reader.Fields()->Select(reader.Fields()->Fields()[i])->Size()) return false;
+
+            column.Name.assign(name, strnlen(name, sizeof(name)));
+            column.Size = (size_t)columnSize;
+            column.Numeric = column.Type == 'N' || column.Type == 'F';
+
+            if (!readZone(column, column) || !read(zones) || zones != (rows + blockRows - 1) / blockRows) return false;
+
+            column.Zones.resize((size_t)zones);
+            for (auto& zone : column.Zones) if (!readZone(zone, column)) return false;
+        }
+
+        BlockRows = (size_t)blockRows;
+        Rows = (size_t)rows;
+        Columns = std::move(columns);
+        return true;
+    }
+
+private:
+    static bool FileKey(const std::filesystem::path& file, uint64_t& size, int64_t& time) noexcept
+    {
+        std::error_code ec;
+        size = (uint64_t)std::filesystem::file_size(file, ec);
+        if (ec) return false;
+
+        time = (int64_t)std::filesystem::last_write_time(file, ec).time_since_epoch().count();
+        return !ec;
+    }
+
+    template<typename Fn>
+    std::vector<size_t> Scan(const DBase* dbase, const std::string& name, bool numeric, std::vector<std::pair<size_t, size_t>> ranges, Fn&& match) const noexcept
+    {
+        std::vector<size_t> rows;
+        const auto handle = DBaseUtils::Find(dbase, name);
+        if (!handle) return rows;
+
+        // statistics of another file, of an older version of this one or zones of the other kind
+        const auto column = Column(name);
+        if (Rows != dbase->RecordCount() || !column || column->Numeric != numeric) ranges.assign(1, { 0, dbase->RecordCount() });
+
+        DBaseCounters::Scope scope(dbase->Counters, DBasePhase::Stats);
+
+        for (const auto& [begin, end] : ranges)
+        {
+            dbase->Counters.Scanned(end - begin);
+
+            for (auto i = begin; i < end; ++i)
+            {
+                if (match(dbase->Records[i] + handle->Offset(), handle->Size())) rows.push_back(i);
+            }
+        }
+
+        return rows;
+    }
+
+    template<typename Fn>
+    std::vector<std::pair<size_t, size_t>> Candidates(const std::string& name, Fn&& match) const noexcept
+    {
+        std::vector<std::pair<size_t, size_t>> ranges;
+        const auto column = Column(name);
+
+        // without statistics every record is a candidate
+        if (!column)
+        {
+            if (Rows) ranges.emplace_back(0, Rows);
+            return ranges;
+        }
+
+        for (size_t block = 0; block < column->Zones.size(); ++block)
+        {
+            const auto& zone = column->Zones[block];
+            if (!zone.Count || !match(zone)) continue;
+
+            const auto begin = block * BlockRows;
+            const auto end = std::min(Rows, begin + BlockRows);
+
+            if (!ranges.empty() && ranges.back().second == begin) ranges.back().second = end;
+            else ranges.emplace_back(begin, end);
+        }
+
+        return ranges;
+    }
+};
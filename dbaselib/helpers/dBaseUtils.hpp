@@ -1,6 +1,12 @@
 #pragma once
 
+#include <ctime>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstring>
 #include <fstream>
+#include <algorithm>
 #include <filesystem>
 
 #include "dBase.hpp"
@@ -8,16 +14,13 @@
 
 namespace DBaseUtils
 {
-    static DBase* FromFile(std::filesystem::path file) noexcept
+    /// <summary>
+    /// Wrap a file image that is already in memory, the DBASE takes ownership of the data.
+    /// </summary>
+    /// <returns>The DBASE, nullptr if the version is not supported (the data is not freed then).</returns>
+    static DBase* FromBuffer(char* data, size_t size) noexcept
     {
-        const auto size = (size_t)std::filesystem::file_size(file);
-        auto data = new char[size];
-
-        std::ifstream dbfStream(file, std::ifstream::in | std::ifstream::binary);
-        dbfStream.read(data, size);
-        dbfStream.close();
-
-        DBase* dbase = nullptr;
+        if (size == 0) return nullptr;
 
         // check whether we are able to load this file or not
         switch ((unsigned char)*data)
@@ -35,4 +38,133 @@ namespace DBaseUtils
             return nullptr;
         }
     }
+
+    static DBase* FromFile(std::filesystem::path file) noexcept
+    {
+        const auto start = std::chrono::steady_clock::now();
+        std::error_code error;
+        const auto size = (size_t)std::filesystem::file_size(file, error);
+        if (error) return nullptr;
+
+        auto data = new char[size];
+
+        std::ifstream dbfStream(file, std::ifstream::in | std::ifstream::binary);
+        dbfStream.read(data, size);
+        dbfStream.close();
+
+        const auto dbase = FromBuffer(data, size);
+
+        if (!dbase)
+        {
+            delete[] data;
+            return nullptr;
+        }
+
+        dbase->Counters.Read(size);
+        dbase->Counters.Record(DBasePhase::Read, start);
+        return dbase;
+    }
+
+    /// <summary>
+    /// Returns the handle of a column or nullptr if it does not exist.
+    /// </summary>
+    /// <param name="dbase">Loaded DBASE.</param>
+    /// <param name="col">Name of the column (case sensitive).</param>
+    static const DBaseHandle* Find(const DBase* dbase, const std::string& col) noexcept
+    {
+        const auto& fields = dbase->Fields();
+        return std::find(fields.begin(), fields.end(), col) != fields.end() ? dbase->Select(col) : nullptr;
+    }
+
+    /// <summary>
+    /// Build a field descriptor.
+    /// </summary>
+    /// <param name="name">Name of the field, truncated to 10 characters.</param>
+    /// <param name="type">DBASE field type (C, N, D, L, ...).</param>
+    /// <param name="length">Size of the field.</param>
+    /// <param name="decimals">Amount of decimals.</param>
+    static DBase3FieldDescriptor MakeField(const std::string& name, char type, size_t length, size_t decimals = 0) noexcept
+    {
+        DBase3FieldDescriptor desc{};
+        memcpy(desc.Name, name.c_str(), std::min<size_t>(name.size(), sizeof(desc.Name) - 1));
+        desc.FieldType = type;
+        desc.Lenght = (char)length;
+        desc.Decimals = (char)decimals;
+        return desc;
+    }
+
+    /// <summary>
+    /// Build a field descriptor that matches an existing field.
+    /// </summary>
+    static DBase3FieldDescriptor MakeField(const DBaseHandle* handle) noexcept
+    {
+        return MakeField(handle->Name(), handle->Type(), handle->Size(), handle->Decimals());
+    }
+
+    /// <summary>
+    /// Returns the size of a DBASE III header with the given amount of fields.
+    /// </summary>
+    static constexpr size_t HeaderSize(size_t fieldCount) noexcept { return sizeof(DBase3Header) + fieldCount * sizeof(DBase3FieldDescriptor) + 1; }
+
+    /// <summary>
+    /// Write a DBASE III header followed by the field descriptors and the terminator.
+    /// </summary>
+    /// <param name="out">Buffer of HeaderSize(fields.size()) bytes.</param>
+    /// <param name="fields">Field descriptors.</param>
+    /// <param name="records">Record count to store in the header.</param>
+    /// <returns>Size of a record including the deleted flag.</returns>
+    static size_t WriteHeader(char* out, const std::vector<DBase3FieldDescriptor>& fields, size_t records) noexcept
+    {
+        size_t recordSize = 1;
+        for (const auto& field : fields) recordSize += (unsigned char)field.Lenght;
+
+        DBase3Header header{};
+        header.Version = 0x3;
+
+        const auto now = std::time(nullptr);
+        const auto date = std::localtime(&now);
+        header.LastChanged[0] = (char)date->tm_year;
+        header.LastChanged[1] = (char)(date->tm_mon + 1);
+        header.LastChanged[2] = (char)date->tm_mday;
+
+        header.Records = (unsigned int)records;
+        header.HeaderBytes = (unsigned short)HeaderSize(fields.size());
+        header.RecordBytes = (unsigned short)recordSize;
+
+        memcpy(out, &header, sizeof(DBase3Header));
+        out += sizeof(DBase3Header);
+
+        if (!fields.empty())
+        {
+            memcpy(out, fields.data(), fields.size() * sizeof(DBase3FieldDescriptor));
+            out += fields.size() * sizeof(DBase3FieldDescriptor);
+        }
+
+        *out = 0xD;
+        return recordSize;
+    }
+
+    /// <summary>
+    /// Create a new loaded DBASE III in memory. All records are live and filled with spaces.
+    /// </summary>
+    /// <param name="fields">Field descriptors.</param>
+    /// <param name="records">Number of records to allocate.</param>
+    static DBase* Create(const std::vector<DBase3FieldDescriptor>& fields, size_t records) noexcept
+    {
+        const auto headerSize = HeaderSize(fields.size());
+
+        size_t recordSize = 1;
+        for (const auto& field : fields) recordSize += (unsigned char)field.Lenght;
+
+        const auto size = headerSize + records * recordSize + 1;
+        auto data = new char[size];
+
+        WriteHeader(data, fields, records);
+        memset(data + headerSize, ' ', records * recordSize);
+        data[size - 1] = 0x1A;
+
+        auto dbase = new DBase3(data, size, true);
+        dbase->Load();
+        return dbase;
+    }
 }
\ No newline at end of file
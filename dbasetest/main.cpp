@@ -0,0 +1,1727 @@
+#include <map>
+#include <set>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <ctime>
+#include <algorithm>
+#include <type_traits>
+#include <filesystem>
+
+#include "dllmain.hpp"
+
+/// <summary>
+/// Live records of a file, every field as trimmed text.
+/// </summary>
+using Table = std::vector<std::vector<std::string>>;
+
+static int Failures = 0;
+
+static bool Check(bool condition, const std::string& what) noexcept
+{
+    if (!condition)
+    {
+        fprintf(stderr, "FAILED: %s\n", what.c_str());
+        ++Failures;
+    }
+
+    return condition;
+}
+
+static std::string Trim(std::string_view text) noexcept
+{
+    while (!text.empty() && text.back() == ' ') text.remove_suffix(1);
+    while (!text.empty() && text.front() == ' ') text.remove_prefix(1);
+    return std::string(text);
+}
+
+/// <summary>
+/// Read the fields and live records of a file through a DBASE of its own,
+/// the exports keep working on the library wide one.
+/// </summary>
+/// <param name="trim">False to keep the padding of the fields.</param>
+static bool Read(const std::filesystem::path& file, std::vector<std::string>& fields, Table& rows, bool trim = true) noexcept
+{
+    const auto dbase = DBaseUtils::FromFile(file);
+
+    if (!dbase || !dbase->Load())
+    {
+        delete dbase;
+        return false;
+    }
+
+    fields = dbase->Fields();
+    rows.clear();
+
+    for (size_t i = 0; i < dbase->RecordCount(); ++i)
+    {
+        std::vector<std::string> row;
+        for (const auto& name : fields)
+        {
+            const auto text = dbase->Select(name)->GetText((int)i);
+            row.push_back(trim ? Trim(text) : std::string(text));
+        }
+
+        rows.push_back(std::move(row));
+    }
+
+    delete dbase;
+    return true;
+}
+
+static Table Read(const std::filesystem::path& file) noexcept
+{
+    std::vector<std::string> fields;
+    Table rows;
+
+    Check(Read(file, fields, rows), "read " + file.filename().string());
+    return rows;
+}
+
+static std::multiset<std::vector<std::string>> Bag(const Table& rows) noexcept
+{
+    return { rows.begin(), rows.end() };
+}
+
+static size_t Column(const std::vector<std::string>& fields, const std::string& name) noexcept
+{
+    return (size_t)(std::find(fields.begin(), fields.end(), name) - fields.begin());
+}
+
+/// <summary>
+/// Mark every n-th record of a file as deleted in place, starting at the first.
+/// </summary>
+static void Delete(const std::filesystem::path& file, size_t every) noexcept
+{
+    DBase3Header header;
+    std::fstream stream(file, std::fstream::in | std::fstream::out | std::fstream::binary);
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    for (size_t i = 0; i < header.Records; i += every)
+    {
+        stream.seekp(header.HeaderBytes + i * header.RecordBytes);
+        stream.put('*');
+    }
+}
+
+/// <summary>
+/// Write a table with text, number, date and logical fields. Names repeat so
+/// there are duplicate keys, every seventh record is marked as deleted.
+/// </summary>
+/// <returns>The live records as Read returns them.</returns>
+static Table MakeTable(const std::filesystem::path& file, size_t rows, uint64_t seed = 42) noexcept
+{
+    const char* names[] = { "NAME", "AMOUNT", "QTY", "DAY", "FLAG" };
+    const char types[] = { 'C', 'N', 'N', 'D', 'L' };
+    const int lengths[] = { 8, 10, 5, 8, 1 };
+    const int decimals[] = { 0, 2, 0, 0, 0 };
+    const char* words[] = { "Ant", "Bee", "Cat", "Dog", "Eel", "Fox", "Gnu", "Hen", "a,b", "say \"hi\"" };
+
+    Table live;
+    if (!Check(CreateTable(file.string().c_str(), names, types, lengths, decimals, 5), "create " + file.filename().string())) return live;
+
+    uint64_t state = seed;
+    const auto next = [&state](uint64_t range) { state = state * 6364136223846793005ULL + 1442695040888963407ULL; return (state >> 33) % range; };
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        const auto name = words[next(10)];
+        const auto amount = ((double)next(2000000) - 1000000.0) / 100.0;
+        const auto qty = (long long)next(500);
+        const auto day = 1 + (int)next(28);
+        const auto month = 1 + (int)next(12);
+        const auto year = 1990 + (int)next(40);
+        const auto flag = next(2) == 1;
+
+        AppendRecord();
+        SetRecordText("NAME", name);
+        SetRecordNumber("AMOUNT", amount);
+        SetRecordInt("QTY", qty);
+        SetRecordDate("DAY", day, month, year);
+        SetRecordLogical("FLAG", flag);
+    }
+
+    Check(CloseTable() == (long long)rows, "close " + file.filename().string());
+    Delete(file, 7);
+
+    return Read(file);
+}
+
+/// <summary>
+/// Fill a field with blanks in every n-th record of a file, starting at the first.
+/// </summary>
+static void Blank(const std::filesystem::path& file, const std::string& field, size_t every, size_t first = 0) noexcept
+{
+    DBase3Header header;
+    std::fstream stream(file, std::fstream::in | std::fstream::out | std::fstream::binary);
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    size_t offset = 1, size = 0;
+    DBase3FieldDescriptor descriptor;
+
+    while (stream.read(reinterpret_cast<char*>(&descriptor), sizeof(descriptor)) && descriptor.Name[0] != 0x0D)
+    {
+        size = (unsigned char)descriptor.Lenght;
+        if (field == descriptor.Name) break;
+
+        offset += size;
+    }
+
+    const std::string blanks(size, ' ');
+
+    for (auto i = first; i < header.Records; i += every)
+    {
+        stream.seekp(header.HeaderBytes + i * header.RecordBytes + offset);
+        stream.write(blanks.data(), (std::streamsize)blanks.size());
+    }
+}
+
+static void TestSort(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "sort.dbf";
+    const auto sorted = dir / "sort_file.dbf";
+    const auto inMemory = dir / "sort_memory.dbf";
+    const auto rows = MakeTable(source, 20000);
+
+    const char* cols[] = { "NAME", "AMOUNT" };
+    const bool descending[] = { false, true };
+
+    // a small budget makes SortFile spill runs and merge them in several passes
+    Check(SortFile(source.string().c_str(), sorted.string().c_str(), cols, descending, 2, 64 * 1024), "SortFile");
+
+    std::vector<std::string> fields;
+    Table result;
+    if (!Check(Read(sorted, fields, result), "read sorted file")) return;
+
+    Check(Bag(result) == Bag(rows), "SortFile keeps the live records");
+
+    const auto name = Column(fields, "NAME");
+    const auto amount = Column(fields, "AMOUNT");
+    auto ordered = true;
+
+    for (size_t i = 1; i < result.size(); ++i)
+    {
+        const auto& a = result[i - 1];
+        const auto& b = result[i];
+        ordered &= a[name] < b[name] || (a[name] == b[name] && std::stod(a[amount]) >= std::stod(b[amount]));
+    }
+
+    Check(ordered, "SortFile orders by NAME ascending and AMOUNT descending");
+
+    Check(Load(source.string().c_str()) && Sort(cols, descending, 2), "Sort");
+    Save(inMemory.string().c_str());
+    Unload();
+
+    Check(Read(inMemory) == result, "Sort and SortFile give the same order");
+}
+
+static void TestCsv(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "csv.dbf";
+    const auto csv = dir / "csv.csv";
+    const auto imported = dir / "csv_import.dbf";
+    const auto rows = MakeTable(source, 3000);
+
+    Check(Load(source.string().c_str()) && ExportCsv(csv.string().c_str(), nullptr, 0, ',', true), "ExportCsv");
+    Unload();
+
+    Check(ImportCsv(csv.string().c_str(), imported.string().c_str(), ',', true) == (long long)rows.size(), "ImportCsv count");
+
+    std::vector<std::string> fields;
+    Table result;
+    if (!Check(Read(imported, fields, result), "read imported file")) return;
+
+    Check(fields == std::vector<std::string>{ "NAME", "AMOUNT", "QTY", "DAY", "FLAG" }, "ImportCsv field names");
+    Check(result == rows, "CSV round trip keeps every value");
+}
+
+static void TestAlter(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "alter.dbf";
+    const auto altered = dir / "alter_out.dbf";
+    const auto rows = MakeTable(source, 2000);
+
+    const DBaseColumnChange changes[] =
+    {
+        DBaseAlter::Change(DBaseChangeKind::Add, "NOTE", 'C', 6, 0, 0),
+        DBaseAlter::Change(DBaseChangeKind::Drop, "FLAG", 0, 0, 0, 0),
+        DBaseAlter::Change(DBaseChangeKind::Resize, "NAME", 'C', 3, 0, 0),
+        DBaseAlter::Change(DBaseChangeKind::Resize, "AMOUNT", 'N', 12, 1, 0),
+        DBaseAlter::Change(DBaseChangeKind::Move, "QTY", 0, 0, 0, -1),
+    };
+
+    Check(AlterSchema(source.string().c_str(), altered.string().c_str(), changes, 5) >= (long long)rows.size(), "AlterSchema");
+
+    std::vector<std::string> fields;
+    Table result;
+    if (!Check(Read(altered, fields, result), "read altered file")) return;
+
+    Check(fields == std::vector<std::string>{ "NOTE", "NAME", "AMOUNT", "DAY", "QTY" }, "AlterSchema field order");
+    if (!Check(result.size() == rows.size(), "AlterSchema keeps the live records")) return;
+
+    auto same = true;
+
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        char amount[32];
+        snprintf(amount, sizeof(amount), "%.1f", std::stod(rows[i][1]));
+
+        same &= result[i][0].empty();
+        same &= result[i][1] == Trim(rows[i][0].substr(0, 3));
+        same &= std::stod(result[i][2]) == std::stod(amount);
+        same &= result[i][3] == rows[i][3];
+        same &= result[i][4] == rows[i][2];
+    }
+
+    Check(same, "AlterSchema values");
+}
+
+static void TestPartition(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "partition.dbf";
+    const auto byKey = dir / "partition_key";
+    const auto byBucket = dir / "partition_bucket";
+    const auto rows = MakeTable(source, 5000);
+
+    std::set<std::string> keys;
+    for (const auto& row : rows) keys.insert(row[0]);
+
+    if (!Check(Load(source.string().c_str()), "load partition source")) return;
+
+    // two open files at most, so partitions are closed and opened again
+    const auto files = PartitionBy(byKey.string().c_str(), "NAME", nullptr, 0, 0, 2);
+    const auto buckets = PartitionBy(byBucket.string().c_str(), "NAME", nullptr, 0, 4, 0);
+    Unload();
+
+    Check(files == (int)keys.size(), "PartitionBy writes a file per key");
+    Check(buckets > 0 && buckets <= 4, "PartitionBy writes a file per used bucket");
+
+    for (const auto& directory : { byKey, byBucket })
+    {
+        Table all;
+        auto single = true;
+
+        for (const auto& entry : std::filesystem::directory_iterator(directory))
+        {
+            const auto part = Read(entry.path());
+            std::set<std::string> partKeys;
+
+            for (const auto& row : part)
+            {
+                partKeys.insert(row[0]);
+                all.push_back(row);
+            }
+
+            single &= directory != byKey || partKeys.size() == 1;
+        }
+
+        Check(single, "PartitionBy puts one key in every file");
+        Check(Bag(all) == Bag(rows), "PartitionBy keeps every record once in " + directory.filename().string());
+    }
+}
+
+/// <summary>
+/// Diff two files, write the patch, apply it to the old file and compare the result with the new one.
+/// </summary>
+static void RoundTrip(const std::filesystem::path& dir, const std::string& name, const std::filesystem::path& old, const std::filesystem::path& current, const char* key, bool ordered) noexcept
+{
+    const auto patch = dir / (name + "_patch.dbf");
+    const auto output = dir / (name + "_out.dbf");
+    const char* keys[] = { key };
+    const auto keyCount = key ? 1 : 0;
+
+    Check(Load(current.string().c_str()) && Diff(old.string().c_str(), keys, keyCount) >= 0, name + ": Diff");
+    Check(SaveDiffPatch(patch.string().c_str()), name + ": SaveDiffPatch");
+    Unload();
+
+    Check(Load(old.string().c_str()) && ApplyPatch(patch.string().c_str(), keys, keyCount, output.string().c_str()) >= 0, name + ": ApplyPatch");
+    Unload();
+
+    const auto expected = Read(current);
+    const auto result = Read(output);
+    Check(ordered ? result == expected : Bag(result) == Bag(expected), name + ": patched file matches the new version");
+}
+
+static void TestDiff(const std::filesystem::path& dir) noexcept
+{
+    const char* names[] = { "K", "V" };
+    const char types[] = { 'C', 'C' };
+    const int lengths[] = { 2, 3 };
+    const int decimals[] = { 0, 0 };
+
+    const auto write = [&](const std::filesystem::path& file, const std::vector<std::pair<const char*, const char*>>& records)
+    {
+        CreateTable(file.string().c_str(), names, types, lengths, decimals, 2);
+
+        for (const auto& [k, v] : records)
+        {
+            AppendRecord();
+            SetRecordText("K", k);
+            SetRecordText("V", v);
+        }
+
+        CloseTable();
+    };
+
+    // rows sharing a key are paired in order, the patch has to hit the same rows
+    const auto old = dir / "diff_dup_old.dbf";
+    const auto current = dir / "diff_dup_new.dbf";
+    write(old, { { "k", "r1" }, { "k", "r2" }, { "k", "r3" } });
+    write(current, { { "k", "n1" }, { "k", "r2" } });
+
+    Check(Load(current.string().c_str()), "load diff_dup_new");
+
+    const char* keys[] = { "K" };
+    long long inserted = 0, deleted = 0, changed = 0;
+    Check(Diff(old.string().c_str(), keys, 1) == 2 && GetDiffCounts(&inserted, &deleted, &changed), "Diff with duplicate keys");
+    Check(inserted == 0 && deleted == 1 && changed == 1, "Diff counts with duplicate keys");
+    Unload();
+
+    RoundTrip(dir, "diff_dup", old, current, "K", true);
+    RoundTrip(dir, "diff_dup_records", old, current, nullptr, false);
+
+    // a bigger file with updates, deletes and inserts
+    const auto bigOld = dir / "diff_old.dbf";
+    const auto kept = dir / "diff_kept.dbf";
+    const auto added = dir / "diff_added.dbf";
+    const auto bigNew = dir / "diff_new.dbf";
+    MakeTable(bigOld, 4000);
+    MakeTable(added, 300, 7);
+
+    // drop every fifth live record and change the amounts of the others
+    Check(Load(bigOld.string().c_str()), "load diff_old");
+    SaveAs(kept.string().c_str(), nullptr, 0, [](int row, void*) { return row % 5 != 0; }, nullptr);
+    Unload();
+
+    Check(Load(kept.string().c_str()), "load diff_kept");
+    AddPercent("AMOUNT", 10.0f);
+    Save(kept.string().c_str());
+    Unload();
+
+    const char* parts[] = { "", "" };
+    const auto keptPath = kept.string();
+    const auto addedPath = added.string();
+    parts[0] = keptPath.c_str();
+    parts[1] = addedPath.c_str();
+    Check(ConcatFiles(parts, 2, bigNew.string().c_str()) > 0, "ConcatFiles for diff_new");
+
+    RoundTrip(dir, "diff", bigOld, bigNew, "NAME", false);
+    RoundTrip(dir, "diff_records", bigOld, bigNew, nullptr, false);
+}
+
+/// <summary>
+/// Check the framing of a file: magic at both ends and a footer length that fits.
+/// </summary>
+static bool Framed(const std::filesystem::path& file, const std::string& magic, size_t headMagic) noexcept
+{
+    std::ifstream stream(file, std::ifstream::in | std::ifstream::binary);
+    const std::vector<char> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    if (data.size() < headMagic + magic.size() + 4) return false;
+
+    int32_t footer;
+    memcpy(&footer, data.data() + data.size() - magic.size() - 4, 4);
+
+    return memcmp(data.data(), magic.data(), magic.size()) == 0
+        && memcmp(data.data() + data.size() - magic.size(), magic.data(), magic.size()) == 0
+        && footer > 0 && (size_t)footer < data.size() - headMagic - magic.size() - 4;
+}
+
+static void TestColumnar(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "columnar.dbf";
+    const auto rows = MakeTable(source, 30000);
+
+    if (!Check(Load(source.string().c_str()), "load columnar source")) return;
+
+    // the CSV is the reference the reader compares the columnar files with
+    Check(ExportCsv((dir / "columnar.csv").string().c_str(), nullptr, 0, ',', true), "ExportCsv for the columnar files");
+    Check(ExportFeather((dir / "columnar.arrow").string().c_str(), nullptr, 0, 4096), "ExportFeather");
+    Check(ExportParquet((dir / "columnar.parquet").string().c_str(), nullptr, 0, 10000), "ExportParquet");
+    Unload();
+
+    Check(Framed(dir / "columnar.arrow", std::string("ARROW1", 6), 8), "Feather file framing");
+    Check(Framed(dir / "columnar.parquet", "PAR1", 4), "Parquet file framing");
+}
+
+static void TestBuilder(const std::filesystem::path& dir) noexcept
+{
+    const auto file = dir / "builder.dbf";
+    const auto rows = MakeTable(file, 500);
+
+    Check(rows.size() == 500 - (500 + 6) / 7, "CreateTable and CloseTable write every record");
+
+    // the header keeps the year as years since 1900
+    const auto now = std::time(nullptr);
+    const auto today = std::localtime(&now);
+    int d = 0, m = 0, y = 0;
+
+    Check(Load(file.string().c_str()) && GetLastChanged(&d, &m, &y), "GetLastChanged");
+    Unload();
+
+    std::ifstream stream(file, std::ifstream::in | std::ifstream::binary);
+    DBase3Header header;
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+    Check((unsigned char)header.LastChanged[0] == today->tm_year, "header year is years since 1900");
+    Check(y == 1900 + today->tm_year && m == today->tm_mon + 1 && d == today->tm_mday, "GetLastChanged returns the date the file was written");
+}
+
+static void TestAsync(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "async.dbf";
+    const auto saved = dir / "async_out.dbf";
+    const auto rows = MakeTable(source, 200000);
+
+    if (!Check(Load(source.string().c_str()), "load async source")) return;
+
+    const auto ok = SaveAsync(saved.string().c_str(), nullptr, nullptr);
+    Check(WaitOperation(ok) == (int)DBaseOperationState::Completed, "SaveAsync completes");
+    ReleaseOperation(ok);
+
+    const auto failed = SaveAsync((dir / "missing" / "async.dbf").string().c_str(), nullptr, nullptr);
+    Check(WaitOperation(failed) == (int)DBaseOperationState::Failed, "SaveAsync fails when the file cannot be written");
+    ReleaseOperation(failed);
+
+    Check(Read(saved) == rows, "SaveAsync writes the loaded file");
+
+    // Unload waits for the running operations, a released one included
+    const auto running = AddPercentAsync("AMOUNT", 10.0f, nullptr, nullptr);
+    const auto released = InsertTextAsync("NAME", 0, "x", nullptr, nullptr);
+    ReleaseOperation(released);
+    Unload();
+
+    long long done = 0, total = 0;
+    const auto state = GetOperationState(running, &done, &total);
+    Check(state == (int)DBaseOperationState::Completed || state == (int)DBaseOperationState::Cancelled, "Unload waits for the operations on the file");
+    ReleaseOperation(running);
+
+    // a file loaded in the background replaces the loaded one once it is taken
+    Check(Load(saved.string().c_str()), "load async_out");
+    const auto pending = AddPercentAsync("AMOUNT", 5.0f, nullptr, nullptr);
+    const auto loading = LoadAsync(source.string().c_str(), nullptr, nullptr);
+
+    Check(WaitOperation(loading) == (int)DBaseOperationState::Completed && TakeLoadedFile(loading), "TakeLoadedFile");
+    Check(GetOperationState(pending, nullptr, nullptr) != (int)DBaseOperationState::Running, "TakeLoadedFile waits for the operations on the replaced file");
+    ReleaseOperation(pending);
+    ReleaseOperation(loading);
+    Unload();
+}
+
+static void TestGroupBy(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "group.dbf";
+    const auto saved = dir / "group_out.dbf";
+    MakeTable(source, 20000);
+    Blank(source, "AMOUNT", 5, 3);
+
+    std::vector<std::string> fields;
+    Table rows;
+    if (!Check(Read(source, fields, rows), "read group source")) return;
+
+    // scalar recomputation keyed by the raw NAME and FLAG bytes, blank amounts are skipped
+    struct Expected { double Sum = 0, Min = 1e300, Max = -1e300, Amounts = 0, Rows = 0, MaxQty = -1e300; };
+    std::map<std::string, Expected> expected;
+
+    for (const auto& row : rows)
+    {
+        auto& group = expected[(row[0] + std::string(8, ' ')).substr(0, 8) + row[4]];
+        ++group.Rows;
+        group.MaxQty = std::max(group.MaxQty, std::stod(row[2]));
+
+        if (row[1].empty()) continue;
+
+        const auto amount = std::stod(row[1]);
+        group.Sum += amount;
+        group.Min = std::min(group.Min, amount);
+        group.Max = std::max(group.Max, amount);
+        ++group.Amounts;
+    }
+
+    const char* keys[] = { "NAME", "FLAG" };
+    const char* cols[] = { "AMOUNT", "AMOUNT", "AMOUNT", "QTY", "AMOUNT", nullptr };
+    const int ops[] = { 0, 1, 4, 2, 3, 3 };
+
+    if (!Check(Load(source.string().c_str()), "load group source")) return;
+
+    const auto groups = GroupBy(keys, 2, cols, ops, 6);
+    Check(groups == (int)expected.size(), "GroupBy group count");
+    Check(GetGroupKeySize() == 9, "GroupBy key size");
+
+    std::vector<char> groupKeys((size_t)std::max(groups, 0) * 9);
+    std::vector<long long> groupRows((size_t)std::max(groups, 0));
+    std::vector<double> values((size_t)std::max(groups, 0) * 6);
+    GetGroupKeys(groupKeys.data());
+    GetGroupRows(groupRows.data());
+    GetGroupValues(values.data());
+
+    const auto close = [](double a, double b) { return std::abs(a - b) <= 1e-6 * std::max(1.0, std::abs(b)); };
+    auto same = groups == (int)expected.size();
+    auto group = 0;
+
+    // groups come ordered by their raw key bytes like the map
+    for (auto it = expected.begin(); same && it != expected.end(); ++it, ++group)
+    {
+        const auto& e = it->second;
+        const auto v = values.data() + group * 6;
+
+        same &= std::string(groupKeys.data() + group * 9, 9) == it->first;
+        same &= groupRows[group] == (long long)e.Rows;
+        same &= close(v[0], e.Sum) && close(v[3], e.MaxQty) && v[4] == e.Amounts && v[5] == e.Rows;
+        same &= e.Amounts ? close(v[1], e.Min) && close(v[2], e.Sum / e.Amounts) : std::isnan(v[1]) && std::isnan(v[2]);
+    }
+
+    Check(same, "GroupBy sum, min, avg, max and count match the recomputation");
+
+    SaveGroups(saved.string().c_str());
+
+    std::vector<std::string> savedFields;
+    Table savedRows;
+    Check(Read(saved, savedFields, savedRows), "read saved groups");
+    Check(savedFields == std::vector<std::string>{ "NAME", "FLAG", "SUM_AMOUNT", "MIN_AMOUNT", "AVG_AMOUNT", "MAX_QTY", "CNT_AMOUNT", "CNT_ROWS" }, "SaveGroups field names");
+
+    same = savedRows.size() == expected.size();
+    group = 0;
+
+    for (auto it = expected.begin(); same && it != expected.end(); ++it, ++group)
+    {
+        const auto& row = savedRows[group];
+        const auto& e = it->second;
+
+        same &= row[0] == Trim(it->first.substr(0, 8)) && row[1] == it->first.substr(8);
+        same &= std::abs(std::stod(row[2]) - e.Sum) < 0.006 && std::stod(row[5]) == e.MaxQty;
+        same &= std::stod(row[6]) == e.Amounts && std::stod(row[7]) == e.Rows;
+        if (e.Amounts) same &= std::abs(std::stod(row[3]) - e.Min) < 0.006 && std::abs(std::stod(row[4]) - e.Sum / e.Amounts) < 0.0001;
+    }
+
+    Check(same, "SaveGroups writes a record per group");
+
+    // a negative key count groups all records together
+    const int count[] = { 3 };
+    Check(GroupBy(keys, -1, cols, count, 1) == 1, "GroupBy without keys");
+
+    double all = 0;
+    GetGroupValues(&all);
+    Check(all == (double)rows.size() - std::count_if(rows.begin(), rows.end(), [](const auto& row) { return row[1].empty(); }), "GroupBy without keys counts every amount");
+
+    const int unknown[] = { 9 };
+    Check(GroupBy(keys, 2, cols, unknown, 1) == -1, "GroupBy rejects an unknown op");
+    Unload();
+}
+
+/// <summary>
+/// Update a target from a source with numeric keys of different sizes and check
+/// every raw field against a recomputation.
+/// </summary>
+static void LookupRoundTrip(const std::filesystem::path& dir, const std::string& name, size_t targetRows, size_t sourceKeys) noexcept
+{
+    const auto target = dir / (name + "_target.dbf");
+    const auto source = dir / (name + "_source.dbf");
+    const auto updated = dir / (name + "_out.dbf");
+
+    {
+        const char* names[] = { "ID", "NAME", "AMOUNT", "DAY", "FLAG" };
+        const char types[] = { 'N', 'C', 'N', 'D', 'L' };
+        const int lengths[] = { 6, 8, 10, 8, 1 };
+        const int decimals[] = { 0, 0, 2, 0, 0 };
+        CreateTable(target.string().c_str(), names, types, lengths, decimals, 5);
+
+        for (size_t i = 0; i < targetRows; ++i)
+        {
+            AppendRecord();
+            SetRecordInt("ID", (long long)(i % 1000));
+            SetRecordText("NAME", "old");
+            SetRecordNumber("AMOUNT", -1.0);
+            SetRecordDate("DAY", 1, 1, 1990);
+            SetRecordLogical("FLAG", false);
+        }
+
+        CloseTable();
+    }
+
+    // every key twice with different values, the first one has to win
+    {
+        const char* names[] = { "KEY", "TEXT", "VAL", "DATE", "OK" };
+        const char types[] = { 'N', 'C', 'N', 'D', 'L' };
+        const int lengths[] = { 4, 5, 7, 8, 1 };
+        const int decimals[] = { 0, 0, 1, 0, 0 };
+        CreateTable(source.string().c_str(), names, types, lengths, decimals, 5);
+
+        for (size_t copy = 0; copy < 2; ++copy)
+        {
+            for (size_t key = 0; key < sourceKeys; ++key)
+            {
+                AppendRecord();
+                SetRecordInt("KEY", (long long)key);
+                SetRecordText("TEXT", ("t" + std::to_string(key * 2 + copy)).c_str());
+                SetRecordNumber("VAL", (double)key * 1.5 + (double)copy);
+                SetRecordDate("DATE", 1 + (int)(key % 28), 1 + (int)copy, 2000 + (int)(key % 20));
+                SetRecordLogical("OK", copy == 0);
+            }
+        }
+
+        CloseTable();
+    }
+
+    // blank keys match nothing on both sides
+    Blank(target, "ID", 11);
+    Blank(source, "KEY", 13);
+
+    std::vector<std::string> targetFields, sourceFields;
+    Table before, lookup;
+    Read(target, targetFields, before, false);
+    Read(source, sourceFields, lookup, false);
+
+    std::map<double, const std::vector<std::string>*> first;
+
+    for (const auto& row : lookup)
+    {
+        if (!Trim(row[0]).empty()) first.emplace(std::stod(row[0]), &row);
+    }
+
+    const auto left = [](const std::string& text, size_t size) { return (text + std::string(size, ' ')).substr(0, size); };
+    const auto right = [](const std::string& text, size_t size) { return std::string(size - std::min(size, text.size()), ' ') + text.substr(0, size); };
+
+    auto expected = before;
+    long long count = 0;
+
+    for (auto& row : expected)
+    {
+        if (Trim(row[0]).empty()) continue;
+
+        const auto match = first.find(std::stod(row[0]));
+        if (match == first.end()) continue;
+
+        const auto& from = *match->second;
+        row[1] = left(from[1], 8);
+        row[2] = right(from[2], 10);
+        row[3] = right(from[3], 8);
+        row[4] = left(from[4], 1);
+        ++count;
+    }
+
+    const char* keys[] = { "ID" };
+    const char* srcKeys[] = { "KEY" };
+    const char* srcCols[] = { "TEXT", "VAL", "DATE", "OK" };
+    const char* dstCols[] = { "NAME", "AMOUNT", "DAY", "FLAG" };
+
+    if (!Check(Load(target.string().c_str()), name + ": load target")) return;
+
+    Check(LookupUpdate(source.string().c_str(), keys, srcKeys, 1, srcCols, dstCols, 4) == count, name + ": LookupUpdate returns the number of updated records");
+    Check(LookupUpdate(source.string().c_str(), keys, srcKeys, -1, srcCols, dstCols, -1) == -1, name + ": LookupUpdate without keys");
+    Save(updated.string().c_str());
+    Unload();
+
+    std::vector<std::string> fields;
+    Table result;
+    Read(updated, fields, result, false);
+
+    Check(count > 0 && result == expected, name + ": LookupUpdate copies the first source record aligned per field type");
+}
+
+static void TestLookup(const std::filesystem::path& dir) noexcept
+{
+    // the smaller side is hashed, so both ways of building the table run
+    LookupRoundTrip(dir, "lookup_source", 3000, 400);
+    LookupRoundTrip(dir, "lookup_target", 3000, 2500);
+}
+
+static void TestStats(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "stats.dbf";
+    const auto sorted = dir / "stats_sorted.dbf";
+    MakeTable(source, 20000);
+    Blank(source, "AMOUNT", 5, 2);
+
+    // sorted amounts give zones that do not overlap, so a range skips blocks
+    const char* cols[] = { "AMOUNT" };
+    Check(Load(source.string().c_str()) && Sort(cols, nullptr, 1), "sort stats source");
+    Save(sorted.string().c_str());
+    Unload();
+
+    const auto rows = Read(sorted);
+    if (!Check(Load(sorted.string().c_str()) && ComputeStats(1000) == 5, "ComputeStats")) return;
+
+    double sum = 0, min = 1e300, max = -1e300;
+    long long count = 0;
+    std::string minName = "~", maxName;
+
+    for (const auto& row : rows)
+    {
+        minName = std::min(minName, row[0]);
+        maxName = std::max(maxName, row[0]);
+        if (row[1].empty()) continue;
+
+        const auto amount = std::stod(row[1]);
+        sum += amount;
+        min = std::min(min, amount);
+        max = std::max(max, amount);
+        ++count;
+    }
+
+    DBaseColumnSummary amount, name;
+    Check(GetColumnStats("AMOUNT", &amount) && GetColumnStats("NAME", &name), "GetColumnStats");
+    Check(amount.Count == count && amount.Blanks == (long long)rows.size() - count, "stats count blanks");
+    Check(std::abs(amount.Sum - sum) < 1e-6 * std::abs(sum) + 1e-6 && amount.Min == min && amount.Max == max, "stats sum, min and max");
+    Check(Trim(name.MinText) == minName && Trim(name.MaxText) == maxName && std::abs(name.Distinct - 10.0) < 1.0, "stats text bounds and distinct values");
+
+    long long blockRows = 0;
+    const auto zoneCount = GetColumnZones("AMOUNT", &blockRows, nullptr);
+    std::vector<DBaseColumnSummary> zones((size_t)std::max(zoneCount, 0));
+    GetColumnZones("AMOUNT", nullptr, zones.data());
+
+    long long zoneRows = 0;
+    for (const auto& zone : zones) zoneRows += zone.Count + zone.Blanks;
+    Check(blockRows == 1000 && zoneCount == (int)((rows.size() + 999) / 1000) && zoneRows == (long long)rows.size(), "GetColumnZones");
+
+    const auto expectRows = [&](auto&& match)
+    {
+        std::vector<long long> found;
+        for (size_t i = 0; i < rows.size(); ++i) if (match(rows[i])) found.push_back((long long)i);
+        return found;
+    };
+
+    const auto numbers = expectRows([](const auto& row) { return !row[1].empty() && std::stod(row[1]) >= -500.0 && std::stod(row[1]) <= 500.0; });
+    const auto texts = expectRows([](const auto& row) { return row[0] >= "Bee" && row[0] <= "Dog"; });
+
+    const auto find = [&rows](const char* col, auto min, auto max)
+    {
+        std::vector<long long> found(rows.size());
+        long long n;
+
+        if constexpr (std::is_same_v<decltype(min), double>) n = FindRows(col, min, max, found.data(), (long long)found.size());
+        else n = FindTextRows(col, min, max, found.data(), (long long)found.size());
+
+        found.resize((size_t)std::max(n, 0LL));
+        return found;
+    };
+
+    ResetStats();
+    Check(find("AMOUNT", -500.0, 500.0) == numbers, "FindRows matches a full scan");
+
+    DBaseRuntimeStats runtime;
+    GetStats(&runtime);
+    Check(!runtime.Enabled || runtime.RowsScanned < (long long)rows.size(), "FindRows skips the zones outside the range");
+    Check(find("NAME", "Bee", "Dog") == texts, "FindTextRows matches a full scan");
+
+    // the sidecar is only used for the file it was written for
+    Check(SaveStats(sorted.string().c_str()), "SaveStats");
+    Check(LoadStats(sorted.string().c_str()), "LoadStats");
+
+    DBaseColumnSummary loaded;
+    Check(GetColumnStats("AMOUNT", &loaded) && loaded.Count == amount.Count && loaded.Sum == amount.Sum && loaded.Min == amount.Min, "LoadStats restores the statistics");
+    Check(find("AMOUNT", -500.0, 500.0) == numbers, "FindRows with loaded statistics");
+    Unload();
+
+    Check(GetColumnZones("AMOUNT", nullptr, nullptr) == -1, "Unload forgets the statistics");
+
+    std::error_code ec;
+    const auto time = std::filesystem::last_write_time(sorted, ec);
+    std::filesystem::last_write_time(sorted, time + std::chrono::seconds(5), ec);
+    Check(!LoadStats(sorted.string().c_str()), "LoadStats rejects a file with another modification time");
+
+    std::filesystem::last_write_time(sorted, time, ec);
+    Check(LoadStats(sorted.string().c_str()), "LoadStats accepts the file again");
+
+    std::ofstream(sorted, std::ofstream::app | std::ofstream::binary).put(0x1A);
+    std::filesystem::last_write_time(sorted, time, ec);
+    Check(!LoadStats(sorted.string().c_str()), "LoadStats rejects a file with another size");
+}
+
+static void TestProfile(const std::filesystem::path& dir) noexcept
+{
+    const auto file = dir / "profile.dbf";
+    const char* heavy[] = { "H0", "H1", "H2", "H3", "H4" };
+    const size_t heavyCounts[] = { 8000, 6000, 5000, 4000, 3000 };
+    constexpr size_t tail = 5000, tailRows = 34000;
+
+    // five heavy hitters and a long tail, shuffled so every part of the file sees all of them
+    std::vector<std::string> values;
+    for (size_t h = 0; h < 5; ++h) values.insert(values.end(), heavyCounts[h], heavy[h]);
+    for (size_t i = 0; i < tailRows; ++i) values.push_back("T" + std::to_string(i % tail));
+
+    uint64_t state = 7;
+    for (auto i = values.size(); i > 1; --i)
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        std::swap(values[i - 1], values[(state >> 33) % i]);
+    }
+
+    {
+        const char* names[] = { "CODE" };
+        const char types[] = { 'C' };
+        const int lengths[] = { 8 };
+        const int decimals[] = { 0 };
+        CreateTable(file.string().c_str(), names, types, lengths, decimals, 1);
+
+        for (const auto& value : values)
+        {
+            AppendRecord();
+            SetRecordText("CODE", value.c_str());
+        }
+
+        CloseTable();
+    }
+
+    constexpr int k = 10;
+    double distinct = 0;
+    std::vector<char> top(k * 8);
+    std::vector<long long> counts(k);
+
+    if (!Check(Load(file.string().c_str()), "load profile source")) return;
+    const auto found = ProfileColumn("CODE", k, &distinct, top.data(), counts.data());
+    Unload();
+
+    // HyperLogLog with 2^12 registers has a standard error of 1.6%, allow three times that
+    const auto exact = 5.0 + (double)tail;
+    Check(std::abs(distinct - exact) <= 0.05 * exact, "ProfileColumn distinct estimate is within the error bound");
+
+    std::map<std::string, long long> reported;
+    for (int i = 0; i < std::max(found, 0); ++i) reported[Trim(std::string_view(top.data() + i * 8, 8))] = counts[i];
+
+    auto heavyFound = found == k;
+
+    for (size_t h = 0; h < 5; ++h)
+    {
+        // count-min estimates never undercount
+        const auto it = reported.find(heavy[h]);
+        heavyFound &= it != reported.end() && it->second >= (long long)heavyCounts[h] && it->second <= (long long)heavyCounts[h] + 600;
+    }
+
+    Check(heavyFound, "ProfileColumn top values hold the heavy hitters");
+
+    // the sketches are merged per thread, split the records over more slots the way the pool does
+    for (const size_t slots : { 1, 2, 3, 8 })
+    {
+        std::vector<DBaseHyperLogLog> sketches(slots);
+        std::vector<DBaseTopK> tops(slots, DBaseTopK(k));
+
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            const auto raw = (values[i] + std::string(8, ' ')).substr(0, 8);
+            const auto hash = DBaseHash::Hash(raw.data(), raw.size());
+            const auto slot = (i / 4096) % slots;
+
+            sketches[slot].Add(hash);
+            tops[slot].Add(raw, hash);
+        }
+
+        for (size_t slot = 1; slot < slots; ++slot)
+        {
+            sketches[0].Merge(sketches[slot]);
+            tops[0].Merge(tops[slot]);
+        }
+
+        std::set<std::string> merged;
+        for (const auto& entry : tops[0].Top()) merged.insert(Trim(entry.Value));
+
+        auto same = sketches[0].Estimate() == distinct;
+        for (const auto value : heavy) same &= merged.count(value) == 1;
+
+        Check(same, "profile of " + std::to_string(slots) + " threads matches ProfileColumn");
+    }
+}
+
+static std::vector<char> Bytes(const std::filesystem::path& file) noexcept
+{
+    std::ifstream stream(file, std::ifstream::in | std::ifstream::binary);
+    return { std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>() };
+}
+
+static void TestWrite(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "write.dbf";
+    const auto reference = dir / "write_reference.dbf";
+    MakeTable(source, 20000);
+
+    if (!Check(Load(source.string().c_str()), "load write source")) return;
+
+    SetWriteOptions(0, false, false, false);
+    Save(reference.string().c_str());
+    const auto expected = Bytes(reference);
+
+    Check(!expected.empty(), "Save with the default options");
+
+    // every combination with chunks much smaller than the file
+    for (int mask = 0; mask < 8; ++mask)
+    {
+        const auto parallel = (mask & 1) != 0, direct = (mask & 2) != 0, preallocate = (mask & 4) != 0;
+        const auto file = dir / ("write_" + std::to_string(mask) + ".dbf");
+        const auto atomic = dir / ("write_atomic_" + std::to_string(mask) + ".dbf");
+
+        SetWriteOptions(5000, parallel, direct, preallocate);
+        Save(file.string().c_str());
+
+        Check(Bytes(file) == expected, "Save bytes with options " + std::to_string(mask));
+        Check(SaveAtomic(atomic.string().c_str()) == (int)DBaseSaveStatus::Ok && Bytes(atomic) == expected, "SaveAtomic bytes with options " + std::to_string(mask));
+    }
+
+    SetWriteOptions(0, false, false, false);
+    Unload();
+
+    // a handle that rejects the writes is replaced by a buffered one
+    const auto retried = dir / "write_retry.dbf";
+    Check(DBaseFile::Write(retried, expected.data(), expected.size()), "write retry file");
+
+    uint64_t size;
+    auto handle = DBaseFile::OpenRead(retried, size);
+    DBaseWriteOptions options;
+    options.ChunkSize = 5000;
+
+    Check(DBaseFile::WriteAllOrBuffered(handle, retried, expected.data(), expected.size(), options, true), "a failed direct write is done again buffered");
+    if (handle != DBaseFile::INVALID) DBaseFile::Close(handle);
+
+    Check(Bytes(retried) == expected, "the buffered retry writes the whole file");
+}
+
+static size_t TempFiles(const std::filesystem::path& directory) noexcept
+{
+    std::error_code ec;
+    size_t count = 0;
+
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec))
+    {
+        count += entry.path().extension() == ".tmp";
+    }
+
+    return count;
+}
+
+static void TestAtomic(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "atomic.dbf";
+    const auto target = dir / "atomic_target.dbf";
+    const auto folder = dir / "atomic_dir";
+    const auto other = dir / "atomic_other";
+    MakeTable(source, 3000);
+
+    std::error_code ec;
+    std::filesystem::create_directories(folder, ec);
+    std::filesystem::create_directories(other, ec);
+
+    // the target is replaced as a whole and keeps its permissions
+    std::ofstream(target, std::ofstream::out | std::ofstream::binary) << "old contents";
+    std::filesystem::permissions(target, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write, ec);
+
+    if (!Check(Load(source.string().c_str()), "load atomic source")) return;
+
+    Check(SaveAtomic(target.string().c_str()) == (int)DBaseSaveStatus::Ok, "SaveAtomic replaces a file");
+    Check(Read(target) == Read(source), "SaveAtomic writes the loaded file");
+    Check((std::filesystem::status(target).permissions() & std::filesystem::perms::all) == (std::filesystem::perms::owner_read | std::filesystem::perms::owner_write), "SaveAtomic keeps the permissions");
+
+    // failures report their step and leave no temp file behind
+    Check(SaveAtomic((dir / "missing" / "atomic.dbf").string().c_str()) == (int)DBaseSaveStatus::OpenFailed, "SaveAtomic into a missing directory");
+    Check(SaveAtomic(folder.string().c_str()) == (int)DBaseSaveStatus::RenameFailed, "SaveAtomic over a directory");
+    Check(std::filesystem::is_directory(folder), "a failed SaveAtomic leaves the target alone");
+
+    // a batch defers the directory syncs to the commit
+    BeginSaveBatch();
+
+    for (int i = 0; i < 3; ++i)
+    {
+        Check(SaveAtomic((folder / ("batch_" + std::to_string(i) + ".dbf")).string().c_str()) == (int)DBaseSaveStatus::Ok, "SaveAtomic in a batch");
+        Check(SaveAtomic((other / ("batch_" + std::to_string(i) + ".dbf")).string().c_str()) == (int)DBaseSaveStatus::Ok, "SaveAtomic in a batch");
+    }
+
+    Check(CommitSaveBatch() == (int)DBaseSaveStatus::Ok, "CommitSaveBatch");
+    Check(CommitSaveBatch() == (int)DBaseSaveStatus::Ok, "CommitSaveBatch without a batch");
+    Unload();
+
+    const auto data = Bytes(source);
+    DBaseSyncBatch batch;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        DBaseFile::WriteAtomic(folder / ("direct_" + std::to_string(i) + ".dbf"), data.data(), data.size(), &batch);
+        DBaseFile::WriteAtomic(other / ("direct_" + std::to_string(i) + ".dbf"), data.data(), data.size(), &batch);
+    }
+
+    Check(batch.Size() == 2, "a batch syncs every directory once");
+    Check(batch.Commit() == DBaseSaveStatus::Ok && batch.Size() == 0, "DBaseSyncBatch::Commit");
+
+#if !defined(_WIN32)
+    batch.Add(dir / "missing");
+    Check(batch.Commit() == DBaseSaveStatus::DirectorySyncFailed, "DBaseSyncBatch::Commit reports a directory it could not sync");
+#endif
+
+    Check(Bytes(folder / "batch_2.dbf") == Bytes(target) && Bytes(other / "direct_2.dbf") == data, "batched saves write the files");
+    Check(TempFiles(dir) + TempFiles(folder) + TempFiles(other) == 0, "no temp files are left");
+}
+
+static void TestRing(const std::filesystem::path& dir) noexcept
+{
+    std::vector<std::filesystem::path> files;
+    std::vector<std::vector<char>> contents;
+
+    for (const size_t rows : { 0, 10, 3000, 40000 })
+    {
+        files.push_back(dir / ("ring_" + std::to_string(rows) + ".dbf"));
+        MakeTable(files.back(), rows, rows + 1);
+        contents.push_back(Bytes(files.back()));
+    }
+
+    files.push_back(dir / "ring_missing.dbf");
+
+    // the same files through io_uring (where the kernel has it) and through pread/pwrite
+    for (const auto ring : { true, false })
+    {
+        const std::string path = ring ? "ring" : "sync";
+
+        DBaseRingOptions options;
+        options.Ring = ring;
+        options.ChunkSize = 64 * 1024;
+
+        const auto loaded = DBaseRingIO::LoadFiles(files, options);
+        auto same = loaded.size() == files.size() && !loaded.back();
+
+        for (size_t i = 0; same && i < contents.size(); ++i)
+        {
+            same &= loaded[i] && loaded[i]->Size == contents[i].size() && memcmp(loaded[i]->Data, contents[i].data(), contents[i].size()) == 0;
+        }
+
+        Check(same, path + ": LoadFiles reads every byte");
+
+        std::vector<const DBase*> dbases(loaded.begin(), loaded.end() - 1);
+        std::vector<std::filesystem::path> outputs;
+        for (size_t i = 0; i < dbases.size(); ++i) outputs.push_back(dir / ("ring_" + path + "_" + std::to_string(i) + ".dbf"));
+
+        const auto statuses = same ? DBaseRingIO::SaveFiles(dbases, outputs, options) : std::vector<DBaseSaveStatus>();
+        same = statuses.size() == outputs.size();
+
+        for (size_t i = 0; same && i < outputs.size(); ++i)
+        {
+            same &= statuses[i] == DBaseSaveStatus::Ok && Bytes(outputs[i]) == contents[i];
+        }
+
+        Check(same, path + ": SaveFiles writes every byte");
+
+        for (const auto dbase : loaded) delete dbase;
+    }
+
+    // the exports use the default options
+    std::vector<std::string> names;
+    for (const auto& file : files) names.push_back(file.string());
+
+    std::vector<const char*> paths;
+    for (const auto& name : names) paths.push_back(name.c_str());
+
+    Check(LoadFiles(paths.data(), (int)paths.size()) == (int)contents.size(), "LoadFiles export");
+    Check(SelectFile(3), "SelectFile after LoadFiles");
+    Save((dir / "ring_selected.dbf").string().c_str());
+    Check(Read(dir / "ring_selected.dbf") == Read(files[3]), "SelectFile makes the batch file the loaded one");
+    Check(!SelectFile(4), "SelectFile of a file that was not loaded");
+
+    std::vector<int> statuses(contents.size(), -1);
+    std::vector<std::string> copies;
+    for (size_t i = 0; i < contents.size(); ++i) copies.push_back((dir / ("ring_export_" + std::to_string(i) + ".dbf")).string());
+
+    std::vector<const char*> copyPaths;
+    for (const auto& copy : copies) copyPaths.push_back(copy.c_str());
+
+    Check(SaveFiles(copyPaths.data(), (int)copyPaths.size(), statuses.data()) == 0, "SaveFiles export");
+    UnloadFiles();
+
+    auto same = true;
+    for (size_t i = 0; i < copies.size(); ++i) same &= statuses[i] == 0 && Bytes(copies[i]) == contents[i];
+    Check(same, "SaveFiles export writes every byte");
+}
+
+static void TestCounters(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "counters.dbf";
+    MakeTable(source, 3000);
+
+    if (!Check(Load(source.string().c_str()), "load counters source")) return;
+
+    DBaseRuntimeStats stats;
+    Check(GetStats(&stats) && stats.Phases == (int)DBasePhase::Count, "GetStats reports every phase");
+
+    ResetStats();
+
+    // one call of every operation on the loaded table, each books its own phase
+    const char* sortCols[] = { "QTY" };
+    const bool descending[] = { false };
+    const char* keys[] = { "NAME" };
+    const char* aggregated[] = { "AMOUNT" };
+    const int ops[] = { 0 };
+
+    SaveAs((dir / "counters_slice.dbf").string().c_str(), nullptr, 0, nullptr, nullptr);
+    PartitionBy((dir / "counters_parts").string().c_str(), "NAME", nullptr, 0, 2, 0);
+    ExportCsv((dir / "counters.csv").string().c_str(), nullptr, 0, ',', true);
+    ExportFeather((dir / "counters.arrow").string().c_str(), nullptr, 0, 1024);
+    Diff(source.string().c_str(), nullptr, 0);
+    FingerprintTable(256);
+    Sort(sortCols, descending, 1);
+    GroupBy(keys, 1, aggregated, ops, 1);
+
+    if (Check(GetStats(&stats), "GetStats after the operations") && stats.Enabled)
+    {
+        auto booked = true;
+        for (const auto phase : { DBasePhase::SaveAs, DBasePhase::Partition, DBasePhase::Csv, DBasePhase::Columnar, DBasePhase::Diff, DBasePhase::Fingerprint, DBasePhase::Sort, DBasePhase::GroupBy })
+        {
+            booked &= stats.PhaseCalls[(size_t)phase] == 1 && stats.PhaseNanoseconds[(size_t)phase] > 0;
+        }
+
+        Check(booked, "every operation is booked once in its phase");
+        Check(stats.PhaseCalls[(size_t)DBasePhase::Save] == 0, "SaveAs and PartitionBy are not booked as Save");
+        Check(stats.RowsScanned > 0 && stats.CellsFormatted > 0 && stats.BytesWritten > 0, "row, cell and byte counters");
+    }
+
+    ResetStats();
+
+    auto zero = GetStats(&stats) && !stats.BytesRead && !stats.BytesWritten && !stats.RowsScanned && !stats.CellsParsed && !stats.CellsFormatted;
+    for (int p = 0; p < stats.Phases; ++p)
+    {
+        zero &= !stats.PhaseCalls[p] && !stats.PhaseNanoseconds[p];
+        for (const auto calls : stats.PhaseHistogram[p]) zero &= !calls;
+    }
+
+    Check(zero, "ResetStats clears every counter");
+    Unload();
+
+    Check(!GetStats(&stats), "GetStats without a loaded table");
+}
+
+static void TestKernels(const std::filesystem::path& dir) noexcept
+{
+    // DBASELIB_ISA lowers the kernels of the library, ctest runs these checks with scalar and sse2 too
+    if (const auto env = getenv("DBASELIB_ISA"))
+    {
+        const std::string isa(env);
+        Check(isa != "scalar" || GetKernelIsa() == (int)DBaseIsa::Scalar, "DBASELIB_ISA=scalar picks the scalar kernels");
+        Check(isa != "sse2" || GetKernelIsa() <= (int)DBaseIsa::SSE2, "DBASELIB_ISA=sse2 picks the sse2 kernels at most");
+    }
+
+    std::vector<uint64_t> values{ 0, 1, 9, 10, 99999999, 100000000, 9999999999999999ull, 10000000000000000ull, UINT64_MAX };
+    uint64_t state = 7;
+
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        values.push_back(state >> (state % 64));
+    }
+
+    for (int isa = 0; isa <= GetKernelIsa(); ++isa)
+    {
+        const auto& kernels = DBaseKernels::Table((DBaseIsa)isa);
+        auto same = (int)kernels.Isa == isa;
+
+        for (const auto value : values)
+        {
+            char digits[20];
+            const auto text = std::to_string(value);
+            const auto length = kernels.FormatDigits(value, digits);
+
+            uint64_t parsed;
+            same &= std::string(digits, length) == text && kernels.ParseDigits(text.data(), text.size(), parsed) == text.size() && parsed == value;
+        }
+
+        Check(same, "FormatDigits and ParseDigits of isa " + std::to_string(isa));
+    }
+
+    // FormatInt goes through the active kernels
+    const auto file = dir / "kernels.dbf";
+    const char* names[] = { "N" };
+    const char types[] = { 'N' };
+    const int lengths[] = { 20 };
+    const int decimals[] = { 0 };
+
+    const long long ints[] = { 0, -1, 42, -9007199254740993ll, 1234567890123456789ll };
+
+    CreateTable(file.string().c_str(), names, types, lengths, decimals, 1);
+
+    for (const auto value : ints)
+    {
+        AppendRecord();
+        SetRecordInt("N", value);
+    }
+
+    CloseTable();
+
+    const auto rows = Read(file);
+    auto same = rows.size() == std::size(ints);
+    for (size_t i = 0; same && i < rows.size(); ++i) same &= rows[i][0] == std::to_string(ints[i]);
+    Check(same, "SetRecordInt formats every integer");
+}
+
+static void TestArrow(const std::filesystem::path& dir) noexcept
+{
+    const char* names[] = { "I", "F", "D", "L", "C" };
+    const char types[] = { 'N', 'N', 'D', 'L', 'C' };
+    const int lengths[] = { 6, 9, 8, 1, 6 };
+    const int decimals[] = { 0, 2, 0, 0, 0 };
+
+    // all digits is not enough for a date, the month and the day have to exist
+    const char* dates[] = { "20240229", "00000000", "20230229", "20231301", "20230431", "", "19700101", "20231231", "19991200", "2023010A", "18991231" };
+    const char* logicals[] = { "T", "F", "?", " ", "y", "n" };
+    const int bits[] = { 1, 0, -1, -1, 1, 0 };
+    const size_t rows = 21;
+
+    const auto contiguous = dir / "arrow.dbf";
+    const auto packed = dir / "arrow_deleted.dbf";
+
+    CreateTable(contiguous.string().c_str(), names, types, lengths, decimals, 5);
+
+    for (size_t i = 0; i < rows; ++i)
+    {
+        AppendRecord();
+
+        if (i % 4 == 0) SetRecordText("I", "");
+        else if (i % 4 == 1) SetRecordText("I", "1x");
+        else SetRecordInt("I", (i % 2 ? -1 : 1) * (long long)i * 1000);
+
+        if (i % 3 == 0) SetRecordText("F", "");
+        else SetRecordNumber("F", 1.25 * (double)i - 10);
+
+        SetRecordText("D", dates[i % std::size(dates)]);
+        SetRecordText("L", logicals[i % std::size(logicals)]);
+        SetRecordText("C", i % 5 == 0 ? "" : ("ab" + std::string(1, (char)('a' + i))).c_str());
+    }
+
+    CloseTable();
+    std::filesystem::copy_file(contiguous, packed, std::filesystem::copy_options::overwrite_existing);
+    Delete(packed, 3);
+
+    const auto bit = [](const void* buffer, size_t i) { return !buffer || ((static_cast<const uint8_t*>(buffer)[i / 8] >> (i % 8)) & 1) != 0; };
+
+    for (const auto& file : { contiguous, packed })
+    {
+        const auto name = file.filename().string();
+        const auto bytes = Bytes(file);
+        const auto header = reinterpret_cast<const DBase3Header*>(bytes.data());
+
+        // the records that are left and their index in the file
+        std::vector<size_t> live;
+        for (size_t i = 0; i < rows; ++i) if (bytes[header->HeaderBytes + i * header->RecordBytes] != '*') live.push_back(i);
+
+        if (!Check(Load(file.string().c_str()), "load " + name)) return;
+
+        ArrowSchema schema;
+        ArrowArray array;
+
+        if (!Check(ExportArrow(nullptr, 0, true, true, &schema, &array), "ExportArrow of " + name))
+        {
+            Unload();
+            continue;
+        }
+
+        auto layout = std::string(schema.format) == "+s" && schema.n_children == 6 && array.n_children == 6 && array.length == (int64_t)live.size();
+        const char* formats[] = { "l", "g", "tdD", "b", "u", nullptr };
+
+        for (int c = 0; layout && c < 5; ++c)
+        {
+            layout &= std::string(schema.children[c]->format) == formats[c] && std::string(schema.children[c]->name) == names[c] && array.children[c]->length == array.length;
+        }
+
+        Check(layout, name + ": struct of the fields and the record view");
+
+        if (layout)
+        {
+            int64_t nulls[5]{};
+            auto same = true;
+
+            for (size_t r = 0; r < live.size(); ++r)
+            {
+                const auto i = live[r];
+                const auto& ints = *array.children[0];
+                const auto& floats = *array.children[1];
+                const auto& days = *array.children[2];
+                const auto& flags = *array.children[3];
+                const auto& text = *array.children[4];
+
+                const auto intValid = i % 4 > 1;
+                same &= bit(ints.buffers[0], r) == intValid && (!intValid || static_cast<const int64_t*>(ints.buffers[1])[r] == (i % 2 ? -1 : 1) * (long long)i * 1000);
+                nulls[0] += !intValid;
+
+                const auto floatValid = i % 3 != 0;
+                same &= bit(floats.buffers[0], r) == floatValid && (!floatValid || static_cast<const double*>(floats.buffers[1])[r] == 1.25 * (double)i - 10);
+                nulls[1] += !floatValid;
+
+                const std::string date = dates[i % std::size(dates)];
+                auto dateValid = date.size() == 8 && std::all_of(date.begin(), date.end(), [](char c) { return c >= '0' && c <= '9'; });
+                int32_t expected = 0;
+
+                if (dateValid)
+                {
+                    const auto value = std::stoi(date);
+                    const std::chrono::year_month_day ymd{ std::chrono::year(value / 10000), std::chrono::month((unsigned)(value / 100 % 100)), std::chrono::day((unsigned)(value % 100)) };
+                    dateValid = ymd.ok();
+                    if (dateValid) expected = (int32_t)std::chrono::sys_days(ymd).time_since_epoch().count();
+                }
+
+                same &= bit(days.buffers[0], r) == dateValid && (!dateValid || static_cast<const int32_t*>(days.buffers[1])[r] == expected);
+                nulls[2] += !dateValid;
+
+                const auto logical = bits[i % std::size(bits)];
+                same &= bit(flags.buffers[0], r) == (logical >= 0) && (logical < 0 || bit(flags.buffers[1], r) == (logical == 1));
+                nulls[3] += logical < 0;
+
+                const auto offsets = static_cast<const int32_t*>(text.buffers[1]);
+                const auto value = std::string(static_cast<const char*>(text.buffers[2]) + offsets[r], (size_t)(offsets[r + 1] - offsets[r]));
+                same &= value == (i % 5 == 0 ? "" : "ab" + std::string(1, (char)('a' + i)));
+            }
+
+            for (int c = 0; c < 5; ++c) same &= array.children[c]->null_count == nulls[c] && (nulls[c] > 0 || !array.children[c]->buffers[0]);
+            Check(same, name + ": values, validity bits and null counts");
+
+            // the record view of the live records, copied only if deleted records are in between
+            const auto& records = *array.children[5];
+            const auto size = (size_t)header->RecordBytes;
+            auto view = std::string(schema.children[5]->format) == "w:" + std::to_string(size) && records.n_buffers == 2 && !records.buffers[0];
+
+            for (size_t r = 0; view && r < live.size(); ++r)
+            {
+                view &= memcmp(static_cast<const char*>(records.buffers[1]) + r * size, bytes.data() + header->HeaderBytes + live[r] * size, size) == 0;
+            }
+
+            const auto copied = !static_cast<const DBaseArrow::ArrayData*>(records.private_data)->Buffers.empty();
+            Check(view && copied == (live.size() < rows), name + (copied ? ": packed record view" : ": record view into the table"));
+        }
+
+        array.release(&array);
+        schema.release(&schema);
+        Check(!array.release && !schema.release, name + ": release callbacks");
+        Unload();
+    }
+
+    if (Load(contiguous.string().c_str()))
+    {
+        ArrowSchema schema;
+        ArrowArray array;
+        const char* cols[] = { "C", "I" };
+
+        Check(ExportArrow(cols, 2, false, false, &schema, &array) && schema.n_children == 2 && std::string(schema.children[0]->format) == "z" && std::string(schema.children[1]->name) == "I", "ExportArrow of chosen fields as binary");
+        if (array.release) array.release(&array);
+        if (schema.release) schema.release(&schema);
+
+        const char* missing[] = { "NOPE" };
+        Check(!ExportArrow(missing, 1, true, false, &schema, &array), "ExportArrow of a missing field");
+        Unload();
+    }
+}
+
+static void TestSlice(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "slice.dbf";
+    const auto output = dir / "slice_out.dbf";
+    MakeTable(source, 2000);
+
+    std::vector<std::string> fields;
+    Table live;
+    if (!Check(Read(source, fields, live, false), "read slice source")) return;
+
+    if (!Check(Load(source.string().c_str()), "load slice source")) return;
+
+    // the rows passed to the predicate count live records only, deleted ones are never offered
+    std::vector<int> calls;
+    const auto keep = [](int row, void* context) { static_cast<std::vector<int>*>(context)->push_back(row); return row % 3 != 0; };
+
+    const char* cols[] = { "FLAG", "NAME", "AMOUNT" };
+    const auto written = SaveAs(output.string().c_str(), cols, 3, keep, &calls);
+
+    std::vector<int> expectedCalls(live.size());
+    for (size_t i = 0; i < live.size(); ++i) expectedCalls[i] = (int)i;
+    Check(calls == expectedCalls, "SaveAs asks the predicate once for every live record in order");
+
+    Table expected;
+    for (size_t i = 0; i < live.size(); ++i)
+    {
+        if (i % 3 != 0) expected.push_back({ live[i][Column(fields, "FLAG")], live[i][Column(fields, "NAME")], live[i][Column(fields, "AMOUNT")] });
+    }
+
+    std::vector<std::string> outputFields;
+    Table outputRows;
+    Check(Read(output, outputFields, outputRows, false) && outputFields == std::vector<std::string>(std::begin(cols), std::end(cols)), "SaveAs writes the fields in the given order");
+    Check(written == (long long)expected.size() && outputRows == expected, "SaveAs writes the matching records with their padding");
+
+    const auto bytes = Bytes(output);
+    const auto header = reinterpret_cast<const DBase3Header*>(bytes.data());
+    auto alive = header->Records == expected.size();
+    for (size_t i = 0; alive && i < header->Records; ++i) alive &= bytes[header->HeaderBytes + i * header->RecordBytes] == ' ';
+    Check(alive, "SaveAs writes no deleted records");
+
+    Check(SaveAs(output.string().c_str(), nullptr, 0, nullptr, nullptr) == (long long)live.size() && Read(output) == Read(source), "SaveAs of every field without a predicate");
+
+    const char* missing[] = { "NAME", "NOPE" };
+    Check(SaveAs((dir / "slice_missing.dbf").string().c_str(), missing, 2, nullptr, nullptr) == -1, "SaveAs of a missing field");
+    Unload();
+}
+
+static void TestUnion(const std::filesystem::path& dir) noexcept
+{
+    // parts without records at the start, in between and at the end
+    std::vector<std::string> names;
+    std::vector<Table> parts;
+
+    for (const size_t rows : { 0, 5, 0, 0, 30, 1, 0 })
+    {
+        names.push_back((dir / ("union_" + std::to_string(names.size()) + ".dbf")).string());
+        parts.push_back(MakeTable(names.back(), rows, names.size()));
+    }
+
+    std::vector<const char*> paths;
+    for (const auto& name : names) paths.push_back(name.c_str());
+
+    Table all;
+    std::vector<std::pair<int, long long>> located;
+
+    for (size_t p = 0; p < parts.size(); ++p)
+    {
+        for (size_t r = 0; r < parts[p].size(); ++r)
+        {
+            all.push_back(parts[p][r]);
+            located.emplace_back((int)p, (long long)r);
+        }
+    }
+
+    if (Check(LoadFiles(paths.data(), (int)paths.size()) == (int)paths.size(), "LoadFiles of the union parts"))
+    {
+        Check(UnionFiles() == (long long)all.size(), "UnionFiles counts the live records of every part");
+
+        auto same = true;
+        for (size_t row = 0; row < located.size(); ++row)
+        {
+            long long fileRow = -1;
+            const auto part = LocateRow((long long)row, &fileRow);
+            same &= part == located[row].first && fileRow == located[row].second;
+        }
+
+        Check(same, "LocateRow skips the parts without records");
+        Check(LocateRow((long long)all.size(), nullptr) == -1 && LocateRow(-1, nullptr) == -1, "LocateRow outside the union");
+    }
+
+    UnloadFiles();
+
+    const auto output = dir / "union_concat.dbf";
+    Check(ConcatFiles(paths.data(), (int)paths.size(), output.string().c_str()) == (long long)all.size() && Read(output) == all, "ConcatFiles appends the live records in order");
+    Check(ConcatFiles(paths.data(), (int)paths.size(), paths[1]) == -1, "ConcatFiles into one of its inputs");
+
+    // the same names with other decimals, and the same fields in another order
+    const char* fields[] = { "NAME", "AMOUNT", "QTY", "DAY", "FLAG" };
+    const char* reordered[] = { "AMOUNT", "NAME", "QTY", "DAY", "FLAG" };
+    const char types[] = { 'C', 'N', 'N', 'D', 'L' };
+    const char reorderedTypes[] = { 'N', 'C', 'N', 'D', 'L' };
+    const int lengths[] = { 8, 10, 5, 8, 1 };
+    const int reorderedLengths[] = { 10, 8, 5, 8, 1 };
+    const int decimals[] = { 0, 3, 0, 0, 0 };
+    const int reorderedDecimals[] = { 2, 0, 0, 0, 0 };
+
+    const auto decimalsFile = (dir / "union_decimals.dbf").string();
+    const auto orderFile = (dir / "union_order.dbf").string();
+
+    CreateTable(decimalsFile.c_str(), fields, types, lengths, decimals, 5);
+    AppendRecord();
+    CloseTable();
+
+    CreateTable(orderFile.c_str(), reordered, reorderedTypes, reorderedLengths, reorderedDecimals, 5);
+    AppendRecord();
+    CloseTable();
+
+    for (const auto& other : { decimalsFile, orderFile })
+    {
+        const auto rejected = dir / "union_rejected.dbf";
+        const char* mixed[] = { paths[1], other.c_str(), paths[4] };
+        std::filesystem::remove(rejected);
+
+        Check(ConcatFiles(mixed, 3, rejected.string().c_str()) == -1 && !std::filesystem::exists(rejected), "ConcatFiles rejects " + std::filesystem::path(other).filename().string() + " before writing");
+
+        Check(LoadFiles(mixed, 3) == 3 && UnionFiles() == -1 && LocateRow(0, nullptr) == -1, "UnionFiles rejects " + std::filesystem::path(other).filename().string());
+        UnloadFiles();
+    }
+}
+
+/// <summary>
+/// Fingerprints computed in order on one thread from the bytes of a file, the
+/// library splits the same work over its pool.
+/// </summary>
+struct Fingerprints
+{
+    std::vector<uint64_t> Blocks;
+    uint64_t Table = 0;
+    std::map<std::string, uint64_t> Columns;
+
+    Fingerprints(const std::filesystem::path& file, size_t blockRows) noexcept
+    {
+        const auto bytes = Bytes(file);
+        const auto header = reinterpret_cast<const DBase3Header*>(bytes.data());
+        const auto region = bytes.data() + header->HeaderBytes;
+        const size_t size = header->RecordBytes;
+        const auto rows = (bytes.size() - header->HeaderBytes) / size;
+
+        for (size_t first = 0; first < rows; first += blockRows)
+        {
+            Blocks.push_back(DBaseHash::Hash(region + first * size, std::min(blockRows, rows - first) * size));
+        }
+
+        Table = DBaseHash::Hash(Blocks.data(), Blocks.size() * sizeof(uint64_t), size);
+
+        std::vector<const char*> live;
+        for (size_t i = 0; i < rows; ++i) if (region[i * size] == ' ') live.push_back(region + i * size);
+
+        DBase3FieldDescriptor descriptor;
+        size_t offset = 1;
+
+        for (auto field = bytes.data() + sizeof(DBase3Header); *field != 0x0D; field += sizeof(descriptor), offset += (unsigned char)descriptor.Lenght)
+        {
+            memcpy(&descriptor, field, sizeof(descriptor));
+            const size_t length = (unsigned char)descriptor.Lenght;
+            std::vector<uint64_t> hashes;
+
+            for (size_t first = 0; first < live.size(); first += blockRows)
+            {
+                std::string values;
+                for (auto i = first; i < std::min(first + blockRows, live.size()); ++i) values.append(live[i] + offset, length);
+                hashes.push_back(DBaseHash::Hash(values.data(), values.size()));
+            }
+
+            Columns[descriptor.Name] = DBaseHash::Hash(hashes.data(), hashes.size() * sizeof(uint64_t), length);
+        }
+    }
+};
+
+static void TestFingerprint(const std::filesystem::path& dir) noexcept
+{
+    const auto source = dir / "fingerprint.dbf";
+    const auto changed = dir / "fingerprint_changed.dbf";
+    const size_t rows = 5000, blockRows = 1000, record = 2500;
+    MakeTable(source, rows);
+
+    // one amount of a live record in the third block
+    std::filesystem::copy_file(source, changed, std::filesystem::copy_options::overwrite_existing);
+    Blank(changed, "AMOUNT", rows, record);
+
+    const char* cols[] = { "NAME", "AMOUNT", "QTY", "DAY", "FLAG" };
+    std::vector<unsigned long long> blocks[2], columns[2];
+    unsigned long long tables[2]{};
+
+    for (const auto& file : { source, changed })
+    {
+        const auto i = file == changed;
+        const auto name = file.filename().string();
+        if (!Check(Load(file.string().c_str()), "load " + name)) return;
+
+        const Fingerprints expected(file, blockRows);
+        blocks[i].resize((size_t)FingerprintBlocks((int)blockRows, nullptr));
+        columns[i].resize(std::size(cols));
+        tables[i] = FingerprintTable((int)blockRows);
+
+        FingerprintBlocks((int)blockRows, blocks[i].data());
+        Check(FingerprintColumns(cols, (int)std::size(cols), (int)blockRows, columns[i].data()), name + ": FingerprintColumns");
+
+        auto same = tables[i] == expected.Table && blocks[i] == std::vector<unsigned long long>(expected.Blocks.begin(), expected.Blocks.end());
+        for (size_t c = 0; c < std::size(cols); ++c) same &= columns[i][c] == expected.Columns.at(cols[c]);
+
+        // the same reference for 1 thread or many, so neither the split nor the thread count shows
+        Check(same, name + ": fingerprints match a sequential computation with " + std::to_string(DBaseParallel::Threads()) + " threads");
+
+        // smaller blocks than the parallel split, several blocks per task
+        const Fingerprints small(file, 7);
+        Check(FingerprintTable(7) == small.Table && (size_t)FingerprintBlocks(7, nullptr) == small.Blocks.size(), name + ": fingerprints of small blocks");
+        Unload();
+    }
+
+    Check(tables[0] != tables[1], "FingerprintTable changes with a value");
+
+    auto others = blocks[0].size() == blocks[1].size();
+    for (size_t b = 0; others && b < blocks[0].size(); ++b) others &= (blocks[0][b] == blocks[1][b]) == (b != record / blockRows);
+    Check(others, "FingerprintBlocks changes for the changed block only");
+
+    auto columnsKept = true;
+    for (size_t c = 0; c < std::size(cols); ++c) columnsKept &= (columns[0][c] == columns[1][c]) == (std::string(cols[c]) != "AMOUNT");
+    Check(columnsKept, "FingerprintColumns changes for the changed column only");
+
+    const char* missing[] = { "NAME", "NOPE" };
+    unsigned long long hashes[2];
+    Check(Load(source.string().c_str()) && !FingerprintColumns(missing, 2, 0, hashes), "FingerprintColumns of a missing column");
+    Unload();
+}
+
+/// <summary>
+/// A named group of checks, every feature adds one.
+/// </summary>
+struct TestCase
+{
+    const char* Name;
+    void (*Run)(const std::filesystem::path& dir) noexcept;
+};
+
+static const TestCase Tests[] =
+{
+    { "sort", TestSort },
+    { "csv", TestCsv },
+    { "alter", TestAlter },
+    { "partition", TestPartition },
+    { "diff", TestDiff },
+    { "columnar", TestColumnar },
+    { "builder", TestBuilder },
+    { "async", TestAsync },
+    { "groupby", TestGroupBy },
+    { "lookup", TestLookup },
+    { "stats", TestStats },
+    { "profile", TestProfile },
+    { "write", TestWrite },
+    { "atomic", TestAtomic },
+    { "ring", TestRing },
+    { "counters", TestCounters },
+    { "kernels", TestKernels },
+    { "arrow", TestArrow },
+    { "slice", TestSlice },
+    { "union", TestUnion },
+    { "fingerprint", TestFingerprint },
+};
+
+static void PrintUsage() noexcept
+{
+    printf("usage: dbasetest [options] [directory]\n");
+    printf("  directory           where the files are written (default dbasetest in the temp directory)\n");
+    printf("  --filter TEXT       only run tests containing TEXT\n");
+    printf("  --list              list the tests\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / "dbasetest";
+    std::string filter;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+
+        if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+        else if (arg == "--list")
+        {
+            for (const auto& test : Tests) printf("%s\n", test.Name);
+            return 0;
+        }
+        else if (arg.rfind("--", 0) == 0)
+        {
+            PrintUsage();
+            return arg == "--help" ? 0 : 1;
+        }
+        else dir = arg;
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    std::filesystem::create_directories(dir, ec);
+
+    for (const auto& test : Tests)
+    {
+        if (!filter.empty() && std::string(test.Name).find(filter) == std::string::npos) continue;
+
+        const auto before = Failures;
+        test.Run(dir);
+        printf("%-12s %s\n", test.Name, Failures == before ? "ok" : "FAILED");
+    }
+
+    if (Failures) fprintf(stderr, "%d checks failed\n", Failures);
+    else printf("all checks passed\n");
+
+    return Failures ? 1 : 0;
+}
@@ -0,0 +1,79 @@
+"""Read the Feather and Parquet files written by dbasetest with pyarrow and
+compare every value with the CSV export of the same file."""
+
+import csv
+import math
+import sys
+from pathlib import Path
+
+import pyarrow.feather
+import pyarrow.parquet
+
+
+def expected(text, arrow_type):
+    if text == "":
+        return None
+    if arrow_type == "int64":
+        return int(text)
+    if arrow_type == "double":
+        return float(text)
+    if arrow_type.startswith("date32"):
+        return text
+    if arrow_type == "bool":
+        return text in ("T", "t", "Y", "y")
+    return text
+
+
+def same(value, reference):
+    if value is None or reference is None:
+        return value is reference
+    if isinstance(reference, float):
+        return math.isclose(value, reference, rel_tol=0, abs_tol=1e-9)
+    if hasattr(value, "isoformat"):
+        return value.isoformat() == reference
+    return value == reference
+
+
+def check(name, table, header, rows):
+    failures = []
+
+    if table.column_names != header:
+        failures.append(f"{name}: columns {table.column_names} instead of {header}")
+    if table.num_rows != len(rows):
+        failures.append(f"{name}: {table.num_rows} rows instead of {len(rows)}")
+
+    if not failures:
+        for index, column in enumerate(header):
+            arrow_type = str(table.schema.field(column).type)
+            values = table.column(column).to_pylist()
+
+            for row, value in enumerate(values):
+                reference = expected(rows[row][index], arrow_type)
+
+                if not same(value, reference):
+                    failures.append(f"{name}: {column} of row {row} is {value!r} instead of {reference!r}")
+                    break
+
+    for failure in failures:
+        print("FAILED:", failure, file=sys.stderr)
+
+    return not failures
+
+
+def main():
+    directory = Path(sys.argv[1])
+
+    with open(directory / "columnar.csv", newline="", encoding="latin-1") as stream:
+        reader = csv.reader(stream)
+        header = next(reader)
+        rows = list(reader)
+
+    ok = check("feather", pyarrow.feather.read_table(directory / "columnar.arrow"), header, rows)
+    ok &= check("parquet", pyarrow.parquet.read_table(directory / "columnar.parquet"), header, rows)
+
+    print("all values match" if ok else "values differ")
+    return 0 if ok else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())